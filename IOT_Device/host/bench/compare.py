@@ -0,0 +1,98 @@
+"""
+Roda o firmware_bench e compara com o baseline guardado (bench/baseline.json).
+
+- allocs/bytes por chamada: exatos (o loop e os caminhos medidos não podem
+  passar a alocar; qualquer aumento falha)
+- tempo de CPU por chamada: falha acima de baseline x fator + 20 ns
+  (fator padrão 2.0; VARAL_BENCH_TIME_FACTOR muda, 0 desliga em máquinas
+  muito diferentes)
+
+Benchmark novo (fora do baseline) só aparece no relatório; benchmark do
+baseline que sumiu falha.
+
+Exemplo:
+    python compare.py _build/firmware_bench baseline.json
+    python compare.py _build/firmware_bench baseline.json --update   # grava o baseline novo
+"""
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+from typing import Dict, List, Optional
+
+COUNTERS = ("allocs", "bytes")
+TIME_SLACK_NS = 20.0  # folga absoluta: benchmarks de poucos ns oscilam mais que 2x
+
+
+def run_bench(binary: str, min_time: float) -> Dict[str, Dict[str, float]]:
+    out = subprocess.run(
+        [binary, "--benchmark_format=json", f"--benchmark_min_time={min_time}",
+         "--benchmark_repetitions=3", "--benchmark_report_aggregates_only=true"],
+        check=True, stdout=subprocess.PIPE, text=True,
+    ).stdout
+    results: Dict[str, Dict[str, float]] = {}
+    for b in json.loads(out)["benchmarks"]:
+        # Mediana das repetições: um soluço da máquina não derruba o teste
+        if b.get("aggregate_name") != "median":
+            continue
+        results[b["run_name"]] = {
+            "cpu_ns": round(b["cpu_time"], 2),
+            "cycles": round(b.get("cycles", 0.0), 1),
+            "allocs": round(b.get("allocs", 0.0), 3),
+            "bytes": round(b.get("bytes", 0.0), 1),
+        }
+    return results
+
+
+def compare(baseline: Dict[str, Dict[str, float]], current: Dict[str, Dict[str, float]],
+            time_factor: float) -> List[str]:
+    failures = []
+    for name, base in baseline.items():
+        now = current.get(name)
+        if now is None:
+            failures.append(f"{name}: sumiu do firmware_bench")
+            continue
+        for key in COUNTERS:
+            if now[key] > base[key]:
+                failures.append(f"{name}: {key} por chamada {base[key]} -> {now[key]}")
+        if time_factor > 0 and now["cpu_ns"] > base["cpu_ns"] * time_factor + TIME_SLACK_NS:
+            failures.append(f"{name}: tempo {base['cpu_ns']} ns -> {now['cpu_ns']} ns (limite {time_factor}x)")
+    return failures
+
+
+def main(argv: Optional[List[str]] = None) -> int:
+    p = argparse.ArgumentParser(description="Compara o firmware_bench com o baseline.")
+    p.add_argument("binary")
+    p.add_argument("baseline")
+    p.add_argument("--update", action="store_true", help="grava o resultado como baseline novo")
+    p.add_argument("--min-time", type=float, default=0.1, help="segundos por benchmark")
+    args = p.parse_args(argv)
+
+    current = run_bench(args.binary, args.min_time)
+    if args.update:
+        with open(args.baseline, "w", encoding="utf-8") as f:
+            json.dump({"benchmarks": current}, f, indent=2, sort_keys=True)
+            f.write("\n")
+        print(f"[BENCH] baseline gravado: {len(current)} benchmarks -> {args.baseline}")
+        return 0
+
+    with open(args.baseline, encoding="utf-8") as f:
+        baseline = json.load(f)["benchmarks"]
+    time_factor = float(os.environ.get("VARAL_BENCH_TIME_FACTOR", "2.0"))
+
+    for name, now in sorted(current.items()):
+        base = baseline.get(name)
+        ref = f"(baseline {base['cpu_ns']} ns, {base['allocs']} allocs)" if base else "(novo)"
+        print(f"[BENCH] {name:<28} {now['cpu_ns']:>10} ns {now['cycles']:>10} cyc "
+              f"{now['allocs']:>6} allocs {now['bytes']:>8} B  {ref}")
+
+    failures = compare(baseline, current, time_factor)
+    for failure in failures:
+        print(f"[BENCH] REGRESSÃO {failure}")
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
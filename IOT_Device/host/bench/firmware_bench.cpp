@@ -0,0 +1,419 @@
+// ==========================================================
+// BENCHMARKS DO FIRMWARE (host, HAL de mentira)
+// ==========================================================
+//
+// Por chamada: tempo (Google Benchmark), "cycles" (rdtsc do PC, não do
+// ESP32: serve para comparar versões, não para prever o tempo no chip),
+// "allocs" e "bytes" (malloc da thread, ver mock/alloc_counter.h).
+//
+// O firmware vive em estáticos: o setup() roda uma vez e todos os
+// benchmarks medem em cima do mesmo varal "ligado".
+
+#include <benchmark/benchmark.h>
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <x86intrin.h>
+#include <string>
+#include <vector>
+
+#include "mock_hal.h"
+#include "alloc_counter.h"
+
+#include "rain_sensor.h"
+#include "sensor.h"
+#include "sensor_registry.h"
+#include "event_bus.h"
+#include "flight_recorder.h"
+#include "stepper_motor.h"
+#include "telemetry.h"
+#include "mqtt_manager.h"
+#include "local_server.h"
+#include "varal_controller.h"
+
+// computeRainLevel é static no rain_sensor.cpp: a cópia fica num namespace
+// próprio (os headers acima já entraram, só o corpo do .cpp é repetido)
+namespace rain_tu {
+#include "rain_sensor.cpp"
+}
+
+void setup();
+void loop();
+
+// ==========================
+// MEDIÇÃO
+// ==========================
+
+static const int ENDSTOP_PIN = 32;  // stepper_motor.cpp
+
+static void bootOnce() {
+  static bool booted = false;
+  if (booted) {
+    return;
+  }
+  mock::reset();
+  mock::setDigitalInput(ENDSTOP_PIN, LOW);  // fim de curso já apertado: homing na hora
+  setup();
+  booted = true;
+}
+
+// Ciclos e alocações somados só nas iterações medidas
+class CallCost {
+public:
+  explicit CallCost(benchmark::State& state) : state(state) {
+    allocs = mock::allocCount();
+    cycles = __rdtsc();
+  }
+
+  ~CallCost() {
+    uint64_t           spent = __rdtsc() - cycles;
+    mock::AllocCount   now   = mock::allocCount();
+    state.counters["cycles"] = benchmark::Counter((double)spent, benchmark::Counter::kAvgIterations);
+    state.counters["allocs"] = benchmark::Counter((double)(now.calls - allocs.calls),
+                                                  benchmark::Counter::kAvgIterations);
+    state.counters["bytes"]  = benchmark::Counter((double)(now.bytes - allocs.bytes),
+                                                  benchmark::Counter::kAvgIterations);
+  }
+
+private:
+  benchmark::State& state;
+  mock::AllocCount  allocs;
+  uint64_t          cycles;
+};
+
+// ==========================
+// FUNÇÕES PURAS
+// ==========================
+
+static void BM_ComputeRainLevel(benchmark::State& state) {
+  int raw = 0;
+  CallCost cost(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(rain_tu::computeRainLevel(raw));
+    raw = (raw + 97) & 4095;  // passa pelas 4 faixas
+  }
+}
+BENCHMARK(BM_ComputeRainLevel);
+
+static void BM_StepperAngleToSteps(benchmark::State& state) {
+  bootOnce();
+  float degrees = 0.0f;
+  CallCost cost(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(stepperAngleToSteps(degrees));
+    degrees = degrees >= 360.0f ? 0.0f : degrees + 7.5f;
+  }
+}
+BENCHMARK(BM_StepperAngleToSteps);
+
+// ==========================
+// MOTOR
+// ==========================
+
+// Um passo (half-step) por iteração: o relógio anda um intervalo e o
+// grupo chama o stepOnce do motor
+static void BM_StepOnce(benchmark::State& state) {
+  StepperMotor motor({ 4, 5, 6, 7, -1, 4096, StepperDrive::HALF_STEP });
+  StepperGroup group;
+  motor.begin();
+  group.add(motor);
+  motor.setSpeed(1000.0f);  // 1 passo a cada 1000 us
+
+  CallCost cost(state);
+  for (auto _ : state) {
+    if (!motor.isMoving()) {
+      motor.moveToSteps((motor.getCurrentSteps() + 2048) % 4096);
+    }
+    mock::advanceMicros(1000);
+    group.loop();
+  }
+  benchmark::DoNotOptimize(motor.getCurrentSteps());
+}
+BENCHMARK(BM_StepOnce);
+
+// Um passo do mestre no movimento coordenado com 1..8 motores (o máximo do
+// StepperGroup): Bresenham dos seguidores e um stepOnce por motor que anda
+static void BM_CoordinatedStep(benchmark::State& state) {
+  const int count = (int)state.range(0);
+  std::vector<StepperMotor> motors;
+  motors.reserve(count);
+  StepperGroup group;
+  for (int i = 0; i < count; i++) {
+    const int pin = 40 + (i % 6) * 4;  // fora dos pinos do firmware; saídas só no mock
+    motors.emplace_back(StepperConfig{ pin, pin + 1, pin + 2, pin + 3, -1, 4096, StepperDrive::HALF_STEP });
+    motors[i].begin();
+    motors[i].setSpeed(1000.0f);
+    group.add(motors[i]);
+  }
+  long targets[StepperGroup::MAX_MOTORS];
+  long leg = 0;
+
+  CallCost cost(state);
+  for (auto _ : state) {
+    if (!motors[0].isMoving()) {
+      // Cada motor com uma distância diferente: todos menos o mestre seguem
+      leg = (leg + 1) % 2;
+      for (int i = 0; i < count; i++) {
+        targets[i] = leg ? 2048 - i * 200 : 0;
+      }
+      group.moveCoordinated(targets, count);
+    }
+    mock::advanceMicros(1000);
+    group.loop();
+  }
+  benchmark::DoNotOptimize(motors[0].getCurrentSteps());
+}
+BENCHMARK(BM_CoordinatedStep)->DenseRange(1, StepperGroup::MAX_MOTORS);
+
+// ==========================
+// SENSORES (sensor.h)
+// ==========================
+
+// Uma amostra na janela: soma, filas monotônicas de mín/máx. Valores
+// pseudoaleatórios (as filas sobem e descem como numa leitura real)
+template <size_t N>
+static void BM_WindowStatsPush(benchmark::State& state) {
+  WindowStats<N> stats;
+  uint32_t x = 0x12345678u;
+  CallCost cost(state);
+  for (auto _ : state) {
+    x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+    stats.push((float)(x & 1023));
+  }
+  benchmark::DoNotOptimize(stats.mean());
+}
+BENCHMARK_TEMPLATE(BM_WindowStatsPush, 8);
+BENCHMARK_TEMPLATE(BM_WindowStatsPush, 32);
+BENCHMARK_TEMPLATE(BM_WindowStatsPush, 128);
+
+// Sensor de 2 canais sem hardware: mede só o framework (read/onSample via
+// CRTP, anel de amostras e estatísticas dos canais)
+struct BenchReading {
+  float a;
+  float b;
+};
+
+class BenchSensor : public Sensor<BenchSensor, BenchReading, 32, 2> {
+public:
+  BenchSensor() : Sensor("bench", CHANNELS, 0) {}
+
+  bool read(BenchReading& out) {
+    next += 0.5f;
+    out = { next, 100.0f - next };
+    return true;
+  }
+
+  static float channelValue(const BenchReading& r, int channel) { return channel == 0 ? r.a : r.b; }
+
+  void onSample(const BenchReading& r) { last = r.a; }
+
+  float last = 0.0f;
+
+private:
+  static const char* const CHANNELS[2];
+  float next = 0.0f;
+};
+const char* const BenchSensor::CHANNELS[2] = { "a", "b" };
+
+static void BM_SensorSample(benchmark::State& state) {
+  static BenchSensor sensor;
+  unsigned long now = 0;
+  CallCost cost(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(sensor.sampleNow(++now));
+  }
+  benchmark::DoNotOptimize(sensor.last);
+}
+BENCHMARK(BM_SensorSample);
+
+// O que a telemetria faz por heartbeat: todos os canais do registro
+// (último, mín, máx, média) pela interface virtual SensorView
+static void BM_SensorRegistryRead(benchmark::State& state) {
+  bootOnce();
+  CallCost cost(state);
+  for (auto _ : state) {
+    float acc = 0.0f;
+    for (int i = 0; i < sensorRegistryCount(); i++) {
+      SensorView* s = sensorRegistryGet(i);
+      for (int c = 0; c < s->channelCount(); c++) {
+        acc += s->channelLast(c) + s->channelMin(c) + s->channelMax(c) + s->channelMean(c);
+      }
+    }
+    benchmark::DoNotOptimize(acc);
+  }
+}
+BENCHMARK(BM_SensorRegistryRead);
+
+// ==========================
+// MQTT / TELEMETRIA
+// ==========================
+
+static void BM_HeartbeatBuild(benchmark::State& state) {
+  bootOnce();
+  static char out[1024];
+  CallCost cost(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(telemetryBuildHeartbeat(out, sizeof(out)));
+  }
+}
+BENCHMARK(BM_HeartbeatBuild);
+
+// Comando como chega do broker: normaliza, aplica o modo e entrega o
+// evento ao controlador (que decide e manda o motor)
+static void BM_CommandParse(benchmark::State& state) {
+  bootOnce();
+  static const char* const RAW[] = { "  open\r\n", "Close ", "auto" };
+  char cmd[16];
+  int  next = 0;
+  CallCost cost(state);
+  for (auto _ : state) {
+    strcpy(cmd, RAW[next]);
+    next = (next + 1) % 3;
+    benchmark::DoNotOptimize(varalControllerHandleCommand(mqttNormalizeCommand(cmd)));
+    eventBusDispatch();
+  }
+}
+BENCHMARK(BM_CommandParse);
+
+// ==========================
+// LOOP INTEIRO
+// ==========================
+
+// loop() com o relógio andando 1 ms por volta: entram as leituras de
+// sensor, heartbeats, decisões e gravações da caixa-preta na proporção real
+static void BM_Loop(benchmark::State& state) {
+  bootOnce();
+  CallCost cost(state);
+  for (auto _ : state) {
+    mock::advanceMillis(1);
+    loop();
+  }
+}
+BENCHMARK(BM_Loop);
+
+// ==========================
+// COMANDO: LOCAL x NUVEM
+// ==========================
+//
+// Do comando chegar ao varal até a resposta sair dele, pelo firmware
+// inteiro (voltas do loop(), 1 ms cada): a rede fica de fora (os
+// transportes do mock entregam na hora), sobra o que o varal gasta.
+// "loops" = voltas do loop() por comando. Alterna OPEN/CLOSE: o motor
+// anda o tempo todo, nos dois caminhos igual.
+
+static const char* const BENCH_COMMANDS[] = { "OPEN", "CLOSE" };
+
+// Volta o varal para AUTO parado (os benchmarks seguintes medem em AUTO)
+static void settleAuto() {
+  varalControllerHandleCommand("AUTO");
+  for (int i = 0; i < 120'000 && (i < 10 || stepperIsMoving()); i++) {
+    mock::advanceMillis(1);
+    loop();
+  }
+}
+
+// WebSocket local: quadro de texto -> {"type":"ack"} no mesmo WebSocket
+static void BM_LocalCommandAck(benchmark::State& state) {
+  bootOnce();
+  mock::advanceMillis(1);
+  loop();  // o servidor local sobe na primeira volta com Wi-Fi
+  std::string url    = std::string("/ws?token=") + LOCAL_SERVER_TOKEN;
+  int         client = mock::wsConnect(url.c_str());
+  if (client < 0) {
+    state.SkipWithError("servidor local não subiu");
+    return;
+  }
+  std::string msg;
+  std::string expected[2];
+  for (int i = 0; i < 2; i++) {
+    expected[i] = std::string("\"command\":\"") + BENCH_COMMANDS[i] + "\"";
+  }
+  int      next  = 0;
+  uint64_t loops = 0;
+  auto     roundTrip = [&] {
+    while (mock::wsReceive(client, &msg)) {}  // heartbeats do comando anterior
+    mock::wsSend(client, BENCH_COMMANDS[next]);
+    bool acked = false;
+    while (!acked) {
+      mock::advanceMillis(1);
+      loop();
+      loops++;
+      while (!acked && mock::wsReceive(client, &msg)) {
+        acked = msg.find("\"type\":\"ack\"") != std::string::npos && msg.find(expected[next]) != std::string::npos;
+      }
+    }
+    next ^= 1;
+  };
+  // Aquece a fila circular do WebSocket do mock (cada posição cresce uma vez só)
+  for (int i = 0; i < 4 * (int)WS_MAX_QUEUED_MESSAGES; i++) {
+    roundTrip();
+  }
+  loops = 0;
+  {
+    CallCost cost(state);
+    for (auto _ : state) {
+      roundTrip();
+    }
+  }
+  state.counters["loops"] = benchmark::Counter((double)loops, benchmark::Counter::kAvgIterations);
+  mock::wsClose(client);
+  settleAuto();
+}
+BENCHMARK(BM_LocalCommandAck);
+
+// Nuvem: casa/<id>/cmd -> heartbeat com o modo novo saindo para o broker
+// (o backend confirma cada mensagem da fila, como no loop_alloc_test)
+struct CloudProbe {
+  char        ackTopic[64];
+  char        heartbeatTopic[64];
+  const char* expectedMode;
+  bool        seen;
+};
+
+static void cloudHook(const char* topic, const uint8_t* payload, size_t length, bool retained, void* context) {
+  (void)retained;
+  CloudProbe* probe = (CloudProbe*)context;
+  unsigned    seq   = 0;
+  if (length > 7 && sscanf((const char*)payload, "{\"seq\":%u", &seq) == 1) {
+    char ack[16];
+    snprintf(ack, sizeof(ack), "%u", seq);
+    mock::mqttInject(probe->ackTopic, ack);
+  }
+  if (strcmp(topic, probe->heartbeatTopic) == 0 &&
+      memmem(payload, length, probe->expectedMode, strlen(probe->expectedMode)) != nullptr) {
+    probe->seen = true;
+  }
+}
+
+static void BM_MqttCommandHeartbeat(benchmark::State& state) {
+  bootOnce();
+  static const char* const MODES[] = { "\"mode\":\"FORCE_OPEN\"", "\"mode\":\"FORCE_CLOSE\"" };
+  CloudProbe probe = {};
+  char       cmdTopic[64];
+  snprintf(probe.ackTopic, sizeof(probe.ackTopic), "casa/%s/ack", mqttGetDeviceId());
+  snprintf(probe.heartbeatTopic, sizeof(probe.heartbeatTopic), "casa/%s/heartbeat", mqttGetDeviceId());
+  snprintf(cmdTopic, sizeof(cmdTopic), "casa/%s/cmd", mqttGetDeviceId());
+  mock::onMqttPublish(cloudHook, &probe);
+
+  int      next  = 0;
+  uint64_t loops = 0;
+  {
+    CallCost cost(state);
+    for (auto _ : state) {
+      probe.expectedMode = MODES[next];
+      probe.seen         = false;
+      mock::mqttInject(cmdTopic, BENCH_COMMANDS[next]);
+      while (!probe.seen) {
+        mock::advanceMillis(1);
+        loop();
+        loops++;
+      }
+      next ^= 1;
+    }
+  }
+  state.counters["loops"] = benchmark::Counter((double)loops, benchmark::Counter::kAvgIterations);
+  settleAuto();
+  mock::onMqttPublish(nullptr, nullptr);
+}
+BENCHMARK(BM_MqttCommandHeartbeat);
+
+BENCHMARK_MAIN();
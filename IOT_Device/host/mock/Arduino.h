@@ -0,0 +1,92 @@
+#pragma once
+// ==========================================================
+// Arduino (ESP32) para o host: só o que o firmware usa.
+// O estado (relógio, pinos, ...) fica no mock_hal.cpp e é controlado
+// pelos testes via mock_hal.h.
+// ==========================================================
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+
+#include "freertos/FreeRTOS.h"
+#include "WString.h"
+
+typedef uint8_t byte;
+
+#define LOW          0
+#define HIGH         1
+#define INPUT        0x01
+#define OUTPUT       0x03
+#define INPUT_PULLUP 0x05
+
+#define PROGMEM
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+using std::min;
+using std::max;
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t level);
+int  digitalRead(uint8_t pin);
+uint16_t analogRead(uint8_t pin);
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+// ---------- Serial ----------
+class Print {
+public:
+  void begin(unsigned long baud) { (void)baud; }
+
+  size_t write(const uint8_t* data, size_t len);
+  size_t write(uint8_t c) { return write(&c, 1); }
+
+  size_t print(const char* s)    { return write((const uint8_t*)s, strlen(s)); }
+  size_t print(char c)           { return write((uint8_t)c); }
+  size_t print(int v)            { return printNumber("%d", v); }
+  size_t print(unsigned v)       { return printNumber("%u", v); }
+  size_t print(long v)           { return printNumber("%ld", v); }
+  size_t print(unsigned long v)  { return printNumber("%lu", v); }
+  size_t print(double v, int digits = 2);
+
+  size_t println()                          { return print("\r\n"); }
+  template <typename T> size_t println(T v) { size_t n = print(v); return n + println(); }
+  size_t println(double v, int digits)      { size_t n = print(v, digits); return n + println(); }
+
+  size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+
+private:
+  template <typename T> size_t printNumber(const char* fmt, T v) {
+    char buf[24];
+    int n = snprintf(buf, sizeof(buf), fmt, v);
+    return write((const uint8_t*)buf, (size_t)n);
+  }
+};
+
+extern Print Serial;
+
+// ---------- ESP ----------
+class EspClass {
+public:
+  uint64_t getEfuseMac();
+  uint32_t getFreeHeap();
+  uint32_t getMinFreeHeap();
+  uint32_t getMaxAllocHeap();
+  uint32_t getCycleCount();
+  uint32_t getCpuFreqMHz();
+  void     restart();
+};
+
+extern EspClass ESP;
+
+uint32_t esp_random();
+void configTime(long gmtOffsetSec, int daylightOffsetSec, const char* server1,
+                const char* server2 = nullptr, const char* server3 = nullptr);
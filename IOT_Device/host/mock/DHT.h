@@ -0,0 +1,19 @@
+#pragma once
+#include "Arduino.h"
+
+#define DHT11 11
+#define DHT22 22
+
+// Leituras vêm de mock::setDht (NAN = sensor não respondeu)
+class DHT {
+public:
+  DHT(uint8_t pin, uint8_t type) : pin(pin), type(type) {}
+
+  void  begin() {}
+  float readHumidity();
+  float readTemperature();
+
+private:
+  uint8_t pin;
+  uint8_t type;
+};
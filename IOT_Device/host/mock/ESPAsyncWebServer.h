@@ -0,0 +1,209 @@
+#pragma once
+#include "Arduino.h"
+#include <string>
+#include <vector>
+
+// Mesma interface do ESPAsyncWebServer (só o que o local_server usa). Sem
+// rede: mock::localRequest / mock::wsConnect / mock::wsSend chamam os
+// handlers do firmware direto, na thread de quem chama (no ESP32 seria a
+// task do AsyncTCP), e o que o servidor manda fica numa fila circular por
+// cliente (mock::wsReceive), que não aloca depois de aquecida. Requisições
+// alocam (String), como na biblioteca.
+
+typedef enum {
+  HTTP_GET     = 0b00000001,
+  HTTP_POST    = 0b00000010,
+  HTTP_DELETE  = 0b00000100,
+  HTTP_PUT     = 0b00001000,
+  HTTP_PATCH   = 0b00010000,
+  HTTP_HEAD    = 0b00100000,
+  HTTP_OPTIONS = 0b01000000,
+  HTTP_ANY     = 0b01111111,
+} WebRequestMethod;
+typedef uint8_t WebRequestMethodComposite;
+
+typedef enum { WS_EVT_CONNECT, WS_EVT_DISCONNECT, WS_EVT_PONG, WS_EVT_ERROR, WS_EVT_DATA } AwsEventType;
+typedef enum { WS_CONTINUATION, WS_TEXT, WS_BINARY, WS_DISCONNECT = 0x08, WS_PING, WS_PONG } AwsFrameType;
+
+typedef struct {
+  uint8_t  message_opcode;
+  uint32_t num;
+  uint8_t  final;
+  uint8_t  masked;
+  uint8_t  opcode;
+  uint64_t len;
+  uint8_t  mask[4];
+  uint64_t index;
+} AwsFrameInfo;
+
+static const size_t WS_MAX_QUEUED_MESSAGES = 32;
+
+class AsyncWebServerRequest;
+class AsyncWebSocket;
+class AsyncWebSocketClient;
+
+typedef void (*ArRequestHandlerFunction)(AsyncWebServerRequest* request);
+typedef bool (*ArRequestFilterFunction)(AsyncWebServerRequest* request);
+typedef void (*AwsEventHandler)(AsyncWebSocket* server, AsyncWebSocketClient* client, AwsEventType type,
+                                void* arg, uint8_t* data, size_t len);
+
+// ==========================
+// REQUISIÇÃO
+// ==========================
+
+class AsyncWebHeader {
+public:
+  AsyncWebHeader(const char* name, const char* value) : headerName(name), headerValue(value) {}
+  const String& name() const { return headerName; }
+  const String& value() const { return headerValue; }
+
+private:
+  String headerName;
+  String headerValue;
+};
+
+class AsyncWebParameter {
+public:
+  AsyncWebParameter(const char* name, const char* value) : paramName(name), paramValue(value) {}
+  const String& name() const { return paramName; }
+  const String& value() const { return paramValue; }
+
+private:
+  String paramName;
+  String paramValue;
+};
+
+class AsyncWebServerRequest {
+public:
+  // url = caminho + query ("/cmd?command=OPEN&token=..."); authorization
+  // = valor do cabeçalho (nullptr = sem cabeçalho)
+  AsyncWebServerRequest(WebRequestMethod method, const char* url, const char* authorization);
+
+  WebRequestMethod method() const { return requestMethod; }
+  const char*      path() const { return requestPath.c_str(); }
+
+  bool               hasHeader(const char* name) const;
+  AsyncWebHeader*    getHeader(const char* name);
+  bool               hasParam(const char* name) const;
+  AsyncWebParameter* getParam(const char* name);
+
+  void send(int code, const String& contentType = String(), const String& content = String());
+
+  // Resposta (mock): -1 = handler não respondeu
+  int         responseCode() const { return code; }
+  const char* responseBody() const { return body.c_str(); }
+
+private:
+  WebRequestMethod               requestMethod;
+  std::string                    requestPath;
+  std::vector<AsyncWebHeader>    headers;
+  std::vector<AsyncWebParameter> params;
+  int                            code = -1;
+  std::string                    body;
+};
+
+// ==========================
+// HANDLERS
+// ==========================
+
+class AsyncWebHandler {
+public:
+  virtual ~AsyncWebHandler() = default;
+
+  AsyncWebHandler& setFilter(ArRequestFilterFunction fn) {
+    filterFn = fn;
+    return *this;
+  }
+  bool filter(AsyncWebServerRequest* request) { return filterFn == nullptr || filterFn(request); }
+
+private:
+  ArRequestFilterFunction filterFn = nullptr;
+};
+
+class AsyncCallbackWebHandler : public AsyncWebHandler {
+public:
+  const char*               uri      = nullptr;
+  WebRequestMethodComposite method   = 0;
+  ArRequestHandlerFunction  callback = nullptr;
+};
+
+// ==========================
+// WEBSOCKET
+// ==========================
+
+class AsyncWebSocketClient {
+public:
+  uint32_t id() const { return clientId; }
+  bool     canSend() const { return queued < WS_MAX_QUEUED_MESSAGES; }
+  void     text(const char* message, size_t len);
+  void     close();
+
+  bool take(std::string* message);  // lado do mock: próxima mensagem do servidor
+
+private:
+  friend class AsyncWebSocket;
+
+  uint32_t        clientId = 0;
+  bool            open     = false;  // conectado (fechado: sai no cleanupClients)
+  bool            used     = false;
+  // Mensagens do servidor ainda não lidas: fila circular com o limite da
+  // biblioteca; cada posição reaproveita a memória da mensagem anterior
+  std::string     outbox[WS_MAX_QUEUED_MESSAGES];
+  size_t          head     = 0;
+  size_t          queued   = 0;
+  AsyncWebSocket* server   = nullptr;
+};
+
+class AsyncWebSocket : public AsyncWebHandler {
+public:
+  static const int CLIENT_SLOTS = 8;
+
+  explicit AsyncWebSocket(const char* url) : wsUrl(url) {}
+
+  const char* url() const { return wsUrl; }
+  void        onEvent(AwsEventHandler handler) { eventHandler = handler; }
+
+  size_t count() const;
+  bool   availableForWriteAll();
+  void   textAll(const char* message, size_t len);
+  void   cleanupClients(uint16_t maxClients = CLIENT_SLOTS);
+
+  // Lado do mock (mock::wsConnect/wsSend/wsReceive/wsClose)
+  AsyncWebSocketClient* connectClient(AsyncWebServerRequest* request);
+  AsyncWebSocketClient* client(int slot);
+  void                  receive(AsyncWebSocketClient* client, const char* text);
+  void                  disconnect(AsyncWebSocketClient* client);
+
+private:
+  const char*          wsUrl;
+  AwsEventHandler      eventHandler = nullptr;
+  AsyncWebSocketClient clients[CLIENT_SLOTS];
+  uint32_t             nextId = 1;
+};
+
+// ==========================
+// SERVIDOR
+// ==========================
+
+class AsyncWebServer {
+public:
+  static const int HANDLER_SLOTS = 8;
+
+  explicit AsyncWebServer(uint16_t port) : port(port) {}
+
+  void                     begin();
+  void                     end();
+  AsyncWebHandler&         addHandler(AsyncWebHandler* handler);
+  AsyncCallbackWebHandler& on(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest);
+
+  // Lado do mock: entrega ao handler da rota (404 sem rota / filtro recusou)
+  void            handle(AsyncWebServerRequest* request);
+  AsyncWebSocket* webSocket(const char* path);
+
+private:
+  uint16_t                port;
+  AsyncWebHandler*        handlers[HANDLER_SLOTS] = {};
+  int                     handlerCount            = 0;
+  AsyncCallbackWebHandler routes[HANDLER_SLOTS];
+  int                     routeCount = 0;
+};
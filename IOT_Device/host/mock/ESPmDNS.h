@@ -0,0 +1,13 @@
+#pragma once
+#include "Arduino.h"
+
+// mDNS sem rede: guarda o nome (mock::mdnsHostname) e aceita os serviços
+class MDNSResponder {
+public:
+  bool begin(const char* hostName);
+  void end();
+  bool addService(const char* service, const char* proto, uint16_t port);
+  bool addServiceTxt(const char* name, const char* proto, const char* key, const char* value);
+};
+
+extern MDNSResponder MDNS;
@@ -0,0 +1,20 @@
+#pragma once
+#include "WiFiClient.h"
+
+#define HTTP_CODE_OK              200
+#define HTTP_CODE_PARTIAL_CONTENT 206
+
+// GET com Range servido por mock::httpServe (ver mock_hal.h)
+class HTTPClient {
+public:
+  bool        begin(WiFiClient& client, const char* url);
+  void        end();
+  void        setTimeout(uint16_t timeoutMs);
+  void        addHeader(const char* name, const char* value, bool first = false, bool replace = true);
+  int         GET();
+  WiFiClient* getStreamPtr();
+
+private:
+  WiFiClient* client      = nullptr;
+  size_t      rangeFrom   = 0;
+};
@@ -0,0 +1,18 @@
+#pragma once
+#include "Arduino.h"
+
+// NVS em memória (sobrevive entre instâncias, não entre processos)
+class Preferences {
+public:
+  bool   begin(const char* name, bool readOnly = false);
+  void   end();
+  size_t getBytesLength(const char* key);
+  size_t getBytes(const char* key, void* buf, size_t maxLen);
+  size_t putBytes(const char* key, const void* value, size_t len);
+  bool   remove(const char* key);
+
+private:
+  char space[16] = {};
+  bool open      = false;
+  bool readOnly  = false;
+};
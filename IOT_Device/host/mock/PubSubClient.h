@@ -0,0 +1,50 @@
+#pragma once
+#include "Arduino.h"
+#include "WiFiClient.h"
+
+#define MQTT_CONNECTION_TIMEOUT     -4
+#define MQTT_CONNECTION_LOST        -3
+#define MQTT_CONNECT_FAILED         -2
+#define MQTT_DISCONNECTED           -1
+#define MQTT_CONNECTED               0
+
+typedef void (*MqttCallback)(char* topic, uint8_t* payload, unsigned int length);
+
+// Mesma interface do PubSubClient (QoS0 na publicação). Sem rede: as
+// publicações vão para o gancho de mock::onMqttPublish e as mensagens de
+// mock::mqttInject chegam no callback, uma por loop(), pelo buffer
+// interno (payload sem '\0', como no original). Com mock::setMqttBroker,
+// o mesmo por TCP num broker de verdade (mqtt_socket.h).
+class PubSubClient {
+public:
+  explicit PubSubClient(WiFiClient& client) { (void)client; }
+  ~PubSubClient();
+
+  PubSubClient& setServer(const char* domain, uint16_t port);
+  PubSubClient& setCallback(MqttCallback callback);
+  bool          setBufferSize(uint16_t size);
+  uint16_t      getBufferSize() const { return bufferSize; }
+
+  bool connect(const char* id);
+  void disconnect();
+  bool connected();
+  int  state() const { return currentState; }
+  bool loop();
+
+  bool subscribe(const char* topic, uint8_t qos = 0);
+  bool unsubscribe(const char* topic);
+
+  bool publish(const char* topic, const char* payload);
+  bool publish(const char* topic, const char* payload, bool retained);
+  bool publish(const char* topic, const uint8_t* payload, unsigned int length);
+  bool publish(const char* topic, const uint8_t* payload, unsigned int length, bool retained);
+
+private:
+  bool deliver(const char* topic, const uint8_t* payload, size_t length);
+
+  MqttCallback callback     = nullptr;
+  uint8_t*     buffer       = nullptr;
+  uint16_t     bufferSize   = 0;
+  int          currentState = MQTT_DISCONNECTED;
+  uint32_t     session      = 0;  // conexão do mock em que este cliente entrou
+};
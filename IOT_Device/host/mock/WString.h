@@ -0,0 +1,21 @@
+#pragma once
+#include <string>
+#include <string.h>
+
+// String do Arduino: só o que os handlers do servidor local usam. O
+// firmware não usa String no loop (aloca); aqui ela só aparece nas
+// requisições do ESPAsyncWebServer do mock.
+class String {
+public:
+  String(const char* text = "") : value(text != nullptr ? text : "") {}
+  String(const char* text, size_t length) : value(text, length) {}
+
+  const char*  c_str() const { return value.c_str(); }
+  unsigned int length() const { return (unsigned int)value.size(); }
+  bool         startsWith(const char* prefix) const { return value.compare(0, strlen(prefix), prefix) == 0; }
+  bool         equals(const char* text) const { return value == text; }
+  bool         operator==(const char* text) const { return value == text; }
+
+private:
+  std::string value;
+};
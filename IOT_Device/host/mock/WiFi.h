@@ -0,0 +1,35 @@
+#pragma once
+#include "Arduino.h"
+
+typedef enum {
+  WL_IDLE_STATUS     = 0,
+  WL_NO_SSID_AVAIL   = 1,
+  WL_SCAN_COMPLETED  = 2,
+  WL_CONNECTED       = 3,
+  WL_CONNECT_FAILED  = 4,
+  WL_CONNECTION_LOST = 5,
+  WL_DISCONNECTED    = 6
+} wl_status_t;
+
+typedef enum { WIFI_OFF, WIFI_STA, WIFI_AP, WIFI_AP_STA } wifi_mode_t;
+
+class IPAddress {
+public:
+  IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) : bytes{a, b, c, d} {}
+  uint8_t operator[](int index) const { return bytes[index]; }
+
+private:
+  uint8_t bytes[4];
+};
+
+// Conectado ou não conforme mock::setWifiConnected
+class WiFiClass {
+public:
+  wl_status_t status();
+  IPAddress   localIP();
+  bool        mode(wifi_mode_t mode);
+  wl_status_t begin(const char* ssid, const char* password);
+  bool        disconnect(bool wifiOff = false);
+};
+
+extern WiFiClass WiFi;
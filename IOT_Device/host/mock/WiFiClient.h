@@ -0,0 +1,12 @@
+#pragma once
+#include "Arduino.h"
+
+// Fluxo HTTP do mock (o corpo servido por mock::httpServe)
+class WiFiClient {
+public:
+  virtual ~WiFiClient() = default;
+
+  int  available();
+  int  read(uint8_t* buf, size_t size);
+  bool connected();
+};
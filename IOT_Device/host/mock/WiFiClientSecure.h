@@ -0,0 +1,11 @@
+#pragma once
+#include "WiFiClient.h"
+
+// TLS não existe no host: as credenciais são só guardadas
+class WiFiClientSecure : public WiFiClient {
+public:
+  void setCACert(const char* rootCA)        { (void)rootCA; }
+  void setCertificate(const char* cert)     { (void)cert; }
+  void setPrivateKey(const char* key)       { (void)key; }
+  void setInsecure()                        {}
+};
@@ -0,0 +1,69 @@
+#include <stddef.h>
+#include <errno.h>
+#include "alloc_counter.h"
+
+// glibc: o alocador de verdade continua acessível por estes nomes
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void  __libc_free(void* ptr);
+}
+
+// TLS estático (initial-exec): ler o contador não pode alocar
+static thread_local mock::AllocCount counted __attribute__((tls_model("initial-exec"))) = {0, 0};
+
+static inline void count(size_t size) {
+  counted.calls++;
+  counted.bytes += size;
+}
+
+namespace mock {
+
+AllocCount allocCount() {
+  return counted;
+}
+
+}  // namespace mock
+
+extern "C" {
+
+void* malloc(size_t size) {
+  count(size);
+  return __libc_malloc(size);
+}
+
+void* calloc(size_t n, size_t size) {
+  count(n * size);
+  return __libc_calloc(n, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+  count(size);
+  return __libc_realloc(ptr, size);
+}
+
+void free(void* ptr) {
+  __libc_free(ptr);
+}
+
+void* memalign(size_t alignment, size_t size) {
+  count(size);
+  return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+  return memalign(alignment, size);
+}
+
+int posix_memalign(void** out, size_t alignment, size_t size) {
+  void* p = memalign(alignment, size);
+  if (p == nullptr) {
+    return ENOMEM;
+  }
+  *out = p;
+  return 0;
+}
+
+}  // extern "C"
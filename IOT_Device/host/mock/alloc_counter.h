@@ -0,0 +1,23 @@
+#pragma once
+#include <stdint.h>
+
+// ==========================================================
+// CONTADOR DE ALOCAÇÕES (host)
+// ==========================================================
+//
+// malloc/calloc/realloc/memalign do processo passam por aqui (glibc:
+// __libc_malloc por baixo) e contam na thread que chamou. Pega o
+// operator new do mem_monitor também, que vai pro malloc.
+//
+// Uso: lê antes e depois do trecho e subtrai.
+
+namespace mock {
+
+struct AllocCount {
+  uint64_t calls;
+  uint64_t bytes;
+};
+
+AllocCount allocCount();  // desta thread, desde que ela nasceu
+
+}  // namespace mock
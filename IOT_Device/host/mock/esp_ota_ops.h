@@ -0,0 +1,27 @@
+#pragma once
+#include "esp_partition.h"
+
+typedef uint32_t esp_ota_handle_t;
+
+#define OTA_SIZE_UNKNOWN           0xffffffff
+#define OTA_WITH_SEQUENTIAL_WRITES 0xfffffffe
+
+typedef enum {
+  ESP_OTA_IMG_NEW,
+  ESP_OTA_IMG_PENDING_VERIFY,
+  ESP_OTA_IMG_VALID,
+  ESP_OTA_IMG_INVALID,
+  ESP_OTA_IMG_ABORTED,
+  ESP_OTA_IMG_UNDEFINED
+} esp_ota_img_states_t;
+
+// Partições app0 (em uso) e app1 (destino) vivem no mock (mock::setRunningImage / mock::otaWritten)
+const esp_partition_t* esp_ota_get_running_partition();
+const esp_partition_t* esp_ota_get_next_update_partition(const esp_partition_t* start);
+esp_err_t esp_ota_begin(const esp_partition_t* part, size_t imageSize, esp_ota_handle_t* handle);
+esp_err_t esp_ota_write(esp_ota_handle_t handle, const void* data, size_t size);
+esp_err_t esp_ota_end(esp_ota_handle_t handle);
+esp_err_t esp_ota_abort(esp_ota_handle_t handle);
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t* part);
+esp_err_t esp_ota_get_state_partition(const esp_partition_t* part, esp_ota_img_states_t* state);
+esp_err_t esp_ota_mark_app_valid_cancel_rollback();
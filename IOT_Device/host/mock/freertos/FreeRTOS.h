@@ -0,0 +1,24 @@
+#pragma once
+// FreeRTOS do ESP-IDF, no host. portMUX é um spinlock recursivo de verdade
+// (os testes rodam o callback do esp_timer em outra thread).
+
+#include <stdint.h>
+
+typedef int          BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t     TickType_t;
+
+#define pdPASS             1
+#define pdFAIL             0
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms)  ((TickType_t)(ms))
+
+typedef struct {
+  volatile uint32_t owner;  // 0 = livre; senão o token da thread dona
+  uint32_t          count;  // entradas recursivas da dona
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED {0, 0}
+
+void portENTER_CRITICAL(portMUX_TYPE* mux);
+void portEXIT_CRITICAL(portMUX_TYPE* mux);
@@ -0,0 +1,15 @@
+#pragma once
+#include "FreeRTOS.h"
+
+typedef void* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+TaskHandle_t xTaskGetCurrentTaskHandle();
+TaskHandle_t xTaskGetHandle(const char* name);
+UBaseType_t  uxTaskGetStackHighWaterMark(TaskHandle_t task);
+
+// Sem escalonador no host: a task roda inteira, na hora, na thread de quem criou
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stackDepth, void* arg,
+                                   UBaseType_t priority, TaskHandle_t* created, BaseType_t core);
+void vTaskDelay(TickType_t ticks);  // avança o relógio do mock
+void vTaskDelete(TaskHandle_t task);
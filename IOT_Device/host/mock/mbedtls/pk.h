@@ -0,0 +1,15 @@
+#pragma once
+#include <stddef.h>
+
+typedef enum { MBEDTLS_MD_NONE = 0, MBEDTLS_MD_SHA256 = 6 } mbedtls_md_type_t;
+
+// Chave pública (ECDSA/RSA) pelo OpenSSL (mock_crypto.cpp)
+typedef struct {
+  void* key;
+} mbedtls_pk_context;
+
+void mbedtls_pk_init(mbedtls_pk_context* ctx);
+void mbedtls_pk_free(mbedtls_pk_context* ctx);
+int  mbedtls_pk_parse_public_key(mbedtls_pk_context* ctx, const unsigned char* key, size_t keylen);
+int  mbedtls_pk_verify(mbedtls_pk_context* ctx, mbedtls_md_type_t md, const unsigned char* hash, size_t hashLen,
+                       const unsigned char* sig, size_t sigLen);
@@ -0,0 +1,14 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// SHA-256 pelo OpenSSL (mock_crypto.cpp); o contexto só precisa caber nele
+typedef struct {
+  uint64_t opaque[16];
+} mbedtls_sha256_context;
+
+void mbedtls_sha256_init(mbedtls_sha256_context* ctx);
+void mbedtls_sha256_free(mbedtls_sha256_context* ctx);
+int  mbedtls_sha256_starts(mbedtls_sha256_context* ctx, int is224);
+int  mbedtls_sha256_update(mbedtls_sha256_context* ctx, const unsigned char* input, size_t len);
+int  mbedtls_sha256_finish(mbedtls_sha256_context* ctx, unsigned char output[32]);
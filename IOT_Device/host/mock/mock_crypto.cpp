@@ -0,0 +1,135 @@
+// mbedtls (SHA-256 + verificação de assinatura) e tinfl da ROM, no host.
+// SHA256_CTX cabe no contexto opaco e não aloca (a API EVP alocaria).
+#define OPENSSL_SUPPRESS_DEPRECATED
+#include <openssl/sha.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <zlib.h>
+#include <string.h>
+
+#include <mbedtls/sha256.h>
+#include <mbedtls/pk.h>
+#include <rom/miniz.h>
+
+static_assert(sizeof(SHA256_CTX) <= sizeof(mbedtls_sha256_context), "contexto SHA-256 pequeno demais");
+
+// ==========================
+// SHA-256
+// ==========================
+
+void mockSha256(const uint8_t* data, size_t length, uint8_t out[32]) {
+  SHA256(data, length, out);
+}
+
+void mbedtls_sha256_init(mbedtls_sha256_context* ctx) {
+  memset(ctx, 0, sizeof(*ctx));
+}
+
+void mbedtls_sha256_free(mbedtls_sha256_context* ctx) {
+  memset(ctx, 0, sizeof(*ctx));
+}
+
+int mbedtls_sha256_starts(mbedtls_sha256_context* ctx, int is224) {
+  return is224 == 0 && SHA256_Init((SHA256_CTX*)ctx) == 1 ? 0 : -1;
+}
+
+int mbedtls_sha256_update(mbedtls_sha256_context* ctx, const unsigned char* input, size_t len) {
+  return SHA256_Update((SHA256_CTX*)ctx, input, len) == 1 ? 0 : -1;
+}
+
+int mbedtls_sha256_finish(mbedtls_sha256_context* ctx, unsigned char output[32]) {
+  return SHA256_Final(output, (SHA256_CTX*)ctx) == 1 ? 0 : -1;
+}
+
+// ==========================
+// CHAVE PÚBLICA
+// ==========================
+
+void mbedtls_pk_init(mbedtls_pk_context* ctx) {
+  ctx->key = nullptr;
+}
+
+void mbedtls_pk_free(mbedtls_pk_context* ctx) {
+  EVP_PKEY_free((EVP_PKEY*)ctx->key);
+  ctx->key = nullptr;
+}
+
+int mbedtls_pk_parse_public_key(mbedtls_pk_context* ctx, const unsigned char* key, size_t keylen) {
+  // Como no mbedtls, o PEM vem com o '\0' final contado em keylen
+  if (keylen < 2 || key[keylen - 1] != '\0') {
+    return -1;
+  }
+  BIO* bio = BIO_new_mem_buf(key, (int)keylen - 1);
+  ctx->key = PEM_read_bio_PUBKEY(bio, nullptr, nullptr, nullptr);
+  BIO_free(bio);
+  return ctx->key != nullptr ? 0 : -1;
+}
+
+int mbedtls_pk_verify(mbedtls_pk_context* ctx, mbedtls_md_type_t md, const unsigned char* hash, size_t hashLen,
+                      const unsigned char* sig, size_t sigLen) {
+  if (ctx->key == nullptr || md != MBEDTLS_MD_SHA256) {
+    return -1;
+  }
+  EVP_PKEY_CTX* pctx = EVP_PKEY_CTX_new((EVP_PKEY*)ctx->key, nullptr);
+  int rc = pctx != nullptr && EVP_PKEY_verify_init(pctx) == 1 &&
+           EVP_PKEY_CTX_set_signature_md(pctx, EVP_sha256()) == 1
+               ? EVP_PKEY_verify(pctx, sig, sigLen, hash, hashLen)
+               : 0;
+  EVP_PKEY_CTX_free(pctx);
+  return rc == 1 ? 0 : -1;
+}
+
+// ==========================
+// TINFL (zlib)
+// ==========================
+
+// Um fluxo por vez (o OTA só descomprime um pacote por vez). tinfl_init não
+// tem par de "fim": o fluxo anterior é liberado no próximo início.
+static z_stream inflater;
+static bool     inflaterOpen = false;
+
+tinfl_status tinfl_decompress(tinfl_decompressor* r, const mz_uint8* pIn_buf_next, size_t* pIn_buf_size,
+                              mz_uint8* pOut_buf_start, mz_uint8* pOut_buf_next, size_t* pOut_buf_size,
+                              const mz_uint32 decomp_flags) {
+  size_t window = (size_t)(pOut_buf_next - pOut_buf_start) + *pOut_buf_size;
+  if ((decomp_flags & TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF) == 0 && (window & (window - 1)) != 0) {
+    return TINFL_STATUS_BAD_PARAM;
+  }
+
+  if (r->m_state == 0) {
+    if (inflaterOpen) {
+      inflateEnd(&inflater);
+    }
+    memset(&inflater, 0, sizeof(inflater));
+    int bits = (decomp_flags & TINFL_FLAG_PARSE_ZLIB_HEADER) ? MAX_WBITS : -MAX_WBITS;
+    if (inflateInit2(&inflater, bits) != Z_OK) {
+      return TINFL_STATUS_FAILED;
+    }
+    inflaterOpen = true;
+    r->stream    = &inflater;
+    r->m_state   = 1;
+  }
+
+  z_stream* z  = (z_stream*)r->stream;
+  z->next_in   = (Bytef*)pIn_buf_next;
+  z->avail_in  = (uInt)*pIn_buf_size;
+  z->next_out  = pOut_buf_next;
+  z->avail_out = (uInt)*pOut_buf_size;
+  int rc = inflate(z, Z_NO_FLUSH);
+  *pIn_buf_size  -= z->avail_in;
+  *pOut_buf_size -= z->avail_out;
+
+  if (rc == Z_STREAM_END) {
+    return TINFL_STATUS_DONE;
+  }
+  if (rc == Z_DATA_ERROR && z->msg != nullptr && strstr(z->msg, "incorrect data check") != nullptr) {
+    return TINFL_STATUS_ADLER32_MISMATCH;
+  }
+  if (rc != Z_OK && rc != Z_BUF_ERROR) {
+    return TINFL_STATUS_FAILED;
+  }
+  if (z->avail_out == 0) {
+    return TINFL_STATUS_HAS_MORE_OUTPUT;
+  }
+  return (decomp_flags & TINFL_FLAG_HAS_MORE_INPUT) ? TINFL_STATUS_NEEDS_MORE_INPUT : TINFL_STATUS_FAILED;
+}
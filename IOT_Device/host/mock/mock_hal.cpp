@@ -0,0 +1,922 @@
+#include <Arduino.h>
+#include <stdarg.h>
+#include <DHT.h>
+#include <WiFi.h>
+#include <WiFiClient.h>
+#include <HTTPClient.h>
+#include <PubSubClient.h>
+#include <Preferences.h>
+#include <esp_timer.h>
+#include <esp_system.h>
+#include <esp_heap_caps.h>
+#include <esp_partition.h>
+#include <esp_ota_ops.h>
+#include <driver/ledc.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <atomic>
+#include <vector>
+
+#include "mock_hal.h"
+#include "mqtt_socket.h"
+
+// ==========================
+// CONFIGURAÇÃO
+// ==========================
+
+static const int      PIN_COUNT          = 64;
+static const int      TIMER_SLOTS        = 16;
+static const int      SUBSCRIPTION_SLOTS = 16;
+static const int      INJECT_SLOTS       = 8;
+static const size_t   TOPIC_MAX          = 128;
+static const size_t   INJECT_PAYLOAD_MAX = 2048;
+static const int      NVS_SLOTS          = 8;
+static const size_t   NVS_VALUE_MAX      = 1024;
+static const int      BROKER_TIMEOUT_MS  = 3000;
+static const uint16_t BROKER_KEEPALIVE_S = 15;       // MQTT_KEEPALIVE do PubSubClient
+static const uint32_t CPU_MHZ            = 240;
+static const uint32_t FLIGHT_SIZE        = 0x80000;   // partitions.csv: flightrec
+static const uint32_t APP_SIZE           = 0x140000;  // partitions.csv: app0/app1
+
+// ==========================
+// ESTADO
+// ==========================
+
+Print     Serial;
+EspClass  ESP;
+WiFiClass WiFi;
+
+static uint64_t nowUs = 0;
+static time_t   wallBase   = 0;   // epoch em nowUs == wallBaseUs (0 = sem NTP)
+static uint64_t wallBaseUs = 0;
+
+static int      digitalIn[PIN_COUNT];
+static int      digitalOut[PIN_COUNT];
+static uint16_t analogIn[PIN_COUNT];
+static float    dhtTemp     = 24.0f;
+static float    dhtHumidity = 55.0f;
+static uint32_t ledcDuties[LEDC_CHANNEL_MAX];
+
+struct esp_timer {
+  esp_timer_cb_t callback;
+  void*          arg;
+  uint64_t       periodUs;
+  uint64_t       nextUs;
+  bool           used;
+  bool           active;
+};
+static esp_timer  timers[TIMER_SLOTS];
+static esp_timer* newestTimer = nullptr;
+
+static bool     wifiConnected = true;
+static uint64_t efuseMac      = 0x0000A1B2C3D4E5F6ULL;
+static bool     serialEcho    = false;
+static int      restarts      = 0;
+
+// MQTT: uma "conexão" do mock por vez; o cliente guarda o número da sessão
+static uint32_t            mqttSession      = 0;
+static bool                mqttUp           = false;
+static int                 mqttFailConnects = 0;
+static bool                mqttPublishFails = false;
+static mock::PublishHook   publishHook      = nullptr;
+static void*               publishContext   = nullptr;
+static uint32_t            publishCount     = 0;
+static uint32_t            connectCount     = 0;
+static char                subscriptions[SUBSCRIPTION_SLOTS][TOPIC_MAX];
+
+struct Injected {
+  char    topic[TOPIC_MAX];
+  uint8_t payload[INJECT_PAYLOAD_MAX];
+  size_t  length;
+};
+static Injected injected[INJECT_SLOTS];
+static int      injectHead  = 0;
+static int      injectCount = 0;
+
+// Broker de verdade (mock::setMqttBroker): "" = sessão do mock
+static char       brokerHost[64];
+static uint16_t   brokerPort = 0;
+static MqttSocket brokerSocket;
+
+// HTTP
+static const uint8_t* httpBody      = nullptr;
+static size_t         httpLength    = 0;
+static size_t         httpDropEvery = 0;
+static size_t         httpPos       = 0;
+static size_t         httpSinceDrop = 0;
+static bool           httpOpen      = false;
+static int            httpGets      = 0;
+static size_t         httpRange     = 0;
+
+// Flash / OTA
+static esp_partition_t flightPartition = { ESP_PARTITION_TYPE_DATA, 0x40, 0x370000, FLIGHT_SIZE, "flightrec" };
+static esp_partition_t app0Partition   = { ESP_PARTITION_TYPE_APP, 0x10, 0x10000, APP_SIZE, "app0" };
+static esp_partition_t app1Partition   = { ESP_PARTITION_TYPE_APP, 0x11, 0x150000, APP_SIZE, "app1" };
+static uint8_t*        flightFlash     = nullptr;  // alocada no primeiro find (setup)
+
+static const uint8_t*       runningImage  = nullptr;
+static size_t               runningLength = 0;
+static std::vector<uint8_t> otaOutput;
+static bool                 otaOpen       = false;
+static bool                 otaSwitched   = false;
+static bool                 otaWasAborted = false;
+
+// NVS
+struct NvsEntry {
+  char    space[16];
+  char    key[16];
+  uint8_t value[NVS_VALUE_MAX];
+  size_t  length;
+  bool    used;
+};
+static NvsEntry nvs[NVS_SLOTS];
+
+// ==========================
+// RELÓGIO / TIMERS
+// ==========================
+
+namespace mock {
+
+void reset() {
+  nowUs      = 0;
+  wallBase   = 0;
+  wallBaseUs = 0;
+  for (int i = 0; i < PIN_COUNT; i++) {
+    digitalIn[i]  = HIGH;
+    digitalOut[i] = -1;
+    analogIn[i]   = 4095;
+  }
+  dhtTemp     = 24.0f;
+  dhtHumidity = 55.0f;
+  memset(ledcDuties, 0, sizeof(ledcDuties));
+  memset(timers, 0, sizeof(timers));
+  newestTimer = nullptr;
+
+  wifiConnected = true;
+  restarts      = 0;
+  const char* echo = getenv("MOCK_SERIAL");
+  serialEcho = echo != nullptr && echo[0] == '1';
+
+  mqttSession++;
+  mqttUp           = false;
+  mqttFailConnects = 0;
+  mqttPublishFails = false;
+  publishHook      = nullptr;
+  publishContext   = nullptr;
+  publishCount     = 0;
+  connectCount     = 0;
+  memset(subscriptions, 0, sizeof(subscriptions));
+  injectHead  = 0;
+  injectCount = 0;
+  brokerSocket.close();
+  brokerHost[0] = '\0';
+
+  httpBody  = nullptr;
+  httpLength = 0;
+  httpOpen  = false;
+  httpGets  = 0;
+  httpRange = 0;
+
+  if (flightPartition.size != FLIGHT_SIZE) {
+    setFlightSize(FLIGHT_SIZE);
+  }
+  if (flightFlash != nullptr) {
+    memset(flightFlash, 0xFF, FLIGHT_SIZE);
+  }
+  runningImage  = nullptr;
+  runningLength = 0;
+  otaOutput.clear();
+  otaOpen       = false;
+  otaSwitched   = false;
+  otaWasAborted = false;
+  memset(nvs, 0, sizeof(nvs));
+}
+
+uint64_t nowMicros() {
+  return nowUs;
+}
+
+void advanceMicros(uint64_t us) {
+  uint64_t target = nowUs + us;
+  for (;;) {
+    esp_timer* due = nullptr;
+    for (int i = 0; i < TIMER_SLOTS; i++) {
+      esp_timer& t = timers[i];
+      if (t.active && t.nextUs <= target && (due == nullptr || t.nextUs < due->nextUs)) {
+        due = &t;
+      }
+    }
+    if (due == nullptr) {
+      break;
+    }
+    nowUs        = due->nextUs;
+    due->nextUs += due->periodUs;
+    due->callback(due->arg);
+  }
+  nowUs = target;
+}
+
+void setWallClock(time_t epoch) {
+  wallBase   = epoch;
+  wallBaseUs = nowUs;
+}
+
+void advanceMillis(uint32_t ms) {
+  advanceMicros((uint64_t)ms * 1000);
+}
+
+void fireTimer(esp_timer_handle_t timer) {
+  timer->callback(timer->arg);
+}
+
+esp_timer_handle_t lastTimer() {
+  return newestTimer;
+}
+
+int activeTimers() {
+  int n = 0;
+  for (int i = 0; i < TIMER_SLOTS; i++) {
+    if (timers[i].active) n++;
+  }
+  return n;
+}
+
+// ==========================
+// PINOS / SENSORES
+// ==========================
+
+void setDigitalInput(int pin, int level) { digitalIn[pin] = level; }
+int  digitalOutput(int pin)              { return digitalOut[pin]; }
+void setAnalog(int pin, uint16_t value)  { analogIn[pin] = value; }
+void setDht(float tempC, float humidity) { dhtTemp = tempC; dhtHumidity = humidity; }
+uint32_t ledcDuty(int channel)           { return ledcDuties[channel]; }
+
+// ==========================
+// WI-FI / MQTT
+// ==========================
+
+void setWifiConnected(bool connected) { wifiConnected = connected; }
+void setEfuseMac(uint64_t mac)        { efuseMac = mac; }
+void failMqttConnects(int n)          { mqttFailConnects = n; }
+void setMqttPublishFails(bool fails)  { mqttPublishFails = fails; }
+uint32_t mqttPublishCount()           { return publishCount; }
+uint32_t mqttConnectCount()           { return connectCount; }
+
+void dropMqtt() {
+  mqttUp = false;
+  mqttSession++;
+  injectCount = 0;
+  brokerSocket.close();
+}
+
+void setMqttBroker(const char* host, uint16_t port) {
+  snprintf(brokerHost, sizeof(brokerHost), "%s", host);
+  brokerPort = port;
+}
+
+int mqttSocketFd() {
+  return brokerSocket.fd();
+}
+
+void onMqttPublish(PublishHook hook, void* context) {
+  publishHook    = hook;
+  publishContext = context;
+}
+
+bool mqttSubscribed(const char* topic) {
+  for (int i = 0; i < SUBSCRIPTION_SLOTS; i++) {
+    if (strcmp(subscriptions[i], topic) == 0) return true;
+  }
+  return false;
+}
+
+bool mqttInject(const char* topic, const uint8_t* payload, size_t length) {
+  if (injectCount == INJECT_SLOTS || strlen(topic) >= TOPIC_MAX || length > INJECT_PAYLOAD_MAX) {
+    return false;
+  }
+  Injected& m = injected[(injectHead + injectCount) % INJECT_SLOTS];
+  strcpy(m.topic, topic);
+  memcpy(m.payload, payload, length);
+  m.length = length;
+  injectCount++;
+  return true;
+}
+
+bool mqttInject(const char* topic, const char* payload) {
+  return mqttInject(topic, (const uint8_t*)payload, strlen(payload));
+}
+
+// ==========================
+// HTTP / OTA
+// ==========================
+
+void httpServe(const uint8_t* body, size_t length, size_t dropEvery) {
+  httpBody      = body;
+  httpLength    = length;
+  httpDropEvery = dropEvery;
+  httpPos       = 0;
+  httpOpen      = false;
+}
+
+int    httpRequests()      { return httpGets; }
+size_t httpLastRangeFrom() { return httpRange; }
+
+void setRunningImage(const uint8_t* image, size_t length) {
+  runningImage  = image;
+  runningLength = length;
+}
+
+void setFlightSize(uint32_t bytes) {
+  flightPartition.size = bytes;
+  free(flightFlash);
+  flightFlash = nullptr;  // nova no próximo find
+}
+
+const uint8_t* otaWritten(size_t* length) {
+  *length = otaOutput.size();
+  return otaOutput.data();
+}
+
+bool otaBootSwitched() { return otaSwitched; }
+bool otaAborted()      { return otaWasAborted; }
+int  restartCount()    { return restarts; }
+
+void setSerialEcho(bool echo) { serialEcho = echo; }
+
+}  // namespace mock
+
+// ==========================
+// ARDUINO
+// ==========================
+
+void pinMode(uint8_t pin, uint8_t mode) { (void)pin; (void)mode; }
+void digitalWrite(uint8_t pin, uint8_t level) { digitalOut[pin % PIN_COUNT] = level; }
+int  digitalRead(uint8_t pin) { return digitalIn[pin % PIN_COUNT]; }
+uint16_t analogRead(uint8_t pin) { return analogIn[pin % PIN_COUNT]; }
+
+unsigned long millis() { return (unsigned long)(nowUs / 1000); }
+unsigned long micros() { return (unsigned long)nowUs; }
+void delay(uint32_t ms) { mock::advanceMillis(ms); }
+void delayMicroseconds(uint32_t us) { mock::advanceMicros(us); }
+
+size_t Print::write(const uint8_t* data, size_t len) {
+  if (serialEcho) {
+    fwrite(data, 1, len, stdout);
+  }
+  return len;
+}
+
+size_t Print::print(double v, int digits) {
+  char buf[40];
+  int n = snprintf(buf, sizeof(buf), "%.*f", digits, v);
+  return write((const uint8_t*)buf, (size_t)n);
+}
+
+size_t Print::printf(const char* fmt, ...) {
+  char buf[256];
+  va_list args;
+  va_start(args, fmt);
+  int n = vsnprintf(buf, sizeof(buf), fmt, args);
+  va_end(args);
+  if (n < 0) return 0;
+  return write((const uint8_t*)buf, min((size_t)n, sizeof(buf) - 1));
+}
+
+uint64_t EspClass::getEfuseMac()     { return efuseMac; }
+uint32_t EspClass::getFreeHeap()     { return 180 * 1024; }
+uint32_t EspClass::getMinFreeHeap()  { return 150 * 1024; }
+uint32_t EspClass::getMaxAllocHeap() { return 110 * 1024; }
+uint32_t EspClass::getCycleCount()   { return (uint32_t)(nowUs * CPU_MHZ); }
+uint32_t EspClass::getCpuFreqMHz()   { return CPU_MHZ; }
+void     EspClass::restart()         { restarts++; }
+
+uint32_t esp_random() {
+  static uint32_t state = 0x9E3779B9u;  // xorshift: determinístico entre execuções
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+void configTime(long, int, const char*, const char*, const char*) {}
+
+// time() da libc trocado pelo relógio do mock (mock::setWallClock)
+extern "C" time_t time(time_t* out) {
+  time_t now = wallBase != 0 ? wallBase + (time_t)((nowUs - wallBaseUs) / 1'000'000)
+                             : (time_t)(nowUs / 1'000'000);
+  if (out != nullptr) {
+    *out = now;
+  }
+  return now;
+}
+
+esp_reset_reason_t esp_reset_reason(void) { return ESP_RST_POWERON; }
+
+void heap_caps_get_info(multi_heap_info_t* info, uint32_t caps) {
+  (void)caps;
+  memset(info, 0, sizeof(*info));
+  info->total_free_bytes   = ESP.getFreeHeap();
+  info->minimum_free_bytes = ESP.getMinFreeHeap();
+  info->largest_free_block = ESP.getMaxAllocHeap();
+  info->allocated_blocks   = 100;
+}
+
+// ==========================
+// FREERTOS
+// ==========================
+
+// Token por thread: é o "TaskHandle" de quem está rodando
+static thread_local char threadToken;
+static char otaTaskToken;
+
+static uint32_t threadId() {
+  static std::atomic<uint32_t> next{1};
+  static thread_local uint32_t id = next++;
+  return id;
+}
+
+void portENTER_CRITICAL(portMUX_TYPE* mux) {
+  uint32_t me = threadId();
+  if (__atomic_load_n(&mux->owner, __ATOMIC_ACQUIRE) == me) {
+    mux->count++;
+    return;
+  }
+  uint32_t expected = 0;
+  while (!__atomic_compare_exchange_n(&mux->owner, &expected, me, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+    expected = 0;
+  }
+  mux->count = 1;
+}
+
+void portEXIT_CRITICAL(portMUX_TYPE* mux) {
+  if (--mux->count == 0) {
+    __atomic_store_n(&mux->owner, 0, __ATOMIC_RELEASE);
+  }
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() { return &threadToken; }
+TaskHandle_t xTaskGetHandle(const char* name) { return strcmp(name, "loopTask") == 0 ? &threadToken : nullptr; }
+UBaseType_t  uxTaskGetStackHighWaterMark(TaskHandle_t) { return 4096; }
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char*, uint32_t, void* arg, UBaseType_t,
+                                   TaskHandle_t* created, BaseType_t) {
+  if (created != nullptr) {
+    *created = &otaTaskToken;  // antes de rodar: a task pode limpar o próprio handle
+  }
+  fn(arg);
+  return pdPASS;
+}
+
+void vTaskDelay(TickType_t ticks) { mock::advanceMillis(ticks * portTICK_PERIOD_MS); }
+void vTaskDelete(TaskHandle_t) {}
+
+// ==========================
+// ESP_TIMER / LEDC
+// ==========================
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* out) {
+  for (int i = 0; i < TIMER_SLOTS; i++) {
+    if (!timers[i].used) {
+      timers[i]          = {};
+      timers[i].used     = true;
+      timers[i].callback = args->callback;
+      timers[i].arg      = args->arg;
+      *out        = &timers[i];
+      newestTimer = &timers[i];
+      return ESP_OK;
+    }
+  }
+  return ESP_ERR_NO_MEM;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t periodUs) {
+  if (timer->active) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  timer->periodUs = periodUs;
+  timer->nextUs   = nowUs + periodUs;
+  timer->active   = true;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+  if (!timer->active) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  timer->active = false;
+  return ESP_OK;
+}
+
+bool    esp_timer_is_active(esp_timer_handle_t timer) { return timer->active; }
+int64_t esp_timer_get_time() { return (int64_t)nowUs; }
+
+esp_err_t ledc_timer_config(const ledc_timer_config_t*) { return ESP_OK; }
+
+esp_err_t ledc_channel_config(const ledc_channel_config_t* cfg) {
+  if (cfg->channel >= LEDC_CHANNEL_MAX) return ESP_ERR_INVALID_ARG;
+  ledcDuties[cfg->channel] = cfg->duty;
+  return ESP_OK;
+}
+
+esp_err_t ledc_set_duty(ledc_mode_t, ledc_channel_t channel, uint32_t duty) {
+  if (channel >= LEDC_CHANNEL_MAX) return ESP_ERR_INVALID_ARG;
+  ledcDuties[channel] = duty;
+  return ESP_OK;
+}
+
+esp_err_t ledc_update_duty(ledc_mode_t, ledc_channel_t) { return ESP_OK; }
+
+// ==========================
+// PERIFÉRICOS
+// ==========================
+
+float DHT::readHumidity()    { return dhtHumidity; }
+float DHT::readTemperature() { return dhtTemp; }
+
+wl_status_t WiFiClass::status()                   { return wifiConnected ? WL_CONNECTED : WL_DISCONNECTED; }
+IPAddress   WiFiClass::localIP()                  { return wifiConnected ? IPAddress(192, 168, 0, 50) : IPAddress(); }
+bool        WiFiClass::mode(wifi_mode_t)          { return true; }
+wl_status_t WiFiClass::begin(const char*, const char*) { return status(); }
+bool        WiFiClass::disconnect(bool)           { return true; }
+
+// ---------- NVS ----------
+
+static NvsEntry* nvsFind(const char* space, const char* key, bool create) {
+  NvsEntry* freeSlot = nullptr;
+  for (int i = 0; i < NVS_SLOTS; i++) {
+    NvsEntry& e = nvs[i];
+    if (e.used && strcmp(e.space, space) == 0 && strcmp(e.key, key) == 0) return &e;
+    if (!e.used && freeSlot == nullptr) freeSlot = &e;
+  }
+  if (!create || freeSlot == nullptr) return nullptr;
+  memset(freeSlot, 0, sizeof(*freeSlot));
+  strncpy(freeSlot->space, space, sizeof(freeSlot->space) - 1);
+  strncpy(freeSlot->key, key, sizeof(freeSlot->key) - 1);
+  freeSlot->used = true;
+  return freeSlot;
+}
+
+bool Preferences::begin(const char* name, bool ro) {
+  strncpy(space, name, sizeof(space) - 1);
+  open     = true;
+  readOnly = ro;
+  return true;
+}
+
+void Preferences::end() { open = false; }
+
+size_t Preferences::getBytesLength(const char* key) {
+  NvsEntry* e = open ? nvsFind(space, key, false) : nullptr;
+  return e != nullptr ? e->length : 0;
+}
+
+size_t Preferences::getBytes(const char* key, void* buf, size_t maxLen) {
+  NvsEntry* e = open ? nvsFind(space, key, false) : nullptr;
+  if (e == nullptr || e->length > maxLen) return 0;
+  memcpy(buf, e->value, e->length);
+  return e->length;
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t len) {
+  if (!open || readOnly || len > NVS_VALUE_MAX) return 0;
+  NvsEntry* e = nvsFind(space, key, true);
+  if (e == nullptr) return 0;
+  memcpy(e->value, value, len);
+  e->length = len;
+  return len;
+}
+
+bool Preferences::remove(const char* key) {
+  NvsEntry* e = open && !readOnly ? nvsFind(space, key, false) : nullptr;
+  if (e == nullptr) return false;
+  e->used = false;
+  return true;
+}
+
+// ---------- PubSubClient ----------
+
+// Tópico MQTT com curingas '+' (um nível) e '#' (o resto)
+static bool topicMatches(const char* filter, const char* topic) {
+  while (*filter != '\0') {
+    if (*filter == '#') return true;
+    if (*filter == '+') {
+      while (*topic != '\0' && *topic != '/') topic++;
+      filter++;
+      continue;
+    }
+    if (*filter != *topic) return false;
+    filter++;
+    topic++;
+  }
+  return *topic == '\0';
+}
+
+PubSubClient::~PubSubClient() {
+  free(buffer);
+}
+
+PubSubClient& PubSubClient::setServer(const char*, uint16_t) { return *this; }
+PubSubClient& PubSubClient::setCallback(MqttCallback cb) { callback = cb; return *this; }
+
+bool PubSubClient::setBufferSize(uint16_t size) {
+  uint8_t* grown = (uint8_t*)realloc(buffer, size);
+  if (grown == nullptr) return false;
+  buffer     = grown;
+  bufferSize = size;
+  return true;
+}
+
+bool PubSubClient::connect(const char* id) {
+  if (!wifiConnected || mqttFailConnects > 0) {
+    if (mqttFailConnects > 0) mqttFailConnects--;
+    currentState = MQTT_CONNECT_FAILED;
+    return false;
+  }
+  if (buffer == nullptr && !setBufferSize(256)) {
+    return false;
+  }
+  if (brokerHost[0] != '\0' &&
+      !brokerSocket.connect(brokerHost, brokerPort, id, BROKER_KEEPALIVE_S, BROKER_TIMEOUT_MS)) {
+    currentState = MQTT_CONNECT_FAILED;
+    return false;
+  }
+  mqttSession++;
+  mqttUp  = true;
+  session = mqttSession;
+  connectCount++;
+  currentState = MQTT_CONNECTED;
+  memset(subscriptions, 0, sizeof(subscriptions));
+  injectCount = 0;
+  return true;
+}
+
+void PubSubClient::disconnect() {
+  if (connected()) {
+    mqttUp = false;
+    mqttSession++;
+  }
+  brokerSocket.disconnect();
+  currentState = MQTT_DISCONNECTED;
+}
+
+bool PubSubClient::connected() {
+  bool up = mqttUp && session == mqttSession && wifiConnected;
+  if (!up && currentState == MQTT_CONNECTED) {
+    currentState = MQTT_CONNECTION_LOST;
+  }
+  return up;
+}
+
+bool PubSubClient::loop() {
+  if (!connected()) return false;
+
+  // Broker de verdade: um pacote por loop() (o socket responde PUBACK/PING)
+  if (brokerHost[0] != '\0') {
+    MqttMessage m;
+    MqttSocket::Poll got = brokerSocket.poll(m);
+    if (got == MqttSocket::Poll::CLOSED) {
+      mock::dropMqtt();
+      return connected();
+    }
+    if (got == MqttSocket::Poll::MESSAGE) {
+      deliver(m.topic, m.payload, m.length);
+    }
+    return true;
+  }
+
+  if (injectCount == 0 || callback == nullptr) return true;
+
+  // Uma mensagem por loop(), copiada no buffer do cliente como no original
+  Injected& m = injected[injectHead];
+  injectHead = (injectHead + 1) % INJECT_SLOTS;
+  injectCount--;
+  deliver(m.topic, m.payload, m.length);
+  return true;
+}
+
+bool PubSubClient::deliver(const char* topic, const uint8_t* payload, size_t length) {
+  bool wanted = false;
+  for (int i = 0; i < SUBSCRIPTION_SLOTS && !wanted; i++) {
+    wanted = subscriptions[i][0] != '\0' && topicMatches(subscriptions[i], topic);
+  }
+  size_t topicLen = strlen(topic);
+  if (callback == nullptr || !wanted || topicLen + 1 + length > bufferSize) {
+    return false;  // sem assinatura ou grande demais: o original também descarta
+  }
+  memcpy(buffer, topic, topicLen + 1);
+  memcpy(buffer + topicLen + 1, payload, length);
+  callback((char*)buffer, buffer + topicLen + 1, (unsigned int)length);
+  return true;
+}
+
+bool PubSubClient::subscribe(const char* topic, uint8_t qos) {
+  if (!connected() || strlen(topic) >= TOPIC_MAX) return false;
+  if (brokerHost[0] != '\0' && !brokerSocket.subscribe(topic, qos)) {
+    mock::dropMqtt();
+    return false;
+  }
+  if (mock::mqttSubscribed(topic)) return true;
+  for (int i = 0; i < SUBSCRIPTION_SLOTS; i++) {
+    if (subscriptions[i][0] == '\0') {
+      strcpy(subscriptions[i], topic);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool PubSubClient::unsubscribe(const char* topic) {
+  for (int i = 0; i < SUBSCRIPTION_SLOTS; i++) {
+    if (strcmp(subscriptions[i], topic) == 0) {
+      subscriptions[i][0] = '\0';
+      return true;
+    }
+  }
+  return false;
+}
+
+bool PubSubClient::publish(const char* topic, const char* payload) {
+  return publish(topic, (const uint8_t*)payload, (unsigned int)strlen(payload), false);
+}
+
+bool PubSubClient::publish(const char* topic, const char* payload, bool retained) {
+  return publish(topic, (const uint8_t*)payload, (unsigned int)strlen(payload), retained);
+}
+
+bool PubSubClient::publish(const char* topic, const uint8_t* payload, unsigned int length) {
+  return publish(topic, payload, length, false);
+}
+
+bool PubSubClient::publish(const char* topic, const uint8_t* payload, unsigned int length, bool retained) {
+  // Cabeçalho fixo (até 5) + tamanho do tópico (2) + tópico + payload no buffer
+  if (!connected() || mqttPublishFails || 7 + strlen(topic) + length > bufferSize) {
+    return false;
+  }
+  if (brokerHost[0] != '\0' && !brokerSocket.publish(topic, payload, length, 0, retained)) {
+    mock::dropMqtt();
+    return false;
+  }
+  publishCount++;
+  if (publishHook != nullptr) {
+    publishHook(topic, payload, length, retained, publishContext);
+  }
+  return true;
+}
+
+// ---------- HTTP ----------
+
+bool HTTPClient::begin(WiFiClient& c, const char* url) {
+  (void)url;
+  client    = &c;
+  rangeFrom = 0;
+  return wifiConnected;
+}
+
+void HTTPClient::end() {
+  httpOpen = false;
+  client   = nullptr;
+}
+
+void HTTPClient::setTimeout(uint16_t) {}
+
+void HTTPClient::addHeader(const char* name, const char* value, bool, bool) {
+  if (strcmp(name, "Range") == 0) {
+    sscanf(value, "bytes=%zu-", &rangeFrom);
+  }
+}
+
+int HTTPClient::GET() {
+  httpGets++;
+  httpRange = rangeFrom;
+  if (httpBody == nullptr) return 404;
+  if (rangeFrom > httpLength) return 416;
+  httpPos       = rangeFrom;
+  httpSinceDrop = 0;
+  httpOpen      = true;
+  return rangeFrom > 0 ? HTTP_CODE_PARTIAL_CONTENT : HTTP_CODE_OK;
+}
+
+WiFiClient* HTTPClient::getStreamPtr() {
+  return client;
+}
+
+int WiFiClient::available() {
+  // Chega em pedaços, como num socket
+  return httpOpen ? (int)min<size_t>(httpLength - httpPos, 700) : 0;
+}
+
+bool WiFiClient::connected() {
+  return httpOpen && httpPos < httpLength;
+}
+
+int WiFiClient::read(uint8_t* buf, size_t size) {
+  if (!httpOpen) return -1;
+  if (httpDropEvery > 0 && httpSinceDrop >= httpDropEvery) {
+    httpOpen = false;  // conexão caiu no meio
+    return -1;
+  }
+  size_t n = min(size, httpLength - httpPos);
+  if (httpDropEvery > 0) n = min(n, httpDropEvery - httpSinceDrop);
+  memcpy(buf, httpBody + httpPos, n);
+  httpPos       += n;
+  httpSinceDrop += n;
+  return (int)n;
+}
+
+// ---------- flash / OTA ----------
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t,
+                                                const char* label) {
+  if (type != ESP_PARTITION_TYPE_DATA || label == nullptr || strcmp(label, flightPartition.label) != 0) {
+    return nullptr;
+  }
+  if (flightFlash == nullptr) {
+    flightFlash = (uint8_t*)malloc(flightPartition.size);
+    memset(flightFlash, 0xFF, flightPartition.size);
+  }
+  return &flightPartition;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t* part, size_t offset, void* dst, size_t size) {
+  if (offset + size > part->size) return ESP_ERR_INVALID_ARG;
+  if (part == &flightPartition) {
+    memcpy(dst, flightFlash + offset, size);
+    return ESP_OK;
+  }
+  // app0: a imagem em uso; depois do fim, flash apagada
+  memset(dst, 0xFF, size);
+  if (part == &app0Partition && offset < runningLength) {
+    memcpy(dst, runningImage + offset, min(size, runningLength - offset));
+  }
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t* part, size_t offset, const void* src, size_t size) {
+  if (part != &flightPartition || offset + size > part->size) return ESP_ERR_INVALID_ARG;
+  const uint8_t* in = (const uint8_t*)src;
+  for (size_t i = 0; i < size; i++) {
+    flightFlash[offset + i] &= in[i];  // NOR: escrita só zera bits
+  }
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t* part, size_t offset, size_t size) {
+  if (part != &flightPartition || offset % 4096 != 0 || size % 4096 != 0 || offset + size > part->size) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  memset(flightFlash + offset, 0xFF, size);
+  return ESP_OK;
+}
+
+// mock_crypto.cpp
+void mockSha256(const uint8_t* data, size_t length, uint8_t out[32]);
+
+esp_err_t esp_partition_get_sha256(const esp_partition_t* part, uint8_t* sha) {
+  if (part != &app0Partition) return ESP_ERR_NOT_FOUND;
+  mockSha256(runningImage, runningLength, sha);
+  return ESP_OK;
+}
+
+const esp_partition_t* esp_ota_get_running_partition() { return &app0Partition; }
+const esp_partition_t* esp_ota_get_next_update_partition(const esp_partition_t*) { return &app1Partition; }
+
+esp_err_t esp_ota_begin(const esp_partition_t* part, size_t, esp_ota_handle_t* handle) {
+  if (part != &app1Partition || otaOpen) return ESP_ERR_INVALID_ARG;
+  otaOutput.clear();
+  otaOpen       = true;
+  otaWasAborted = false;
+  *handle = 1;
+  return ESP_OK;
+}
+
+esp_err_t esp_ota_write(esp_ota_handle_t, const void* data, size_t size) {
+  if (!otaOpen || otaOutput.size() + size > APP_SIZE) return ESP_ERR_INVALID_ARG;
+  const uint8_t* in = (const uint8_t*)data;
+  otaOutput.insert(otaOutput.end(), in, in + size);
+  return ESP_OK;
+}
+
+esp_err_t esp_ota_end(esp_ota_handle_t) {
+  if (!otaOpen) return ESP_ERR_INVALID_STATE;
+  otaOpen = false;
+  return otaOutput.empty() ? ESP_FAIL : ESP_OK;
+}
+
+esp_err_t esp_ota_abort(esp_ota_handle_t) {
+  otaOpen       = false;
+  otaWasAborted = true;
+  return ESP_OK;
+}
+
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t* part) {
+  if (part != &app1Partition) return ESP_ERR_INVALID_ARG;
+  otaSwitched = true;
+  return ESP_OK;
+}
+
+esp_err_t esp_ota_get_state_partition(const esp_partition_t*, esp_ota_img_states_t* state) {
+  *state = ESP_OTA_IMG_VALID;
+  return ESP_OK;
+}
+
+esp_err_t esp_ota_mark_app_valid_cancel_rollback() { return ESP_OK; }
@@ -0,0 +1,114 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <string>
+#include <esp_timer.h>
+
+// ==========================================================
+// HAL DE MENTIRA (host): controle pelos testes/benchmarks
+// ==========================================================
+//
+// O firmware compila sem mudança contra os headers desta pasta; o estado
+// do "hardware" fica aqui. Nada neste caminho aloca depois do setup()
+// (o teste de zero alocação roda loop() em cima dele); só as requisições
+// ao servidor local, que chegam fora do loop().
+//
+// Relógio: millis()/micros() só andam quando o teste manda (ou pelo
+// delay()/vTaskDelay() do próprio firmware). Os esp_timer periódicos
+// disparam dentro de advanceMicros, na ordem dos prazos.
+
+namespace mock {
+
+// Volta tudo ao estado de boot (relógio, pinos, Wi-Fi, MQTT, flash, NVS)
+void reset();
+
+// ---------- relógio ----------
+uint64_t nowMicros();
+void     advanceMicros(uint64_t us);
+void     advanceMillis(uint32_t ms);
+
+// Hora "do NTP" (time()): epoch no relógio atual, andando junto com ele.
+// 0 = sem NTP (padrão): time() devolve só os segundos desde o boot.
+void     setWallClock(time_t epoch);
+
+// ---------- pinos / sensores ----------
+void setDigitalInput(int pin, int level);   // padrão: HIGH (pull-up)
+int  digitalOutput(int pin);                // último digitalWrite (-1 = nunca)
+void setAnalog(int pin, uint16_t value);    // padrão: 4095 (seco)
+void setDht(float tempC, float humidity);   // NAN = falha de leitura
+uint32_t ledcDuty(int channel);
+
+// ---------- esp_timer ----------
+// Chama o callback fora do relógio (ex: um tick que já estava em
+// andamento quando o loop parou o timer)
+void fireTimer(esp_timer_handle_t timer);
+int  activeTimers();
+esp_timer_handle_t lastTimer();  // último esp_timer_create (nullptr se nenhum)
+
+// ---------- Wi-Fi / MQTT ----------
+void setWifiConnected(bool connected);
+void setEfuseMac(uint64_t mac);
+
+// Próximas n tentativas de connect() falham (rc = MQTT_CONNECT_FAILED)
+void failMqttConnects(int n);
+// Derruba a conexão atual (o firmware vê connected() == false)
+void dropMqtt();
+// Publicações recusadas pelo cliente (buffer cheio / socket travado)
+void setMqttPublishFails(bool fails);
+
+typedef void (*PublishHook)(const char* topic, const uint8_t* payload, size_t length, bool retained,
+                            void* context);
+void     onMqttPublish(PublishHook hook, void* context);
+uint32_t mqttPublishCount();
+uint32_t mqttConnectCount();
+bool     mqttSubscribed(const char* topic);
+
+// Mensagem do broker: entregue ao callback num próximo client.loop()
+// (só se casar com uma assinatura). false = fila do mock cheia.
+bool mqttInject(const char* topic, const uint8_t* payload, size_t length);
+bool mqttInject(const char* topic, const char* payload);
+
+// Broker de verdade (TCP, MQTT 3.1.1) no lugar da sessão do mock: o
+// PubSubClient conecta, assina e publica pela rede (o gancho de
+// onMqttPublish continua valendo; mqttInject não). reset() volta para o
+// mock.
+void setMqttBroker(const char* host, uint16_t port);
+int  mqttSocketFd();  // -1 = sem conexão com o broker
+
+// ---------- servidor local (ESPAsyncWebServer / ESPmDNS) ----------
+// Sem rede: a requisição vai direto aos handlers do firmware, na thread de
+// quem chama (mock/ESPAsyncWebServer.h). -1 = servidor ainda não subiu.
+// authorization = cabeçalho "Authorization" (nullptr = sem cabeçalho)
+int localRequest(const char* method, const char* url, const char* authorization = nullptr,
+                 std::string* body = nullptr);
+// Handshake do WebSocket (url com ?token=...): cliente, -1 = recusado (404)
+int  wsConnect(const char* url, const char* authorization = nullptr);
+void wsSend(int client, const char* text);      // um quadro de texto inteiro
+bool wsReceive(int client, std::string* text);  // próximo texto do servidor (false = nada)
+void wsClose(int client);
+const char* mdnsHostname();  // "" = mDNS não subiu
+
+// ---------- HTTP (OTA) ----------
+// Corpo servido em qualquer URL; Range "bytes=N-" responde 206.
+// dropEvery > 0: a conexão cai a cada dropEvery bytes entregues.
+void httpServe(const uint8_t* body, size_t length, size_t dropEvery = 0);
+int  httpRequests();        // GETs recebidos
+size_t httpLastRangeFrom(); // início do último Range (0 = sem Range)
+
+// ---------- flash (caixa-preta) ----------
+// Tamanho da partição flightrec (padrão: 512 KB do partitions.csv), antes
+// do setup(); reset() volta ao padrão
+void setFlightSize(uint32_t bytes);
+
+// ---------- OTA (partições app0/app1) ----------
+void           setRunningImage(const uint8_t* image, size_t length);
+const uint8_t* otaWritten(size_t* length);  // o que foi gravado na app1
+bool           otaBootSwitched();            // esp_ota_set_boot_partition chamado
+bool           otaAborted();
+int            restartCount();
+
+// ---------- Serial ----------
+void setSerialEcho(bool echo);  // padrão: desligado (ou MOCK_SERIAL=1)
+
+}  // namespace mock
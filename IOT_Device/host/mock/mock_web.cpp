@@ -0,0 +1,372 @@
+// ESPAsyncWebServer e ESPmDNS no host: sem sockets, os testes entregam as
+// requisições e os quadros do WebSocket direto aos handlers do firmware
+// (mock::localRequest / mock::wsConnect / mock::wsSend, ver mock_hal.h).
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <ESPmDNS.h>
+#include <strings.h>
+
+#include "mock_hal.h"
+
+// ==========================
+// ESTADO
+// ==========================
+
+MDNSResponder MDNS;
+
+static AsyncWebServer* runningServer = nullptr;  // server.begin() já chamado
+static AsyncWebSocket* clientSocket  = nullptr;  // WebSocket do último mock::wsConnect
+static char            mdnsHost[32];
+
+// ==========================
+// REQUISIÇÃO
+// ==========================
+
+static int hexDigit(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// %XX e '+' da query
+static std::string urlDecode(const char* text, size_t length) {
+  std::string out;
+  for (size_t i = 0; i < length; i++) {
+    if (text[i] == '+') {
+      out += ' ';
+    } else if (text[i] == '%' && i + 2 < length && hexDigit(text[i + 1]) >= 0 && hexDigit(text[i + 2]) >= 0) {
+      out += (char)(hexDigit(text[i + 1]) * 16 + hexDigit(text[i + 2]));
+      i += 2;
+    } else {
+      out += text[i];
+    }
+  }
+  return out;
+}
+
+AsyncWebServerRequest::AsyncWebServerRequest(WebRequestMethod method, const char* url, const char* authorization)
+    : requestMethod(method) {
+  const char* query = strchr(url, '?');
+  requestPath.assign(url, query != nullptr ? (size_t)(query - url) : strlen(url));
+  while (query != nullptr) {
+    const char* start = query + 1;
+    query             = strchr(start, '&');
+    size_t      len   = query != nullptr ? (size_t)(query - start) : strlen(start);
+    const char* eq    = (const char*)memchr(start, '=', len);
+    size_t      nameLen = eq != nullptr ? (size_t)(eq - start) : len;
+    std::string name    = urlDecode(start, nameLen);
+    std::string value   = eq != nullptr ? urlDecode(eq + 1, len - nameLen - 1) : std::string();
+    if (!name.empty()) {
+      params.emplace_back(name.c_str(), value.c_str());
+    }
+  }
+  if (authorization != nullptr) {
+    headers.emplace_back("Authorization", authorization);
+  }
+}
+
+bool AsyncWebServerRequest::hasHeader(const char* name) const {
+  for (const AsyncWebHeader& h : headers) {
+    if (strcasecmp(h.name().c_str(), name) == 0) return true;
+  }
+  return false;
+}
+
+AsyncWebHeader* AsyncWebServerRequest::getHeader(const char* name) {
+  for (AsyncWebHeader& h : headers) {
+    if (strcasecmp(h.name().c_str(), name) == 0) return &h;
+  }
+  return nullptr;
+}
+
+bool AsyncWebServerRequest::hasParam(const char* name) const {
+  for (const AsyncWebParameter& p : params) {
+    if (p.name() == name) return true;
+  }
+  return false;
+}
+
+AsyncWebParameter* AsyncWebServerRequest::getParam(const char* name) {
+  for (AsyncWebParameter& p : params) {
+    if (p.name() == name) return &p;
+  }
+  return nullptr;
+}
+
+void AsyncWebServerRequest::send(int status, const String& contentType, const String& content) {
+  (void)contentType;
+  code = status;
+  body = content.c_str();
+}
+
+// ==========================
+// WEBSOCKET
+// ==========================
+
+void AsyncWebSocketClient::text(const char* message, size_t len) {
+  if (!open || !canSend()) {
+    return;  // fila cheia: a biblioteca descarta a mensagem
+  }
+  outbox[(head + queued) % WS_MAX_QUEUED_MESSAGES].assign(message, len);
+  queued++;
+}
+
+bool AsyncWebSocketClient::take(std::string* message) {
+  if (queued == 0) {
+    return false;
+  }
+  message->swap(outbox[head]);  // a posição fica com a memória de *message
+  head = (head + 1) % WS_MAX_QUEUED_MESSAGES;
+  queued--;
+  return true;
+}
+
+void AsyncWebSocketClient::close() {
+  if (server != nullptr) {
+    server->disconnect(this);
+  }
+}
+
+size_t AsyncWebSocket::count() const {
+  size_t n = 0;
+  for (const AsyncWebSocketClient& c : clients) {
+    if (c.open) n++;
+  }
+  return n;
+}
+
+bool AsyncWebSocket::availableForWriteAll() {
+  for (const AsyncWebSocketClient& c : clients) {
+    if (c.open && !c.canSend()) return false;
+  }
+  return true;
+}
+
+void AsyncWebSocket::textAll(const char* message, size_t len) {
+  for (AsyncWebSocketClient& c : clients) {
+    c.text(message, len);
+  }
+}
+
+// Libera os fechados e fecha os mais antigos acima de maxClients
+void AsyncWebSocket::cleanupClients(uint16_t maxClients) {
+  while (count() > maxClients) {
+    AsyncWebSocketClient* oldest = nullptr;
+    for (AsyncWebSocketClient& c : clients) {
+      if (c.open && (oldest == nullptr || c.clientId < oldest->clientId)) oldest = &c;
+    }
+    disconnect(oldest);
+  }
+  for (AsyncWebSocketClient& c : clients) {
+    if (c.used && !c.open) {
+      c.used   = false;
+      c.head   = 0;
+      c.queued = 0;
+    }
+  }
+}
+
+AsyncWebSocketClient* AsyncWebSocket::connectClient(AsyncWebServerRequest* request) {
+  if (!filter(request)) {
+    return nullptr;  // handshake não casa com o handler: 404
+  }
+  for (AsyncWebSocketClient& c : clients) {
+    if (!c.used) {
+      c.used     = true;
+      c.open     = true;
+      c.clientId = nextId++;
+      c.server   = this;
+      c.head     = 0;
+      c.queued   = 0;
+      if (eventHandler != nullptr) {
+        eventHandler(this, &c, WS_EVT_CONNECT, request, nullptr, 0);
+      }
+      return &c;
+    }
+  }
+  return nullptr;
+}
+
+AsyncWebSocketClient* AsyncWebSocket::client(int slot) {
+  if (slot < 0 || slot >= CLIENT_SLOTS || !clients[slot].used) {
+    return nullptr;
+  }
+  return &clients[slot];
+}
+
+void AsyncWebSocket::receive(AsyncWebSocketClient* client, const char* text) {
+  if (!client->open || eventHandler == nullptr) {
+    return;
+  }
+  // O handler recebe o quadro num buffer mutável (como o do AsyncTCP)
+  std::string  frame(text);
+  AwsFrameInfo info   = {};
+  info.message_opcode = WS_TEXT;
+  info.final          = 1;
+  info.opcode         = WS_TEXT;
+  info.len            = frame.size();
+  eventHandler(this, client, WS_EVT_DATA, &info, (uint8_t*)&frame[0], frame.size());
+}
+
+void AsyncWebSocket::disconnect(AsyncWebSocketClient* client) {
+  if (!client->open) {
+    return;
+  }
+  client->open = false;
+  if (eventHandler != nullptr) {
+    eventHandler(this, client, WS_EVT_DISCONNECT, nullptr, nullptr, 0);
+  }
+}
+
+// ==========================
+// SERVIDOR
+// ==========================
+
+void AsyncWebServer::begin() {
+  runningServer = this;
+}
+
+void AsyncWebServer::end() {
+  if (runningServer == this) {
+    runningServer = nullptr;
+  }
+}
+
+AsyncWebHandler& AsyncWebServer::addHandler(AsyncWebHandler* handler) {
+  if (handlerCount == HANDLER_SLOTS) {
+    fprintf(stderr, "[MOCK] AsyncWebServer: handlers demais\n");
+    abort();
+  }
+  handlers[handlerCount++] = handler;
+  return *handler;
+}
+
+AsyncCallbackWebHandler& AsyncWebServer::on(const char* uri, WebRequestMethodComposite method,
+                                            ArRequestHandlerFunction onRequest) {
+  if (routeCount == HANDLER_SLOTS) {
+    fprintf(stderr, "[MOCK] AsyncWebServer: rotas demais\n");
+    abort();
+  }
+  AsyncCallbackWebHandler& route = routes[routeCount++];
+  route.uri      = uri;
+  route.method   = method;
+  route.callback = onRequest;
+  return route;
+}
+
+void AsyncWebServer::handle(AsyncWebServerRequest* request) {
+  for (int i = 0; i < routeCount; i++) {
+    AsyncCallbackWebHandler& route = routes[i];
+    if (strcmp(route.uri, request->path()) == 0 && (route.method & request->method()) != 0 &&
+        route.filter(request)) {
+      route.callback(request);
+      return;
+    }
+  }
+  request->send(404, "text/plain", "Not found");
+}
+
+AsyncWebSocket* AsyncWebServer::webSocket(const char* path) {
+  for (int i = 0; i < handlerCount; i++) {
+    AsyncWebSocket* ws = dynamic_cast<AsyncWebSocket*>(handlers[i]);
+    if (ws != nullptr && strcmp(ws->url(), path) == 0) {
+      return ws;
+    }
+  }
+  return nullptr;
+}
+
+// ==========================
+// mDNS
+// ==========================
+
+bool MDNSResponder::begin(const char* hostName) {
+  if (hostName == nullptr || hostName[0] == '\0') {
+    return false;
+  }
+  snprintf(mdnsHost, sizeof(mdnsHost), "%s", hostName);
+  return true;
+}
+
+void MDNSResponder::end() {
+  mdnsHost[0] = '\0';
+}
+
+bool MDNSResponder::addService(const char*, const char*, uint16_t) { return mdnsHost[0] != '\0'; }
+bool MDNSResponder::addServiceTxt(const char*, const char*, const char*, const char*) { return mdnsHost[0] != '\0'; }
+
+// ==========================
+// CONTROLE (mock_hal.h)
+// ==========================
+
+namespace mock {
+
+static WebRequestMethod parseMethod(const char* method) {
+  if (strcmp(method, "GET") == 0) return HTTP_GET;
+  if (strcmp(method, "POST") == 0) return HTTP_POST;
+  if (strcmp(method, "PUT") == 0) return HTTP_PUT;
+  if (strcmp(method, "DELETE") == 0) return HTTP_DELETE;
+  if (strcmp(method, "PATCH") == 0) return HTTP_PATCH;
+  if (strcmp(method, "HEAD") == 0) return HTTP_HEAD;
+  return HTTP_OPTIONS;
+}
+
+int localRequest(const char* method, const char* url, const char* authorization, std::string* body) {
+  if (runningServer == nullptr) {
+    return -1;
+  }
+  AsyncWebServerRequest request(parseMethod(method), url, authorization);
+  runningServer->handle(&request);
+  if (body != nullptr) {
+    *body = request.responseBody();
+  }
+  return request.responseCode();
+}
+
+int wsConnect(const char* url, const char* authorization) {
+  if (runningServer == nullptr) {
+    return -1;
+  }
+  AsyncWebServerRequest request(HTTP_GET, url, authorization);
+  AsyncWebSocket*       ws = runningServer->webSocket(request.path());
+  if (ws == nullptr) {
+    return -1;
+  }
+  AsyncWebSocketClient* client = ws->connectClient(&request);
+  if (client == nullptr) {
+    return -1;
+  }
+  clientSocket = ws;
+  for (int slot = 0; slot < AsyncWebSocket::CLIENT_SLOTS; slot++) {
+    if (ws->client(slot) == client) {
+      return slot;
+    }
+  }
+  return -1;
+}
+
+void wsSend(int client, const char* text) {
+  AsyncWebSocketClient* c = clientSocket != nullptr ? clientSocket->client(client) : nullptr;
+  if (c != nullptr) {
+    clientSocket->receive(c, text);
+  }
+}
+
+bool wsReceive(int client, std::string* text) {
+  AsyncWebSocketClient* c = clientSocket != nullptr ? clientSocket->client(client) : nullptr;
+  return c != nullptr && c->take(text);
+}
+
+void wsClose(int client) {
+  AsyncWebSocketClient* c = clientSocket != nullptr ? clientSocket->client(client) : nullptr;
+  if (c != nullptr) {
+    c->close();
+  }
+}
+
+const char* mdnsHostname() {
+  return mdnsHost;
+}
+
+}  // namespace mock
@@ -0,0 +1,286 @@
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "mqtt_socket.h"
+
+// ==========================
+// PROTOCOLO
+// ==========================
+
+static const uint8_t CONNECT    = 0x10;
+static const uint8_t CONNACK    = 0x20;
+static const uint8_t PUBLISH    = 0x30;
+static const uint8_t PUBACK     = 0x40;
+static const uint8_t SUBSCRIBE  = 0x82;  // bits reservados = 0010
+static const uint8_t PINGREQ    = 0xC0;
+static const uint8_t DISCONNECT = 0xE0;
+
+static uint64_t monotonicMs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1'000'000;
+}
+
+// "Remaining length": 7 bits por byte, bit 7 = continua
+static size_t encodeLength(size_t n, uint8_t* out) {
+  size_t i = 0;
+  do {
+    uint8_t b = n % 128;
+    n /= 128;
+    out[i++] = n > 0 ? (b | 0x80) : b;
+  } while (n > 0);
+  return i;
+}
+
+// false = cabeçalho fixo ainda incompleto no buffer
+static bool decodeLength(const uint8_t* buf, size_t len, size_t& remaining, size_t& headerLen) {
+  size_t value = 0;
+  for (size_t i = 1; i < len && i <= 4; i++) {
+    value |= (size_t)(buf[i] & 0x7F) << (7 * (i - 1));
+    if ((buf[i] & 0x80) == 0) {
+      remaining = value;
+      headerLen = i + 1;
+      return true;
+    }
+  }
+  return false;
+}
+
+// ==========================
+// CONEXÃO
+// ==========================
+
+bool MqttSocket::connect(const char* host, uint16_t port, const char* clientId, uint16_t keepAliveS,
+                         int timeoutMs) {
+  close();
+
+  char service[8];
+  snprintf(service, sizeof(service), "%u", port);
+  addrinfo hints = {};
+  hints.ai_family   = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo* found   = nullptr;
+  if (getaddrinfo(host, service, &hints, &found) != 0) {
+    return false;
+  }
+  for (addrinfo* a = found; a != nullptr && sock < 0; a = a->ai_next) {
+    int s = socket(a->ai_family, a->ai_socktype | SOCK_CLOEXEC, a->ai_protocol);
+    if (s < 0) {
+      continue;
+    }
+    // Prazo do connect, do envio e da espera do CONNACK
+    timeval tv = { timeoutMs / 1000, (timeoutMs % 1000) * 1000 };
+    setsockopt(s, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    int one = 1;
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (::connect(s, a->ai_addr, a->ai_addrlen) == 0) {
+      sock = s;
+    } else {
+      ::close(s);
+    }
+  }
+  freeaddrinfo(found);
+  if (sock < 0) {
+    return false;
+  }
+
+  keepAliveMs = keepAliveS * 1000u;
+  size_t  idLen      = strlen(clientId);
+  uint8_t variable[] = { 0, 4, 'M', 'Q', 'T', 'T', 4,
+                         0x02,  // clean session
+                         (uint8_t)(keepAliveS >> 8), (uint8_t)keepAliveS,
+                         (uint8_t)(idLen >> 8), (uint8_t)idLen };
+  const void* parts[]   = { variable, clientId };
+  size_t      lengths[] = { sizeof(variable), idLen };
+  if (!send(CONNECT, parts, lengths, 2)) {
+    return false;
+  }
+
+  // CONNACK: 4 bytes, código de retorno 0 = aceito
+  while (rxLen < 4) {
+    if (fill(true) <= 0) {
+      close();
+      return false;
+    }
+  }
+  if (rx[0] != CONNACK || rx[1] != 2 || rx[3] != 0) {
+    close();
+    return false;
+  }
+  drop(4);
+  return true;
+}
+
+void MqttSocket::disconnect() {
+  if (sock >= 0) {
+    send(DISCONNECT, nullptr, nullptr, 0);
+  }
+  close();
+}
+
+void MqttSocket::close() {
+  if (sock >= 0) {
+    ::close(sock);
+  }
+  sock     = -1;
+  rxLen    = 0;
+  consumed = 0;
+  skip     = 0;
+}
+
+// ==========================
+// ENVIO
+// ==========================
+
+bool MqttSocket::send(uint8_t header, const void* const* parts, const size_t* lengths, int count) {
+  if (sock < 0) {
+    return false;
+  }
+  size_t bodyLen = 0;
+  for (int i = 0; i < count; i++) {
+    bodyLen += lengths[i];
+  }
+  uint8_t fixed[5] = { header };
+  iovec   iov[8];
+  iov[0] = { fixed, 1 + encodeLength(bodyLen, fixed + 1) };
+  for (int i = 0; i < count; i++) {
+    iov[i + 1] = { const_cast<void*>(parts[i]), lengths[i] };
+  }
+  msghdr msg = {};
+  msg.msg_iov    = iov;
+  msg.msg_iovlen = count + 1;
+
+  // Envio pela metade (prazo estourado) deixa o fluxo sem volta: fecha
+  ssize_t sent = sendmsg(sock, &msg, MSG_NOSIGNAL);
+  if (sent != (ssize_t)(iov[0].iov_len + bodyLen)) {
+    close();
+    return false;
+  }
+  lastSentMs = monotonicMs();
+  return true;
+}
+
+bool MqttSocket::publish(const char* topic, const uint8_t* payload, size_t length, uint8_t qos, bool retained) {
+  size_t  topicLen    = strlen(topic);
+  uint8_t topicHead[] = { (uint8_t)(topicLen >> 8), (uint8_t)topicLen };
+  uint8_t id[]        = { (uint8_t)(nextId >> 8), (uint8_t)nextId };
+  if (qos > 0) {
+    nextId = nextId == 0xFFFF ? 1 : nextId + 1;
+  }
+  const void* parts[]   = { topicHead, topic, id, payload };
+  size_t      lengths[] = { 2, topicLen, qos > 0 ? 2u : 0u, length };
+  return send(PUBLISH | (uint8_t)(qos << 1) | (retained ? 1 : 0), parts, lengths, 4);
+}
+
+bool MqttSocket::subscribe(const char* topic, uint8_t qos) {
+  size_t  topicLen    = strlen(topic);
+  uint8_t id[]        = { (uint8_t)(nextId >> 8), (uint8_t)nextId };
+  uint8_t topicHead[] = { (uint8_t)(topicLen >> 8), (uint8_t)topicLen };
+  nextId = nextId == 0xFFFF ? 1 : nextId + 1;
+  const void* parts[]   = { id, topicHead, topic, &qos };
+  size_t      lengths[] = { 2, 2, topicLen, 1 };
+  return send(SUBSCRIBE, parts, lengths, 4);
+}
+
+// ==========================
+// RECEBIMENTO
+// ==========================
+
+int MqttSocket::fill(bool wait) {
+  if (sock < 0 || rxLen == RX_MAX) {
+    return sock < 0 ? -1 : 0;
+  }
+  ssize_t n = recv(sock, rx + rxLen, RX_MAX - rxLen, wait ? 0 : MSG_DONTWAIT);
+  if (n > 0) {
+    rxLen += (size_t)n;
+    return (int)n;
+  }
+  if (n < 0 && !wait && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+    return 0;
+  }
+  return -1;  // broker fechou, erro ou prazo do CONNACK
+}
+
+void MqttSocket::drop(size_t n) {
+  memmove(rx, rx + n, rxLen - n);
+  rxLen -= n;
+}
+
+bool MqttSocket::readPublish(size_t headerLen, size_t remaining, MqttMessage& out) {
+  const uint8_t* p        = rx + headerLen;
+  uint8_t        qos      = (rx[0] >> 1) & 0x03;
+  size_t         topicLen = remaining >= 2 ? ((size_t)p[0] << 8 | p[1]) : SIZE_MAX;
+  size_t         offset   = 2 + topicLen + (qos > 0 ? 2 : 0);
+  if (topicLen >= sizeof(out.topic) || offset > remaining) {
+    return false;
+  }
+  memcpy(out.topic, p + 2, topicLen);
+  out.topic[topicLen] = '\0';
+  out.payload         = p + offset;
+  out.length          = remaining - offset;
+
+  if (qos == 1) {
+    const void* parts[]   = { p + offset - 2 };
+    size_t      lengths[] = { 2 };
+    send(PUBACK, parts, lengths, 1);  // falhou: o próximo poll() vê o socket fechado
+  }
+  return true;
+}
+
+MqttSocket::Poll MqttSocket::poll(MqttMessage& out) {
+  // O pacote entregue da outra vez sai do buffer
+  if (consumed > 0) {
+    drop(consumed);
+    consumed = 0;
+  }
+  if (sock < 0) {
+    return Poll::CLOSED;
+  }
+  if (keepAliveMs > 0 && monotonicMs() - lastSentMs >= keepAliveMs && !send(PINGREQ, nullptr, nullptr, 0)) {
+    return Poll::CLOSED;
+  }
+
+  for (;;) {
+    if (skip > 0) {
+      size_t n = skip < rxLen ? skip : rxLen;
+      drop(n);
+      skip -= n;
+    }
+    size_t remaining, headerLen;
+    if (skip == 0 && rxLen >= 2) {
+      if (!decodeLength(rx, rxLen, remaining, headerLen)) {
+        if (rxLen >= 5) {  // comprimento com mais de 4 bytes: fluxo inválido
+          close();
+          return Poll::CLOSED;
+        }
+      } else if (headerLen + remaining > RX_MAX) {
+        skip = headerLen + remaining;
+        continue;
+      } else if (rxLen >= headerLen + remaining) {
+        if ((rx[0] & 0xF0) == PUBLISH && readPublish(headerLen, remaining, out)) {
+          consumed = sock >= 0 ? headerLen + remaining : 0;  // PUBACK falhou: buffer já zerado
+          return Poll::MESSAGE;
+        }
+        drop(headerLen + remaining);  // SUBACK, PUBACK, PINGRESP
+        continue;
+      }
+    }
+    int got = fill(false);
+    if (got < 0) {
+      close();
+      return Poll::CLOSED;
+    }
+    if (got == 0) {
+      return Poll::IDLE;
+    }
+  }
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// ==========================================================
+// MQTT 3.1.1 SOBRE TCP (host)
+// ==========================================================
+//
+// Cliente mínimo para um broker de verdade: é a rede do PubSubClient do
+// mock com mock::setMqttBroker e o cliente de sonda do varal_swarm.
+//
+// - connect() bloqueia até o CONNACK (com prazo); o resto não bloqueia
+//   na leitura (envio com o mesmo prazo, socket travado = conexão morta)
+// - poll(): um PUBLISH recebido por chamada; PUBACK dos QoS1 sai na hora,
+//   SUBACK/PUBACK/PINGRESP são descartados; PINGREQ no keepalive
+// - sem alocação e sem thread: todo o estado fica no objeto (o enxame
+//   troca o estado do mock junto com o do firmware)
+
+struct MqttMessage {
+  char           topic[128];
+  const uint8_t* payload;  // dentro do buffer do socket: vale até o próximo poll()
+  size_t         length;
+};
+
+class MqttSocket {
+public:
+  static const size_t RX_MAX = 4096;  // pacote maior que isso é descartado
+
+  enum class Poll { IDLE, MESSAGE, CLOSED };
+
+  bool connect(const char* host, uint16_t port, const char* clientId, uint16_t keepAliveS, int timeoutMs);
+  void disconnect();  // DISCONNECT e fecha
+  void close();
+  bool isOpen() const { return sock >= 0; }
+  int  fd() const { return sock; }
+
+  bool publish(const char* topic, const uint8_t* payload, size_t length, uint8_t qos, bool retained);
+  bool subscribe(const char* topic, uint8_t qos);
+
+  Poll poll(MqttMessage& out);
+
+private:
+  bool send(uint8_t header, const void* const* parts, const size_t* lengths, int count);
+  int  fill(bool wait);  // bytes lidos; 0 = nada ainda, -1 = fechou
+  void drop(size_t n);
+  bool readPublish(size_t headerLen, size_t remaining, MqttMessage& out);
+
+  int      sock        = -1;
+  uint32_t keepAliveMs = 0;
+  uint16_t nextId      = 1;
+  uint64_t lastSentMs  = 0;
+  size_t   consumed    = 0;  // pacote entregue no poll() anterior
+  size_t   skip        = 0;  // resto de um pacote grande demais
+  size_t   rxLen       = 0;
+  uint8_t  rx[RX_MAX];
+};
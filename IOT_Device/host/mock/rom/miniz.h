@@ -0,0 +1,38 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// tinfl da ROM do ESP32, no host em cima do zlib (mock_crypto.cpp). Mantém
+// o contrato de saída do tinfl (buffer potência de 2, NEEDS_MORE_INPUT /
+// HAS_MORE_OUTPUT); a janela do deflate fica com o zlib.
+
+typedef uint8_t  mz_uint8;
+typedef uint32_t mz_uint32;
+
+enum {
+  TINFL_FLAG_PARSE_ZLIB_HEADER             = 1,
+  TINFL_FLAG_HAS_MORE_INPUT                = 2,
+  TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF = 4,
+  TINFL_FLAG_COMPUTE_ADLER32               = 8
+};
+
+typedef enum {
+  TINFL_STATUS_BAD_PARAM         = -3,
+  TINFL_STATUS_ADLER32_MISMATCH  = -2,
+  TINFL_STATUS_FAILED            = -1,
+  TINFL_STATUS_DONE              = 0,
+  TINFL_STATUS_NEEDS_MORE_INPUT  = 1,
+  TINFL_STATUS_HAS_MORE_OUTPUT   = 2
+} tinfl_status;
+
+typedef struct {
+  mz_uint32 m_state;
+  void*     stream;         // z_stream do zlib (criado no primeiro bloco)
+  uint8_t   reserved[10992]; // mesmo tamanho aproximado do tinfl da ROM
+} tinfl_decompressor;
+
+#define tinfl_init(r) do { (r)->m_state = 0; (r)->stream = nullptr; } while (0)
+
+tinfl_status tinfl_decompress(tinfl_decompressor* r, const mz_uint8* pIn_buf_next, size_t* pIn_buf_size,
+                              mz_uint8* pOut_buf_start, mz_uint8* pOut_buf_next, size_t* pOut_buf_size,
+                              const mz_uint32 decomp_flags);
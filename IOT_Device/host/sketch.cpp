@@ -0,0 +1,2 @@
+// O sketch do Arduino como uma unidade de tradução C++ comum
+#include "projeto_iot.ino"
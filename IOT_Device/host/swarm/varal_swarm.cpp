@@ -0,0 +1,888 @@
+// Enxame de varais com o firmware de verdade: N varais num processo, cada
+// um rodando o setup()/loop() do projeto_iot inteiro (varal_controller.cpp,
+// rain_sensor.cpp, heartbeat do mqtt_manager/telemetry...) contra sensores
+// simulados, falando MQTT com um broker local pelo PubSubClient do mock
+// (mock::setMqttBroker).
+//
+// O firmware vive em estáticos: swarm/fw_state.ld junta o .data/.bss de
+// todo o libvaral_firmware.a (firmware + mock) numa seção só. Cada varal
+// guarda a sua cópia dessa seção e o laço troca a cópia antes de rodar o
+// loop() dele. Ponteiros continuam valendo (toda cópia roda no mesmo
+// endereço) e o que o firmware alocou no heap é só daquele varal.
+//
+// Sem thread por varal: um event loop por processo, com uma rodada por
+// todos os varais a cada --tick-ms e, no resto da rodada, epoll nos
+// sockets para atender na hora quem recebeu mensagem. --workers processos
+// (fork) dividem os varais; o processo pai mede o round-trip de comando
+// com um cliente MQTT próprio e junta os relatórios.
+//
+// Métricas (as mesmas do backend/tools/swarm_sim.py):
+// - taxa de publicação (tudo o que os firmwares publicaram)
+// - round-trip de comando: nova versão do desejado (PUT
+//   /devices/{id}/desired com --backend-url, senão publicada direto em
+//   casa/<id>/desired) -> heartbeat com "dv" >= essa versão
+// - atraso de ingestão no backend (received_at - instante do publish),
+//   amostrando GET /devices/{id}/heartbeat com --backend-url
+//
+//   varal_swarm --devices 5000 --workers 4 --backend-url http://localhost:8000
+
+#include <Arduino.h>
+#include <errno.h>
+#include <getopt.h>
+#include <math.h>
+#include <netdb.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "mock_hal.h"
+#include "mqtt_socket.h"
+#include "mqtt_manager.h"
+#include "stepper_motor.h"
+
+void setup();
+void loop();
+
+// Limites da seção do swarm/fw_state.ld
+extern "C" uint8_t __fw_state_start[];
+extern "C" uint8_t __fw_state_end[];
+
+namespace {
+
+// ==========================
+// CONFIGURAÇÃO
+// ==========================
+
+// Pinos da placa (stepper_motor.cpp / rain_sensor.cpp)
+const int ENDSTOP_PIN      = 32;
+const int RAIN_ANALOG_PIN  = 34;
+const int RAIN_DIGITAL_PIN = 25;
+
+const int      BOOT_BATCH     = 50;    // setup() por rodada em cada worker
+const uint64_t STEP_SLICE_US  = 1000;  // volta do loop() com o motor andando
+const int      LAG_SAMPLES    = 32;    // GET de heartbeat por relatório (todos os workers)
+const int      HTTP_TIMEOUT_S = 2;
+const double   FINAL_GRACE_S  = 5.0;   // espera pelos últimos relatórios dos workers
+
+const char* const MODES[] = { "AUTO", "FORCE_OPEN", "FORCE_CLOSE" };
+
+struct Options {
+  int         devices        = 500;
+  int         workers        = 4;
+  std::string broker         = "localhost";
+  int         port           = 1883;
+  double      duration       = 60.0;
+  double      cmdRate        = 5.0;
+  std::string backendUrl;
+  double      reportInterval = 5.0;
+  uint32_t    seed           = 1;
+  uint32_t    macBase        = 0x100000;
+  int         tickMs         = 50;
+  uint32_t    flightKb       = 16;
+  double      rainPerHour    = 0.5;
+};
+
+volatile sig_atomic_t stopRequested = 0;
+
+// ==========================
+// RELÓGIOS (time() é o do mock: do varal que estiver carregado)
+// ==========================
+
+uint64_t monotonicUs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1'000'000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+double monotonicS() {
+  return monotonicUs() / 1e6;
+}
+
+double epochS() {
+  timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// xorshift32: estado de 4 bytes por varal
+uint32_t nextRandom(uint32_t& state) {
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+double uniform(uint32_t& state, double lo, double hi) {
+  return lo + (hi - lo) * (nextRandom(state) / 4294967296.0);
+}
+
+// Valor numérico de "chave": no JSON (o firmware e o backend não aninham o que lemos)
+bool jsonNumber(const std::string& doc, const char* key, double& out) {
+  std::string pattern = std::string("\"") + key + "\":";
+  size_t      at      = doc.find(pattern);
+  if (at == std::string::npos) {
+    return false;
+  }
+  const char* start = doc.c_str() + at + pattern.size();
+  char*       end   = nullptr;
+  out               = strtod(start, &end);
+  return end != start;
+}
+
+std::string percentiles(std::vector<double> values) {
+  if (values.empty()) {
+    return "—";
+  }
+  std::sort(values.begin(), values.end());
+  auto pick = [&](double p) {
+    return values[std::min(values.size() - 1, (size_t)(p * values.size()))] * 1000.0;
+  };
+  char text[96];
+  snprintf(text, sizeof(text), "p50=%.1fms p95=%.1fms p99=%.1fms (n=%zu)", pick(0.50), pick(0.95), pick(0.99),
+           values.size());
+  return text;
+}
+
+// ==========================
+// HTTP (backend)
+// ==========================
+
+struct Url {
+  std::string host;
+  std::string port = "80";
+  std::string base;  // caminho antes de /devices
+};
+
+bool parseUrl(const std::string& text, Url& out) {
+  const std::string scheme = "http://";
+  if (text.compare(0, scheme.size(), scheme) != 0) {
+    return false;
+  }
+  std::string rest  = text.substr(scheme.size());
+  size_t      slash = rest.find('/');
+  std::string hostPort = rest.substr(0, slash);
+  out.base             = slash == std::string::npos ? "" : rest.substr(slash);
+  while (!out.base.empty() && out.base.back() == '/') {
+    out.base.pop_back();
+  }
+  size_t colon = hostPort.rfind(':');
+  out.host     = hostPort.substr(0, colon);
+  if (colon != std::string::npos) {
+    out.port = hostPort.substr(colon + 1);
+  }
+  return !out.host.empty();
+}
+
+// Requisição bloqueante (Connection: close); status HTTP ou -1
+int httpRequest(const Url& url, const char* method, const std::string& path, const std::string& body,
+                std::string& response) {
+  addrinfo hints = {};
+  hints.ai_family   = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo* found   = nullptr;
+  if (getaddrinfo(url.host.c_str(), url.port.c_str(), &hints, &found) != 0) {
+    return -1;
+  }
+  int sock = -1;
+  for (addrinfo* a = found; a != nullptr && sock < 0; a = a->ai_next) {
+    sock = socket(a->ai_family, a->ai_socktype | SOCK_CLOEXEC, a->ai_protocol);
+    if (sock < 0) {
+      continue;
+    }
+    timeval tv = { HTTP_TIMEOUT_S, 0 };
+    setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    if (connect(sock, a->ai_addr, a->ai_addrlen) != 0) {
+      close(sock);
+      sock = -1;
+    }
+  }
+  freeaddrinfo(found);
+  if (sock < 0) {
+    return -1;
+  }
+
+  std::string request = std::string(method) + " " + url.base + path + " HTTP/1.1\r\nHost: " + url.host +
+                        "\r\nConnection: close\r\nContent-Type: application/json\r\nContent-Length: " +
+                        std::to_string(body.size()) + "\r\n\r\n" + body;
+  bool sent = send(sock, request.data(), request.size(), MSG_NOSIGNAL) == (ssize_t)request.size();
+
+  std::string raw;
+  char        chunk[4096];
+  ssize_t     n;
+  while (sent && (n = recv(sock, chunk, sizeof(chunk), 0)) > 0) {
+    raw.append(chunk, (size_t)n);
+  }
+  close(sock);
+
+  size_t headerEnd = raw.find("\r\n\r\n");
+  if (!sent || raw.compare(0, 5, "HTTP/") != 0 || headerEnd == std::string::npos) {
+    return -1;
+  }
+  response = raw.substr(headerEnd + 4);
+  return atoi(raw.c_str() + raw.find(' ') + 1);
+}
+
+// ==========================
+// VARAIS (worker)
+// ==========================
+
+struct Device {
+  uint8_t* image     = nullptr;  // cópia do estado do firmware + mock
+  uint32_t index     = 0;        // posição no vetor do worker (epoll)
+  uint32_t number    = 0;        // número no enxame (MAC)
+  uint64_t bootUs    = 0;        // relógio real no boot: o do mock conta daqui
+  uint32_t connects  = 0;        // mock::mqttConnectCount() já visto (socket novo)
+  bool     connected = false;
+  char     id[24]    = "";       // mqttGetDeviceId() depois do setup()
+
+  // Sensores simulados: chuva marcada no tempo, umidade sobe antes
+  uint32_t rng         = 0;
+  double   rainStartS  = 0;
+  double   rainEndS    = 0;
+  double   lastSenseS  = 0;
+  float    humidity    = 55.0f;
+  float    temperature = 26.0f;
+
+  // Último heartbeat que saiu (atraso de ingestão)
+  bool          heartbeatSent = false;
+  unsigned long heartbeatUptimeMs = 0;
+  double        heartbeatEpoch    = 0;
+};
+
+// Relatório de um worker para o pai (um write() atômico, < PIPE_BUF)
+struct Report {
+  uint64_t published;   // acumulado
+  uint64_t heartbeats;  // acumulado
+  uint32_t booted;
+  uint32_t connected;
+  float    slowestRoundMs;
+  uint32_t lagCount;
+  float    lags[LAG_SAMPLES];
+  bool     finished;
+};
+
+class Worker {
+public:
+  Worker(const Options& options, int index) : opt(options), workerIndex(index), sampler(options.seed + index + 1) {}
+
+  int run(int out);
+
+private:
+  void activate(Device& dev);
+  void boot(Device& dev);
+  void turn(Device& dev);
+  void sense(Device& dev, uint64_t uptimeUs);
+  void sampleIngestLag(Report& report);
+
+  static void onPublish(const char* topic, const uint8_t* payload, size_t length, bool retained, void* context);
+
+  const Options&       opt;
+  int                  workerIndex;
+  std::vector<Device>  devices;
+  std::vector<uint8_t> pristine;  // estado antes do primeiro setup()
+  Device*              active  = nullptr;
+  int                  epoll   = -1;
+  uint32_t             sampler = 0;  // sorteio dos GET de heartbeat
+  Url                  backend;
+
+  static uint64_t published;
+  static uint64_t heartbeats;
+};
+
+uint64_t Worker::published  = 0;
+uint64_t Worker::heartbeats = 0;
+
+size_t stateSize() {
+  return (size_t)(__fw_state_end - __fw_state_start);
+}
+
+// Troca o estado carregado: o do varal anterior volta para a cópia dele
+void Worker::activate(Device& dev) {
+  if (active == &dev) {
+    return;
+  }
+  if (active != nullptr) {
+    memcpy(active->image, __fw_state_start, stateSize());
+  }
+  memcpy(__fw_state_start, dev.image, stateSize());
+  active = &dev;
+}
+
+void Worker::boot(Device& dev) {
+  if (active != nullptr) {
+    memcpy(active->image, __fw_state_start, stateSize());
+  }
+  dev.image = (uint8_t*)malloc(stateSize());
+  memcpy(__fw_state_start, pristine.data(), stateSize());
+  active = &dev;
+
+  mock::reset();
+  mock::setEfuseMac((uint64_t)((opt.macBase + dev.number) & 0xFFFFFF) << 24);
+  mock::setDigitalInput(ENDSTOP_PIN, LOW);  // homing na hora
+  mock::setFlightSize(opt.flightKb * 1024);
+  mock::setMqttBroker(opt.broker.c_str(), (uint16_t)opt.port);
+  mock::onMqttPublish(onPublish, &dev);
+  mock::setWallClock((time_t)epochS());
+
+  dev.rng        = opt.seed * 2654435761u + dev.number + 1;
+  dev.rainEndS   = 0;
+  dev.lastSenseS = 0;
+  sense(dev, 0);
+  dev.bootUs = monotonicUs();
+  setup();
+  snprintf(dev.id, sizeof(dev.id), "%s", mqttGetDeviceId());
+  turn(dev);
+}
+
+// Uma volta do varal: relógio do mock até o real e loop()
+void Worker::turn(Device& dev) {
+  activate(dev);
+  uint64_t target = monotonicUs() - dev.bootUs;
+  sense(dev, target);
+  if (target > mock::nowMicros()) {
+    // Motor andando: voltas de 1 ms até alcançar o relógio (um passo por volta, como no ESP32)
+    while (stepperIsMoving() && mock::nowMicros() + STEP_SLICE_US < target) {
+      mock::advanceMicros(STEP_SLICE_US);
+      loop();
+    }
+    mock::advanceMicros(target - mock::nowMicros());
+  }
+  loop();
+  dev.connected = mqttIsConnected();
+
+  // Socket novo (conexão ou reconexão): entra no epoll
+  uint32_t connects = mock::mqttConnectCount();
+  int      fd       = mock::mqttSocketFd();
+  if (connects != dev.connects && fd >= 0) {
+    dev.connects = connects;
+    epoll_event ev = {};
+    ev.events      = EPOLLIN;
+    ev.data.u32    = dev.index;
+    if (epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &ev) != 0 && errno == EEXIST) {
+      epoll_ctl(epoll, EPOLL_CTL_MOD, fd, &ev);
+    }
+  }
+}
+
+// Tempo do varal: chuva começa ao acaso (--rain-per-hour) e dura de 2 a 20
+// min; a umidade sobe nos 15 min antes (a previsão tem o que ver)
+void Worker::sense(Device& dev, uint64_t uptimeUs) {
+  double t = uptimeUs / 1e6;
+  if (t >= dev.rainEndS) {
+    double gap    = opt.rainPerHour > 0 ? -log(1.0 - uniform(dev.rng, 0, 1)) * 3600.0 / opt.rainPerHour : 1e12;
+    dev.rainStartS = t + gap;
+    dev.rainEndS   = dev.rainStartS + uniform(dev.rng, 120, 1200);
+  }
+  bool  raining    = t >= dev.rainStartS;
+  float humTarget  = raining ? 95.0f : dev.rainStartS - t < 900 ? 90.0f : 55.0f;
+  float tempTarget = raining ? 18.0f : 26.0f;
+  float alpha      = (float)(1.0 - exp(-(t - dev.lastSenseS) / 300.0));
+  dev.lastSenseS   = t;
+  dev.humidity    += (humTarget - dev.humidity) * alpha;
+  dev.temperature += (tempTarget - dev.temperature) * alpha;
+
+  mock::setDht(dev.temperature + (float)uniform(dev.rng, -0.3, 0.3),
+               dev.humidity + (float)uniform(dev.rng, -1.0, 1.0));
+  uint16_t wet = raining ? (uint16_t)uniform(dev.rng, 1400, 2200) : (uint16_t)uniform(dev.rng, 0, 150);
+  mock::setAnalog(RAIN_ANALOG_PIN, 4095 - wet);
+  mock::setDigitalInput(RAIN_DIGITAL_PIN, raining ? LOW : HIGH);
+}
+
+void Worker::onPublish(const char* topic, const uint8_t* payload, size_t length, bool retained, void* context) {
+  (void)retained;
+  published++;
+  size_t topicLen = strlen(topic);
+  if (topicLen < 10 || strcmp(topic + topicLen - 10, "/heartbeat") != 0) {
+    return;
+  }
+  heartbeats++;
+  static const char KEY[] = "\"uptime_ms\":";
+  const void* at = memmem(payload, length, KEY, sizeof(KEY) - 1);
+  if (at != nullptr) {
+    Device& dev          = *(Device*)context;
+    dev.heartbeatSent    = true;
+    dev.heartbeatUptimeMs = strtoul((const char*)at + sizeof(KEY) - 1, nullptr, 10);
+    dev.heartbeatEpoch   = epochS();
+  }
+}
+
+// received_at do backend menos o instante em que o heartbeat saiu
+void Worker::sampleIngestLag(Report& report) {
+  int want = std::max(1, LAG_SAMPLES / opt.workers);
+  for (int i = 0; i < want * 2 && (int)report.lagCount < want; i++) {
+    Device& dev = devices[nextRandom(sampler) % devices.size()];
+    if (dev.image == nullptr || !dev.heartbeatSent) {
+      continue;
+    }
+    std::string body;
+    std::string path = std::string("/devices/") + dev.id + "/heartbeat";
+    double      uptime, receivedAt;
+    if (httpRequest(backend, "GET", path, "", body) == 200 && jsonNumber(body, "uptime_ms", uptime) &&
+        jsonNumber(body, "received_at", receivedAt) && (unsigned long)uptime == dev.heartbeatUptimeMs) {
+      report.lags[report.lagCount++] = (float)(receivedAt - dev.heartbeatEpoch);
+    }
+  }
+}
+
+int Worker::run(int out) {
+  for (int n = workerIndex; n < opt.devices; n += opt.workers) {
+    Device dev;
+    dev.index  = (uint32_t)devices.size();
+    dev.number = (uint32_t)n;
+    devices.push_back(dev);
+  }
+  pristine.assign(__fw_state_start, __fw_state_end);
+  epoll = epoll_create1(EPOLL_CLOEXEC);
+  parseUrl(opt.backendUrl, backend);
+
+  const uint64_t tickUs     = (uint64_t)opt.tickMs * 1000;
+  const double   deadline   = monotonicS() + opt.duration;
+  double         nextReport = monotonicS() + opt.reportInterval;
+  size_t         booted     = 0;
+  float          slowest    = 0;
+  Report         report     = {};
+
+  while (!stopRequested && monotonicS() < deadline) {
+    uint64_t roundStart = monotonicUs();
+    for (int k = 0; k < BOOT_BATCH && booted < devices.size(); k++) {
+      boot(devices[booted++]);
+    }
+    for (size_t i = 0; i < booted; i++) {
+      turn(devices[i]);
+    }
+    slowest = std::max(slowest, (monotonicUs() - roundStart) / 1000.0f);
+
+    if (monotonicS() >= nextReport) {
+      nextReport    = monotonicS() + opt.reportInterval;
+      report        = {};
+      if (!opt.backendUrl.empty()) {
+        sampleIngestLag(report);
+      }
+      report.published      = published;
+      report.heartbeats     = heartbeats;
+      report.booted         = (uint32_t)booted;
+      report.connected      = (uint32_t)std::count_if(devices.begin(), devices.begin() + booted,
+                                                      [](const Device& d) { return d.connected; });
+      report.slowestRoundMs = slowest;
+      slowest               = 0;
+      write(out, &report, sizeof(report));
+    }
+
+    // Resto da rodada: atende na hora quem recebeu mensagem
+    uint64_t now;
+    while (!stopRequested && (now = monotonicUs()) < roundStart + tickUs) {
+      epoll_event ready[64];
+      int         n = epoll_wait(epoll, ready, 64, (int)((roundStart + tickUs - now + 999) / 1000));
+      for (int i = 0; i < n; i++) {
+        turn(devices[ready[i].data.u32]);
+      }
+    }
+  }
+
+  // Último relatório: sem amostra de atraso, só os totais
+  report                = {};
+  report.published      = published;
+  report.heartbeats     = heartbeats;
+  report.booted         = (uint32_t)booted;
+  report.connected      = (uint32_t)std::count_if(devices.begin(), devices.begin() + booted,
+                                                  [](const Device& d) { return d.connected; });
+  report.slowestRoundMs = slowest;
+  report.finished       = true;
+  write(out, &report, sizeof(report));
+  return 0;
+}
+
+// ==========================
+// SONDA DE COMANDO (processo pai)
+// ==========================
+
+class CommandProbe {
+public:
+  CommandProbe(const Options& options, const Url& backendUrl) : opt(options), backend(backendUrl) {}
+
+  bool connect();
+  int  fd() const { return mqtt.fd(); }
+  void drain();
+  void sendRandom(uint32_t& rng);
+
+  std::vector<double> takeRtts() {
+    std::vector<double> out;
+    out.swap(rtts);
+    return out;
+  }
+
+  size_t   pendingCount() const { return pending.size(); }
+  uint32_t failures = 0;
+
+private:
+  struct Pending {
+    uint32_t version;
+    double   startedS;
+  };
+
+  void onHeartbeat(const std::string& deviceId, const std::string& payload);
+
+  const Options&                            opt;
+  const Url&                                backend;
+  MqttSocket                                mqtt;
+  std::unordered_map<std::string, uint32_t> lastDv;
+  std::unordered_map<std::string, Pending>  pending;
+  std::vector<std::string>                  seen;  // varais com heartbeat (sorteio)
+  std::vector<double>                       rtts;
+};
+
+bool CommandProbe::connect() {
+  char clientId[32];
+  snprintf(clientId, sizeof(clientId), "swarm-probe-%d", (int)getpid());
+  return mqtt.connect(opt.broker.c_str(), (uint16_t)opt.port, clientId, 60, 3000) &&
+         mqtt.subscribe("casa/+/heartbeat", 0);
+}
+
+void CommandProbe::drain() {
+  MqttMessage m;
+  while (mqtt.poll(m) == MqttSocket::Poll::MESSAGE) {
+    // casa/<id>/heartbeat
+    const char* id  = strchr(m.topic, '/');
+    const char* end = id != nullptr ? strchr(id + 1, '/') : nullptr;
+    if (end != nullptr) {
+      onHeartbeat(std::string(id + 1, end), std::string((const char*)m.payload, m.length));
+    }
+  }
+}
+
+void CommandProbe::onHeartbeat(const std::string& deviceId, const std::string& payload) {
+  double dv;
+  if (!jsonNumber(payload, "dv", dv)) {
+    return;
+  }
+  auto known = lastDv.find(deviceId);
+  if (known == lastDv.end()) {
+    seen.push_back(deviceId);
+    known = lastDv.emplace(deviceId, 0).first;
+  }
+  known->second = std::max(known->second, (uint32_t)dv);
+
+  auto waiting = pending.find(deviceId);
+  if (waiting != pending.end() && known->second >= waiting->second.version) {
+    rtts.push_back(monotonicS() - waiting->second.startedS);
+    pending.erase(waiting);
+  }
+}
+
+// Nova versão do desejado para um varal sorteado (o modo não serve de
+// marca: AUTO pedido a um varal em AUTO casaria com qualquer heartbeat)
+void CommandProbe::sendRandom(uint32_t& rng) {
+  if (seen.empty()) {
+    return;
+  }
+  const std::string& deviceId = seen[nextRandom(rng) % seen.size()];
+  const char*        mode     = MODES[nextRandom(rng) % 3];
+  double             started  = monotonicS();
+  uint32_t           version;
+
+  if (!opt.backendUrl.empty()) {
+    // Caminho real: o backend cria a versão e publica o desejado retido
+    std::string response;
+    double      created;
+    std::string body = std::string("{\"mode\":\"") + mode + "\"}";
+    if (httpRequest(backend, "PUT", "/devices/" + deviceId + "/desired", body, response) != 200 ||
+        !jsonNumber(response, "version", created)) {
+      failures++;
+      return;
+    }
+    version = (uint32_t)created;
+  } else {
+    version = lastDv[deviceId] + 1;
+    char doc[64];
+    int  n = snprintf(doc, sizeof(doc), "{\"v\":%u,\"mode\":\"%s\"}", version, mode);
+    mqtt.publish(("casa/" + deviceId + "/desired").c_str(), (const uint8_t*)doc, (size_t)n, 1, false);
+  }
+
+  drain();  // heartbeat que chegou antes da resposta HTTP
+  if (lastDv[deviceId] >= version) {
+    rtts.push_back(monotonicS() - started);
+  } else {
+    pending[deviceId] = { version, started };
+  }
+}
+
+// ==========================
+// LINHA DE COMANDO
+// ==========================
+
+void usage(const char* program) {
+  fprintf(stderr,
+          "uso: %s [opções]\n"
+          "  --devices N            varais (padrão 500)\n"
+          "  --workers N            processos (padrão 4)\n"
+          "  --broker HOST          broker MQTT (padrão localhost)\n"
+          "  --port N               porta do broker (padrão 1883)\n"
+          "  --duration S           segundos (padrão 60)\n"
+          "  --cmd-rate N           comandos/s para medir round-trip (padrão 5)\n"
+          "  --backend-url URL      ex: http://localhost:8000\n"
+          "  --report-interval S    segundos (padrão 5)\n"
+          "  --seed N               semente dos sensores e da sonda (padrão 1)\n"
+          "  --mac-base N           MAC do 1º varal (padrão 0x100000; IDs varal-xxxxxx)\n"
+          "  --tick-ms N            loop() de cada varal a cada N ms (padrão 50)\n"
+          "  --flight-kb N          caixa-preta por varal em KB (padrão 16; placa: 512)\n"
+          "  --rain-per-hour X      chuvas por varal por hora (padrão 0.5)\n",
+          program);
+}
+
+bool parseOptions(int argc, char** argv, Options& opt) {
+  static const option longOptions[] = {
+    { "devices", required_argument, nullptr, 'd' },       { "workers", required_argument, nullptr, 'w' },
+    { "broker", required_argument, nullptr, 'b' },        { "port", required_argument, nullptr, 'p' },
+    { "duration", required_argument, nullptr, 't' },      { "cmd-rate", required_argument, nullptr, 'c' },
+    { "backend-url", required_argument, nullptr, 'u' },   { "report-interval", required_argument, nullptr, 'r' },
+    { "seed", required_argument, nullptr, 's' },          { "mac-base", required_argument, nullptr, 'm' },
+    { "tick-ms", required_argument, nullptr, 'k' },       { "flight-kb", required_argument, nullptr, 'f' },
+    { "rain-per-hour", required_argument, nullptr, 'x' }, { "help", no_argument, nullptr, 'h' },
+    { nullptr, 0, nullptr, 0 },
+  };
+  int c;
+  while ((c = getopt_long(argc, argv, "h", longOptions, nullptr)) != -1) {
+    switch (c) {
+      case 'd': opt.devices        = atoi(optarg); break;
+      case 'w': opt.workers        = atoi(optarg); break;
+      case 'b': opt.broker         = optarg; break;
+      case 'p': opt.port           = atoi(optarg); break;
+      case 't': opt.duration       = atof(optarg); break;
+      case 'c': opt.cmdRate        = atof(optarg); break;
+      case 'u': opt.backendUrl     = optarg; break;
+      case 'r': opt.reportInterval = atof(optarg); break;
+      case 's': opt.seed           = (uint32_t)strtoul(optarg, nullptr, 0); break;
+      case 'm': opt.macBase        = (uint32_t)strtoul(optarg, nullptr, 0); break;
+      case 'k': opt.tickMs         = atoi(optarg); break;
+      case 'f': opt.flightKb       = (uint32_t)strtoul(optarg, nullptr, 0); break;
+      case 'x': opt.rainPerHour    = atof(optarg); break;
+      default: return false;
+    }
+  }
+  if (optind != argc || opt.devices < 1 || opt.port < 1 || opt.port > 65535 || opt.tickMs < 1 ||
+      opt.reportInterval <= 0 || opt.flightKb < 8 || opt.flightKb % 4 != 0) {
+    return false;  // caixa-preta: setores de 4 KB, pelo menos 2
+  }
+  // Pelo menos um worker e nunca mais workers que varais
+  opt.workers = std::max(1, std::min(opt.workers, opt.devices));
+  return true;
+}
+
+void onSignal(int) {
+  stopRequested = 1;
+}
+
+// Um socket por varal: sobe o limite de descritores até o teto do sistema
+void raiseFileLimit(const Options& opt) {
+  rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) != 0) {
+    return;
+  }
+  limit.rlim_cur = limit.rlim_max;
+  setrlimit(RLIMIT_NOFILE, &limit);
+  getrlimit(RLIMIT_NOFILE, &limit);
+  rlim_t perWorker = (rlim_t)(opt.devices / opt.workers + 1) + 64;
+  if (limit.rlim_cur != RLIM_INFINITY && limit.rlim_cur < perWorker) {
+    fprintf(stderr, "[SWARM] aviso: limite de %llu descritores para %llu varais por worker (ulimit -n)\n",
+            (unsigned long long)limit.rlim_cur, (unsigned long long)perWorker);
+  }
+}
+
+// ==========================
+// PROCESSO PAI
+// ==========================
+
+struct WorkerProcess {
+  pid_t  pid;
+  int    pipe;
+  Report last;
+  bool   fresh;  // relatório novo desde a última linha
+  bool   done;
+};
+
+int runSwarm(const Options& opt) {
+  Url backend;
+  if (!opt.backendUrl.empty() && !parseUrl(opt.backendUrl, backend)) {
+    fprintf(stderr, "[SWARM] --backend-url precisa ser http://host[:porta][/caminho]\n");
+    return 2;
+  }
+  CommandProbe probe(opt, backend);
+  if (!probe.connect()) {
+    fprintf(stderr, "[SWARM] broker %s:%d não responde\n", opt.broker.c_str(), opt.port);
+    return 1;
+  }
+
+  printf("[SWARM] %d varais em %d workers -> %s:%d (estado do firmware: %zu bytes por varal)\n", opt.devices,
+         opt.workers, opt.broker.c_str(), opt.port, stateSize());
+  fflush(stdout);
+
+  std::vector<WorkerProcess> workers;
+  for (int w = 0; w < opt.workers; w++) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+      perror("pipe");
+      return 1;
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+      // Filho: o socket da sonda e os pipes dos irmãos não são dele
+      close(probe.fd());
+      close(fds[0]);
+      for (const WorkerProcess& other : workers) {
+        close(other.pipe);
+      }
+      Worker worker(opt, w);
+      _exit(worker.run(fds[1]));  // sem destrutores: o estado carregado é de um varal qualquer
+    }
+    close(fds[1]);
+    if (pid < 0) {
+      perror("fork");
+      return 1;
+    }
+    workers.push_back({ pid, fds[0], {}, false, false });
+  }
+
+  uint32_t            rng     = opt.seed;
+  const double        t0      = monotonicS();
+  double              nextCmd = t0;
+  double              lastReport = t0;
+  uint64_t            lastPublished = 0;
+  std::vector<double> allRtts, allLags, lags;
+  bool                forwarded = false;
+
+  auto totals = [&](Report& sum) {
+    sum = {};
+    for (const WorkerProcess& w : workers) {
+      sum.published += w.last.published;
+      sum.heartbeats += w.last.heartbeats;
+      sum.booted += w.last.booted;
+      sum.connected += w.last.connected;
+      sum.slowestRoundMs = std::max(sum.slowestRoundMs, w.last.slowestRoundMs);
+    }
+  };
+
+  for (;;) {
+    double now      = monotonicS();
+    bool   allDone  = std::all_of(workers.begin(), workers.end(), [](const WorkerProcess& w) { return w.done; });
+    bool   running  = !stopRequested && now - t0 < opt.duration;
+    if (allDone || (!running && now - t0 > opt.duration + FINAL_GRACE_S)) {
+      break;
+    }
+    if (stopRequested && !forwarded) {
+      forwarded = true;
+      for (const WorkerProcess& w : workers) {
+        kill(w.pid, SIGTERM);  // Ctrl-C já chegou neles; SIGTERM só no pai, não
+      }
+    }
+
+    if (running && opt.cmdRate > 0 && now >= nextCmd) {
+      nextCmd = now + 1.0 / opt.cmdRate;
+      probe.sendRandom(rng);
+    }
+
+    // Uma linha quando todos os workers no ar mandaram o relatório do intervalo
+    bool reported = std::all_of(workers.begin(), workers.end(),
+                                [](const WorkerProcess& w) { return w.fresh || w.done; });
+    if (reported && !allDone) {
+      for (WorkerProcess& w : workers) {
+        w.fresh = false;
+      }
+      Report sum;
+      totals(sum);
+      double rate   = (sum.published - lastPublished) / (now - lastReport);
+      lastPublished = sum.published;
+      lastReport    = now;
+      std::vector<double> rtts = probe.takeRtts();
+      allRtts.insert(allRtts.end(), rtts.begin(), rtts.end());
+      printf("[SWARM] conectados=%u/%u pub=%.0f msg/s rodada=%.0f ms | cmd RTT %s | ingest lag %s\n", sum.connected,
+             opt.devices, rate, sum.slowestRoundMs, percentiles(rtts).c_str(), percentiles(lags).c_str());
+      fflush(stdout);
+      lags.clear();
+    }
+
+    // Sonda + relatórios dos workers, até o próximo comando
+    std::vector<pollfd> fds = { { probe.fd(), POLLIN, 0 } };
+    for (const WorkerProcess& w : workers) {
+      fds.push_back({ w.done ? -1 : w.pipe, POLLIN, 0 });
+    }
+    double wait = running && opt.cmdRate > 0 ? nextCmd - monotonicS() : 0.1;
+    ::poll(fds.data(), fds.size(), std::max(0, std::min(100, (int)(wait * 1000))));
+    probe.drain();
+    for (size_t i = 0; i < workers.size(); i++) {
+      WorkerProcess& w = workers[i];
+      if (w.done || (fds[i + 1].revents & (POLLIN | POLLHUP)) == 0) {
+        continue;
+      }
+      Report r;
+      if (read(w.pipe, &r, sizeof(r)) != (ssize_t)sizeof(r)) {
+        w.done = true;  // worker morreu sem o relatório final
+        continue;
+      }
+      w.last  = r;
+      w.fresh = !r.finished;
+      w.done  = r.finished;
+      lags.insert(lags.end(), r.lags, r.lags + r.lagCount);
+      allLags.insert(allLags.end(), r.lags, r.lags + r.lagCount);
+    }
+  }
+
+  for (WorkerProcess& w : workers) {
+    if (!w.done) {
+      kill(w.pid, SIGKILL);
+    }
+    waitpid(w.pid, nullptr, 0);
+  }
+
+  Report sum;
+  totals(sum);
+  double elapsed = monotonicS() - t0;
+  std::vector<double> rtts = probe.takeRtts();
+  allRtts.insert(allRtts.end(), rtts.begin(), rtts.end());
+  printf("[SWARM] ===== Resumo =====\n");
+  printf("[SWARM] varais no ar: %u de %d (%u conectados no fim)\n", sum.booted, opt.devices, sum.connected);
+  printf("[SWARM] publicações: %llu (%.0f msg/s), heartbeats: %llu\n", (unsigned long long)sum.published,
+         sum.published / elapsed, (unsigned long long)sum.heartbeats);
+  printf("[SWARM] round-trip de comando: %s (%zu sem resposta, %u recusados pelo backend)\n",
+         percentiles(allRtts).c_str(), probe.pendingCount(), probe.failures);
+  printf("[SWARM] atraso de ingestão:    %s\n", percentiles(allLags).c_str());
+  return 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options opt;
+  if (!parseOptions(argc, argv, opt)) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  // O swarm/fw_state.ld tem que ter pegado o estado do firmware e do mock
+  const uint8_t* deviceId = (const uint8_t*)mqttGetDeviceId();
+  const uint8_t* serial   = (const uint8_t*)&Serial;
+  if (deviceId < __fw_state_start || deviceId >= __fw_state_end || serial < __fw_state_start ||
+      serial >= __fw_state_end) {
+    fprintf(stderr, "[SWARM] estado do firmware fora da seção .fw_state (link sem swarm/fw_state.ld?)\n");
+    return 1;
+  }
+
+  struct sigaction action = {};
+  action.sa_handler = onSignal;
+  sigaction(SIGINT, &action, nullptr);
+  sigaction(SIGTERM, &action, nullptr);
+  raiseFileLimit(opt);
+  return runSwarm(opt);
+}
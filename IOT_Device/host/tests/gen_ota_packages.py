@@ -0,0 +1,75 @@
+"""
+Gera os pacotes do ota_update_test com o backend/tools/ota_pack: um par de
+chaves novo (o ota_key.h vai só para o teste), duas imagens de firmware de
+mentira (semente fixa) e os pacotes completo e delta da antiga para a nova.
+
+Saída em --out:
+    ota_key.h            OTA_PUBLIC_KEY_PEM do teste
+    old.bin, new.bin     imagem em uso e imagem nova
+    full.vota            pacote completo (new.bin)
+    delta.vota           pacote delta (old.bin -> new.bin)
+
+    python gen_ota_packages.py --backend ../../backend --out _build/ota
+"""
+
+import argparse
+import os
+import random
+import sys
+from types import SimpleNamespace
+from typing import List, Optional
+
+SEED = 42
+IMAGE_SIZE = 256 * 1024
+
+
+def fake_image(rng: random.Random, size: int) -> bytes:
+    """Parecida com um .bin de verdade: trechos repetidos (código, tabelas) e ruído."""
+    out = bytearray()
+    pieces = [bytes(rng.randrange(256) for _ in range(rng.randrange(16, 256))) for _ in range(64)]
+    while len(out) < size:
+        if rng.random() < 0.7:
+            out += rng.choice(pieces)
+        else:
+            out += bytes(rng.randrange(256) for _ in range(rng.randrange(8, 64)))
+    return bytes(out[:size])
+
+
+def recompiled(rng: random.Random, old: bytes) -> bytes:
+    """Nova versão: endereços trocados aqui e ali e uma função nova no meio."""
+    new = bytearray(old)
+    for _ in range(400):
+        i = rng.randrange(len(new) - 4)
+        new[i:i + 4] = rng.randrange(1 << 32).to_bytes(4, "little")
+    cut = len(new) // 3
+    return bytes(new[:cut] + fake_image(rng, 4096) + new[cut:])
+
+
+def main(argv: Optional[List[str]] = None) -> int:
+    p = argparse.ArgumentParser(description="Gera os pacotes OTA do teste do firmware.")
+    p.add_argument("--backend", required=True, help="pasta backend/ (tools.ota_pack)")
+    p.add_argument("--out", required=True, help="pasta de saída")
+    args = p.parse_args(argv)
+
+    sys.path.insert(0, os.path.abspath(args.backend))
+    from tools import ota_pack
+
+    os.makedirs(args.out, exist_ok=True)
+    out = lambda name: os.path.join(args.out, name)  # noqa: E731
+
+    ota_pack.cmd_keygen(SimpleNamespace(key=out("ota_key.pem"), header=out("ota_key.h")))
+
+    rng = random.Random(SEED)
+    old = fake_image(rng, IMAGE_SIZE)
+    new = recompiled(rng, old)
+    ota_pack._write(out("old.bin"), old)
+    ota_pack._write(out("new.bin"), new)
+
+    ota_pack.cmd_full(SimpleNamespace(image=out("new.bin"), key=out("ota_key.pem"), out=out("full.vota")))
+    ota_pack.cmd_delta(SimpleNamespace(base=out("old.bin"), image=out("new.bin"), key=out("ota_key.pem"),
+                                       out=out("delta.vota")))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,115 @@
+"""
+Gera os casos do rule_vm_test: compila um programa de regras com o
+backend/tools/rule_compiler e roda uma linha do tempo aleatória (semente
+fixa) no RuleVM do backend/tools/rule_sim. O teste C++ repete a mesma
+linha do tempo no rule_engine.cpp do firmware e confere, caso a caso, a
+ação, a regra e os limites (permanência mínima, movimentos por hora).
+
+Saída em --out:
+    rules.bin   programa compilado
+    cases.txt   um caso por linha (colunas no cabeçalho do arquivo)
+
+    python gen_rule_cases.py --backend ../../backend --rules ../data/rules/crosscheck.txt --out _build/rules
+"""
+
+import argparse
+import os
+import random
+import sys
+from typing import List, Optional
+
+CASES = 4000
+SEED = 40
+
+# Valores nas fronteiras das comparações do programa, mais alguns soltos
+TEMPS_X10 = [-400, -26, -25, -24, -1, 0, 1, 179, 180, 181, 250, 400]
+HUMS_X10 = [0, 100, 499, 500, 501, 699, 700, 701, 854, 855, 856, 1000]
+STEPS_S = [1, 2, 59, 60, 61, 299, 599, 600, 601, 1200, 1800, 3599, 3600, 3601, 7200, 7260]
+EPOCH_MIN = 1_600_000_000  # TIME_VALID_AFTER do rule_engine.cpp
+
+
+def local_time(epoch: int, tz_min: int):
+    """(minuto do dia, dia da semana) como o localTime() do firmware."""
+    if epoch < EPOCH_MIN:
+        return -1, -1
+    local_min = epoch // 60 + tz_min
+    return local_min % 1440, (local_min // 1440 + 4) % 7
+
+
+def main(argv: Optional[List[str]] = None) -> int:
+    p = argparse.ArgumentParser(description="Gera os casos do teste cruzado firmware x rule_sim.")
+    p.add_argument("--backend", required=True, help="pasta backend/ (tools.rule_compiler/rule_sim)")
+    p.add_argument("--rules", required=True, help="programa de regras (texto)")
+    p.add_argument("--out", required=True, help="pasta de saída")
+    args = p.parse_args(argv)
+
+    sys.path.insert(0, os.path.abspath(args.backend))
+    from tools.rule_compiler import NO_RULE, VAR_INDEX, compile_source, decode_header
+    from tools.rule_sim import RuleVM
+
+    with open(args.rules, encoding="utf-8") as f:
+        program, _ = compile_source(f.read())
+    tz_min = decode_header(program)["tz_min"]
+    vm = RuleVM(program)
+    rng = random.Random(SEED)
+
+    os.makedirs(args.out, exist_ok=True)
+    with open(os.path.join(args.out, "rules.bin"), "wb") as f:
+        f.write(program)
+
+    lines = ["# dt_s moved rain_level raining rain_likely temp_x10 humidity_x10 epoch is_open dht_valid"
+             " -> action rule allowed"]
+    now = 0
+    epoch = 0
+    for _ in range(CASES):
+        dt_s = rng.choice(STEPS_S)
+        now += dt_s
+        moved = int(rng.random() < 0.3)
+        if moved:
+            vm.note_move(now)
+
+        # Chuva é rara: senão a regra 0 (fecha com chuva) decide quase tudo
+        level = rng.choice([0, 0, 0, 0, 0, 1, 2, 3])
+        raining = int(level > 0 and rng.random() < 0.5)
+        likely = int(rng.random() < 0.3)
+        dht_valid = int(rng.random() < 0.85)
+        temp10 = rng.choice(TEMPS_X10) if dht_valid else 0
+        hum10 = rng.choice(HUMS_X10) if dht_valid else 0
+        is_open = rng.randrange(2)
+        # Hora: às vezes sem NTP; senão anda junto (pulos de até 3 dias)
+        # para cruzar janelas, meia-noite e fins de semana
+        if rng.random() < 0.1:
+            epoch = 0
+        elif epoch == 0:
+            epoch = EPOCH_MIN + rng.randrange(400 * 86400)
+        else:
+            epoch += dt_s + rng.choice([0, 0, 60 * rng.randrange(1440), 86400 * rng.randrange(3)])
+
+        minute, weekday = local_time(epoch, tz_min)
+        since = min((now - vm.last_move) // 60, 32767) if vm.last_move is not None else 32767
+        inputs = [0] * len(VAR_INDEX)
+        inputs[VAR_INDEX["rain_level"]] = level
+        inputs[VAR_INDEX["raining"]] = raining
+        inputs[VAR_INDEX["rain_likely"]] = likely
+        inputs[VAR_INDEX["temp"]] = temp10
+        inputs[VAR_INDEX["humidity"]] = hum10
+        inputs[VAR_INDEX["minute"]] = minute
+        inputs[VAR_INDEX["weekday"]] = weekday
+        inputs[VAR_INDEX["minutes_since_move"]] = since
+        inputs[VAR_INDEX["moves_last_hour"]] = vm.moves_last_hour(now)
+        inputs[VAR_INDEX["is_open"]] = is_open
+        inputs[VAR_INDEX["dht_valid"]] = dht_valid
+
+        action, rule = vm.evaluate(inputs)
+        allowed = int(vm.move_allowed(now))
+        lines.append(f"{dt_s} {moved} {level} {raining} {likely} {temp10} {hum10} {epoch} {is_open} {dht_valid}"
+                     f" {action} {rule if rule != NO_RULE else 255} {allowed}")
+
+    with open(os.path.join(args.out, "cases.txt"), "w", encoding="utf-8") as f:
+        f.write("\n".join(lines) + "\n")
+    print(f"[RULES] {CASES} casos -> {args.out}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,41 @@
+#pragma once
+#include <Arduino.h>
+#include <string>
+
+#include "mock_hal.h"
+#include "mqtt_manager.h"
+
+// ==========================================================
+// Firmware inteiro no host: boot e voltas do loop() para os testes
+// ==========================================================
+
+void setup();
+void loop();
+
+namespace host {
+
+// Pinos da placa (stepper_motor.cpp / rain_sensor.cpp)
+static const int ENDSTOP_PIN     = 32;
+static const int RAIN_ANALOG_PIN = 34;
+
+// Boot com Wi-Fi/MQTT no ar e o fim de curso apertado (homing na hora)
+inline void boot() {
+  mock::reset();
+  mock::setDigitalInput(ENDSTOP_PIN, LOW);
+  setup();
+}
+
+// Voltas do loop(), o relógio andando 1 ms por volta
+inline void runFor(uint32_t ms) {
+  for (uint32_t i = 0; i < ms; i++) {
+    mock::advanceMillis(1);
+    loop();
+  }
+}
+
+// "casa/<id>/<leaf>"
+inline std::string topic(const char* leaf) {
+  return std::string("casa/") + mqttGetDeviceId() + "/" + leaf;
+}
+
+}  // namespace host
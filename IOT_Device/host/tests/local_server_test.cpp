@@ -0,0 +1,124 @@
+// Servidor local (local_server.cpp) de verdade, em cima do ESPAsyncWebServer
+// do mock: token obrigatório, comando por HTTP e por WebSocket aplicado pelo
+// loop com "ack" no WebSocket, e tudo isso com o broker fora do ar (a
+// reconexão do MQTT não pode prender o loop: é o caso para que o servidor
+// local existe).
+
+#include <gtest/gtest.h>
+
+#include "host_firmware.h"
+#include "local_server.h"
+#include "varal_controller.h"
+
+namespace {
+
+const std::string TOKEN = LOCAL_SERVER_TOKEN;
+
+class LocalServerTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    host::boot();
+    host::runFor(5'000);  // servidor sobe no primeiro loop com Wi-Fi; homing e abertura inicial
+    ASSERT_GE(mock::localRequest("GET", "/heartbeat"), 0) << "servidor local não subiu";
+  }
+
+  // Uma volta do loop(); devolve quanto o relógio andou dentro dela
+  uint64_t onePass() {
+    mock::advanceMillis(1);
+    uint64_t before = mock::nowMicros();
+    loop();
+    return mock::nowMicros() - before;
+  }
+
+  int connectWs() {
+    int client = mock::wsConnect(("/ws?token=" + TOKEN).c_str());
+    std::string first;
+    EXPECT_TRUE(mock::wsReceive(client, &first));  // estado atual na conexão
+    EXPECT_NE(first.find("\"type\":\"heartbeat\""), std::string::npos);
+    return client;
+  }
+
+  // Próxima mensagem "ack" do cliente (pula os heartbeats)
+  std::string nextAck(int client) {
+    std::string msg;
+    while (mock::wsReceive(client, &msg)) {
+      if (msg.find("\"type\":\"ack\"") != std::string::npos) {
+        return msg;
+      }
+    }
+    return "";
+  }
+};
+
+TEST_F(LocalServerTest, RejectsRequestsWithoutToken) {
+  EXPECT_STREQ(mock::mdnsHostname(), mqttGetDeviceId());
+
+  EXPECT_EQ(mock::localRequest("GET", "/heartbeat"), 401);
+  EXPECT_EQ(mock::localRequest("GET", "/heartbeat", "Bearer errado"), 401);
+  EXPECT_EQ(mock::localRequest("GET", "/heartbeat?token=errado"), 401);
+  EXPECT_EQ(mock::localRequest("POST", "/cmd?command=OPEN"), 401);
+  EXPECT_EQ(mock::wsConnect("/ws"), -1);
+  EXPECT_EQ(mock::wsConnect("/ws?token=errado"), -1);
+  EXPECT_EQ(varalControllerGetMode(), VaralMode::AUTO);
+
+  std::string body;
+  EXPECT_EQ(mock::localRequest("GET", "/heartbeat", ("Bearer " + TOKEN).c_str(), &body), 200);
+  EXPECT_NE(body.find("\"mode\":\"AUTO\""), std::string::npos) << body;
+}
+
+TEST_F(LocalServerTest, AppliesHttpAndWebSocketCommandsOnTheNextPass) {
+  int client = connectWs();
+
+  // POST /cmd: aceito na hora, aplicado pelo loop, "ack" no WebSocket
+  std::string url = "/cmd?command=open&token=" + TOKEN;
+  EXPECT_EQ(mock::localRequest("POST", url.c_str()), 202);
+  EXPECT_EQ(varalControllerGetMode(), VaralMode::AUTO);
+  onePass();
+  EXPECT_EQ(varalControllerGetMode(), VaralMode::FORCE_OPEN);
+  EXPECT_NE(nextAck(client).find("\"command\":\"OPEN\""), std::string::npos);
+
+  // Quadro de texto no WebSocket
+  mock::wsSend(client, " close ");
+  onePass();
+  EXPECT_EQ(varalControllerGetMode(), VaralMode::FORCE_CLOSE);
+  EXPECT_NE(nextAck(client).find("\"command\":\"CLOSE\""), std::string::npos);
+
+  // Desconhecido: nem muda o modo nem confirma
+  mock::wsSend(client, "DANCE");
+  onePass();
+  EXPECT_EQ(varalControllerGetMode(), VaralMode::FORCE_CLOSE);
+  EXPECT_EQ(nextAck(client), "");
+}
+
+TEST_F(LocalServerTest, LocalCommandsWorkWhileTheBrokerRefusesConnections) {
+  int client = connectWs();
+
+  // Internet caiu: Wi-Fi no ar, broker recusando toda tentativa
+  mock::dropMqtt();
+  mock::failMqttConnects(1'000'000);
+  uint64_t slowestPassUs = 0;
+  for (int i = 0; i < 30'000; i++) {
+    slowestPassUs = std::max(slowestPassUs, onePass());
+  }
+  EXPECT_FALSE(mqttIsConnected());
+  EXPECT_LT(slowestPassUs, 1'000u) << "o loop ficou preso na reconexão";
+
+  // Comando local chega e é aplicado na volta seguinte, com ack
+  mock::wsSend(client, "OPEN");
+  onePass();
+  EXPECT_EQ(varalControllerGetMode(), VaralMode::FORCE_OPEN);
+  EXPECT_NE(nextAck(client).find("\"command\":\"OPEN\""), std::string::npos);
+
+  // O heartbeat local acompanha (refeito no evento de modo)
+  host::runFor(10);
+  std::string body;
+  EXPECT_EQ(mock::localRequest("GET", "/heartbeat", ("Bearer " + TOKEN).c_str(), &body), 200);
+  EXPECT_NE(body.find("\"mode\":\"FORCE_OPEN\""), std::string::npos) << body;
+
+  // Broker volta: a próxima tentativa (no máximo 5 s depois) conecta
+  mock::failMqttConnects(0);
+  host::runFor(5'001);
+  EXPECT_TRUE(mqttIsConnected());
+}
+
+}  // namespace
@@ -0,0 +1,138 @@
+// loop() não aloca em regime permanente (o memMonitor conta no ESP32; aqui
+// o malloc do processo inteiro é contado, incluindo o que o HAL chamaria).
+// O HAL de mentira não aloca, então qualquer alocação vem do firmware.
+
+#include <gtest/gtest.h>
+#include <math.h>
+
+#include "host_firmware.h"
+#include "alloc_counter.h"
+#include "flight_recorder.h"
+#include "mem_monitor.h"
+#include "varal_controller.h"
+
+namespace {
+
+// O backend confirma na hora tudo que o transporte manda ({"seq":N,...})
+char ackTopic[64];
+
+void autoAck(const char* topic, const uint8_t* payload, size_t length, bool retained, void* context) {
+  (void)topic; (void)retained; (void)context;
+  unsigned seq = 0;
+  if (length > 7 && sscanf((const char*)payload, "{\"seq\":%u", &seq) == 1) {
+    char ack[16];
+    snprintf(ack, sizeof(ack), "%u", seq);
+    mock::mqttInject(ackTopic, ack);
+  }
+}
+
+class LoopAllocTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    host::boot();
+    snprintf(ackTopic, sizeof(ackTopic), "%s", host::topic("ack").c_str());
+    cmdTopic     = host::topic("cmd");
+    desiredTopic = host::topic("desired");
+    mock::onMqttPublish(autoAck, nullptr);
+    host::runFor(5'000);  // primeiro heartbeat, homing e a abertura inicial
+  }
+
+  // Alocações (chamadas) durante fn; o memMonitor do firmware tem que ver
+  // o mesmo zero (o teste em si aloca fora da janela e ele contaria)
+  template <typename Fn>
+  uint64_t allocationsDuring(Fn fn) {
+    uint32_t         monitored = memMonitorLoopAllocations();
+    mock::AllocCount before    = mock::allocCount();
+    fn();
+    uint64_t n = mock::allocCount().calls - before.calls;
+    firmwareCounted = memMonitorLoopAllocations() - monitored;
+    return n;
+  }
+
+  uint32_t firmwareCounted = 0;
+
+  std::string cmdTopic;
+  std::string desiredTopic;
+};
+
+TEST_F(LoopAllocTest, SetupAllocatesAndCounterSeesIt) {
+  // Sanidade do contador: o boot aloca (buffer do MQTT, flash de mentira)
+  uint64_t n = allocationsDuring([] { host::boot(); });
+  EXPECT_GT(n, 0u);
+}
+
+TEST_F(LoopAllocTest, SteadyStateLoopDoesNotAllocate) {
+  uint64_t n = allocationsDuring([] { host::runFor(120'000); });  // 2 min: heartbeats, sensores, caixa-preta
+  EXPECT_EQ(n, 0u);
+  EXPECT_EQ(firmwareCounted, 0u);
+}
+
+TEST_F(LoopAllocTest, RainAndCommandsDoNotAllocate) {
+  const char* cmd     = cmdTopic.c_str();
+  const char* desired = desiredTopic.c_str();
+  uint64_t n = allocationsDuring([&] {
+    mock::setAnalog(host::RAIN_ANALOG_PIN, 500);  // chuva forte: fecha
+    host::runFor(10'000);
+    mock::mqttInject(cmd, " open ");
+    host::runFor(5'000);
+    mock::mqttInject(cmd, "SYNC");
+    mock::mqttInject(desired, "{\"v\":7,\"mode\":\"FORCE_CLOSE\",\"hb_s\":10}");
+    host::runFor(15'000);
+    mock::mqttInject(cmd, "auto");
+    mock::setAnalog(host::RAIN_ANALOG_PIN, 4095);
+    mock::setDht(NAN, NAN);  // DHT parou de responder
+    host::runFor(10'000);
+    mock::mqttInject(cmd, "DUMP 2");  // caixa-preta pela fila BULK
+    host::runFor(10'000);
+  });
+  EXPECT_EQ(n, 0u);
+  EXPECT_EQ(firmwareCounted, 0u);
+  EXPECT_EQ(varalControllerGetMode(), VaralMode::AUTO);
+}
+
+TEST_F(LoopAllocTest, DumpNeedsAWholePositiveSectorCount) {
+  const char* cmd = cmdTopic.c_str();
+  // Sufixo que não é inteiro positivo: comando desconhecido, sem dump
+  // Volta a volta: um dump pequeno começa e termina em poucas voltas
+  auto dumpStartsAfter = [&](const char* command) {
+    mock::mqttInject(cmd, command);
+    bool started = false;
+    for (int i = 0; i < 50 && !started; i++) {
+      host::runFor(1);
+      started = flightRecorderDumpActive();
+    }
+    for (int i = 0; i < 600'000 && flightRecorderDumpActive(); i++) {
+      host::runFor(1);
+    }
+    return started;
+  };
+
+  uint64_t n = allocationsDuring([&] {
+    // Sufixo que não é inteiro positivo: comando desconhecido, sem dump
+    for (const char* bad : { "DUMP abc", "DUMP -3", "DUMP 2x", "DUMP +3", "DUMP 0", "DUMPX", "DUMP 99999999999" }) {
+      EXPECT_FALSE(dumpStartsAfter(bad)) << bad;
+    }
+    // "dump 1" (normalizado) e "DUMP" (caixa-preta inteira) valem
+    EXPECT_TRUE(dumpStartsAfter(" dump 1 "));
+    EXPECT_TRUE(dumpStartsAfter("DUMP"));
+  });
+  EXPECT_EQ(n, 0u);
+  EXPECT_EQ(firmwareCounted, 0u);
+}
+
+TEST_F(LoopAllocTest, ReconnectDoesNotAllocate) {
+  uint64_t n = allocationsDuring([] {
+    mock::dropMqtt();
+    mock::failMqttConnects(2);  // reconexão insiste (uma tentativa a cada 5 s)
+    host::runFor(2'000);
+    mock::setWifiConnected(false);
+    host::runFor(20'000);
+    mock::setWifiConnected(true);
+    host::runFor(20'000);
+  });
+  EXPECT_EQ(n, 0u);
+  EXPECT_EQ(firmwareCounted, 0u);
+  EXPECT_GE(mock::mqttConnectCount(), 2u);
+}
+
+}  // namespace
@@ -0,0 +1,56 @@
+// Chuva com a internet fora do ar: o broker recusa toda conexão e a
+// reconexão do MQTT não pode atrasar o fechamento (RAIN_LEVEL_CHANGED ->
+// controlador -> motor na mesma volta do loop, como com o broker no ar).
+
+#include <gtest/gtest.h>
+
+#include "host_firmware.h"
+#include "rain_sensor.h"
+#include "stepper_motor.h"
+#include "varal_controller.h"
+
+namespace {
+
+const unsigned long RAIN_CHECK_MS = 1'000;  // leitura do sensor (rain_sensor.cpp)
+
+class OfflineReactionTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    host::boot();
+    host::runFor(5'000);  // homing e a abertura inicial
+    for (int i = 0; i < 60'000 && stepperIsMoving(); i++) {
+      onePass();
+    }
+    ASSERT_FALSE(stepperIsMoving()) << "abertura inicial não terminou";
+    ASSERT_FALSE(rainIsRaining());
+  }
+
+  // Uma volta do loop(); devolve quanto o relógio andou dentro dela
+  uint64_t onePass() {
+    mock::advanceMillis(1);
+    uint64_t before = mock::nowMicros();
+    loop();
+    return mock::nowMicros() - before;
+  }
+};
+
+TEST_F(OfflineReactionTest, RainClosesWithinOnePassWhileTheBrokerRefusesConnections) {
+  // Internet cai junto com a chuva forte: Wi-Fi no ar, broker recusando
+  // toda tentativa; a volta que lê o sensor já começa a fechar
+  mock::dropMqtt();
+  mock::failMqttConnects(1'000'000);
+  mock::setAnalog(host::RAIN_ANALOG_PIN, 500);
+  unsigned long rainStart     = millis();
+  uint64_t      slowestPassUs = 0;
+  for (int i = 0; i < 10'000 && !rainIsRaining(); i++) {
+    slowestPassUs = std::max(slowestPassUs, onePass());
+  }
+  ASSERT_TRUE(rainIsRaining()) << "sensor não viu a chuva";
+  EXPECT_TRUE(stepperIsMoving()) << "fechamento não começou na volta do evento";
+  EXPECT_LE(varalControllerGetLastReactionMs(), 1u);
+  EXPECT_LE(millis() - rainStart, RAIN_CHECK_MS + 1) << "chuva -> motor atrasou";
+  EXPECT_LT(slowestPassUs, 1'000u) << "o loop ficou preso na reconexão";
+  EXPECT_FALSE(mqttIsConnected());
+}
+
+}  // namespace
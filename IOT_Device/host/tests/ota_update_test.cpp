@@ -0,0 +1,188 @@
+// OTA de ponta a ponta no ota_update.cpp: pacotes de verdade do
+// backend/tools/ota_pack (tests/gen_ota_packages.py, chave própria do
+// teste) servidos pelo HTTP do mock, gravados na app1 do mock.
+//
+// - completo e delta: a app1 recebe a imagem nova e o boot troca
+// - conexão caindo no meio: retoma com Range e termina igual
+// - assinatura, cabeçalho ou fluxo adulterados: recusado; com assinatura
+//   ruim nada é gravado, com fluxo ruim a gravação aborta e o boot não troca
+// - pacote cortado: falha sem trocar o boot
+//
+// A task do OTA roda dentro do otaHandleJob (tasks do mock são síncronas);
+// as esperas dela (vTaskDelay) andam o relógio do mock.
+
+#include <gtest/gtest.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "mock_hal.h"
+#include "ota_update.h"
+#include "mqtt_manager.h"
+#include "telemetry.h"
+#include "mem_monitor.h"
+#include "stepper_motor.h"
+
+// ==========================
+// RESTO DO FIRMWARE (o OTA só consulta)
+// ==========================
+
+bool mqttIsConnected()                 { return true; }
+void mqttRequestHeartbeat()            {}
+void telemetryRequestFullReport()      {}
+void memMonitorAllowAllocations(bool)  {}
+bool stepperIsMoving()                 { return false; }
+
+namespace {
+
+const size_t SIGNATURE_OFFSET = 81;   // ota_update.h: u8 tamanho em 80, assinatura depois
+const size_t IMAGE_SHA_OFFSET = 16;
+const size_t HEADER_SIZE      = 160;
+
+int jobs = 0;  // o firmware lembra a última url mesmo entre testes do mesmo processo
+
+std::vector<uint8_t> load(const char* name) {
+  std::ifstream in(std::string(VARAL_OTA_DIR) + "/" + name, std::ios::binary);
+  EXPECT_TRUE(in.good()) << name << " não gerado (precisa de Python 3 com cryptography)";
+  return std::vector<uint8_t>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+class OtaUpdateTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    mock::reset();
+    oldImage = load("old.bin");
+    newImage = load("new.bin");
+    full     = load("full.vota");
+    delta    = load("delta.vota");
+    ASSERT_FALSE(oldImage.empty());
+    ASSERT_FALSE(full.empty());
+    mock::setRunningImage(oldImage.data(), oldImage.size());
+    otaInit();
+  }
+
+  // Pede a atualização (cada teste com a sua url: uma tentativa por url)
+  bool update(const std::vector<uint8_t>& package, size_t dropEvery = 0) {
+    mock::httpServe(package.data(), package.size(), dropEvery);
+    char job[64];
+    snprintf(job, sizeof(job), "{\"url\":\"http://backend/ota/%d.vota\"}", ++jobs);
+    return otaHandleJob((const uint8_t*)job, strlen(job));
+  }
+
+  std::string report() {
+    char json[256];
+    return otaReportJson(json, sizeof(json)) > 0 ? json : "";
+  }
+
+  std::vector<uint8_t> written() {
+    size_t         n;
+    const uint8_t* data = mock::otaWritten(&n);
+    return std::vector<uint8_t>(data, data + n);
+  }
+
+  void expectInstalled() {
+    EXPECT_FALSE(otaBusy());
+    EXPECT_NE(report().find("\"state\":\"ready\""), std::string::npos) << report();
+    EXPECT_TRUE(written() == newImage) << "app1 com " << written().size() << " bytes";
+    EXPECT_TRUE(mock::otaBootSwitched());
+    EXPECT_FALSE(mock::otaAborted());
+  }
+
+  // Recusado antes do esp_ota_begin: nada apagado nem gravado
+  void expectRejectedBeforeWriting(const char* error) {
+    EXPECT_NE(report().find(error), std::string::npos) << report();
+    EXPECT_TRUE(written().empty());
+    EXPECT_FALSE(mock::otaAborted());
+    EXPECT_FALSE(mock::otaBootSwitched());
+  }
+
+  std::vector<uint8_t> oldImage, newImage, full, delta;
+};
+
+TEST_F(OtaUpdateTest, FullImageInstalls) {
+  ASSERT_TRUE(update(full));
+  expectInstalled();
+  EXPECT_NE(report().find("\"kind\":\"full\""), std::string::npos);
+  EXPECT_EQ(mock::httpRequests(), 1);
+}
+
+TEST_F(OtaUpdateTest, DeltaInstalls) {
+  ASSERT_TRUE(update(delta));
+  expectInstalled();
+  EXPECT_NE(report().find("\"kind\":\"delta\""), std::string::npos);
+}
+
+TEST_F(OtaUpdateTest, ResumesAfterDroppedConnections) {
+  ASSERT_TRUE(update(delta, 1500));
+  expectInstalled();
+  EXPECT_GT(mock::httpRequests(), 1);
+  EXPECT_GT(mock::httpLastRangeFrom(), 0u);
+  EXPECT_EQ(report().find("\"resumes\":0"), std::string::npos) << report();
+
+  // Completo também: o fluxo zlib continua de onde parou
+  mock::reset();
+  mock::setRunningImage(oldImage.data(), oldImage.size());
+  ASSERT_TRUE(update(full, 40'000));
+  expectInstalled();
+  EXPECT_GT(mock::httpLastRangeFrom(), 0u);
+}
+
+TEST_F(OtaUpdateTest, AlreadyRunningIsUpToDate) {
+  mock::setRunningImage(newImage.data(), newImage.size());
+  ASSERT_TRUE(update(full));
+  EXPECT_NE(report().find("\"state\":\"up_to_date\""), std::string::npos) << report();
+  EXPECT_TRUE(written().empty());
+  EXPECT_FALSE(mock::otaBootSwitched());
+}
+
+TEST_F(OtaUpdateTest, TamperedSignatureRejected) {
+  std::vector<uint8_t> bad = full;
+  bad[SIGNATURE_OFFSET + 10] ^= 0x40;
+  ASSERT_TRUE(update(bad));
+  expectRejectedBeforeWriting("assinatura inválida");
+}
+
+TEST_F(OtaUpdateTest, TamperedHeaderRejected) {
+  // Outra imagem com a assinatura original: o SHA-256 faz parte do assinado
+  std::vector<uint8_t> bad = delta;
+  bad[IMAGE_SHA_OFFSET + 3] ^= 0x01;
+  ASSERT_TRUE(update(bad));
+  expectRejectedBeforeWriting("assinatura inválida");
+}
+
+TEST_F(OtaUpdateTest, DeltaForAnotherImageRejected) {
+  std::vector<uint8_t> other = oldImage;
+  other[1000] ^= 0xFF;
+  mock::setRunningImage(other.data(), other.size());
+  ASSERT_TRUE(update(delta));
+  expectRejectedBeforeWriting("delta feito para outra imagem");
+}
+
+TEST_F(OtaUpdateTest, TamperedPayloadNeverBoots) {
+  // A assinatura cobre só o cabeçalho: o fluxo adulterado é pego pelo zlib
+  // ou pelo SHA-256 da imagem gravada, e o boot fica na imagem atual
+  std::vector<uint8_t> bad = full;
+  bad[HEADER_SIZE + (bad.size() - HEADER_SIZE) / 2] ^= 0x10;
+  ASSERT_TRUE(update(bad));
+  EXPECT_NE(report().find("\"state\":\"failed\""), std::string::npos) << report();
+  EXPECT_TRUE(mock::otaAborted());
+  EXPECT_FALSE(mock::otaBootSwitched());
+}
+
+TEST_F(OtaUpdateTest, TruncatedPackageFails) {
+  std::vector<uint8_t> cut(full.begin(), full.end() - 1000);
+  ASSERT_TRUE(update(cut));
+  EXPECT_NE(report().find("\"state\":\"failed\""), std::string::npos) << report();
+  EXPECT_TRUE(mock::otaAborted());
+  EXPECT_FALSE(mock::otaBootSwitched());
+  EXPECT_LT(written().size(), newImage.size());
+
+  // Só o cabeçalho pela metade: nem começa a gravar
+  mock::reset();
+  mock::setRunningImage(oldImage.data(), oldImage.size());
+  std::vector<uint8_t> header(full.begin(), full.begin() + 100);
+  ASSERT_TRUE(update(header));
+  expectRejectedBeforeWriting("download do cabeçalho");
+}
+
+}  // namespace
@@ -0,0 +1,254 @@
+// Replay de traços de tempo (data/weather/*.csv) no firmware inteiro: o
+// DHT11 e o sensor de chuva seguem o traço e o varal decide sozinho (AUTO).
+//
+// Cada traço roda duas vezes:
+//   - com a previsão (DHT11 lendo o traço)
+//   - só reativo (DHT11 sem resposta: a previsão nunca opina)
+// e mede:
+//   - antecedência ganha: varal fechado no reativo - fechado com previsão
+//   - folga: início da chuva - varal fechado com previsão (> 0 = seco)
+//   - fechamentos falsos: fechou e não choveu nos 30 min seguintes
+//
+// Formato do traço: "t_min,temp_c,humidity,rain_analog" (pontos-chave,
+// interpolados em linha reta); "# expect: lead_min_s=N false_max=M" no
+// cabeçalho diz o que o traço precisa atingir. Um log da caixa-preta vira
+// traço com "python -m tools.flight_log --file log.bin --csv".
+
+#include <gtest/gtest.h>
+#include <math.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "host_firmware.h"
+#include "rain_sensor.h"
+#include "rain_predictor.h"
+#include "stepper_motor.h"
+
+namespace {
+
+const uint64_t FALSE_CLOSE_WINDOW_MS = 30ull * 60'000;
+
+struct TracePoint {
+  double tMin;
+  float  tempC;
+  float  humidity;
+  int    rainAnalog;
+};
+
+struct Trace {
+  std::string             name;
+  std::vector<TracePoint> points;
+  long                    leadMinS = 0;
+  int                     falseMax = 0;
+};
+
+Trace loadTrace(const std::string& name) {
+  Trace trace;
+  trace.name = name;
+  std::ifstream in(std::string(VARAL_WEATHER_DIR) + "/" + name + ".csv");
+  EXPECT_TRUE(in.good()) << "traço não encontrado: " << name;
+
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.rfind("# expect:", 0) == 0) {
+      sscanf(line.c_str(), "# expect: lead_min_s=%ld false_max=%d", &trace.leadMinS, &trace.falseMax);
+      continue;
+    }
+    TracePoint p;
+    if (line.empty() || line[0] == '#' ||
+        sscanf(line.c_str(), "%lf,%f,%f,%d", &p.tMin, &p.tempC, &p.humidity, &p.rainAnalog) != 4) {
+      continue;  // comentário ou cabeçalho
+    }
+    trace.points.push_back(p);
+  }
+  return trace;
+}
+
+// Ponto do traço no instante t (linha reta entre pontos-chave). O DHT11
+// entrega umidade inteira; a chuva é o valor cru do ADC.
+TracePoint sample(const Trace& trace, double tMin) {
+  const std::vector<TracePoint>& p = trace.points;
+  size_t i = 1;
+  while (i < p.size() - 1 && p[i].tMin < tMin) {
+    i++;
+  }
+  const TracePoint& a = p[i - 1];
+  const TracePoint& b = p[i];
+  double f = b.tMin > a.tMin ? (tMin - a.tMin) / (b.tMin - a.tMin) : 1.0;
+  f = f < 0.0 ? 0.0 : (f > 1.0 ? 1.0 : f);
+
+  TracePoint s;
+  s.tMin       = tMin;
+  s.tempC      = roundf((float)(a.tempC + (b.tempC - a.tempC) * f) * 10.0f) / 10.0f;
+  s.humidity   = roundf((float)(a.humidity + (b.humidity - a.humidity) * f));
+  s.rainAnalog = (int)lround(a.rainAnalog + (b.rainAnalog - a.rainAnalog) * f);
+  return s;
+}
+
+struct CloseEvent {
+  uint64_t startMs;
+  uint64_t closedMs;  // 0 = não terminou de fechar
+  bool     rainAfter; // choveu até FALSE_CLOSE_WINDOW_MS depois do início
+};
+
+struct Replay {
+  uint64_t                rainMs = 0;  // 1ª vez que o sensor de chuva acusou (0 = não choveu)
+  std::vector<CloseEvent> closes;
+
+  uint64_t firstClosedMs() const {
+    for (const CloseEvent& c : closes) {
+      if (c.closedMs != 0) return c.closedMs;
+    }
+    return 0;
+  }
+
+  int falseCloses() const {
+    int n = 0;
+    for (const CloseEvent& c : closes) {
+      if (!c.rainAfter) n++;
+    }
+    return n;
+  }
+};
+
+Replay replay(const Trace& trace, bool withDht) {
+  auto feed = [&](double tMin) {
+    TracePoint s = sample(trace, tMin);
+    if (withDht) {
+      mock::setDht(s.tempC, s.humidity);
+    } else {
+      mock::setDht(NAN, NAN);
+    }
+    mock::setAnalog(host::RAIN_ANALOG_PIN, (uint16_t)s.rainAnalog);
+  };
+
+  feed(0.0);
+  host::boot();
+  uint64_t start = mock::nowMicros() / 1000;
+  uint64_t end   = start + (uint64_t)(trace.points.back().tMin * 60'000.0);
+
+  Replay r;
+  long prevSteps = stepperGetCurrentSteps();
+  bool closing   = false;
+  while (mock::nowMicros() / 1000 < end) {
+    uint64_t now = mock::nowMicros() / 1000 - start;
+    feed(now / 60'000.0);
+
+    // Motor andando: passo a passo (um por volta do loop); parado, 100 ms
+    // bastam (sensores a cada 1-2 s, decisões a cada 2 s)
+    uint32_t step = stepperIsMoving() ? 2 : 100;
+    mock::advanceMillis(step);
+    loop();
+    now += step;
+
+    if (r.rainMs == 0 && rainIsRaining()) {
+      r.rainMs = now;
+      for (CloseEvent& c : r.closes) {
+        c.rainAfter = c.rainAfter || now - c.startMs <= FALSE_CLOSE_WINDOW_MS;
+      }
+    }
+
+    long steps = stepperGetCurrentSteps();
+    if (!closing && steps < prevSteps && stepperIsMoving()) {
+      closing = true;
+      r.closes.push_back({ now, 0, r.rainMs != 0 && now >= r.rainMs });
+    }
+    if (closing && steps == 0 && !stepperIsMoving()) {
+      closing = false;
+      r.closes.back().closedMs = now;
+    }
+    if (closing && steps > prevSteps) {
+      closing = false;  // reabriu no meio
+    }
+    prevSteps = steps;
+  }
+  return r;
+}
+
+// O firmware vive em estáticos: cada replay roda num processo filho com um
+// boot limpo e devolve o resultado pelo pipe
+Replay replayIsolated(const Trace& trace, bool withDht) {
+  int fds[2];
+  EXPECT_EQ(pipe(fds), 0);
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid == 0) {
+    close(fds[0]);
+    Replay r = replay(trace, withDht);
+    uint64_t header[2] = { r.rainMs, r.closes.size() };
+    bool ok = write(fds[1], header, sizeof(header)) == (ssize_t)sizeof(header) &&
+              (r.closes.empty() || write(fds[1], r.closes.data(), r.closes.size() * sizeof(CloseEvent)) ==
+                                       (ssize_t)(r.closes.size() * sizeof(CloseEvent)));
+    _exit(ok ? 0 : 1);
+  }
+  close(fds[1]);
+
+  Replay   r;
+  uint64_t header[2] = { 0, 0 };
+  if (read(fds[0], header, sizeof(header)) == (ssize_t)sizeof(header)) {
+    r.rainMs = header[0];
+    r.closes.resize(header[1]);
+    size_t want = r.closes.size() * sizeof(CloseEvent);
+    size_t got  = 0;
+    while (got < want) {
+      ssize_t n = read(fds[0], (char*)r.closes.data() + got, want - got);
+      if (n <= 0) break;
+      got += (size_t)n;
+    }
+  }
+  close(fds[0]);
+  int status = 0;
+  waitpid(pid, &status, 0);
+  EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0) << "replay morreu: " << trace.name;
+  return r;
+}
+
+std::string fmtMin(uint64_t ms) {
+  if (ms == 0) return "-";
+  char buf[16];
+  snprintf(buf, sizeof(buf), "%.1f", ms / 60'000.0);
+  return buf;
+}
+
+class RainReplayTest : public ::testing::TestWithParam<const char*> {};
+
+TEST_P(RainReplayTest, LeadTimeAndFalseCloses) {
+  Trace trace = loadTrace(GetParam());
+  ASSERT_GE(trace.points.size(), 2u);
+
+  Replay predictive = replayIsolated(trace, true);
+  Replay reactive   = replayIsolated(trace, false);
+
+  uint64_t closedPredictive = predictive.firstClosedMs();
+  uint64_t closedReactive   = reactive.firstClosedMs();
+  long leadS   = 0;
+  long marginS = 0;
+  if (predictive.rainMs != 0) {
+    ASSERT_NE(closedPredictive, 0u) << "choveu e o varal não fechou";
+    ASSERT_NE(closedReactive, 0u) << "choveu e o varal (reativo) não fechou";
+    leadS   = ((long)closedReactive - (long)closedPredictive) / 1000;
+    marginS = ((long)predictive.rainMs - (long)closedPredictive) / 1000;
+  }
+
+  printf("[REPLAY] %-18s chuva=%5s min | fechado: previsão=%5s reativo=%5s min | "
+         "antecedência ganha=%5ld s | folga=%5ld s | fechamentos falsos=%d (reativo %d)\n",
+         trace.name.c_str(), fmtMin(predictive.rainMs).c_str(), fmtMin(closedPredictive).c_str(),
+         fmtMin(closedReactive).c_str(), leadS, marginS, predictive.falseCloses(), reactive.falseCloses());
+  RecordProperty("lead_gained_s", (int)leadS);
+  RecordProperty("margin_s", (int)marginS);
+  RecordProperty("false_closes", predictive.falseCloses());
+
+  EXPECT_GE(leadS, trace.leadMinS);
+  EXPECT_LE(predictive.falseCloses(), trace.falseMax);
+  EXPECT_EQ(reactive.falseCloses(), 0) << "sem previsão, só chuva de verdade fecha";
+}
+
+INSTANTIATE_TEST_SUITE_P(Weather, RainReplayTest,
+                         ::testing::Values("frente_fria", "pancada_de_verao", "chuva_sem_aviso", "manha_umida",
+                                           "dia_seco"),
+                         [](const ::testing::TestParamInfo<const char*>& info) { return std::string(info.param); });
+
+}  // namespace
@@ -0,0 +1,183 @@
+// Teste cruzado: a máquina de regras do firmware (rule_engine.cpp) contra o
+// RuleVM do backend (tools/rule_sim.py), que é quem aprova os programas
+// antes de irem para o varal. Os dois têm que decidir igual.
+//
+// tests/gen_rule_cases.py compila data/rules/crosscheck.txt, roda uma
+// linha do tempo aleatória no RuleVM e grava o esperado caso a caso (ação,
+// regra, limites de movimento). Aqui a mesma linha do tempo roda no
+// rule_engine.cpp sozinho: as entradas (chuva, previsão, DHT11) são
+// funções deste arquivo e a hora vem de mock::setWallClock.
+
+#include <gtest/gtest.h>
+#include <math.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "mock_hal.h"
+#include "rule_engine.h"
+#include "rain_sensor.h"
+#include "rain_predictor.h"
+#include "dht11_sensor.h"
+#include "mem_monitor.h"
+
+// ==========================
+// ENTRADAS DO MOTOR DE REGRAS
+// ==========================
+
+namespace {
+
+struct Inputs {
+  RainLevel level    = RainLevel::NONE;
+  bool      raining  = false;
+  bool      likely   = false;
+  bool      dhtValid = false;
+  float     tempC    = 0.0f;
+  float     humidity = 0.0f;
+};
+
+Inputs inputs;
+
+}  // namespace
+
+RainLevel rainGetLevel()              { return inputs.level; }
+bool      rainIsRaining()             { return inputs.raining; }
+bool      rainPredictorIsRainLikely() { return inputs.likely; }
+bool      dht11HasValidData()         { return inputs.dhtValid; }
+float     dht11GetTemperatureC()      { return inputs.tempC; }
+float     dht11GetHumidity()          { return inputs.humidity; }
+void      memMonitorAllowAllocations(bool allow) { (void)allow; }
+
+namespace {
+
+struct Case {
+  int         line;
+  uint32_t    dtS;
+  bool        moved;
+  int         level;
+  bool        raining;
+  bool        likely;
+  int         tempX10;
+  int         humidityX10;
+  time_t      epoch;   // 0 = sem NTP
+  bool        isOpen;
+  bool        dhtValid;
+  std::string action;  // OPEN / CLOSE / DEFAULT
+  int         rule;    // 255 = nenhuma regra decidiu
+  bool        allowed;
+};
+
+std::vector<uint8_t> loadProgram() {
+  std::ifstream in(std::string(VARAL_RULE_CASES_DIR) + "/rules.bin", std::ios::binary);
+  return std::vector<uint8_t>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+std::vector<Case> loadCases() {
+  std::ifstream     in(std::string(VARAL_RULE_CASES_DIR) + "/cases.txt");
+  std::vector<Case> cases;
+  std::string       line;
+  int               n = 0;
+  while (std::getline(in, line)) {
+    n++;
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    std::istringstream f(line);
+    Case c;
+    int  moved, raining, likely, isOpen, dhtValid, allowed;
+    long long epoch;
+    c.line = n;
+    f >> c.dtS >> moved >> c.level >> raining >> likely >> c.tempX10 >> c.humidityX10 >> epoch >> isOpen >>
+        dhtValid >> c.action >> c.rule >> allowed;
+    EXPECT_FALSE(f.fail()) << "cases.txt:" << n << " mal formada";
+    c.moved    = moved != 0;
+    c.raining  = raining != 0;
+    c.likely   = likely != 0;
+    c.epoch    = (time_t)epoch;
+    c.isOpen   = isOpen != 0;
+    c.dhtValid = dhtValid != 0;
+    c.allowed  = allowed != 0;
+    cases.push_back(c);
+  }
+  return cases;
+}
+
+const char* actionName(RuleAction action) {
+  return action == RuleAction::OPEN ? "OPEN" : action == RuleAction::CLOSE ? "CLOSE" : "DEFAULT";
+}
+
+// Regra que decidiu, pelo relatório do firmware ("rule":-1 -> 255, como no
+// RuleVM); -2 se o relatório não saiu
+int reportedRule() {
+  char json[160];
+  if (ruleEngineReportJson(json, sizeof(json)) == 0) {
+    return -2;
+  }
+  const char* p = strstr(json, "\"rule\":");
+  if (p == nullptr) {
+    return -2;
+  }
+  int rule = atoi(p + 7);
+  return rule < 0 ? RULE_NO_RULE : rule;
+}
+
+class RuleVmTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    mock::reset();
+    inputs  = Inputs();
+    program = loadProgram();
+    ASSERT_GT(program.size(), 12u) << "rules.bin não gerado (precisa de Python 3)";
+  }
+
+  std::vector<uint8_t> program;
+};
+
+TEST_F(RuleVmTest, RejectsCorruptedProgram) {
+  std::vector<uint8_t> bad = program;
+  bad[bad.size() / 2] ^= 0x01;
+  EXPECT_FALSE(ruleEngineInstall(bad.data(), bad.size()));
+  bad = program;
+  bad.pop_back();  // CRC cortado
+  EXPECT_FALSE(ruleEngineInstall(bad.data(), bad.size()));
+  EXPECT_FALSE(ruleEngineActive());
+  EXPECT_TRUE(ruleEngineInstall(program.data(), program.size()));
+  EXPECT_TRUE(ruleEngineActive());
+}
+
+TEST_F(RuleVmTest, FirmwareMatchesRuleSim) {
+  std::vector<Case> cases = loadCases();
+  ASSERT_GT(cases.size(), 1000u);
+  ASSERT_TRUE(ruleEngineInstall(program.data(), program.size()));
+
+  int mismatches = 0;
+  for (const Case& c : cases) {
+    mock::advanceMillis(c.dtS * 1000);
+    if (c.moved) {
+      ruleEngineNoteMove();
+    }
+    mock::setWallClock(c.epoch);
+    inputs.level    = (RainLevel)c.level;
+    inputs.raining  = c.raining;
+    inputs.likely   = c.likely;
+    inputs.dhtValid = c.dhtValid;
+    inputs.tempC    = c.dhtValid ? c.tempX10 / 10.0f : NAN;
+    inputs.humidity = c.dhtValid ? c.humidityX10 / 10.0f : NAN;
+
+    const char* action  = actionName(ruleEngineEvaluate(c.isOpen));
+    int         rule    = reportedRule();
+    bool        allowed = ruleEngineMoveAllowed();
+    if (c.action != action || c.rule != rule || c.allowed != allowed) {
+      ADD_FAILURE() << "cases.txt:" << c.line << ": firmware " << action << " regra " << rule
+                    << (allowed ? " livre" : " segurado") << ", rule_sim " << c.action << " regra " << c.rule
+                    << (c.allowed ? " livre" : " segurado");
+      if (++mismatches >= 10) {
+        break;  // o resto é o mesmo erro
+      }
+    }
+  }
+  printf("[RULES] %zu casos conferidos, %d divergências\n", cases.size(), mismatches);
+}
+
+}  // namespace
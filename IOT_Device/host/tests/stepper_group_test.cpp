@@ -0,0 +1,136 @@
+// StepperGroup: movimento coordenado (Bresenham sobre o motor "mestre") e
+// troca de alvo no meio. Quem ganha alvo próprio sai do grupo e anda
+// sozinho; os que ficam refazem o Bresenham com o que falta e continuam
+// chegando juntos, mesmo quando quem saiu era o mestre.
+
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "mock_hal.h"
+#include "stepper_motor.h"
+
+namespace {
+
+const int MOTORS = 3;
+
+StepperConfig halfStep(int firstPin) {
+  return { firstPin, firstPin + 1, firstPin + 2, firstPin + 3, -1, 4096, StepperDrive::HALF_STEP };
+}
+
+class StepperGroupTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    mock::reset();
+    for (StepperMotor& m : motors) {
+      m.begin();
+      m.setSpeed(1000.0f);  // um passo por ms
+      group.add(m);
+    }
+  }
+
+  // Anda de ms em ms até todos pararem; guarda em que ms cada um parou
+  void runUntilIdle(int maxMs = 10'000) {
+    for (int i = 0; i < MOTORS; i++) {
+      stoppedAt[i] = motors[i].isMoving() ? -1 : 0;
+    }
+    for (int ms = 1; ms <= maxMs; ms++) {
+      step();
+      bool anyMoving = false;
+      for (int i = 0; i < MOTORS; i++) {
+        if (stoppedAt[i] < 0 && !motors[i].isMoving()) {
+          stoppedAt[i] = ms;
+        }
+        anyMoving = anyMoving || motors[i].isMoving();
+      }
+      if (!anyMoving) {
+        return;
+      }
+    }
+    FAIL() << "motores não pararam em " << maxMs << " ms";
+  }
+
+  void step(int ms = 1) {
+    for (int i = 0; i < ms; i++) {
+      mock::advanceMicros(1000);
+      group.loop();
+    }
+  }
+
+  StepperMotor motors[MOTORS] = { StepperMotor(halfStep(4)), StepperMotor(halfStep(8)),
+                                  StepperMotor(halfStep(12)) };
+  StepperGroup group;
+  int          stoppedAt[MOTORS] = {};
+};
+
+TEST_F(StepperGroupTest, CoordinatedMotorsArriveTogether) {
+  const long targets[] = { 400, 200, 100 };
+  group.moveCoordinated(targets, MOTORS);
+  runUntilIdle();
+  for (int i = 0; i < MOTORS; i++) {
+    EXPECT_EQ(motors[i].getCurrentSteps(), targets[i]);
+    EXPECT_EQ(stoppedAt[i], stoppedAt[0]) << "motor " << i;
+  }
+  EXPECT_NEAR(stoppedAt[0], 400, 2);  // no ritmo do mestre
+}
+
+TEST_F(StepperGroupTest, FollowerRetargetedMidMove) {
+  const long targets[] = { 400, 200, 100 };
+  group.moveCoordinated(targets, MOTORS);
+  step(100);
+  long before = motors[1].getCurrentSteps();
+  ASSERT_GT(before, 0);
+
+  motors[1].moveToSteps(20);  // volta sozinho
+  runUntilIdle();
+  EXPECT_EQ(motors[0].getCurrentSteps(), 400);
+  EXPECT_EQ(motors[1].getCurrentSteps(), 20);
+  EXPECT_EQ(motors[2].getCurrentSteps(), 100);
+  EXPECT_EQ(stoppedAt[0], stoppedAt[2]) << "os que ficaram no grupo chegam juntos";
+  EXPECT_LT(stoppedAt[1], stoppedAt[0]);
+}
+
+TEST_F(StepperGroupTest, MasterRetargetedMidMove) {
+  const long targets[] = { 400, 200, 100 };
+  group.moveCoordinated(targets, MOTORS);
+  step(100);
+
+  // Sai o mestre: o motor 1 (o que mais falta) passa a ditar o ritmo
+  motors[0].moveToSteps(150);
+  runUntilIdle();
+  EXPECT_EQ(motors[0].getCurrentSteps(), 150);
+  EXPECT_EQ(motors[1].getCurrentSteps(), 200);
+  EXPECT_EQ(motors[2].getCurrentSteps(), 100);
+  EXPECT_EQ(stoppedAt[1], stoppedAt[2]) << "os que ficaram no grupo chegam juntos";
+  EXPECT_NEAR(stoppedAt[1], 200 - 50, 3);  // faltavam ~150 passos do motor 1
+}
+
+TEST_F(StepperGroupTest, EveryoneRetargetedEndsCoordinatedMove) {
+  const long targets[] = { 400, 200, 100 };
+  group.moveCoordinated(targets, MOTORS);
+  step(50);
+
+  motors[0].moveToSteps(60);
+  motors[1].moveToSteps(70);
+  motors[2].moveToSteps(80);
+  runUntilIdle();
+  EXPECT_EQ(motors[0].getCurrentSteps(), 60);
+  EXPECT_EQ(motors[1].getCurrentSteps(), 70);
+  EXPECT_EQ(motors[2].getCurrentSteps(), 80);
+}
+
+TEST_F(StepperGroupTest, SmallerCoordinatedMoveReleasesTheRest) {
+  const long first[] = { 400, 200, 100 };
+  group.moveCoordinated(first, MOTORS);
+  step(40);
+
+  // Novo movimento só com os dois primeiros: o terceiro segue sozinho
+  const long second[] = { 10, 300 };
+  group.moveCoordinated(second, 2);
+  runUntilIdle();
+  EXPECT_EQ(motors[0].getCurrentSteps(), 10);
+  EXPECT_EQ(motors[1].getCurrentSteps(), 300);
+  EXPECT_EQ(motors[2].getCurrentSteps(), 100);
+  EXPECT_EQ(stoppedAt[0], stoppedAt[1]);
+}
+
+}  // namespace
@@ -0,0 +1,174 @@
+// Microstepping (StepperDrive::MICROSTEP): os passos saem do esp_timer e o
+// loop pode parar o movimento enquanto um tick já disparado ainda roda
+// (esp_timer_stop não espera o callback). Depois do stop, nenhum tick pode
+// mexer em posição nem nas bobinas.
+//
+// - determinístico: para (home / movimento coordenado) e chama o callback
+//   "atrasado" com mock::fireTimer
+// - estresse: uma thread dispara o callback sem parar enquanto o teste
+//   move, para e confere (o portMUX do mock é um spinlock de verdade)
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "mock_hal.h"
+#include "stepper_motor.h"
+
+namespace {
+
+const StepperConfig MICRO_CONFIG = { 25, 26, 27, 14, 33, 4096, StepperDrive::MICROSTEP };
+const StepperConfig HALF_CONFIG  = { 16, 17, 18, 19, -1, 4096, StepperDrive::HALF_STEP };
+
+const float    SPEED     = 200.0f;                        // half-steps/s: micropassos
+const uint64_t MICRO_US  = 1'000'000 / 200 / MICROSTEPS_PER_HALFSTEP;
+const uint64_t HALF_US   = MICRO_US * MICROSTEPS_PER_HALFSTEP;
+
+// Posição e correntes das 4 bobinas (canais LEDC 0..3: o 1º motor microstep)
+struct Snapshot {
+  long     steps;
+  uint32_t duty[4];
+
+  bool operator==(const Snapshot& o) const {
+    return steps == o.steps && memcmp(duty, o.duty, sizeof(duty)) == 0;
+  }
+};
+
+Snapshot snapshot(const StepperMotor& motor) {
+  Snapshot s;
+  s.steps = motor.getCurrentSteps();
+  for (int k = 0; k < 4; k++) {
+    s.duty[k] = mock::ledcDuty(k);
+  }
+  return s;
+}
+
+// Os canais LEDC do firmware não voltam (4 por motor microstep): um motor
+// só para o processo inteiro, reiniciado a cada teste
+class StepperMicrostepTest : public ::testing::Test {
+protected:
+  static void SetUpTestSuite() {
+    mock::reset();
+    microMotor().begin();
+    timer = mock::lastTimer();
+  }
+
+  void SetUp() override {
+    ASSERT_NE(timer, nullptr) << "microstepping sem esp_timer";
+    esp_timer_stop(timer);  // sobra de um teste anterior (erro se parado: ok)
+    motor.begin();
+    group.add(motor);
+    motor.setSpeed(SPEED);
+  }
+
+  static StepperMotor& microMotor() {
+    static StepperMotor m(MICRO_CONFIG);
+    return m;
+  }
+
+  static esp_timer_handle_t timer;
+
+  StepperMotor& motor = microMotor();
+  StepperGroup  group;
+};
+
+esp_timer_handle_t StepperMicrostepTest::timer = nullptr;
+
+TEST_F(StepperMicrostepTest, StepsComeFromTheTimer) {
+  motor.moveToSteps(100);
+  EXPECT_EQ(mock::activeTimers(), 1);
+  mock::advanceMicros(HALF_US * 10);
+  EXPECT_EQ(motor.getCurrentSteps(), 10);
+
+  mock::advanceMicros(HALF_US * 100);
+  group.loop();
+  EXPECT_EQ(motor.getCurrentSteps(), 100);
+  EXPECT_FALSE(motor.isMoving());
+  EXPECT_EQ(mock::activeTimers(), 0);
+}
+
+TEST_F(StepperMicrostepTest, LateTickAfterHomeChangesNothing) {
+  motor.moveToSteps(1000);
+  mock::advanceMicros(HALF_US * 10 + MICRO_US * 3);  // no meio de um half-step
+  ASSERT_EQ(motor.getCurrentSteps(), 10);
+
+  motor.home();  // stopTimedMove: volta as bobinas para a fronteira da fase
+  EXPECT_EQ(mock::activeTimers(), 0);
+  Snapshot stopped = snapshot(motor);
+  for (int i = 0; i < 3 * MICROSTEPS_PER_HALFSTEP; i++) {
+    mock::fireTimer(timer);  // tick que já tinha disparado antes do stop
+  }
+  EXPECT_TRUE(snapshot(motor) == stopped);
+}
+
+TEST_F(StepperMicrostepTest, LateTickAfterCoordinatedMoveChangesNothing) {
+  StepperMotor other(HALF_CONFIG);
+  other.begin();
+  group.add(other);
+
+  motor.moveToSteps(1000);
+  mock::advanceMicros(HALF_US * 20 + MICRO_US * 5);
+  ASSERT_EQ(motor.getCurrentSteps(), 20);
+
+  // O coordenado passa o motor para o loop (o mestre dita o ritmo)
+  const long targets[] = { 40, 10 };
+  group.moveCoordinated(targets, 2);
+  Snapshot stopped = snapshot(motor);
+  for (int i = 0; i < 3 * MICROSTEPS_PER_HALFSTEP; i++) {
+    mock::fireTimer(timer);
+  }
+  EXPECT_TRUE(snapshot(motor) == stopped);
+
+  // Só o loop anda com ele daqui em diante
+  for (int i = 0; i < 40 && motor.isMoving(); i++) {
+    mock::advanceMicros(HALF_US);
+    group.loop();
+  }
+  EXPECT_EQ(motor.getCurrentSteps(), 40);
+  EXPECT_EQ(other.getCurrentSteps(), 10);
+}
+
+TEST_F(StepperMicrostepTest, StopRacingTimerThreadStress) {
+  std::atomic<bool>     running{ true };
+  std::atomic<uint64_t> fired{ 0 };
+  std::thread ticker([&] {
+    while (running.load(std::memory_order_relaxed)) {
+      mock::fireTimer(timer);
+      fired.fetch_add(1, std::memory_order_relaxed);
+      std::this_thread::yield();
+    }
+  });
+
+  // Até 2000 rodadas ou 3 s (numa máquina de 1 core as threads revezam devagar)
+  auto deadline   = std::chrono::steady_clock::now() + std::chrono::seconds(3);
+  int  violations = 0;
+  int  round      = 0;
+  for (; round < 2000 && violations == 0 && std::chrono::steady_clock::now() < deadline; round++) {
+    motor.moveToSteps((motor.getCurrentSteps() + 37 + round) % MICRO_CONFIG.stepsPerRev);
+    // Deixa a thread dar alguns micropassos (às vezes para no meio de um)
+    uint64_t until = fired.load() + 1 + round % 13;
+    while (fired.load() < until) {
+      std::this_thread::yield();
+    }
+
+    motor.home();
+    Snapshot stopped = snapshot(motor);
+    until = fired.load() + 20;
+    while (fired.load() < until) {
+      std::this_thread::yield();
+    }
+    Snapshot later = snapshot(motor);
+    if (!(later == stopped) || later.steps < 0 || later.steps >= MICRO_CONFIG.stepsPerRev) {
+      ADD_FAILURE() << "rodada " << round << ": parado em " << stopped.steps << ", depois " << later.steps;
+      violations++;
+    }
+  }
+
+  running = false;
+  ticker.join();
+  printf("[STRESS] %d rodadas, %llu ticks da thread\n", round, (unsigned long long)fired.load());
+  EXPECT_GE(round, 50) << "a thread do timer quase não rodou";
+}
+
+}  // namespace
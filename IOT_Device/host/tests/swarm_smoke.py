@@ -0,0 +1,234 @@
+"""
+Teste de fumaça do varal_swarm: broker MQTT mínimo e um backend de mentira
+(PUT /devices/{id}/desired, GET /devices/{id}/heartbeat) neste processo,
+o enxame rodando contra eles por alguns segundos.
+
+Confere que cada varal do enxame é um firmware separado (um client ID e um
+"online" por varal, versões do desejado aplicadas por varal) e que as três
+métricas saem no resumo: publicação, round-trip de comando e atraso de
+ingestão.
+
+    python swarm_smoke.py _build/varal_swarm
+"""
+
+import asyncio
+import json
+import re
+import subprocess
+import sys
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from typing import Dict, List, Optional, Set
+
+DEVICES = 60
+WORKERS = 2
+DURATION_S = 8
+
+
+# =========================================
+# BROKER (MQTT 3.1.1, QoS0 na entrega, retidos)
+# =========================================
+
+def encode_length(n: int) -> bytes:
+    out = bytearray()
+    while True:
+        b, n = n % 128, n // 128
+        out.append(b | (0x80 if n else 0))
+        if not n:
+            return bytes(out)
+
+
+def topic_matches(filt: str, topic: str) -> bool:
+    fp, tp = filt.split("/"), topic.split("/")
+    for i, part in enumerate(fp):
+        if part == "#":
+            return True
+        if i >= len(tp) or (part != "+" and part != tp[i]):
+            return False
+    return len(fp) == len(tp)
+
+
+def publish_packet(topic: str, payload: bytes, retained: bool = False) -> bytes:
+    body = len(topic.encode()).to_bytes(2, "big") + topic.encode() + payload
+    return bytes([0x30 | (1 if retained else 0)]) + encode_length(len(body)) + body
+
+
+class Broker:
+    def __init__(self) -> None:
+        self.subs: Dict[asyncio.StreamWriter, List[str]] = {}
+        self.retained: Dict[str, bytes] = {}
+        self.client_ids: Set[str] = set()
+        self.online: Set[str] = set()
+        self.heartbeats: Dict[str, Dict] = {}  # device_id -> último heartbeat + received_at
+        self.loop: Optional[asyncio.AbstractEventLoop] = None
+        self.port = 0
+
+    async def _read(self, reader: asyncio.StreamReader):
+        header = (await reader.readexactly(1))[0]
+        length, shift = 0, 0
+        while True:
+            b = (await reader.readexactly(1))[0]
+            length |= (b & 0x7F) << shift
+            shift += 7
+            if not b & 0x80:
+                break
+        return header, await reader.readexactly(length)
+
+    def publish(self, topic: str, payload: bytes, retained: bool) -> None:
+        if retained:
+            self.retained[topic] = payload
+        parts = topic.split("/")
+        if len(parts) == 3 and parts[2] == "status" and payload == b"online":
+            self.online.add(parts[1])
+        if len(parts) == 3 and parts[2] == "heartbeat":
+            doc = json.loads(payload)
+            doc["received_at"] = time.time()
+            self.heartbeats[parts[1]] = doc
+        packet = publish_packet(topic, payload)
+        for writer, filters in list(self.subs.items()):
+            if any(topic_matches(f, topic) for f in filters):
+                writer.write(packet)
+
+    async def _handle(self, reader: asyncio.StreamReader, writer: asyncio.StreamWriter) -> None:
+        self.subs[writer] = []
+        try:
+            while True:
+                header, body = await self._read(reader)
+                kind = header >> 4
+                if kind == 1:  # CONNECT: client ID depois do cabeçalho variável (10 bytes)
+                    n = int.from_bytes(body[10:12], "big")
+                    self.client_ids.add(body[12:12 + n].decode())
+                    writer.write(b"\x20\x02\x00\x00")
+                elif kind == 8:  # SUBSCRIBE
+                    i, granted = 2, []
+                    while i < len(body):
+                        n = int.from_bytes(body[i:i + 2], "big")
+                        filt = body[i + 2:i + 2 + n].decode()
+                        i += 3 + n
+                        self.subs[writer].append(filt)
+                        granted.append(0)
+                        for topic, payload in self.retained.items():
+                            if topic_matches(filt, topic):
+                                writer.write(publish_packet(topic, payload, True))
+                    writer.write(bytes([0x90, 2 + len(granted)]) + body[:2] + bytes(granted))
+                elif kind == 3:  # PUBLISH
+                    qos = (header >> 1) & 3
+                    n = int.from_bytes(body[:2], "big")
+                    topic, i = body[2:2 + n].decode(), 2 + n
+                    if qos:
+                        writer.write(b"\x40\x02" + body[i:i + 2])
+                        i += 2
+                    self.publish(topic, body[i:], bool(header & 1))
+                elif kind == 12:  # PINGREQ
+                    writer.write(b"\xd0\x00")
+                elif kind == 14:  # DISCONNECT
+                    break
+        except (asyncio.IncompleteReadError, ConnectionError):
+            pass
+        finally:
+            self.subs.pop(writer, None)
+            writer.close()
+
+    def start(self) -> None:
+        ready = threading.Event()
+
+        async def serve():
+            server = await asyncio.start_server(self._handle, "127.0.0.1", 0, backlog=1024)
+            self.port = server.sockets[0].getsockname()[1]
+            ready.set()
+            await server.serve_forever()
+
+        self.loop = asyncio.new_event_loop()
+        threading.Thread(target=self.loop.run_until_complete, args=(serve(),), daemon=True).start()
+        ready.wait(5)
+
+
+# =========================================
+# BACKEND DE MENTIRA
+# =========================================
+
+def start_backend(broker: Broker) -> ThreadingHTTPServer:
+    versions: Dict[str, int] = {}
+
+    class Handler(BaseHTTPRequestHandler):
+        def log_message(self, *args) -> None:
+            pass
+
+        def _reply(self, status: int, doc: Dict) -> None:
+            data = json.dumps(doc).encode()
+            self.send_response(status)
+            self.send_header("Content-Type", "application/json")
+            self.send_header("Content-Length", str(len(data)))
+            self.end_headers()
+            self.wfile.write(data)
+
+        def do_GET(self) -> None:
+            m = re.fullmatch(r"/devices/([^/]+)/heartbeat", self.path)
+            hb = broker.heartbeats.get(m.group(1)) if m else None
+            self._reply(200, hb) if hb else self._reply(404, {"detail": "not found"})
+
+        def do_PUT(self) -> None:
+            m = re.fullmatch(r"/devices/([^/]+)/desired", self.path)
+            doc = json.loads(self.rfile.read(int(self.headers["Content-Length"])))
+            if not m:
+                return self._reply(404, {"detail": "not found"})
+            device_id = m.group(1)
+            versions[device_id] = versions.get(device_id, 0) + 1
+            desired = {"v": versions[device_id], "mode": doc["mode"]}
+            payload = json.dumps(desired, separators=(",", ":")).encode()
+            broker.loop.call_soon_threadsafe(broker.publish, f"casa/{device_id}/desired", payload, True)
+            self._reply(200, {"device_id": device_id, "version": versions[device_id]})
+
+    server = ThreadingHTTPServer(("127.0.0.1", 0), Handler)
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    return server
+
+
+# =========================================
+# MAIN
+# =========================================
+
+def main(argv: List[str]) -> int:
+    if len(argv) != 2:
+        print(__doc__)
+        return 2
+    broker = Broker()
+    broker.start()
+    backend = start_backend(broker)
+
+    cmd = [argv[1], "--devices", str(DEVICES), "--workers", str(WORKERS), "--port", str(broker.port),
+           "--duration", str(DURATION_S), "--report-interval", "2", "--cmd-rate", "10",
+           "--backend-url", f"http://127.0.0.1:{backend.server_address[1]}"]
+    run = subprocess.run(cmd, capture_output=True, text=True, timeout=DURATION_S + 60)
+    print(run.stdout, end="")
+    print(run.stderr, end="", file=sys.stderr)
+
+    errors = []
+    if run.returncode != 0:
+        errors.append(f"varal_swarm saiu com {run.returncode}")
+    devices = {c for c in broker.client_ids if c.startswith("varal-")}
+    if len(devices) != DEVICES:
+        errors.append(f"{len(devices)} client IDs de varal no broker, esperado {DEVICES}")
+    if broker.online != devices:
+        errors.append(f"'online' de {len(broker.online)} varais, {len(devices)} conectaram")
+
+    summary = {key: value for key, value in re.findall(r"\[SWARM\] ([^:=]+): (.*)", run.stdout)}
+    if not re.match(r"\d+ de %d" % DEVICES, summary.get("varais no ar", "")):
+        errors.append("nem todos os varais subiram")
+    heartbeats = re.search(r"heartbeats: (\d+)", summary.get("publicações", ""))
+    if not heartbeats or int(heartbeats.group(1)) < DEVICES:
+        errors.append("heartbeats não saíram")
+    rtt = re.search(r"\(n=(\d+)\) \((\d+) sem resposta, (\d+) recusados", summary.get("round-trip de comando", ""))
+    if not rtt or int(rtt.group(1)) < 10 or int(rtt.group(3)) != 0:
+        errors.append("round-trip de comando sem medidas (ou comandos recusados)")
+    if "n=" not in summary.get("atraso de ingestão", ""):
+        errors.append("atraso de ingestão sem amostras")
+
+    for e in errors:
+        print(f"FALHA: {e}", file=sys.stderr)
+    return 1 if errors else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
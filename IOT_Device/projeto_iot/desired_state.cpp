@@ -0,0 +1,109 @@
+#include <Arduino.h>
+#include <stdlib.h>
+
+#include "desired_state.h"
+#include "telemetry.h"
+#include "varal_controller.h"
+
+// ==========================
+// ESTADO
+// ==========================
+
+// Documento é pequeno; maior que isso é ignorado (não é nosso)
+static const size_t DESIRED_DOC_MAX = 127;
+
+static uint32_t      appliedVersion      = 0;
+static unsigned long heartbeatIntervalMs = DESIRED_HEARTBEAT_DEFAULT_S * 1000UL;
+
+// ==========================
+// LEITURA DO JSON
+// ==========================
+// Só chaves de primeiro nível com número ou string simples: basta procurar
+// "chave": no texto, sem biblioteca nem alocação.
+
+static const char* findValue(const char* doc, const char* key) {
+  char pattern[16];
+  snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+  const char* p = strstr(doc, pattern);
+  if (p == nullptr) {
+    return nullptr;
+  }
+  p += strlen(pattern);
+  while (*p == ' ') p++;
+  return p;
+}
+
+static bool readUnsigned(const char* doc, const char* key, unsigned long& out) {
+  const char* p = findValue(doc, key);
+  if (p == nullptr || *p < '0' || *p > '9') {
+    return false;
+  }
+  out = strtoul(p, nullptr, 10);
+  return true;
+}
+
+static bool readMode(const char* doc, VaralMode& out) {
+  const char* p = findValue(doc, "mode");
+  if (p == nullptr || *p != '"') {
+    return false;
+  }
+  p++;
+  const VaralMode modes[] = { VaralMode::AUTO, VaralMode::FORCE_OPEN, VaralMode::FORCE_CLOSE };
+  for (VaralMode mode : modes) {
+    const char* name = telemetryModeName(mode);
+    size_t len = strlen(name);
+    if (strncmp(p, name, len) == 0 && p[len] == '"') {
+      out = mode;
+      return true;
+    }
+  }
+  return false;
+}
+
+// ==========================
+// API
+// ==========================
+
+bool desiredStateHandle(const uint8_t* payload, size_t length) {
+  if (length == 0 || length > DESIRED_DOC_MAX) {
+    return false; // retido apagado, ou lixo
+  }
+  static char doc[DESIRED_DOC_MAX + 1];
+  memcpy(doc, payload, length);
+  doc[length] = '\0';
+
+  unsigned long version = 0;
+  if (!readUnsigned(doc, "v", version)) {
+    Serial.println("[DESIRED] Documento sem versão (ignorado).");
+    return false;
+  }
+  if (version <= appliedVersion) {
+    return false; // já aplicado (chega de novo a cada reconexão)
+  }
+  appliedVersion = version;
+
+  // Só o que difere do estado atual
+  VaralMode mode;
+  if (readMode(doc, mode) && mode != varalControllerGetMode()) {
+    varalControllerSetMode(mode);
+  }
+
+  unsigned long seconds;
+  if (readUnsigned(doc, "hb_s", seconds)) {
+    seconds = constrain(seconds, DESIRED_HEARTBEAT_MIN_S, DESIRED_HEARTBEAT_MAX_S);
+    heartbeatIntervalMs = seconds * 1000UL;
+  }
+
+  Serial.print("[DESIRED] Versão ");
+  Serial.print(version);
+  Serial.println(" aplicada.");
+  return true;
+}
+
+uint32_t desiredStateVersion() {
+  return appliedVersion;
+}
+
+unsigned long desiredStateHeartbeatIntervalMs() {
+  return heartbeatIntervalMs;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <Arduino.h>
+
+// ==========================================================
+// ESTADO DESEJADO (sincronização com o backend)
+// ==========================================================
+//
+// O backend guarda, por varal, o estado desejado (modo + parâmetros) com um
+// número de versão e publica RETIDO em casa/<id>/desired:
+//
+//   {"v":7,"mode":"FORCE_OPEN","hb_s":30}
+//
+// Como a mensagem fica retida no broker, um varal que estava offline recebe
+// a versão mais nova assim que se inscreve: nenhum comando se perde. Versões
+// já aplicadas (v <= dv) são ignoradas; de uma versão nova só é aplicado o
+// campo que difere do estado atual. A versão aplicada ("dv") volta no
+// heartbeat, e o backend sabe quando o varal convergiu.
+
+static const unsigned long DESIRED_HEARTBEAT_DEFAULT_S = 30;
+static const unsigned long DESIRED_HEARTBEAT_MIN_S     = 10;
+static const unsigned long DESIRED_HEARTBEAT_MAX_S     = 3600;
+
+// Aplica um documento recebido em casa/<id>/desired.
+// Retorna true se algo mudou (vale mandar um heartbeat na hora).
+bool desiredStateHandle(const uint8_t* payload, size_t length);
+
+// Última versão aplicada (0 = nenhuma desde o boot)
+uint32_t desiredStateVersion();
+
+// Intervalo do heartbeat pedido pelo backend ("hb_s")
+unsigned long desiredStateHeartbeatIntervalMs();
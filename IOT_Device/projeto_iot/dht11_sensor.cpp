@@ -1,6 +1,9 @@
 #include <Arduino.h>
 #include <DHT.h>
 #include "dht11_sensor.h"
+#include "rain_predictor.h"
+#include "sensor_registry.h"
+#include "flight_recorder.h"
 
 // ==================================
 // CONFIGURAÇÃO DO PINO / TIPO
@@ -15,56 +18,80 @@ static DHT dht(DHT_PIN, DHT_TYPE);
 // DHT11 aguenta algo na casa de 1 leitura a cada 1–2 segundos
 static const unsigned long DHT_READ_INTERVAL_MS = 2000; // 2s
 
+// Amostras guardadas no histórico do sensor (1 a cada 2 s -> 2 min)
+static const size_t DHT_HISTORY = 60;
+
 // Estado interno
-static unsigned long lastReadMillis = 0;
-static float lastTempC      = NAN;
-static float lastHumidity   = NAN;
 static DhtStatus lastStatus = DhtStatus::NOT_READ_YET;
 
+struct DhtReading {
+  float tempC;
+  float humidity;
+};
+
+// ==================================
+// SENSOR (framework)
+// ==================================
+
+static const char* const DHT_CHANNELS[] = { "temp_c", "humidity" };
+
+class Dht11Sensor : public Sensor<Dht11Sensor, DhtReading, DHT_HISTORY, 2> {
+public:
+  Dht11Sensor() : Sensor("dht11", DHT_CHANNELS, DHT_READ_INTERVAL_MS) {}
+
+  bool read(DhtReading& out) {
+    // Faz a leitura (a lib cuida do timing interno)
+    out.humidity = dht.readHumidity();
+    out.tempC    = dht.readTemperature(); // Celsius
+
+    if (isnan(out.humidity) || isnan(out.tempC)) {
+      // Leitura falhou
+      lastStatus = DhtStatus::ERROR_TIMEOUT;
+      Serial.println("[DHT11] Falha na leitura (NaN)");
+      return false;
+    }
+    return true;
+  }
+
+  static float channelValue(const DhtReading& r, int channel) {
+    return channel == 0 ? r.tempC : r.humidity;
+  }
+
+  void onSample(const DhtReading& r) {
+    // Leitura OK
+    lastStatus = DhtStatus::OK;
+
+    // Alimenta a previsão de chuva (tendência de umidade / ponto de orvalho)
+    rainPredictorAddSample(r.tempC, r.humidity, latest().ms);
+    flightRecorderLogDht(r.tempC, r.humidity);
+
+    // Debug opcional
+    Serial.print("[DHT11] Temp: ");
+    Serial.print(r.tempC);
+    Serial.print(" °C | Umid: ");
+    Serial.print(r.humidity);
+    Serial.println(" %");
+  }
+};
+
+static Dht11Sensor dhtSensor;
+
 // ==================================
 // FUNÇÕES PÚBLICAS
 // ==================================
 
 void dht11Init() {
   dht.begin();
-  lastReadMillis = 0;
-  lastTempC      = NAN;
-  lastHumidity   = NAN;
-  lastStatus     = DhtStatus::NOT_READ_YET;
+  lastStatus = DhtStatus::NOT_READ_YET;
+  sensorRegistryAdd(&dhtSensor);
 
   Serial.print("[DHT11] Iniciado no pino ");
   Serial.println(DHT_PIN);
 }
 
 void dht11Loop() {
-  unsigned long now = millis();
-  if (now - lastReadMillis < DHT_READ_INTERVAL_MS) {
-    return; // ainda não é hora de ler novamente
-  }
-  lastReadMillis = now;
-
-  // Faz a leitura (a lib cuida do timing interno)
-  float h = dht.readHumidity();
-  float t = dht.readTemperature(); // Celsius
-
-  if (isnan(h) || isnan(t)) {
-    // Leitura falhou
-    lastStatus = DhtStatus::ERROR_TIMEOUT;
-    Serial.println("[DHT11] Falha na leitura (NaN)");
-    return;
-  }
-
-  // Leitura OK
-  lastTempC    = t;
-  lastHumidity = h;
-  lastStatus   = DhtStatus::OK;
-
-  // Debug opcional
-  Serial.print("[DHT11] Temp: ");
-  Serial.print(lastTempC);
-  Serial.print(" °C | Umid: ");
-  Serial.print(lastHumidity);
-  Serial.println(" %");
+  // Só lê quando passa o intervalo (DHT11 não gosta de leituras seguidas)
+  dhtSensor.loop(millis());
 }
 
 bool dht11HasValidData() {
@@ -72,11 +99,11 @@ bool dht11HasValidData() {
 }
 
 float dht11GetTemperatureC() {
-  return lastTempC;
+  return dhtSensor.hasData() ? dhtSensor.latest().value.tempC : NAN;
 }
 
 float dht11GetHumidity() {
-  return lastHumidity;
+  return dhtSensor.hasData() ? dhtSensor.latest().value.humidity : NAN;
 }
 
 DhtStatus dht11GetStatus() {
@@ -0,0 +1,99 @@
+#include <Arduino.h>
+#include "event_bus.h"
+
+// ==========================
+// ESTADO INTERNO
+// ==========================
+
+static Event queue[EVENT_QUEUE_SIZE];
+static uint8_t queueHead  = 0;   // próximo a entregar
+static uint8_t queueCount = 0;
+static uint32_t droppedCount = 0;
+
+struct Subscriber {
+  EventType    type;
+  EventHandler handler;
+};
+
+static Subscriber subscribers[EVENT_MAX_SUBSCRIBERS];
+static int subscriberCount = 0;
+
+// ==========================
+// FUNÇÕES PÚBLICAS
+// ==========================
+
+bool eventBusSubscribe(EventType type, EventHandler handler) {
+  if (subscriberCount >= EVENT_MAX_SUBSCRIBERS) {
+    Serial.println("[EVENT] Tabela de assinantes cheia.");
+    return false;
+  }
+  subscribers[subscriberCount++] = { type, handler };
+  return true;
+}
+
+bool eventBusEmit(const Event& event) {
+  if (queueCount >= EVENT_QUEUE_SIZE) {
+    droppedCount++;
+    return false;
+  }
+  queue[(queueHead + queueCount) % EVENT_QUEUE_SIZE] = event;
+  queueCount++;
+  return true;
+}
+
+void eventBusDispatch() {
+  // Handlers podem emitir novos eventos; eles entram na fila e
+  // são entregues nesta mesma chamada.
+  while (queueCount > 0) {
+    Event event = queue[queueHead];
+    queueHead = (queueHead + 1) % EVENT_QUEUE_SIZE;
+    queueCount--;
+
+    for (int i = 0; i < subscriberCount; i++) {
+      if (subscribers[i].type == event.type) {
+        subscribers[i].handler(event);
+      }
+    }
+  }
+}
+
+uint32_t eventBusDroppedCount() {
+  return droppedCount;
+}
+
+// ==========================
+// HELPERS
+// ==========================
+
+void eventBusEmitRainLevel(RainLevel level, RainLevel previous) {
+  Event e;
+  e.type          = EventType::RAIN_LEVEL_CHANGED;
+  e.millis        = millis();
+  e.rain.level    = level;
+  e.rain.previous = previous;
+  eventBusEmit(e);
+}
+
+void eventBusEmitMode(VaralMode mode) {
+  Event e;
+  e.type      = EventType::MODE_CHANGED;
+  e.millis    = millis();
+  e.mode.mode = mode;
+  eventBusEmit(e);
+}
+
+void eventBusEmitMotionDone(uint8_t motor, long steps) {
+  Event e;
+  e.type          = EventType::MOTION_DONE;
+  e.millis        = millis();
+  e.motion.motor  = motor;
+  e.motion.steps  = steps;
+  eventBusEmit(e);
+}
+
+void eventBusEmitLink(bool up) {
+  Event e;
+  e.type   = up ? EventType::LINK_UP : EventType::LINK_DOWN;
+  e.millis = millis();
+  eventBusEmit(e);
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <Arduino.h>
+#include "rain_sensor.h"
+#include "varal_controller.h"
+
+// ==========================================================
+// BARRAMENTO DE EVENTOS (publish/subscribe interno)
+// ==========================================================
+//
+// Fila circular de tamanho fixo + tabela fixa de assinantes: nada é
+// alocado. Produtores chamam eventBusEmit() (de dentro do loop, nunca
+// de ISR); eventBusDispatch() entrega tudo que está na fila aos
+// assinantes do tipo, na ordem em que foi emitido.
+
+enum class EventType : uint8_t {
+  RAIN_LEVEL_CHANGED,
+  MODE_CHANGED,
+  MOTION_DONE,
+  LINK_UP,
+  LINK_DOWN,
+  COUNT
+};
+
+struct Event {
+  EventType     type;
+  unsigned long millis;   // quando o produtor viu a mudança
+  union {
+    struct { RainLevel level; RainLevel previous; } rain;
+    struct { VaralMode mode; } mode;
+    struct { uint8_t motor; long steps; } motion;
+  };
+};
+
+typedef void (*EventHandler)(const Event& event);
+
+static const int EVENT_QUEUE_SIZE      = 16;
+static const int EVENT_MAX_SUBSCRIBERS = 12;
+
+// Assina um tipo de evento (false se a tabela estiver cheia)
+bool eventBusSubscribe(EventType type, EventHandler handler);
+
+// Enfileira um evento (false se a fila estiver cheia: evento descartado)
+bool eventBusEmit(const Event& event);
+
+// Entrega os eventos pendentes (chamar no loop principal)
+void eventBusDispatch();
+
+// Eventos descartados por fila cheia (telemetria)
+uint32_t eventBusDroppedCount();
+
+// Helpers de emissão
+void eventBusEmitRainLevel(RainLevel level, RainLevel previous);
+void eventBusEmitMode(VaralMode mode);
+void eventBusEmitMotionDone(uint8_t motor, long steps);
+void eventBusEmitLink(bool up);
@@ -0,0 +1,523 @@
+#include <Arduino.h>
+#include <esp_partition.h>
+#include <esp_system.h>
+#include "flight_recorder.h"
+#include "event_bus.h"
+
+// ==========================
+// CONFIGURAÇÃO
+// ==========================
+
+static const char*    PARTITION_LABEL = "flightrec";
+static const uint32_t SECTOR_SIZE     = 4096;     // unidade de apagamento da flash
+static const uint32_t HEADER_SIZE     = 16;
+static const uint32_t MAGIC           = 0x31524656; // "VFR1"
+
+static const unsigned long TICK_MS = 10;          // resolução do tempo gravado
+
+// Buffer em RAM: a flash só é escrita quando enche ou a cada FLUSH_INTERVAL_MS
+// (numa queda de energia perde-se no máximo esse intervalo).
+static const size_t        RAM_BUFFER_SIZE   = 256;
+static const unsigned long FLUSH_INTERVAL_MS = 60'000;
+
+// Mudança de nível/saída digital da chuva entra sempre, na hora. Fora isso,
+// o analógico (1/s) só entra se andar mais que o deadband e no máximo a cada
+// 30 s, e o DHT11 (que oscila ±1 na última casa) idem; parados, entra um
+// registro de cada a cada 1 / 5 min. Pior caso ~25 KB/dia, dia seco bem menos.
+static const int           RAIN_LOG_DEADBAND     = 32;      // contagens do ADC
+static const unsigned long SAMPLE_MIN_GAP_MS     = 30'000;
+static const unsigned long RAIN_LOG_KEEPALIVE_MS = 60'000;
+static const unsigned long DHT_LOG_KEEPALIVE_MS  = 300'000;
+
+// Setor com menos espaço que isso no boot não é reaproveitado
+static const uint32_t MIN_FREE_TO_APPEND = 512;
+
+// Maior registro possível: tipo + 4 varints de 32 bits + 1 byte
+static const size_t MAX_RECORD_SIZE = 1 + 4 * 5 + 1;
+
+// ==========================
+// ESTADO INTERNO
+// ==========================
+
+static const esp_partition_t* partition = nullptr;
+static uint32_t sectorCount = 0;
+static uint32_t curSector   = 0;
+static uint32_t curSeq      = 0;
+static uint32_t bootCount   = 0;
+static uint32_t writeOffset = 0;   // bytes já gravados na flash no setor atual
+
+static uint8_t ramBuffer[RAM_BUFFER_SIZE];
+static size_t  ramLen = 0;
+static unsigned long lastFlushMillis = 0;
+
+// Bases dos deltas (zeradas a cada setor novo e a cada BOOT)
+static unsigned long baseMillis = 0;
+static int32_t baseRain   = 0;
+static int32_t baseTemp10 = 0;
+static int32_t baseHum10  = 0;
+static int32_t baseTarget = 0;
+static int32_t basePos    = 0;
+
+// Filtro de amostras (o que foi gravado por último)
+static bool          rainLogged = false;
+static int           lastRainAnalog = 0;
+static uint8_t       lastRainFlags  = 0;
+static unsigned long lastRainLogMillis = 0;
+
+static bool          dhtLogged = false;
+static int32_t       lastTemp10 = 0;
+static int32_t       lastHum10  = 0;
+static unsigned long lastDhtLogMillis = 0;
+
+// Dump em andamento
+static bool     dumpActive   = false;
+static uint32_t dumpIndex    = 0;   // setor (relativo ao primeiro do dump)
+static uint32_t dumpTotal    = 0;
+static uint32_t dumpFirst    = 0;   // índice absoluto do primeiro setor
+static uint32_t dumpOffset   = 0;   // posição dentro do setor atual
+static uint32_t dumpUsed     = 0;   // bytes úteis do setor atual (0 = ainda não lido)
+static uint32_t dumpSeq      = 0;
+static uint32_t dumpSent     = 0;   // setores enviados
+static uint32_t dumpChunks   = 0;   // pedaços de dados enviados (índice do próximo)
+
+struct Record {
+  FlightRecordType type;
+  unsigned long    ms;
+  int32_t          a;
+  int32_t          b;
+  uint8_t          u8;
+};
+
+// ==========================
+// CODIFICAÇÃO
+// ==========================
+
+static size_t putVarint(uint8_t* out, uint32_t v) {
+  size_t n = 0;
+  while (v >= 0x80) {
+    out[n++] = (uint8_t)(v | 0x80);
+    v >>= 7;
+  }
+  out[n++] = (uint8_t)v;
+  return n;
+}
+
+static uint32_t zigzag(int32_t v) {
+  return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static void putU32(uint8_t* out, uint32_t v) {
+  out[0] = (uint8_t)v;
+  out[1] = (uint8_t)(v >> 8);
+  out[2] = (uint8_t)(v >> 16);
+  out[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t getU32(const uint8_t* in) {
+  return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+// Ticks desde o registro anterior (evento "atrasado" conta como 0)
+static uint32_t ticksSinceBase(unsigned long ms) {
+  long delta = (long)(ms - baseMillis);
+  return delta > 0 ? (uint32_t)delta / TICK_MS : 0;
+}
+
+static void resetBases(unsigned long ms) {
+  baseMillis = ms;
+  baseRain = baseTemp10 = baseHum10 = baseTarget = basePos = 0;
+}
+
+static size_t encodeRecord(const Record& r, uint8_t* out) {
+  size_t n = 0;
+  out[n++] = (uint8_t)r.type;
+  n += putVarint(out + n, r.type == FlightRecordType::BOOT ? 0 : ticksSinceBase(r.ms));
+
+  switch (r.type) {
+    case FlightRecordType::BOOT:
+      // Valores absolutos: zera as bases do decodificador
+      n += putVarint(out + n, (uint32_t)r.a);   // nº do boot
+      n += putVarint(out + n, (uint32_t)r.ms);  // uptime
+      out[n++] = r.u8;                          // motivo do reset
+      break;
+    case FlightRecordType::RAIN:
+      n += putVarint(out + n, zigzag(r.a - baseRain));
+      out[n++] = r.u8;
+      break;
+    case FlightRecordType::DHT:
+      n += putVarint(out + n, zigzag(r.a - baseTemp10));
+      n += putVarint(out + n, zigzag(r.b - baseHum10));
+      break;
+    case FlightRecordType::MOVE_START:
+      out[n++] = r.u8;
+      n += putVarint(out + n, zigzag(r.a - baseTarget));
+      break;
+    case FlightRecordType::MOVE_END:
+      out[n++] = r.u8;
+      n += putVarint(out + n, zigzag(r.a - basePos));
+      break;
+    case FlightRecordType::MODE:
+    case FlightRecordType::LINK:
+      out[n++] = r.u8;
+      break;
+  }
+  return n;
+}
+
+static void commitRecord(const Record& r) {
+  if (r.type == FlightRecordType::BOOT) {
+    resetBases(r.ms);
+    return;
+  }
+  baseMillis += ticksSinceBase(r.ms) * TICK_MS;
+
+  switch (r.type) {
+    case FlightRecordType::RAIN:       baseRain = r.a;                   break;
+    case FlightRecordType::DHT:        baseTemp10 = r.a; baseHum10 = r.b; break;
+    case FlightRecordType::MOVE_START: baseTarget = r.a;                 break;
+    case FlightRecordType::MOVE_END:   basePos = r.a;                    break;
+    default: break;
+  }
+}
+
+// ==========================
+// FLASH
+// ==========================
+
+static uint32_t sectorAddress(uint32_t sector) {
+  return sector * SECTOR_SIZE;
+}
+
+static void flushBuffer() {
+  if (ramLen == 0) {
+    return;
+  }
+  esp_err_t err = esp_partition_write(partition, sectorAddress(curSector) + writeOffset, ramBuffer, ramLen);
+  if (err != ESP_OK) {
+    Serial.print("[FREC] Erro ao gravar na flash: ");
+    Serial.println((int)err);
+  }
+  writeOffset += ramLen;
+  ramLen = 0;
+}
+
+static void openNextSector(unsigned long ms) {
+  flushBuffer();
+
+  curSector = (curSector + 1) % sectorCount;
+  curSeq++;
+
+  // ~45 ms bloqueando, uma vez a cada poucas horas
+  esp_partition_erase_range(partition, sectorAddress(curSector), SECTOR_SIZE);
+
+  uint8_t header[HEADER_SIZE];
+  putU32(header,      MAGIC);
+  putU32(header + 4,  curSeq);
+  putU32(header + 8,  bootCount);
+  putU32(header + 12, (uint32_t)ms);
+  esp_partition_write(partition, sectorAddress(curSector), header, HEADER_SIZE);
+
+  writeOffset = HEADER_SIZE;
+  resetBases(ms);
+}
+
+static bool readSectorHeader(uint32_t sector, uint32_t& seq) {
+  uint8_t header[HEADER_SIZE];
+  if (esp_partition_read(partition, sectorAddress(sector), header, HEADER_SIZE) != ESP_OK) {
+    return false;
+  }
+  if (getU32(header) != MAGIC) {
+    return false;
+  }
+  seq = getU32(header + 4);
+  return true;
+}
+
+// Bytes usados no setor: nenhum registro termina em 0xFF, então basta
+// achar o último byte diferente de 0xFF (flash apagada = 0xFF).
+static uint32_t sectorUsedBytes(uint32_t sector) {
+  uint8_t chunk[64];
+  uint32_t end = SECTOR_SIZE;
+  while (end > HEADER_SIZE) {
+    uint32_t start = end >= HEADER_SIZE + sizeof(chunk) ? end - sizeof(chunk) : HEADER_SIZE;
+    esp_partition_read(partition, sectorAddress(sector) + start, chunk, end - start);
+    for (uint32_t i = end - start; i > 0; i--) {
+      if (chunk[i - 1] != 0xFF) {
+        return start + i;
+      }
+    }
+    end = start;
+  }
+  return HEADER_SIZE;
+}
+
+// ==========================
+// REGISTRO
+// ==========================
+
+static void record(const Record& r) {
+  if (partition == nullptr) {
+    return;
+  }
+
+  uint8_t tmp[MAX_RECORD_SIZE];
+  size_t len = encodeRecord(r, tmp);
+
+  if (writeOffset + ramLen + len > SECTOR_SIZE) {
+    openNextSector(r.ms);
+    len = encodeRecord(r, tmp);  // bases zeradas: recodifica
+  }
+  if (ramLen + len > RAM_BUFFER_SIZE) {
+    flushBuffer();
+  }
+
+  memcpy(ramBuffer + ramLen, tmp, len);
+  ramLen += len;
+  commitRecord(r);
+}
+
+static void onRecorderEvent(const Event& event) {
+  Record r = {};
+  r.ms = event.millis;
+
+  switch (event.type) {
+    case EventType::MODE_CHANGED:
+      r.type = FlightRecordType::MODE;
+      r.u8   = (uint8_t)event.mode.mode;
+      break;
+    case EventType::MOTION_DONE:
+      r.type = FlightRecordType::MOVE_END;
+      r.u8   = event.motion.motor;
+      r.a    = (int32_t)event.motion.steps;
+      break;
+    case EventType::LINK_UP:
+    case EventType::LINK_DOWN:
+      r.type = FlightRecordType::LINK;
+      r.u8   = event.type == EventType::LINK_UP ? 1 : 0;
+      break;
+    default:
+      return;
+  }
+  record(r);
+}
+
+// ==========================
+// FUNÇÕES PÚBLICAS
+// ==========================
+
+void flightRecorderInit() {
+  partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, PARTITION_LABEL);
+  if (partition == nullptr) {
+    Serial.println("[FREC] Partição 'flightrec' não encontrada (partitions.csv) — caixa-preta desligada.");
+    return;
+  }
+  sectorCount = partition->size / SECTOR_SIZE;
+
+  // Acha o setor mais recente (maior seq)
+  bool found = false;
+  for (uint32_t s = 0; s < sectorCount; s++) {
+    uint32_t seq;
+    if (readSectorHeader(s, seq) && (!found || seq > curSeq)) {
+      found     = true;
+      curSeq    = seq;
+      curSector = s;
+    }
+  }
+
+  unsigned long now = millis();
+  if (found) {
+    uint8_t header[HEADER_SIZE];
+    esp_partition_read(partition, sectorAddress(curSector), header, HEADER_SIZE);
+    bootCount = getU32(header + 8) + 1;
+
+    // Continua no mesmo setor se ainda tiver espaço (o BOOT zera as bases);
+    // assim um reset em loop não apaga o histórico de semanas.
+    writeOffset = sectorUsedBytes(curSector);
+    if (SECTOR_SIZE - writeOffset < MIN_FREE_TO_APPEND) {
+      openNextSector(now);
+    }
+  } else {
+    curSector = sectorCount - 1;  // o próximo é o 0
+    curSeq    = 0;
+    bootCount = 0;
+    openNextSector(now);
+  }
+
+  Record boot = {};
+  boot.type = FlightRecordType::BOOT;
+  boot.ms   = now;
+  boot.a    = (int32_t)bootCount;
+  boot.u8   = (uint8_t)esp_reset_reason();
+  record(boot);
+  flushBuffer();
+  lastFlushMillis = now;
+
+  static bool subscribed = false;
+  if (!subscribed) {
+    eventBusSubscribe(EventType::MODE_CHANGED, onRecorderEvent);
+    eventBusSubscribe(EventType::MOTION_DONE,  onRecorderEvent);
+    eventBusSubscribe(EventType::LINK_UP,      onRecorderEvent);
+    eventBusSubscribe(EventType::LINK_DOWN,    onRecorderEvent);
+    subscribed = true;
+  }
+
+  Serial.print("[FREC] Caixa-preta: ");
+  Serial.print(sectorCount);
+  Serial.print(" setores | boot #");
+  Serial.print(bootCount);
+  Serial.print(" | setor ");
+  Serial.print(curSector);
+  Serial.print(" @ ");
+  Serial.println(writeOffset);
+}
+
+void flightRecorderLoop() {
+  if (partition == nullptr) {
+    return;
+  }
+  unsigned long now = millis();
+  if (ramLen > 0 && now - lastFlushMillis >= FLUSH_INTERVAL_MS) {
+    flushBuffer();
+    lastFlushMillis = now;
+  }
+}
+
+void flightRecorderLogRain(int analog, bool digital, RainLevel level) {
+  unsigned long now = millis();
+  uint8_t flags = (uint8_t)(((uint8_t)level << 1) | (digital ? 1 : 0));
+
+  unsigned long elapsed = now - lastRainLogMillis;
+  bool changed = !rainLogged
+              || flags != lastRainFlags
+              || (abs(analog - lastRainAnalog) >= RAIN_LOG_DEADBAND && elapsed >= SAMPLE_MIN_GAP_MS)
+              || elapsed >= RAIN_LOG_KEEPALIVE_MS;
+  if (!changed) {
+    return;
+  }
+  rainLogged        = true;
+  lastRainAnalog    = analog;
+  lastRainFlags     = flags;
+  lastRainLogMillis = now;
+
+  Record r = {};
+  r.type = FlightRecordType::RAIN;
+  r.ms   = now;
+  r.a    = analog;
+  r.u8   = flags;
+  record(r);
+}
+
+void flightRecorderLogDht(float tempC, float humidity) {
+  unsigned long now = millis();
+  int32_t temp10 = (int32_t)lroundf(tempC * 10.0f);
+  int32_t hum10  = (int32_t)lroundf(humidity * 10.0f);
+
+  unsigned long elapsed = now - lastDhtLogMillis;
+  bool changed = !dhtLogged
+              || ((temp10 != lastTemp10 || hum10 != lastHum10) && elapsed >= SAMPLE_MIN_GAP_MS)
+              || elapsed >= DHT_LOG_KEEPALIVE_MS;
+  if (!changed) {
+    return;
+  }
+  dhtLogged        = true;
+  lastTemp10       = temp10;
+  lastHum10        = hum10;
+  lastDhtLogMillis = now;
+
+  Record r = {};
+  r.type = FlightRecordType::DHT;
+  r.ms   = now;
+  r.a    = temp10;
+  r.b    = hum10;
+  record(r);
+}
+
+void flightRecorderLogMoveStart(uint8_t motor, long targetSteps) {
+  Record r = {};
+  r.type = FlightRecordType::MOVE_START;
+  r.ms   = millis();
+  r.u8   = motor;
+  r.a    = (int32_t)targetSteps;
+  record(r);
+}
+
+// ==========================
+// DUMP
+// ==========================
+
+bool flightRecorderStartDump(int maxSectors) {
+  if (partition == nullptr) {
+    return false;
+  }
+  flushBuffer();
+
+  uint32_t total = (maxSectors <= 0 || (uint32_t)maxSectors > sectorCount) ? sectorCount : (uint32_t)maxSectors;
+  dumpActive = true;
+  dumpTotal  = total;
+  dumpFirst  = (curSector + 1 + sectorCount - total) % sectorCount;
+  dumpIndex  = 0;
+  dumpOffset = 0;
+  dumpUsed   = 0;
+  dumpSent   = 0;
+  dumpChunks = 0;
+
+  Serial.print("[FREC] Dump de ");
+  Serial.print(total);
+  Serial.println(" setores.");
+  return true;
+}
+
+bool flightRecorderDumpActive() {
+  return dumpActive;
+}
+
+static void putChunkHeader(uint8_t* out, uint8_t type, uint32_t offset, uint32_t seq, uint32_t index) {
+  out[0] = type;
+  out[1] = 1;
+  out[2] = (uint8_t)offset;
+  out[3] = (uint8_t)(offset >> 8);
+  putU32(out + 4, seq);
+  putU32(out + 8, index);
+}
+
+size_t flightRecorderDumpNext(uint8_t* out, size_t capacity) {
+  if (!dumpActive || capacity <= FLIGHT_DUMP_HEADER_SIZE) {
+    return 0;
+  }
+
+  // Próximo setor válido
+  while (dumpUsed == 0 && dumpIndex < dumpTotal) {
+    uint32_t sector = (dumpFirst + dumpIndex) % sectorCount;
+    if (readSectorHeader(sector, dumpSeq)) {
+      dumpUsed   = sector == curSector ? writeOffset : sectorUsedBytes(sector);
+      dumpOffset = 0;
+      dumpSent++;
+    } else {
+      dumpIndex++;
+    }
+  }
+
+  if (dumpUsed == 0) {
+    // Fim: seq = nº de setores enviados, índice = nº de pedaços de dados
+    putChunkHeader(out, 2, 0, dumpSent, dumpChunks);
+    dumpActive = false;
+    Serial.println("[FREC] Dump concluído.");
+    return FLIGHT_DUMP_HEADER_SIZE;
+  }
+
+  uint32_t sector = (dumpFirst + dumpIndex) % sectorCount;
+  uint32_t len    = dumpUsed - dumpOffset;
+  if (len > capacity - FLIGHT_DUMP_HEADER_SIZE) {
+    len = capacity - FLIGHT_DUMP_HEADER_SIZE;
+  }
+
+  putChunkHeader(out, 1, dumpOffset, dumpSeq, dumpChunks++);
+  esp_partition_read(partition, sectorAddress(sector) + dumpOffset, out + FLIGHT_DUMP_HEADER_SIZE, len);
+
+  dumpOffset += len;
+  if (dumpOffset >= dumpUsed) {
+    dumpUsed = 0;
+    dumpIndex++;
+  }
+  return FLIGHT_DUMP_HEADER_SIZE + len;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <Arduino.h>
+#include "rain_sensor.h"
+
+// ==========================================================
+// CAIXA-PRETA (flight recorder)
+// ==========================================================
+//
+// Registro compacto de tudo que o varal viu e fez, gravado numa
+// partição de dados da flash ("flightrec", ver partitions.csv) usada
+// como buffer circular de setores de 4 KB.
+//
+// Formato de um setor:
+//   cabeçalho (16 bytes, little-endian):
+//     u32 magic "VFR1" | u32 seq | u32 boot | u32 uptime_ms do início
+//   registros, até o primeiro byte 0xFF:
+//     u8 tipo | varint Δtempo (em ticks de 10 ms) | campos do tipo
+// Valores numéricos são gravados como Δ em relação ao registro anterior
+// do mesmo tipo (zigzag + varint). Cada setor recomeça do zero, então
+// pode ser decodificado sozinho depois que o mais antigo for apagado.
+// O decodificador fica em backend/tools/flight_log.py.
+
+enum class FlightRecordType : uint8_t {
+  BOOT       = 1,  // u8 motivo do reset
+  RAIN       = 2,  // zigzag Δanalog, u8 (nível << 1 | digital)
+  DHT        = 3,  // zigzag Δ(temp*10), zigzag Δ(umid*10)
+  MODE       = 4,  // u8 modo
+  MOVE_START = 5,  // u8 motor, zigzag alvo (steps)
+  MOVE_END   = 6,  // u8 motor, zigzag posição (steps)
+  LINK       = 7   // u8 1 = conectado, 0 = caiu
+};
+
+// Abre a partição e continua a sequência do último setor gravado
+void flightRecorderInit();
+
+// Grava o buffer em RAM na flash de tempos em tempos (chamar no loop)
+void flightRecorderLoop();
+
+// Registros (o recorder descarta amostras que não trazem informação nova)
+void flightRecorderLogRain(int analog, bool digital, RainLevel level);
+void flightRecorderLogDht(float tempC, float humidity);
+void flightRecorderLogMoveStart(uint8_t motor, long targetSteps);
+
+// === Leitura em pedaços (comando DUMP) ===
+// Começa a despejar os últimos maxSectors setores (0 = todos), do mais antigo
+// ao mais novo. Cada pedaço tem 12 bytes de cabeçalho:
+//   u8 tipo (1 = dados, 2 = fim) | u8 versão (1) | u16 offset no setor |
+//   u32 seq do setor | u32 índice do pedaço no dump (0, 1, 2, ...)
+// seguidos dos bytes do setor. No "fim", seq = nº de setores enviados e o
+// índice = nº de pedaços de dados: quem recebe (QoS0) sabe quais faltaram.
+static const size_t FLIGHT_DUMP_HEADER_SIZE = 12;
+
+bool flightRecorderStartDump(int maxSectors);
+bool flightRecorderDumpActive();
+
+// Preenche o próximo pedaço (retorna o tamanho; 0 = nada a enviar)
+size_t flightRecorderDumpNext(uint8_t* out, size_t capacity);
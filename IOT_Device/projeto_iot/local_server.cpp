@@ -0,0 +1,326 @@
+#include <Arduino.h>
+#include "local_server.h"
+
+#if LOCAL_SERVER_ENABLED
+
+#include <ESPmDNS.h>
+#include <ESPAsyncWebServer.h>
+
+#include "wifi_manager.h"
+#include "mqtt_manager.h"
+#include "mqtt_transport.h"
+#include "telemetry.h"
+#include "event_bus.h"
+#include "mem_monitor.h"
+#include "stepper_motor.h"
+#include "varal_controller.h"
+
+// ==========================
+// CONFIGURAÇÃO
+// ==========================
+
+static const unsigned long SNAPSHOT_INTERVAL_MS = 2'000;  // heartbeat local "fresco"
+static const unsigned long CLEANUP_INTERVAL_MS  = 1'000;  // clientes WS fechados
+static const size_t        LOCAL_COMMAND_MAX    = 15;
+
+static const char   LOCAL_TOKEN[]   = LOCAL_SERVER_TOKEN;
+static const size_t LOCAL_TOKEN_LEN = sizeof(LOCAL_TOKEN) - 1;
+
+// ==========================
+// ESTADO INTERNO
+// ==========================
+
+static AsyncWebServer server(LOCAL_SERVER_PORT);
+static AsyncWebSocket ws("/ws");
+
+static bool started = false;
+
+// Snapshot já no envelope do WebSocket:
+//   {"type":"heartbeat","device_id":"..","data":<heartbeat>}
+// O GET /heartbeat devolve só o <heartbeat> (de snapshotDataOffset até o '}' final).
+static char   snapshot[MQTT_TRANSPORT_MAX_PAYLOAD];
+static size_t snapshotLen        = 0;
+static size_t snapshotDataOffset = 0;
+static char   snapshotScratch[MQTT_TRANSPORT_MAX_PAYLOAD];  // montagem (só o loop)
+static char   handlerCopy[MQTT_TRANSPORT_MAX_PAYLOAD];      // cópia (só a task do AsyncTCP)
+static unsigned long lastSnapshotMillis = 0;
+static unsigned long lastCleanupMillis  = 0;
+static bool pushRequested = false;   // evento no barramento: refaz e empurra
+
+// Comando pendente (escrito pelos handlers, consumido pelo loop; o último vence)
+static char pendingCommand[LOCAL_COMMAND_MAX + 1];
+static bool pendingValid = false;
+
+static portMUX_TYPE localMux = portMUX_INITIALIZER_UNLOCKED;
+
+// ==========================
+// SNAPSHOT / COMANDO (entre tasks)
+// ==========================
+
+static void buildSnapshot() {
+  int head = snprintf(snapshotScratch, sizeof(snapshotScratch),
+                      "{\"type\":\"heartbeat\",\"device_id\":\"%s\",\"data\":", mqttGetDeviceId());
+  int body = telemetryBuildHeartbeat(snapshotScratch + head, sizeof(snapshotScratch) - head - 1);
+  if (body == 0) {
+    return;  // não coube: fica o anterior
+  }
+  size_t len = head + body;
+  snapshotScratch[len++] = '}';
+  snapshotScratch[len]   = '\0';
+
+  portENTER_CRITICAL(&localMux);
+  memcpy(snapshot, snapshotScratch, len + 1);
+  snapshotLen        = len;
+  snapshotDataOffset = head;
+  portEXIT_CRITICAL(&localMux);
+
+  lastSnapshotMillis = millis();
+}
+
+// Copia o snapshot para handlerCopy; 'dataOnly' = só o heartbeat, sem o envelope
+static size_t copySnapshot(bool dataOnly) {
+  portENTER_CRITICAL(&localMux);
+  size_t from = dataOnly ? snapshotDataOffset : 0;
+  size_t len  = snapshotLen == 0 ? 0 : snapshotLen - from - (dataOnly ? 1 : 0);
+  memcpy(handlerCopy, snapshot + from, len);
+  portEXIT_CRITICAL(&localMux);
+
+  handlerCopy[len] = '\0';
+  return len;
+}
+
+static bool queueCommand(const uint8_t* data, size_t len) {
+  if (len == 0 || len > LOCAL_COMMAND_MAX) {
+    return false;
+  }
+  portENTER_CRITICAL(&localMux);
+  memcpy(pendingCommand, data, len);
+  pendingCommand[len] = '\0';
+  pendingValid = true;
+  portEXIT_CRITICAL(&localMux);
+  return true;
+}
+
+static bool takeCommand(char* out) {
+  portENTER_CRITICAL(&localMux);
+  bool valid = pendingValid;
+  if (valid) {
+    memcpy(out, pendingCommand, sizeof(pendingCommand));
+    pendingValid = false;
+  }
+  portEXIT_CRITICAL(&localMux);
+  return valid;
+}
+
+// ==========================
+// TOKEN (task do AsyncTCP)
+// ==========================
+
+// Comparação em tempo constante (não entrega o prefixo certo pelo tempo)
+static bool tokenMatches(const char* given, size_t len) {
+  uint8_t diff = (len != LOCAL_TOKEN_LEN);
+  for (size_t i = 0; i < LOCAL_TOKEN_LEN; i++) {
+    diff |= (uint8_t)(LOCAL_TOKEN[i] ^ (i < len ? given[i] : 0));
+  }
+  return diff == 0;
+}
+
+static bool authorized(AsyncWebServerRequest* request) {
+  if (request->hasHeader("Authorization")) {
+    const String& header = request->getHeader("Authorization")->value();
+    if (!header.startsWith("Bearer ")) {
+      return false;
+    }
+    return tokenMatches(header.c_str() + 7, header.length() - 7);
+  }
+  if (request->hasParam("token")) {
+    const String& token = request->getParam("token")->value();
+    return tokenMatches(token.c_str(), token.length());
+  }
+  return false;
+}
+
+static bool rejectUnauthorized(AsyncWebServerRequest* request) {
+  if (authorized(request)) {
+    return false;
+  }
+  request->send(401, "application/json", "{\"error\":\"token inválido\"}");
+  return true;
+}
+
+// ==========================
+// HANDLERS (task do AsyncTCP)
+// ==========================
+
+static void onHeartbeatRequest(AsyncWebServerRequest* request) {
+  if (rejectUnauthorized(request)) {
+    return;
+  }
+  size_t len = copySnapshot(true);
+  if (len == 0) {
+    request->send(503, "application/json", "{\"error\":\"sem dados ainda\"}");
+    return;
+  }
+  request->send(200, "application/json", handlerCopy);
+}
+
+static void onCommandRequest(AsyncWebServerRequest* request) {
+  if (rejectUnauthorized(request)) {
+    return;
+  }
+  if (!request->hasParam("command")) {
+    request->send(400, "application/json", "{\"error\":\"falta ?command=OPEN|CLOSE|AUTO\"}");
+    return;
+  }
+  const String& cmd = request->getParam("command")->value();
+  if (!queueCommand((const uint8_t*)cmd.c_str(), cmd.length())) {
+    request->send(400, "application/json", "{\"error\":\"comando inválido\"}");
+    return;
+  }
+  // Aceito; o resultado chega como "ack" no WebSocket (e no heartbeat)
+  request->send(202, "application/json", "{\"status\":\"queued\"}");
+}
+
+static void onWsEvent(AsyncWebSocket* server, AsyncWebSocketClient* client, AwsEventType type,
+                      void* arg, uint8_t* data, size_t len) {
+  if (type == WS_EVT_CONNECT) {
+    // Estado atual na hora, como o stream do backend
+    size_t n = copySnapshot(false);
+    if (n > 0) {
+      client->text(handlerCopy, n);
+    }
+    return;
+  }
+
+  if (type == WS_EVT_DATA) {
+    // Comando = um quadro de texto inteiro ("OPEN", "CLOSE", "AUTO")
+    AwsFrameInfo* info = (AwsFrameInfo*)arg;
+    if (info->final && info->index == 0 && info->len == len && info->opcode == WS_TEXT) {
+      queueCommand(data, len);
+    }
+  }
+}
+
+// ==========================
+// EVENTOS (loop)
+// ==========================
+
+static void onStateEvent(const Event& event) {
+  pushRequested = true;
+}
+
+static void startServer() {
+  const char* id = mqttGetDeviceId();
+
+  started = true;
+  if (LOCAL_TOKEN_LEN == 0) {
+    Serial.println("[LOCAL] LOCAL_SERVER_TOKEN não definido (local_token.h): servidor local desligado.");
+    return;
+  }
+
+  // Subir mDNS/servidor aloca (sockets, tarefas): fora da contagem do loop
+  memMonitorAllowAllocations(true);
+  if (MDNS.begin(id)) {
+    MDNS.addService("http", "tcp", LOCAL_SERVER_PORT);
+    MDNS.addService("varal", "tcp", LOCAL_SERVER_PORT);
+    MDNS.addServiceTxt("varal", "tcp", "id", id);
+  } else {
+    Serial.println("[LOCAL] Falha ao iniciar mDNS (segue só por IP).");
+  }
+
+  // Handshake sem token não casa com o handler (o servidor responde 404)
+  ws.setFilter(authorized);
+  ws.onEvent(onWsEvent);
+  server.addHandler(&ws);
+  server.on("/heartbeat", HTTP_GET, onHeartbeatRequest);
+  server.on("/cmd", HTTP_POST, onCommandRequest);
+  server.begin();
+  memMonitorAllowAllocations(false);
+
+  Serial.print("[LOCAL] Servidor local em http://");
+  Serial.print(id);
+  Serial.println(".local/");
+}
+
+static void applyPendingCommand() {
+  char buf[LOCAL_COMMAND_MAX + 1];
+  if (!takeCommand(buf)) {
+    return;
+  }
+
+  const char* cmd = mqttNormalizeCommand(buf);
+  Serial.print("[LOCAL] Comando recebido: '");
+  Serial.print(cmd);
+  Serial.println("'");
+
+  if (!varalControllerHandleCommand(cmd)) {
+    Serial.println("[LOCAL] Comando desconhecido (ignorado).");
+    return;
+  }
+
+  // A nuvem também fica sabendo (heartbeat imediato)
+  mqttRequestHeartbeat();
+
+  if (ws.count() > 0) {
+    char ack[96];
+    int n = snprintf(ack, sizeof(ack), "{\"type\":\"ack\",\"device_id\":\"%s\",\"command\":\"%s\"}",
+                     mqttGetDeviceId(), cmd);
+    memMonitorAllowAllocations(true);  // a fila do AsyncTCP aloca por mensagem
+    ws.textAll(ack, n);
+    memMonitorAllowAllocations(false);
+  }
+}
+
+// ==========================
+// API
+// ==========================
+
+void localServerInit() {
+  static bool subscribed = false;
+  if (!subscribed) {
+    eventBusSubscribe(EventType::MODE_CHANGED,       onStateEvent);
+    eventBusSubscribe(EventType::RAIN_LEVEL_CHANGED, onStateEvent);
+    eventBusSubscribe(EventType::MOTION_DONE,        onStateEvent);
+    subscribed = true;
+  }
+}
+
+void localServerLoop() {
+  if (!started) {
+    if (wifiIsConnected()) {
+      startServer();
+    }
+    return;
+  }
+  if (LOCAL_TOKEN_LEN == 0) {
+    return;  // sem token o servidor não subiu
+  }
+
+  applyPendingCommand();
+
+  // Snapshot: na hora se houve evento; periódico só com o motor parado
+  unsigned long now = millis();
+  bool periodic = !stepperIsMoving() && now - lastSnapshotMillis >= SNAPSHOT_INTERVAL_MS;
+  if (pushRequested || periodic) {
+    buildSnapshot();
+
+    if (pushRequested && ws.count() > 0 && ws.availableForWriteAll()) {
+      memMonitorAllowAllocations(true);
+      ws.textAll(snapshot, snapshotLen);
+      memMonitorAllowAllocations(false);
+    }
+    pushRequested = false;
+  }
+
+  if (now - lastCleanupMillis >= CLEANUP_INTERVAL_MS) {
+    lastCleanupMillis = now;
+    ws.cleanupClients();
+  }
+}
+
+#else
+
+void localServerInit() {}
+void localServerLoop() {}
+
+#endif
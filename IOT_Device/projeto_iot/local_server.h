@@ -0,0 +1,51 @@
+#pragma once
+#include <Arduino.h>
+
+// ==========================================================
+// SERVIDOR LOCAL (mDNS + HTTP + WebSocket, sem passar pela nuvem)
+// ==========================================================
+//
+// Na rede da casa o app fala direto com o varal, mesmo sem internet:
+//   http://varal-a1b2c3.local/heartbeat     -> mesmo JSON do heartbeat MQTT
+//   POST http://varal-a1b2c3.local/cmd?command=OPEN   (OPEN / CLOSE / AUTO)
+//   ws://varal-a1b2c3.local/ws              -> comandos (texto) e eventos
+//
+// Eventos no WebSocket têm o formato do stream do backend:
+//   {"type":"heartbeat","device_id":"..","data":{...}}   (mudou modo/chuva/motor)
+//   {"type":"ack","device_id":"..","command":"OPEN"}      (comando aplicado)
+//
+// Os handlers rodam na task do AsyncTCP e só copiam o comando para um
+// slot pendente; quem aplica é o loop (localServerLoop), junto com o
+// resto da lógica. Snapshot do heartbeat é montado no loop e só copiado
+// pelos handlers. Enquanto o motor anda, o snapshot só é refeito em evento.
+//
+// Qualquer um na rede local alcança a porta 80, então toda requisição leva
+// um token compartilhado: cabeçalho "Authorization: Bearer <token>" ou
+// ?token=<token> (o WebSocket do navegador não manda cabeçalho). Sem
+// token, 401 no HTTP e o handshake do WebSocket é recusado.
+//
+// Vem desligado: liga com LOCAL_SERVER_ENABLED = 1 e o token em
+// local_token.h (fora do git):
+//   #define LOCAL_SERVER_TOKEN "..."
+// Ligado sem token, o servidor não sobe.
+
+#ifndef LOCAL_SERVER_ENABLED
+#define LOCAL_SERVER_ENABLED 0
+#endif
+
+#if __has_include("local_token.h")
+#include "local_token.h"
+#endif
+
+#ifndef LOCAL_SERVER_TOKEN
+#define LOCAL_SERVER_TOKEN ""
+#endif
+
+static const uint16_t LOCAL_SERVER_PORT = 80;
+
+// Chamar no setup, depois do mqttInit() (usa o ID do dispositivo)
+void localServerInit();
+
+// Chamar no loop: sobe o servidor quando o Wi-Fi conecta, aplica o
+// comando pendente e empurra os eventos aos clientes
+void localServerLoop();
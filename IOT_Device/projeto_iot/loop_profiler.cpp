@@ -0,0 +1,92 @@
+#include <Arduino.h>
+#include "loop_profiler.h"
+
+// ==========================
+// ESTADO INTERNO
+// ==========================
+
+struct SectionStats {
+  uint32_t count;
+  uint64_t totalCycles;
+  uint32_t maxCycles;
+};
+
+static const int SECTION_COUNT = (int)LoopSection::COUNT;
+
+static const char* const SECTION_NAMES[SECTION_COUNT] = {
+  "wifi", "mqtt", "sensors", "stepper", "events", "controller", "recorder", "local"
+};
+
+static SectionStats sections[SECTION_COUNT];
+static SectionStats loopStats;
+
+// ==========================
+// FUNÇÕES INTERNAS
+// ==========================
+
+static void addSample(SectionStats& s, uint32_t cycles) {
+  s.count++;
+  s.totalCycles += cycles;
+  if (cycles > s.maxCycles) {
+    s.maxCycles = cycles;
+  }
+}
+
+// Anexa "nome":[média,máx] (em µs); false se não coube
+static bool appendStats(char* out, size_t capacity, int& len, const char* name,
+                        const SectionStats& s, uint32_t cyclesPerUs) {
+  float avgUs = s.count ? (float)s.totalCycles / (float)s.count / (float)cyclesPerUs : 0.0f;
+  float maxUs = (float)s.maxCycles / (float)cyclesPerUs;
+
+  int n = snprintf(out + len, capacity - len, "%s\"%s\":[%.1f,%.1f]",
+                   len > 1 ? "," : "", name, avgUs, maxUs);
+  if (n < 0 || (size_t)(len + n) >= capacity) {
+    return false;
+  }
+  len += n;
+  return true;
+}
+
+// ==========================
+// FUNÇÕES PÚBLICAS
+// ==========================
+
+uint32_t loopProfilerStart() {
+  return ESP.getCycleCount();
+}
+
+uint32_t loopProfilerMark(LoopSection section, uint32_t since) {
+  uint32_t now = ESP.getCycleCount();
+  addSample(sections[(int)section], now - since);  // subtração sem sinal: ok no wrap
+  return now;
+}
+
+void loopProfilerEndLoop(uint32_t loopStart) {
+  addSample(loopStats, ESP.getCycleCount() - loopStart);
+}
+
+int loopProfilerReportJson(char* out, size_t capacity) {
+  if (capacity < 3) {
+    return 0;
+  }
+  uint32_t cyclesPerUs = ESP.getCpuFreqMHz();
+
+  int len = 0;
+  out[len++] = '{';
+  for (int i = 0; i < SECTION_COUNT; i++) {
+    if (!appendStats(out, capacity, len, SECTION_NAMES[i], sections[i], cyclesPerUs)) {
+      return 0;
+    }
+  }
+  if (!appendStats(out, capacity, len, "total", loopStats, cyclesPerUs) || (size_t)len + 2 > capacity) {
+    return 0;
+  }
+  out[len++] = '}';
+  out[len]   = '\0';
+  return len;
+}
+
+void loopProfilerResetWindow() {
+  memset(sections, 0, sizeof(sections));
+  memset(&loopStats, 0, sizeof(loopStats));
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <Arduino.h>
+
+// ==========================================================
+// PERFIL DO LOOP (ciclos de CPU por trecho)
+// ==========================================================
+//
+// Mede, com o contador de ciclos do Xtensa, quanto cada etapa do loop()
+// gasta. Guarda média e pior caso desde o último heartbeat MQTT, que
+// publica os números em "loop_us" e zera a janela.
+//
+//   uint32_t t = loopProfilerStart();
+//   handleWiFi();
+//   t = loopProfilerMark(LoopSection::WIFI, t);
+//   ...
+//   loopProfilerEndLoop(inicio);
+
+enum class LoopSection : uint8_t {
+  WIFI,
+  MQTT,
+  SENSORS,
+  STEPPER,
+  EVENTS,
+  CONTROLLER,
+  RECORDER,
+  LOCAL,
+  COUNT
+};
+
+// Ciclo atual (início de um trecho)
+uint32_t loopProfilerStart();
+
+// Fecha o trecho iniciado em 'since' e devolve o ciclo atual (início do próximo)
+uint32_t loopProfilerMark(LoopSection section, uint32_t since);
+
+// Fecha o loop inteiro (iniciado em 'loopStart')
+void loopProfilerEndLoop(uint32_t loopStart);
+
+// Escreve {"wifi":[média,máx],...,"total":[média,máx]} em µs.
+// Retorna o nº de caracteres escritos (0 se não coube).
+int loopProfilerReportJson(char* out, size_t capacity);
+
+// Começa uma nova janela (o heartbeat MQTT chama depois de publicar)
+void loopProfilerResetWindow();
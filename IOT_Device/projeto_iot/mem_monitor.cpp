@@ -0,0 +1,142 @@
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "mem_monitor.h"
+
+// ==========================
+// CONFIGURAÇÃO
+// ==========================
+
+// Tasks cuja pilha vai pra telemetria (as que não existirem são puladas)
+static const char* const STACK_TASKS[] = {
+  "loopTask", "arduino_events", "tiT", "wifi", "esp_timer", "ota"
+};
+static const int STACK_TASK_COUNT = sizeof(STACK_TASKS) / sizeof(STACK_TASKS[0]);
+
+// ==========================
+// ESTADO INTERNO
+// ==========================
+
+static TaskHandle_t      loopTaskHandle  = nullptr;
+static volatile bool     armed           = false;
+static volatile bool     allowed         = false;
+static volatile uint32_t loopAllocations = 0;
+static size_t            blocksAtArm     = 0;
+
+// ==========================
+// CONTAGEM
+// ==========================
+
+static void countAllocation() {
+  if (!armed || allowed || xTaskGetCurrentTaskHandle() != loopTaskHandle) {
+    return;
+  }
+  loopAllocations++;
+#if MEM_TRAP_LOOP_ALLOCATIONS
+  abort();
+#endif
+}
+
+#ifdef CONFIG_HEAP_USE_HOOKS
+// Chamado pelo ESP-IDF em toda alocação do heap (inclui o operator new)
+extern "C" void esp_heap_trace_alloc_hook(void* ptr, size_t size, uint32_t caps) {
+  (void)ptr; (void)size; (void)caps;
+  countAllocation();
+}
+
+extern "C" void esp_heap_trace_free_hook(void* ptr) {
+  (void)ptr;
+}
+#endif
+
+void* operator new(size_t size) {
+#ifndef CONFIG_HEAP_USE_HOOKS
+  countAllocation();
+#endif
+  void* p = malloc(size);
+  if (p == nullptr) {
+    abort();  // sem memória: melhor resetar do que seguir com ponteiro nulo
+  }
+  return p;
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+// ==========================
+// FUNÇÕES PÚBLICAS
+// ==========================
+
+void memMonitorInit() {
+  loopTaskHandle  = xTaskGetCurrentTaskHandle();  // setup() roda na task do loop
+  armed           = false;
+  allowed         = false;
+  loopAllocations = 0;
+}
+
+void memMonitorArmSteadyState() {
+  multi_heap_info_t info;
+  heap_caps_get_info(&info, MALLOC_CAP_DEFAULT);
+  blocksAtArm = info.allocated_blocks;
+  armed       = true;
+
+  Serial.print("[MEM] Regime permanente | heap livre: ");
+  Serial.print(ESP.getFreeHeap());
+  Serial.print(" | maior bloco: ");
+  Serial.println(ESP.getMaxAllocHeap());
+}
+
+void memMonitorAllowAllocations(bool allow) {
+  allowed = allow;
+}
+
+uint32_t memMonitorLoopAllocations() {
+  return loopAllocations;
+}
+
+int memMonitorReportJson(char* out, size_t capacity) {
+  multi_heap_info_t info;
+  heap_caps_get_info(&info, MALLOC_CAP_DEFAULT);
+
+  // Crescimento de blocos vivos desde o setup (todas as tasks): sobe sem
+  // parar = vazamento; oscila = pilha de rede trabalhando
+  long blockGrowth = (long)info.allocated_blocks - (long)blocksAtArm;
+
+  int len = snprintf(out, capacity,
+                     "{\"free\":%u,\"min_free\":%u,\"largest\":%u,\"block_growth\":%ld,\"loop_allocs\":%u,\"stack\":{",
+                     (unsigned)info.total_free_bytes, (unsigned)info.minimum_free_bytes,
+                     (unsigned)info.largest_free_block, blockGrowth, (unsigned)loopAllocations);
+  if (len < 0 || (size_t)len >= capacity) {
+    return 0;
+  }
+
+  bool first = true;
+  for (int i = 0; i < STACK_TASK_COUNT; i++) {
+    TaskHandle_t task = xTaskGetHandle(STACK_TASKS[i]);
+    if (task == nullptr) continue;
+
+    // No ESP-IDF a marca d'água já vem em bytes
+    int n = snprintf(out + len, capacity - len, "%s\"%s\":%u",
+                     first ? "" : ",", STACK_TASKS[i], (unsigned)uxTaskGetStackHighWaterMark(task));
+    if (n < 0 || (size_t)(len + n) >= capacity) {
+      return 0;
+    }
+    len += n;
+    first = false;
+  }
+
+  if ((size_t)len + 3 > capacity) {
+    return 0;
+  }
+  out[len++] = '}';
+  out[len++] = '}';
+  out[len]   = '\0';
+  return len;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <Arduino.h>
+
+// ==========================================================
+// MONITOR DE MEMÓRIA
+// ==========================================================
+//
+// Depois do setup() o loop() não deveria alocar nada (buffers fixos em
+// todo o caminho quente). O monitor conta toda alocação feita pela task
+// do loop depois de memMonitorArmSteadyState() e publica no heartbeat,
+// junto com heap livre, mínimo histórico, maior bloco e a marca d'água
+// da pilha das tasks principais.
+//
+// Contagem: operator new/new[] sempre; com CONFIG_HEAP_USE_HOOKS
+// (ESP-IDF 5) também malloc/calloc/realloc, via os ganchos do heap.
+// Com MEM_TRAP_LOOP_ALLOCATIONS = 1 a primeira alocação no loop aborta
+// (o backtrace do panic mostra quem alocou) — útil na bancada.
+
+#ifndef MEM_TRAP_LOOP_ALLOCATIONS
+#define MEM_TRAP_LOOP_ALLOCATIONS 0
+#endif
+
+// Chamar no início do setup() (guarda a task do loop)
+void memMonitorInit();
+
+// Chamar no fim do setup(): daqui pra frente alocação no loop é contada
+void memMonitorArmSteadyState();
+
+// Libera temporariamente (reconexão Wi-Fi/TLS aloca por natureza)
+void memMonitorAllowAllocations(bool allow);
+
+// Alocações na task do loop desde que armou
+uint32_t memMonitorLoopAllocations();
+
+// Escreve {"free":..,"min_free":..,"largest":..,"block_growth":..,
+//          "loop_allocs":..,"stack":{"loopTask":..,...}} (bytes).
+// Retorna o nº de caracteres escritos (0 se não coube).
+int memMonitorReportJson(char* out, size_t capacity);
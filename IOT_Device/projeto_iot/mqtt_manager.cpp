@@ -1,11 +1,20 @@
 #include <Arduino.h>
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
 #include <WiFiClientSecure.h>
 #include <PubSubClient.h>
 
 #include "mqtt_manager.h"
 #include "wifi_manager.h"
-#include "dht11_sensor.h"
-#include "rain_sensor.h"
+#include "event_bus.h"
+#include "flight_recorder.h"
+#include "mem_monitor.h"
+#include "mqtt_transport.h"
+#include "telemetry.h"
+#include "rule_engine.h"
+#include "desired_state.h"
+#include "ota_update.h"
 #include "varal_controller.h"
 
 // =========================================
@@ -16,15 +25,48 @@ static const char* AWS_IOT_ENDPOINT = "a35ipjtxc4uo0u-ats.iot.us-east-1.amazonaw
 static const int   AWS_IOT_PORT     = 8883;
 
 // IDs / tópicos
-static const char* MQTT_CLIENT_ID        = "esp32_iot";
-static const char* MQTT_TOPIC_HEARTBEAT  = "casa/varal1/heartbeat";
-static const char* MQTT_TOPIC_STATUS     = "casa/varal1/status";
-static const char* MQTT_TOPIC_CMD        = "casa/varal1/cmd";
-
-// Intervalo do heartbeat (ms)
-static const unsigned long HEARTBEAT_INTERVAL_MS = 30'000; // 30 segundos
+// O ID do dispositivo vem do MAC gravado no efuse (ex: "varal-a1b2c3"),
+// então o mesmo firmware serve pra todos os varais da casa.
+static const char* MQTT_DEVICE_PREFIX = "varal-";
+static const char* MQTT_TOPIC_ROOT    = "casa";
+
+static char deviceId[24];
+static char mqttTopicHeartbeat[64];
+static char mqttTopicStatus[64];
+static char mqttTopicCmd[64];
+static char mqttTopicLog[64];
+static char mqttTopicAck[64];
+static char mqttTopicRules[64];
+static char mqttTopicDesired[64];
+static char mqttTopicOta[64];
+
+// Buffer do PubSubClient: cabe a maior mensagem da fila de saída + tópico + cabeçalho
+static const uint16_t MQTT_BUFFER_SIZE = MQTT_TRANSPORT_MAX_PAYLOAD + 256;
+
+// Pedaços da caixa-preta (cabeçalho + 512 bytes de dados; cabe no buffer acima)
+static const size_t LOG_CHUNK_SIZE = FLIGHT_DUMP_HEADER_SIZE + 512;
+
+// Buffers fixos (nada de String no caminho do loop: sem heap, sem fragmentação)
+static const size_t MQTT_COMMAND_MAX = 63;
+static char   heartbeatPayload[MQTT_TRANSPORT_MAX_PAYLOAD - 32]; // sobra p/ o "seq" do transporte
+
+// Intervalo do heartbeat: vem do estado desejado ("hb_s", padrão 30 s)
 static unsigned long lastHeartbeatMillis = 0;
 
+// Estado do link (para emitir LINK_UP / LINK_DOWN só nas transições)
+static bool linkUp = false;
+
+// Reconexão: uma tentativa por volta do loop, no máximo a cada 5 s. Com o
+// broker fora (internet caiu) o resto do loop segue: servidor local, chuva,
+// motor. A primeira tentativa (setup) sai na hora.
+static const unsigned long MQTT_RETRY_INTERVAL_MS = 5'000;
+static unsigned long lastAttemptMillis = 0;
+static bool          attempted         = false;
+
+// Depois de um comando, manda um heartbeat na hora (serve de confirmação pro app)
+// com prioridade alta na fila de saída
+static bool heartbeatRequested = false;
+
 // =========================================
 // CERTIFICADOS (PLACEHOLDER)
 // =========================================
@@ -105,6 +147,31 @@ xWwS7/YN26mFEy9WuWENMoRQ2sDk45JHQDCjtRUTMGE3osKaPz1MCVw=
 -----END RSA PRIVATE KEY-----
 )EOF";
 
+// =========================================
+// IDENTIDADE DO DISPOSITIVO
+// =========================================
+
+static void buildDeviceIdentity() {
+  // getEfuseMac() devolve o MAC com o 1º byte nos bits menos significativos;
+  // os 3 últimos bytes (parte específica da placa) bastam pra distinguir.
+  uint64_t mac = ESP.getEfuseMac();
+  snprintf(deviceId, sizeof(deviceId), "%s%02x%02x%02x",
+           MQTT_DEVICE_PREFIX,
+           (uint8_t)(mac >> 24), (uint8_t)(mac >> 32), (uint8_t)(mac >> 40));
+
+  snprintf(mqttTopicHeartbeat, sizeof(mqttTopicHeartbeat), "%s/%s/heartbeat", MQTT_TOPIC_ROOT, deviceId);
+  snprintf(mqttTopicStatus,    sizeof(mqttTopicStatus),    "%s/%s/status",    MQTT_TOPIC_ROOT, deviceId);
+  snprintf(mqttTopicCmd,       sizeof(mqttTopicCmd),       "%s/%s/cmd",       MQTT_TOPIC_ROOT, deviceId);
+  snprintf(mqttTopicLog,       sizeof(mqttTopicLog),       "%s/%s/log",       MQTT_TOPIC_ROOT, deviceId);
+  snprintf(mqttTopicAck,       sizeof(mqttTopicAck),       "%s/%s/ack",       MQTT_TOPIC_ROOT, deviceId);
+  snprintf(mqttTopicRules,     sizeof(mqttTopicRules),     "%s/%s/rules",     MQTT_TOPIC_ROOT, deviceId);
+  snprintf(mqttTopicDesired,   sizeof(mqttTopicDesired),   "%s/%s/desired",   MQTT_TOPIC_ROOT, deviceId);
+  snprintf(mqttTopicOta,       sizeof(mqttTopicOta),       "%s/%s/ota",       MQTT_TOPIC_ROOT, deviceId);
+
+  Serial.print("[MQTT] Device ID: ");
+  Serial.println(deviceId);
+}
+
 // =========================================
 // CLIENTES MQTT / TLS
 // =========================================
@@ -116,21 +183,49 @@ static PubSubClient mqttClient(secureClient);
 // HELPERS PARA COMANDOS
 // =========================================
 
-static void handleMqttCommand(const String& cmdRaw) {
-  String cmd = cmdRaw;
-  cmd.trim();
-  cmd.toUpperCase();
+// "DUMP" = caixa-preta inteira (0), "DUMP n" = últimos n setores de 4 KB.
+// n tem que ser um inteiro positivo e ocupar o resto do comando
+// ("DUMP 2x", "DUMP -3", "DUMP +3" são desconhecidos)
+static bool parseDumpCommand(const char* cmd, int* sectors) {
+  if (strncmp(cmd, "DUMP", 4) != 0) {
+    return false;
+  }
+  if (cmd[4] == '\0') {
+    *sectors = 0;
+    return true;
+  }
+  const char* digits = cmd + 5;
+  if (cmd[4] != ' ' || !isdigit((unsigned char)*digits)) {
+    return false;
+  }
+  char* end = nullptr;
+  errno     = 0;
+  long n    = strtol(digits, &end, 10);
+  if (*end != '\0' || errno == ERANGE || n <= 0 || n > INT_MAX) {
+    return false;
+  }
+  *sectors = (int)n;
+  return true;
+}
+
+static void handleMqttCommand(char* cmdRaw) {
+  const char* cmd     = mqttNormalizeCommand(cmdRaw);
+  int         sectors = 0;
 
   Serial.print("[MQTT] Comando recebido: '");
   Serial.print(cmd);
   Serial.println("'");
 
-  if (cmd == "OPEN") {
-    varalControllerSetMode(VaralMode::FORCE_OPEN);
-  } else if (cmd == "CLOSE") {
-    varalControllerSetMode(VaralMode::FORCE_CLOSE);
-  } else if (cmd == "AUTO") {
-    varalControllerSetMode(VaralMode::AUTO);
+  if (varalControllerHandleCommand(cmd)) {
+    heartbeatRequested = true;
+  } else if (strcmp(cmd, "SYNC") == 0) {
+    // Backend perdeu algum delta: manda o estado inteiro
+    telemetryRequestFullReport();
+    heartbeatRequested = true;
+  } else if (parseDumpCommand(cmd, &sectors)) {
+    if (!flightRecorderStartDump(sectors)) {
+      Serial.println("[MQTT] Caixa-preta indisponível.");
+    }
   } else {
     Serial.println("[MQTT] Comando desconhecido (ignorado).");
   }
@@ -141,19 +236,49 @@ static void handleMqttCommand(const String& cmdRaw) {
 // =========================================
 
 static void mqttCallback(char* topic, byte* payload, unsigned int length) {
+  // Programa de regras: binário, vai inteiro para o motor de regras
+  if (strcmp(topic, mqttTopicRules) == 0) {
+    Serial.print("[MQTT] Programa de regras recebido (");
+    Serial.print(length);
+    Serial.println(" bytes)");
+    ruleEngineInstall(payload, length);
+    heartbeatRequested = true;
+    return;
+  }
+
+  // Estado desejado (retido): chega a cada conexão, só aplica versão nova
+  if (strcmp(topic, mqttTopicDesired) == 0) {
+    if (desiredStateHandle(payload, length)) {
+      heartbeatRequested = true; // o "dv" novo confirma para o backend
+    }
+    return;
+  }
+
+  // Pedido de atualização (retido): o download roda numa task própria
+  if (strcmp(topic, mqttTopicOta) == 0) {
+    if (otaHandleJob(payload, length)) {
+      heartbeatRequested = true;
+    }
+    return;
+  }
+
   Serial.print("[MQTT] Mensagem recebida em [");
   Serial.print(topic);
   Serial.print("]: ");
 
-  String msg;
-  for (unsigned int i = 0; i < length; i++) {
-    msg += (char)payload[i];
-  }
+  // Cópia terminada em '\0' num buffer fixo (comandos maiores são cortados)
+  static char msg[MQTT_COMMAND_MAX + 1];
+  unsigned int n = length < MQTT_COMMAND_MAX ? length : MQTT_COMMAND_MAX;
+  memcpy(msg, payload, n);
+  msg[n] = '\0';
   Serial.println(msg);
 
   // Tratar comandos no tópico de comando
-  if (String(topic) == MQTT_TOPIC_CMD) {
+  if (strcmp(topic, mqttTopicCmd) == 0) {
     handleMqttCommand(msg);
+  } else if (strcmp(topic, mqttTopicAck) == 0) {
+    // Backend confirmou uma mensagem da fila de saída
+    mqttTransportHandleAck(msg);
   }
 
   // Se quiser tratar outros tópicos no futuro, é aqui
@@ -168,87 +293,86 @@ static void mqttConnect() {
     return;
   }
 
+  if (!wifiIsConnected()) {
+    Serial.println("[MQTT] Wi-Fi não está conectado, abortando tentativa MQTT.");
+    return;
+  }
+
+  unsigned long now = millis();
+  if (attempted && now - lastAttemptMillis < MQTT_RETRY_INTERVAL_MS) {
+    return;
+  }
+  attempted         = true;
+  lastAttemptMillis = now;
+
   Serial.print("[MQTT] Conectando ao broker: ");
   Serial.println(AWS_IOT_ENDPOINT);
 
-  // Tenta até conectar
-  while (!mqttClient.connected()) {
-    if (!wifiIsConnected()) {
-      Serial.println("[MQTT] Wi-Fi não está conectado, abortando tentativa MQTT.");
-      return;
-    }
+  if (!mqttClient.connect(deviceId)) {
+    Serial.print("[MQTT] Falha na conexão, rc=");
+    Serial.print(mqttClient.state());
+    Serial.println(" | nova tentativa em 5s...");
+    return;
+  }
 
-    bool ok = mqttClient.connect(MQTT_CLIENT_ID);
-    if (ok) {
-      Serial.println("[MQTT] Conectado!");
-
-      // Inscreve nos tópicos de comando
-      if (mqttClient.subscribe(MQTT_TOPIC_CMD)) {
-        Serial.print("[MQTT] Inscrito em: ");
-        Serial.println(MQTT_TOPIC_CMD);
-      } else {
-        Serial.println("[MQTT] Falha ao inscrever em tópico de comando");
-      }
-
-      // Publica um "online" no tópico de STATUS (não mais no heartbeat)
-      mqttClient.publish(MQTT_TOPIC_STATUS, "online");
-
-    } else {
-      Serial.print("[MQTT] Falha na conexão, rc=");
-      Serial.print(mqttClient.state());
-      Serial.println(" | nova tentativa em 5s...");
-      delay(5000);
-    }
+  Serial.println("[MQTT] Conectado!");
+  linkUp = true;
+  eventBusEmitLink(true);
+
+  // Inscreve nos tópicos de comando
+  if (mqttClient.subscribe(mqttTopicCmd)) {
+    Serial.print("[MQTT] Inscrito em: ");
+    Serial.println(mqttTopicCmd);
+  } else {
+    Serial.println("[MQTT] Falha ao inscrever em tópico de comando");
   }
-}
 
-static const char* modeToString(VaralMode mode) {
-  switch (mode) {
-    case VaralMode::AUTO:        return "AUTO";
-    case VaralMode::FORCE_OPEN:  return "FORCE_OPEN";
-    case VaralMode::FORCE_CLOSE: return "FORCE_CLOSE";
-    default:                     return "UNKNOWN";
+  // Confirmações do backend (QoS1 na assinatura: o broker reentrega)
+  if (!mqttClient.subscribe(mqttTopicAck, 1)) {
+    Serial.println("[MQTT] Falha ao inscrever em tópico de ack");
   }
-}
 
-static void mqttPublishHeartbeat() {
-  if (!mqttClient.connected()) {
-    return;
+  // Programa de regras (retido no broker: chega a cada conexão)
+  if (!mqttClient.subscribe(mqttTopicRules, 1)) {
+    Serial.println("[MQTT] Falha ao inscrever em tópico de regras");
   }
 
-  String payload = "{";
+  // Estado desejado (retido: o que foi pedido com o varal offline chega agora)
+  if (!mqttClient.subscribe(mqttTopicDesired, 1)) {
+    Serial.println("[MQTT] Falha ao inscrever em tópico de estado desejado");
+  }
 
-  // DHT
-  if (dht11HasValidData()) {
-    payload += "\"temp_c\":";
-    payload += String(dht11GetTemperatureC(), 1);
-    payload += ",\"humidity\":";
-    payload += String(dht11GetHumidity(), 1);
-  } else {
-    payload += "\"temp_c\":null,\"humidity\":null";
+  // Atualização OTA (retido: a versão pedida vale até o backend limpar)
+  if (!mqttClient.subscribe(mqttTopicOta, 1)) {
+    Serial.println("[MQTT] Falha ao inscrever em tópico de OTA");
   }
 
-  // Chuva
-  bool chovendo = rainIsRaining();
-  payload += ",\"rain\":";
-  payload += (chovendo ? "true" : "false");
+  // Heartbeats da conexão anterior já envelheceram: saem da fila e vai
+  // um relatório completo novo (o backend carimba a hora da chegada)
+  mqttTransportDiscard(mqttTopicHeartbeat);
+  telemetryRequestFullReport();
+  heartbeatRequested = true;
 
-  // Modo atual do varal (seu controlador)
-  VaralMode mode = varalControllerGetMode();
-  payload += ",\"mode\":\"";
-  payload += modeToString(mode);
-  payload += "\"";
+  // O resto que estava em voo na conexão anterior é reenviado
+  mqttTransportOnConnected();
 
-  // Timestamp local (millis)
-  payload += ",\"uptime_ms\":";
-  payload += String(millis());
+  // Publica um "online" no tópico de STATUS (não mais no heartbeat)
+  mqttTransportPublishJson(mqttTopicStatus, "online", MqttPriority::URGENT, false);
+}
 
-  payload += "}";
+// Enfileira o heartbeat (entrega confirmada); só com o broker conectado.
+// Só leva o que mudou desde o anterior, com relatório completo de tempos em tempos.
+static void mqttPublishHeartbeat(MqttPriority priority) {
+  int len = telemetryBuildReport(heartbeatPayload, sizeof(heartbeatPayload));
+  if (len == 0) {
+    Serial.println("[MQTT] Heartbeat não coube no buffer (não enviado).");
+    return;
+  }
 
   Serial.print("[MQTT] Heartbeat -> ");
-  Serial.println(payload);
+  Serial.println(heartbeatPayload);
 
-  mqttClient.publish(MQTT_TOPIC_HEARTBEAT, payload.c_str());
+  mqttTransportPublishJson(mqttTopicHeartbeat, heartbeatPayload, priority, true);
 }
 
 // =========================================
@@ -256,6 +380,9 @@ static void mqttPublishHeartbeat() {
 // =========================================
 
 void mqttInit() {
+  // Identidade (client ID + tópicos) derivada do MAC
+  buildDeviceIdentity();
+
   // Configura TLS
   secureClient.setCACert(AWS_ROOT_CA);
   secureClient.setCertificate(AWS_CLIENT_CERT);
@@ -264,26 +391,78 @@ void mqttInit() {
   // Configura broker e callback
   mqttClient.setServer(AWS_IOT_ENDPOINT, AWS_IOT_PORT);
   mqttClient.setCallback(mqttCallback);
+  mqttClient.setBufferSize(MQTT_BUFFER_SIZE);
+  mqttTransportInit(mqttClient);
 
-  // Primeira tentativa de conexão
+  // Primeira tentativa de conexão (falhou: o mqttLoop tenta de novo)
   mqttConnect();
 }
 
 void mqttLoop() {
+  if (linkUp && !mqttClient.connected()) {
+    linkUp = false;
+    eventBusEmitLink(false);
+    Serial.println("[MQTT] Conexão perdida.");
+  }
+
   if (!wifiIsConnected()) {
     return; // sem Wi-Fi, sem MQTT
   }
 
   if (!mqttClient.connected()) {
+    // Reconexão (TLS) aloca por natureza: não conta como vazamento do loop
+    memMonitorAllowAllocations(true);
     mqttConnect();
+    memMonitorAllowAllocations(false);
   }
 
   mqttClient.loop();
 
-  // Heartbeat periódico
+  // Heartbeat periódico (ou imediato, confirmando um comando). Offline não
+  // entra na fila: chegaria atrasado com a hora da entrega; ao reconectar
+  // vai um completo novo.
   unsigned long now = millis();
-  if (now - lastHeartbeatMillis >= HEARTBEAT_INTERVAL_MS) {
+  if (mqttClient.connected() &&
+      (heartbeatRequested || now - lastHeartbeatMillis >= desiredStateHeartbeatIntervalMs())) {
+    MqttPriority priority = heartbeatRequested ? MqttPriority::URGENT : MqttPriority::NORMAL;
+    heartbeatRequested  = false;
     lastHeartbeatMillis = now;
-    mqttPublishHeartbeat();
+    mqttPublishHeartbeat(priority);
+  }
+
+  // Caixa-preta: um pedaço por vez, só quando sobra vaga na fila (BULK)
+  if (flightRecorderDumpActive() && mqttTransportHasRoom(MqttPriority::BULK)) {
+    static uint8_t chunk[LOG_CHUNK_SIZE];
+    size_t len = flightRecorderDumpNext(chunk, sizeof(chunk));
+    if (len > 0) {
+      mqttTransportPublish(mqttTopicLog, chunk, len, MqttPriority::BULK, false);
+    }
+  }
+
+  // Envia o que estiver na fila (prioridade, janela de voo, reenvios)
+  mqttTransportLoop();
+}
+
+const char* mqttGetDeviceId() {
+  return deviceId;
+}
+
+void mqttRequestHeartbeat() {
+  heartbeatRequested = true;
+}
+
+bool mqttIsConnected() {
+  return mqttClient.connected();
+}
+
+char* mqttNormalizeCommand(char* cmd) {
+  while (*cmd != '\0' && isspace((unsigned char)*cmd)) cmd++;
+
+  size_t len = strlen(cmd);
+  while (len > 0 && isspace((unsigned char)cmd[len - 1])) cmd[--len] = '\0';
+
+  for (char* c = cmd; *c != '\0'; c++) {
+    *c = (char)toupper((unsigned char)*c);
   }
+  return cmd;
 }
@@ -5,3 +5,15 @@ void mqttInit();
 
 // Chamar sempre no loop principal
 void mqttLoop();
+
+// ID do dispositivo (derivado do MAC), usado no client ID e nos tópicos
+const char* mqttGetDeviceId();
+
+// Publica um heartbeat na próxima volta do loop (confirma comando vindo de fora do MQTT)
+void mqttRequestHeartbeat();
+
+// Sessão com o broker aberta agora
+bool mqttIsConnected();
+
+// Tira espaços das pontas e passa pra maiúsculas, no próprio buffer
+char* mqttNormalizeCommand(char* cmd);
@@ -0,0 +1,267 @@
+#include <Arduino.h>
+#include "mqtt_transport.h"
+
+// ==========================
+// CONFIGURAÇÃO
+// ==========================
+
+static const unsigned long ACK_TIMEOUT_MS   = 5'000;  // sem ack nesse prazo -> reenvia
+static const uint8_t       MAX_ATTEMPTS     = 6;      // depois disso a mensagem expira
+static const int           SENDS_PER_LOOP   = 4;      // não monopoliza o loop
+static const int           BULK_RESERVED    = 2;      // vagas que BULK não pode usar
+
+// ==========================
+// ESTADO INTERNO
+// ==========================
+
+struct OutboundSlot {
+  bool          used;
+  bool          reliable;
+  bool          sent;        // publicado e (se confiável) aguardando ack
+  MqttPriority  priority;
+  uint8_t       attempts;
+  uint32_t      seq;
+  uint32_t      order;       // ordem de chegada (FIFO dentro da prioridade)
+  unsigned long sentMillis;
+  const char*   topic;
+  uint16_t      length;
+  uint8_t       payload[MQTT_TRANSPORT_MAX_PAYLOAD];
+};
+
+static OutboundSlot slots[MQTT_TRANSPORT_SLOTS];
+static PubSubClient* client = nullptr;
+
+static uint32_t nextSeq   = 0;
+static uint32_t nextOrder = 0;
+
+// Contadores (telemetria)
+static uint32_t sentCount    = 0;
+static uint32_t ackedCount   = 0;
+static uint32_t retxCount    = 0;
+static uint32_t droppedCount = 0;
+static uint32_t expiredCount = 0;
+
+// ==========================
+// FUNÇÕES INTERNAS
+// ==========================
+
+static int freeSlotCount() {
+  int n = 0;
+  for (int i = 0; i < MQTT_TRANSPORT_SLOTS; i++) {
+    if (!slots[i].used) n++;
+  }
+  return n;
+}
+
+static int inflightCount() {
+  int n = 0;
+  for (int i = 0; i < MQTT_TRANSPORT_SLOTS; i++) {
+    if (slots[i].used && slots[i].reliable && slots[i].sent) n++;
+  }
+  return n;
+}
+
+// Vaga livre ou, na falta, a mais antiga de prioridade igual/menor (descartada)
+static OutboundSlot* acquireSlot(MqttPriority priority) {
+  OutboundSlot* victim = nullptr;
+  for (int i = 0; i < MQTT_TRANSPORT_SLOTS; i++) {
+    OutboundSlot& s = slots[i];
+    if (!s.used) {
+      return &s;
+    }
+    if (s.priority < priority) {
+      continue;
+    }
+    if (victim == nullptr || s.priority > victim->priority ||
+        (s.priority == victim->priority && s.order < victim->order)) {
+      victim = &s;
+    }
+  }
+  if (victim != nullptr) {
+    droppedCount++;
+    victim->used = false;
+  }
+  return victim;
+}
+
+// Próxima a enviar: nunca enviada ou confirmável com ack vencido
+static OutboundSlot* pickNext(unsigned long now) {
+  bool windowFull = inflightCount() >= MQTT_TRANSPORT_WINDOW;
+
+  OutboundSlot* best = nullptr;
+  for (int i = 0; i < MQTT_TRANSPORT_SLOTS; i++) {
+    OutboundSlot& s = slots[i];
+    if (!s.used) continue;
+
+    bool due;
+    if (!s.sent) {
+      due = !(s.reliable && windowFull);
+    } else {
+      due = s.reliable && now - s.sentMillis >= ACK_TIMEOUT_MS;
+    }
+    if (!due) continue;
+
+    if (best == nullptr || s.priority < best->priority ||
+        (s.priority == best->priority && s.order < best->order)) {
+      best = &s;
+    }
+  }
+  return best;
+}
+
+// ==========================
+// FUNÇÕES PÚBLICAS
+// ==========================
+
+void mqttTransportInit(PubSubClient& mqttClient) {
+  client = &mqttClient;
+  for (int i = 0; i < MQTT_TRANSPORT_SLOTS; i++) {
+    slots[i].used = false;
+  }
+  // Começa num seq aleatório: depois de um reset o backend não confunde
+  // mensagens novas com duplicatas do boot anterior
+  nextSeq = esp_random();
+}
+
+bool mqttTransportPublish(const char* topic, const uint8_t* payload, size_t length,
+                          MqttPriority priority, bool reliable) {
+  if (!mqttTransportHasRoom(priority) && priority == MqttPriority::BULK) {
+    droppedCount++;
+    return false;
+  }
+
+  // Espaço para o ",\"seq\":4294967295" inserido nas confiáveis
+  size_t extra = reliable ? 20 : 0;
+  if (length + extra > MQTT_TRANSPORT_MAX_PAYLOAD || (reliable && (length < 2 || payload[0] != '{'))) {
+    Serial.println("[MQTT] Mensagem grande demais (ou não-JSON confiável): descartada.");
+    droppedCount++;
+    return false;
+  }
+
+  OutboundSlot* s = acquireSlot(priority);
+  if (s == nullptr) {
+    droppedCount++;
+    return false;
+  }
+
+  s->used       = true;
+  s->reliable   = reliable;
+  s->sent       = false;
+  s->priority   = priority;
+  s->attempts   = 0;
+  s->order      = nextOrder++;
+  s->topic      = topic;
+  s->sentMillis = 0;
+
+  if (reliable) {
+    // {"seq":N, + resto do objeto original (sem a '{')
+    s->seq = nextSeq++;
+    bool empty = payload[1] == '}';
+    int n = snprintf((char*)s->payload, MQTT_TRANSPORT_MAX_PAYLOAD, "{\"seq\":%lu%s",
+                     (unsigned long)s->seq, empty ? "" : ",");
+    memcpy(s->payload + n, payload + 1, length - 1);
+    s->length = (uint16_t)(n + length - 1);
+  } else {
+    s->seq = 0;
+    memcpy(s->payload, payload, length);
+    s->length = (uint16_t)length;
+  }
+  return true;
+}
+
+bool mqttTransportPublishJson(const char* topic, const char* json,
+                              MqttPriority priority, bool reliable) {
+  return mqttTransportPublish(topic, (const uint8_t*)json, strlen(json), priority, reliable);
+}
+
+bool mqttTransportHasRoom(MqttPriority priority) {
+  int free = freeSlotCount();
+  return priority == MqttPriority::BULK ? free > BULK_RESERVED : free > 0;
+}
+
+void mqttTransportOnConnected() {
+  // O que estava em voo pode ter se perdido junto com a conexão
+  for (int i = 0; i < MQTT_TRANSPORT_SLOTS; i++) {
+    if (slots[i].used && slots[i].sent) {
+      slots[i].sent = false;
+    }
+  }
+}
+
+int mqttTransportDiscard(const char* topic) {
+  int n = 0;
+  for (int i = 0; i < MQTT_TRANSPORT_SLOTS; i++) {
+    OutboundSlot& s = slots[i];
+    if (s.used && s.topic == topic) {
+      s.used = false;
+      n++;
+    }
+  }
+  droppedCount += n;
+  return n;
+}
+
+void mqttTransportHandleAck(const char* payload) {
+  char* end = nullptr;
+  uint32_t seq = (uint32_t)strtoul(payload, &end, 10);
+  if (end == payload) {
+    return;
+  }
+  for (int i = 0; i < MQTT_TRANSPORT_SLOTS; i++) {
+    OutboundSlot& s = slots[i];
+    if (s.used && s.reliable && s.seq == seq) {
+      s.used = false;
+      ackedCount++;
+      return;
+    }
+  }
+  // Ack de algo já confirmado (duplicata): nada a fazer
+}
+
+void mqttTransportLoop() {
+  if (client == nullptr || !client->connected()) {
+    return;
+  }
+
+  unsigned long now = millis();
+  for (int n = 0; n < SENDS_PER_LOOP; n++) {
+    OutboundSlot* s = pickNext(now);
+    if (s == nullptr) {
+      return;
+    }
+
+    if (s->reliable && s->attempts >= MAX_ATTEMPTS) {
+      s->used = false;
+      expiredCount++;
+      continue;
+    }
+
+    if (!client->publish(s->topic, s->payload, s->length)) {
+      // Cliente caiu ou buffer cheio: tenta de novo na próxima volta
+      return;
+    }
+
+    sentCount++;
+    if (s->attempts > 0) retxCount++;
+    s->attempts++;
+
+    if (s->reliable) {
+      s->sent       = true;
+      s->sentMillis = now;
+    } else {
+      s->used = false;  // QoS0: publicou, acabou
+    }
+  }
+}
+
+int mqttTransportReportJson(char* out, size_t capacity) {
+  int queued = MQTT_TRANSPORT_SLOTS - freeSlotCount();
+  int n = snprintf(out, capacity,
+                   "{\"queued\":%d,\"inflight\":%d,\"sent\":%lu,\"acked\":%lu,\"retx\":%lu,\"dropped\":%lu,\"expired\":%lu}",
+                   queued, inflightCount(), (unsigned long)sentCount, (unsigned long)ackedCount,
+                   (unsigned long)retxCount, (unsigned long)droppedCount, (unsigned long)expiredCount);
+  if (n < 0 || (size_t)n >= capacity) {
+    return 0;
+  }
+  return n;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <Arduino.h>
+#include <PubSubClient.h>
+
+// ==========================================================
+// TRANSPORTE MQTT (fila de saída com prioridade + entrega confirmada)
+// ==========================================================
+//
+// O PubSubClient só publica em QoS0. Esta camada fica entre o
+// mqtt_manager e o cliente e dá:
+//   - fila de saída pré-alocada (MQTT_TRANSPORT_SLOTS x payload máximo),
+//     sem heap; com prioridade (URGENT antes de NORMAL antes de BULK) e
+//     FIFO dentro da mesma prioridade;
+//   - entrega confirmada ("QoS1 de aplicação") para mensagens JSON:
+//     o transporte insere "seq" no objeto, o backend responde com o seq
+//     em casa/<id>/ack e a mensagem fica na fila até o ack. No máximo
+//     MQTT_TRANSPORT_WINDOW mensagens em voo; sem ack no prazo, reenvia;
+//     ao reconectar, reenvia tudo que estava em voo. O backend descarta
+//     duplicatas pelo seq.
+// Fila cheia: descarta a mensagem mais antiga de prioridade igual ou
+// menor (como a fila dos clientes do stream no backend); se não houver,
+// a nova é descartada. BULK nunca ocupa as últimas vagas da fila.
+
+enum class MqttPriority : uint8_t {
+  URGENT = 0,  // status, confirmação de comando
+  NORMAL = 1,  // heartbeat periódico
+  BULK   = 2   // caixa-preta, métricas em lote
+};
+
+static const int      MQTT_TRANSPORT_SLOTS       = 8;
+static const size_t   MQTT_TRANSPORT_MAX_PAYLOAD = 1536;
+static const int      MQTT_TRANSPORT_WINDOW      = 4;   // mensagens confirmadas em voo
+
+// Chamar no setup, depois de configurar o cliente
+void mqttTransportInit(PubSubClient& client);
+
+// Enfileira uma mensagem (o tópico precisa continuar válido até o envio).
+// reliable = entrega confirmada; exige payload JSON começando com '{'.
+bool mqttTransportPublish(const char* topic, const uint8_t* payload, size_t length,
+                          MqttPriority priority, bool reliable);
+bool mqttTransportPublishJson(const char* topic, const char* json,
+                              MqttPriority priority, bool reliable);
+
+// Há vaga para uma mensagem desta prioridade? (produtores BULK se pautam por isso)
+bool mqttTransportHasRoom(MqttPriority priority);
+
+// Conexão (re)estabelecida: reenvia o que estava em voo
+void mqttTransportOnConnected();
+
+// Tira da fila tudo que ainda não foi confirmado neste tópico (o mesmo
+// ponteiro passado no publish). Mensagens que envelhecem, como o
+// heartbeat, não valem ser entregues atrasadas.
+// Retorna quantas saíram (contam como descartadas).
+int mqttTransportDiscard(const char* topic);
+
+// Payload recebido em casa/<id>/ack (seq em decimal)
+void mqttTransportHandleAck(const char* payload);
+
+// Envia o que couber (chamar no loop, com o cliente conectado)
+void mqttTransportLoop();
+
+// Escreve {"queued":..,"inflight":..,"sent":..,"acked":..,"retx":..,"dropped":..,"expired":..}
+// Retorna o nº de caracteres escritos (0 se não coube).
+int mqttTransportReportJson(char* out, size_t capacity);
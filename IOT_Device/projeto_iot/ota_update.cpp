@@ -0,0 +1,760 @@
+#include <Arduino.h>
+#include "ota_update.h"
+
+#if OTA_ENABLED
+
+#include <WiFiClient.h>
+#include <WiFiClientSecure.h>
+#include <HTTPClient.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <mbedtls/sha256.h>
+#include <mbedtls/pk.h>
+#if __has_include(<esp32/rom/miniz.h>)
+#include <esp32/rom/miniz.h>
+#else
+#include <rom/miniz.h>
+#endif
+
+#include "mqtt_manager.h"
+#include "mem_monitor.h"
+#include "stepper_motor.h"
+#include "telemetry.h"
+
+// ==========================
+// CONFIGURAÇÃO
+// ==========================
+
+static const size_t   OTA_HEADER_SIZE      = 160;
+static const size_t   OTA_SIGNED_SIZE      = 80;    // bytes do cabeçalho cobertos pela assinatura
+static const size_t   OTA_SIG_MAX          = 72;
+static const size_t   OTA_INPUT_CHUNK      = 1024;  // leitura do HTTP
+static const size_t   OTA_WRITE_CHUNK      = 4096;  // um setor por gravação
+static const size_t   OTA_BASE_CHUNK       = 256;   // leitura da imagem em uso (delta)
+static const uint8_t  OTA_FORMAT_VERSION   = 1;
+static const uint8_t  OTA_KIND_FULL        = 0;
+static const uint8_t  OTA_KIND_DELTA       = 1;
+
+static const uint8_t  OTA_OP_END  = 0x00;
+static const uint8_t  OTA_OP_COPY = 0x01;
+static const uint8_t  OTA_OP_DIFF = 0x02;
+static const uint8_t  OTA_OP_DATA = 0x03;
+
+static const uint32_t      OTA_TASK_STACK       = 8192;
+static const UBaseType_t   OTA_TASK_PRIORITY    = 1;     // acima só da idle; Wi-Fi/lwIP no core 0 ficam na frente
+static const BaseType_t    OTA_TASK_CORE        = 0;     // o loop() roda no core 1
+static const uint16_t      OTA_HTTP_TIMEOUT_MS  = 15'000;
+static const uint8_t       OTA_MAX_RESUMES      = 8;     // retomadas (Range) por atualização
+static const unsigned long OTA_REBOOT_DELAY_MS  = 3'000; // tempo p/ o heartbeat "ready" sair
+
+// Chave pública dos pacotes: OTA_PUBLIC_KEY_PEM (ota_update.h)
+static const char OTA_PUBLIC_KEY[] PROGMEM = OTA_PUBLIC_KEY_PEM;
+static const bool OTA_KEY_CONFIGURED      = sizeof(OTA_PUBLIC_KEY) > 1;
+
+// ==========================
+// ESTADO (loop <-> task)
+// ==========================
+
+enum class OtaState : uint8_t {
+  IDLE,
+  DOWNLOADING,
+  READY,        // gravada e conferida: reinicia assim que o motor parar
+  UP_TO_DATE,   // pacote é a imagem que já está rodando
+  FAILED
+};
+
+struct OtaStatus {
+  OtaState    state;
+  uint8_t     kind;
+  uint32_t    received;   // bytes do pacote baixados
+  uint32_t    total;      // tamanho do pacote
+  uint32_t    written;    // bytes da imagem gerados
+  uint8_t     resumes;
+  const char* error;      // literal (nunca aponta para buffer)
+};
+
+static OtaStatus    status    = { OtaState::IDLE, 0, 0, 0, 0, 0, nullptr };
+static portMUX_TYPE otaMux    = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t otaTaskHandle = nullptr;
+
+static char jobUrl[OTA_URL_MAX + 1];
+static char lastJobUrl[OTA_URL_MAX + 1];   // o pedido retido volta a cada reconexão
+
+// Loop
+static bool          pendingVerify   = false;
+static OtaState      lastSeenState   = OtaState::IDLE;
+static unsigned long readyMillis     = 0;
+
+// ==========================
+// ESTADO (só a task)
+// ==========================
+
+struct PackageHeader {
+  uint8_t  kind;
+  uint8_t  windowLog2;
+  uint32_t imageSize;
+  uint32_t payloadSize;
+  uint8_t  imageSha[32];
+  uint8_t  baseSha[32];
+};
+
+// Tudo que a atualização precisa, num bloco só (alocado no início, liberado no fim)
+struct OtaWork {
+  tinfl_decompressor     inflater;
+  uint8_t                window[OTA_WINDOW_SIZE];  // janela do zlib = saída circular do tinfl
+  uint8_t                input[OTA_INPUT_CHUNK];
+  uint8_t                output[OTA_WRITE_CHUNK];
+  uint8_t                base[OTA_BASE_CHUNK];
+  uint8_t                header[OTA_HEADER_SIZE];
+  mbedtls_sha256_context sha;
+
+  size_t   outputLen;
+  uint32_t written;
+
+  // Operação de delta em andamento
+  uint8_t  op;          // OTA_OP_* (0xFF = lendo o código da próxima)
+  uint8_t  args[8];
+  uint8_t  argsHave;
+  uint8_t  argsNeed;
+  uint32_t opOffset;
+  uint32_t opRemaining;
+  size_t   baseLen;     // bytes válidos em base[] (DIFF)
+  size_t   basePos;
+  bool     deltaDone;
+};
+
+static OtaWork*                work      = nullptr;
+static const esp_partition_t*  running   = nullptr;
+static esp_ota_handle_t        otaHandle = 0;
+
+static HTTPClient       http;
+static WiFiClient       plainClient;
+static WiFiClientSecure secureClient;
+static WiFiClient*      stream     = nullptr;
+static uint32_t         downloaded = 0;
+
+// ==========================
+// STATUS
+// ==========================
+
+static void setState(OtaState state, const char* error = nullptr) {
+  portENTER_CRITICAL(&otaMux);
+  status.state = state;
+  status.error = error;
+  portEXIT_CRITICAL(&otaMux);
+}
+
+static bool fail(const char* why) {
+  Serial.print("[OTA] Falha: ");
+  Serial.println(why);
+  setState(OtaState::FAILED, why);
+  return false;
+}
+
+static void updateProgress() {
+  portENTER_CRITICAL(&otaMux);
+  status.received = downloaded;
+  status.written  = work->written;
+  portEXIT_CRITICAL(&otaMux);
+}
+
+// ==========================
+// DOWNLOAD (HTTP com retomada)
+// ==========================
+
+static bool httpOpen(uint32_t offset) {
+  http.end();
+  stream = nullptr;
+  http.setTimeout(OTA_HTTP_TIMEOUT_MS);
+
+  bool ok;
+  if (strncmp(jobUrl, "https://", 8) == 0) {
+    // Quem garante o conteúdo é a assinatura do pacote, não o TLS
+    secureClient.setInsecure();
+    ok = http.begin(secureClient, jobUrl);
+  } else {
+    ok = http.begin(plainClient, jobUrl);
+  }
+  if (!ok) {
+    return false;
+  }
+
+  if (offset > 0) {
+    char range[32];
+    snprintf(range, sizeof(range), "bytes=%lu-", (unsigned long)offset);
+    http.addHeader("Range", range);
+  }
+
+  int code = http.GET();
+  if (code != (offset > 0 ? 206 : 200)) {
+    Serial.print("[OTA] HTTP ");
+    Serial.println(code);
+    return false;
+  }
+  stream = http.getStreamPtr();
+  return stream != nullptr;
+}
+
+// Lê o que tiver chegado (até 'capacity'); 0 se a conexão caiu ou parou de mandar
+static size_t httpRead(uint8_t* buf, size_t capacity) {
+  if (stream == nullptr) {
+    return 0;
+  }
+  unsigned long start = millis();
+  while (millis() - start < OTA_HTTP_TIMEOUT_MS) {
+    int available = stream->available();
+    if (available > 0) {
+      int n = stream->read(buf, min((size_t)available, capacity));
+      return n > 0 ? (size_t)n : 0;
+    }
+    if (!stream->connected()) {
+      return 0;
+    }
+    vTaskDelay(pdMS_TO_TICKS(5));
+  }
+  return 0;
+}
+
+// Próximos bytes do pacote; se a conexão cair, retoma do ponto onde parou
+static size_t fetch(uint8_t* buf, size_t capacity) {
+  for (;;) {
+    size_t n = httpRead(buf, capacity);
+    if (n > 0) {
+      downloaded += n;
+      return n;
+    }
+    if (status.resumes >= OTA_MAX_RESUMES) {
+      return 0;
+    }
+    portENTER_CRITICAL(&otaMux);
+    status.resumes++;
+    portEXIT_CRITICAL(&otaMux);
+    Serial.print("[OTA] Conexão caiu, retomando em ");
+    Serial.println(downloaded);
+    vTaskDelay(pdMS_TO_TICKS(1000UL * status.resumes));
+    httpOpen(downloaded);
+  }
+}
+
+static bool readExact(uint8_t* buf, size_t length) {
+  size_t have = 0;
+  while (have < length) {
+    size_t n = fetch(buf + have, length - have);
+    if (n == 0) {
+      return false;
+    }
+    have += n;
+  }
+  return true;
+}
+
+// ==========================
+// CABEÇALHO / ASSINATURA
+// ==========================
+
+static uint32_t readU32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static bool parseHeader(const uint8_t* h, PackageHeader& out) {
+  if (memcmp(h, "VOTA", 4) != 0 || h[4] != OTA_FORMAT_VERSION) {
+    return fail("não é um pacote VOTA v1");
+  }
+  out.kind        = h[5];
+  out.windowLog2  = h[6];
+  out.imageSize   = readU32(h + 8);
+  out.payloadSize = readU32(h + 12);
+  memcpy(out.imageSha, h + 16, 32);
+  memcpy(out.baseSha,  h + 48, 32);
+
+  if (out.kind != OTA_KIND_FULL && out.kind != OTA_KIND_DELTA) {
+    return fail("tipo de pacote desconhecido");
+  }
+  if (out.windowLog2 < 8 || (1UL << out.windowLog2) > OTA_WINDOW_SIZE) {
+    return fail("janela zlib maior que a do firmware");
+  }
+  return true;
+}
+
+static bool verifySignature(const uint8_t* h) {
+  size_t sigLen = h[OTA_SIGNED_SIZE];
+  if (sigLen == 0 || sigLen > OTA_SIG_MAX) {
+    return false;
+  }
+
+  uint8_t hash[32];
+  mbedtls_sha256_context sha;
+  mbedtls_sha256_init(&sha);
+  mbedtls_sha256_starts(&sha, 0);
+  mbedtls_sha256_update(&sha, h, OTA_SIGNED_SIZE);
+  mbedtls_sha256_finish(&sha, hash);
+  mbedtls_sha256_free(&sha);
+
+  mbedtls_pk_context pk;
+  mbedtls_pk_init(&pk);
+  bool ok = mbedtls_pk_parse_public_key(&pk, (const unsigned char*)OTA_PUBLIC_KEY, sizeof(OTA_PUBLIC_KEY)) == 0 &&
+            mbedtls_pk_verify(&pk, MBEDTLS_MD_SHA256, hash, sizeof(hash), h + OTA_SIGNED_SIZE + 1, sigLen) == 0;
+  mbedtls_pk_free(&pk);
+  return ok;
+}
+
+// ==========================
+// SAÍDA (partição inativa)
+// ==========================
+
+static bool flushOutput() {
+  if (work->outputLen == 0) {
+    return true;
+  }
+  // Gravar/apagar flash desliga o cache dos dois cores: não no meio de um movimento
+  while (stepperIsMoving()) {
+    vTaskDelay(pdMS_TO_TICKS(50));
+  }
+  if (esp_ota_write(otaHandle, work->output, work->outputLen) != ESP_OK) {
+    return fail("gravação na flash");
+  }
+  work->outputLen = 0;
+  return true;
+}
+
+static bool emit(const uint8_t* data, size_t length, uint32_t imageSize) {
+  if (work->written + length > imageSize) {
+    return fail("imagem maior que o anunciado");
+  }
+  mbedtls_sha256_update(&work->sha, data, length);
+  work->written += length;
+
+  while (length > 0) {
+    size_t n = min(length, OTA_WRITE_CHUNK - work->outputLen);
+    memcpy(work->output + work->outputLen, data, n);
+    work->outputLen += n;
+    data   += n;
+    length -= n;
+    if (work->outputLen == OTA_WRITE_CHUNK && !flushOutput()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// ==========================
+// DELTA (operações em streaming)
+// ==========================
+
+static bool readBase(uint32_t offset, size_t length) {
+  if (offset + length > running->size) {
+    return fail("delta lê fora da imagem em uso");
+  }
+  return esp_partition_read(running, offset, work->base, length) == ESP_OK || fail("leitura da imagem em uso");
+}
+
+static bool startOp(uint32_t imageSize) {
+  switch (work->op) {
+    case OTA_OP_COPY:
+      // Não tem bytes no fluxo: copia tudo agora
+      while (work->opRemaining > 0) {
+        size_t n = min((size_t)work->opRemaining, OTA_BASE_CHUNK);
+        if (!readBase(work->opOffset, n) || !emit(work->base, n, imageSize)) {
+          return false;
+        }
+        work->opOffset    += n;
+        work->opRemaining -= n;
+      }
+      work->op = 0xFF;
+      return true;
+    case OTA_OP_DIFF:
+      work->baseLen = work->basePos = 0;
+      return true;
+    default:
+      return true;
+  }
+}
+
+static bool feedDelta(const uint8_t* data, size_t length, uint32_t imageSize) {
+  while (length > 0) {
+    if (work->deltaDone) {
+      return fail("dados depois do END do delta");
+    }
+
+    // Código da operação
+    if (work->op == 0xFF) {
+      work->op       = *data++;
+      length--;
+      work->argsHave = 0;
+      switch (work->op) {
+        case OTA_OP_END:  work->deltaDone = true; continue;
+        case OTA_OP_COPY:
+        case OTA_OP_DIFF: work->argsNeed = 8; break;
+        case OTA_OP_DATA: work->argsNeed = 4; break;
+        default:          return fail("operação de delta inválida");
+      }
+      continue;
+    }
+
+    // Argumentos (offset/tamanho)
+    if (work->argsHave < work->argsNeed) {
+      work->args[work->argsHave++] = *data++;
+      length--;
+      if (work->argsHave == work->argsNeed) {
+        if (work->op == OTA_OP_DATA) {
+          work->opRemaining = readU32(work->args);
+        } else {
+          work->opOffset    = readU32(work->args);
+          work->opRemaining = readU32(work->args + 4);
+        }
+        if (!startOp(imageSize)) {
+          return false;
+        }
+        if (work->op != 0xFF && work->opRemaining == 0) {
+          work->op = 0xFF;
+        }
+      }
+      continue;
+    }
+
+    // Bytes da operação (DATA: literais; DIFF: somados à imagem em uso)
+    size_t n = min(length, (size_t)work->opRemaining);
+    if (work->op == OTA_OP_DATA) {
+      if (!emit(data, n, imageSize)) {
+        return false;
+      }
+    } else {
+      if (work->basePos == work->baseLen) {
+        work->baseLen = min((size_t)work->opRemaining, OTA_BASE_CHUNK);
+        work->basePos = 0;
+        if (!readBase(work->opOffset, work->baseLen)) {
+          return false;
+        }
+        work->opOffset += work->baseLen;
+      }
+      n = min(n, work->baseLen - work->basePos);
+      uint8_t* b = work->base + work->basePos;
+      for (size_t i = 0; i < n; i++) {
+        b[i] += data[i];
+      }
+      if (!emit(b, n, imageSize)) {
+        return false;
+      }
+      work->basePos += n;
+    }
+    data   += n;
+    length -= n;
+    work->opRemaining -= n;
+    if (work->opRemaining == 0) {
+      work->op = 0xFF;
+    }
+  }
+  return true;
+}
+
+// ==========================
+// DESCOMPRESSÃO
+// ==========================
+
+static bool streamPayload(const PackageHeader& hdr) {
+  tinfl_init(&work->inflater);
+  size_t   windowPos   = 0;
+  uint32_t payloadRead = 0;
+  size_t   inPos = 0, inLen = 0;
+
+  for (;;) {
+    if (inPos == inLen && payloadRead < hdr.payloadSize) {
+      size_t want = min(OTA_INPUT_CHUNK, (size_t)(hdr.payloadSize - payloadRead));
+      inLen = fetch(work->input, want);
+      if (inLen == 0) {
+        return fail("download interrompido");
+      }
+      inPos        = 0;
+      payloadRead += inLen;
+      updateProgress();
+    }
+
+    size_t inBytes  = inLen - inPos;
+    size_t outBytes = OTA_WINDOW_SIZE - windowPos;
+    mz_uint32 flags = TINFL_FLAG_PARSE_ZLIB_HEADER |
+                      (payloadRead < hdr.payloadSize ? TINFL_FLAG_HAS_MORE_INPUT : 0);
+    tinfl_status st = tinfl_decompress(&work->inflater, work->input + inPos, &inBytes,
+                                       work->window, work->window + windowPos, &outBytes, flags);
+    inPos += inBytes;
+
+    if (outBytes > 0) {
+      const uint8_t* out = work->window + windowPos;
+      bool ok = hdr.kind == OTA_KIND_DELTA ? feedDelta(out, outBytes, hdr.imageSize)
+                                           : emit(out, outBytes, hdr.imageSize);
+      if (!ok) {
+        return false;
+      }
+      windowPos = (windowPos + outBytes) & (OTA_WINDOW_SIZE - 1);
+    }
+
+    if (st == TINFL_STATUS_DONE) {
+      break;
+    }
+    if (st < 0) {
+      return fail("fluxo zlib inválido");
+    }
+    if (st == TINFL_STATUS_NEEDS_MORE_INPUT && payloadRead >= hdr.payloadSize && inPos == inLen) {
+      return fail("fluxo zlib truncado");
+    }
+  }
+
+  if (hdr.kind == OTA_KIND_DELTA && !work->deltaDone) {
+    return fail("delta sem END");
+  }
+  return flushOutput();
+}
+
+// ==========================
+// TASK
+// ==========================
+
+static bool runUpdate() {
+  downloaded = 0;
+  if (!httpOpen(0) || !readExact(work->header, OTA_HEADER_SIZE)) {
+    return fail("download do cabeçalho");
+  }
+
+  PackageHeader hdr;
+  if (!parseHeader(work->header, hdr)) {
+    return false;
+  }
+  if (!OTA_KEY_CONFIGURED) {
+    return fail("chave pública do OTA não configurada");
+  }
+  if (!verifySignature(work->header)) {
+    return fail("assinatura inválida");
+  }
+  portENTER_CRITICAL(&otaMux);
+  status.kind  = hdr.kind;
+  status.total    = OTA_HEADER_SIZE + hdr.payloadSize;
+  status.received = downloaded;
+  portEXIT_CRITICAL(&otaMux);
+
+  // Já está rodando essa imagem? (o pedido fica retido e volta depois do reboot)
+  running = esp_ota_get_running_partition();
+  uint8_t runningSha[32];
+  if (esp_partition_get_sha256(running, runningSha) != ESP_OK) {
+    return fail("SHA-256 da imagem em uso");
+  }
+  if (memcmp(runningSha, hdr.imageSha, 32) == 0) {
+    Serial.println("[OTA] Imagem já instalada.");
+    setState(OtaState::UP_TO_DATE);
+    return true;
+  }
+  if (hdr.kind == OTA_KIND_DELTA && memcmp(runningSha, hdr.baseSha, 32) != 0) {
+    return fail("delta feito para outra imagem");
+  }
+
+  const esp_partition_t* target = esp_ota_get_next_update_partition(nullptr);
+  if (target == nullptr || hdr.imageSize > target->size) {
+    return fail("imagem não cabe na partição");
+  }
+  // Gravação sequencial: cada setor é apagado quando chega a vez dele
+  if (esp_ota_begin(target, OTA_WITH_SEQUENTIAL_WRITES, &otaHandle) != ESP_OK) {
+    return fail("esp_ota_begin");
+  }
+
+  Serial.print("[OTA] Gravando ");
+  Serial.print(hdr.kind == OTA_KIND_DELTA ? "delta" : "imagem completa");
+  Serial.print(" em ");
+  Serial.println(target->label);
+
+  mbedtls_sha256_starts(&work->sha, 0);
+  work->outputLen = 0;
+  work->written   = 0;
+  work->op        = 0xFF;
+  work->deltaDone = false;
+
+  bool streamed = streamPayload(hdr);
+  updateProgress();
+  if (!streamed) {
+    esp_ota_abort(otaHandle);
+    return false;
+  }
+
+  uint8_t sha[32];
+  mbedtls_sha256_finish(&work->sha, sha);
+  if (work->written != hdr.imageSize || memcmp(sha, hdr.imageSha, 32) != 0) {
+    esp_ota_abort(otaHandle);
+    return fail("SHA-256 da imagem gravada não confere");
+  }
+  if (esp_ota_end(otaHandle) != ESP_OK) {
+    return fail("imagem recusada pelo esp_ota_end");
+  }
+  if (esp_ota_set_boot_partition(target) != ESP_OK) {
+    return fail("troca da partição de boot");
+  }
+
+  Serial.println("[OTA] Imagem conferida; reinicia com o motor parado.");
+  setState(OtaState::READY);
+  return true;
+}
+
+static void otaTask(void*) {
+  runUpdate();
+
+  http.end();
+  stream = nullptr;
+  // Iniciado junto com o bloco (otaHandleJob): vale para qualquer saída do runUpdate
+  mbedtls_sha256_free(&work->sha);
+  free(work);
+  work = nullptr;
+
+  otaTaskHandle = nullptr;
+  vTaskDelete(nullptr);
+}
+
+// ==========================
+// API
+// ==========================
+
+// O core do Arduino confirma a imagem nova sozinho no boot, a não ser que
+// esta função diga o contrário: quem confirma aqui é o otaLoop()
+extern "C" bool verifyRollbackLater() {
+  return true;
+}
+
+void otaInit() {
+  if (!OTA_KEY_CONFIGURED) {
+    Serial.println("[OTA] OTA_PUBLIC_KEY_PEM não definida: pacotes serão recusados.");
+  }
+  const esp_partition_t* part = esp_ota_get_running_partition();
+  esp_ota_img_states_t state;
+  if (esp_ota_get_state_partition(part, &state) == ESP_OK && state == ESP_OTA_IMG_PENDING_VERIFY) {
+    pendingVerify = true;
+    Serial.println("[OTA] Imagem nova em teste (confirma quando o MQTT conectar).");
+  }
+}
+
+void otaLoop() {
+  // Sem confirmação, o bootloader volta para a imagem anterior no próximo reset
+  if (pendingVerify && mqttIsConnected()) {
+    esp_ota_mark_app_valid_cancel_rollback();
+    pendingVerify = false;
+    Serial.println("[OTA] Imagem nova confirmada.");
+  }
+
+  portENTER_CRITICAL(&otaMux);
+  OtaState state = status.state;
+  portEXIT_CRITICAL(&otaMux);
+
+  // Mudou de estado: heartbeat completo na hora (o app acompanha)
+  if (state != lastSeenState) {
+    lastSeenState = state;
+    readyMillis   = millis();
+    telemetryRequestFullReport();
+    mqttRequestHeartbeat();
+  }
+
+  if (state == OtaState::READY && millis() - readyMillis >= OTA_REBOOT_DELAY_MS && !stepperIsMoving()) {
+    Serial.println("[OTA] Reiniciando na imagem nova...");
+    ESP.restart();
+  }
+}
+
+bool otaHandleJob(const uint8_t* payload, size_t length) {
+  if (length == 0 || otaBusy()) {
+    return false;  // retido apagado, ou já atualizando
+  }
+
+  // {"url":"..."}
+  char doc[OTA_URL_MAX + 16];
+  size_t n = min(length, sizeof(doc) - 1);
+  memcpy(doc, payload, n);
+  doc[n] = '\0';
+  const char* start = strstr(doc, "\"url\":\"");
+  if (start == nullptr) {
+    Serial.println("[OTA] Pedido sem url (ignorado).");
+    return false;
+  }
+  start += 7;
+  const char* end = strchr(start, '"');
+  if (end == nullptr || (size_t)(end - start) > OTA_URL_MAX) {
+    Serial.println("[OTA] url inválida (ignorado).");
+    return false;
+  }
+  memcpy(jobUrl, start, end - start);
+  jobUrl[end - start] = '\0';
+
+  // O pedido retido chega de novo a cada reconexão: uma tentativa por boot
+  if (strcmp(jobUrl, lastJobUrl) == 0) {
+    return false;
+  }
+  strcpy(lastJobUrl, jobUrl);
+
+  // Antes de criar a task: no core 0 ela já pode estar rodando na volta
+  portENTER_CRITICAL(&otaMux);
+  status = { OtaState::DOWNLOADING, 0, 0, 0, 0, 0, nullptr };
+  portEXIT_CRITICAL(&otaMux);
+
+  // Bloco de trabalho e task existem só durante a atualização. Zerado e com
+  // o SHA-256 iniciado antes da task: otaTask libera tudo em qualquer saída
+  memMonitorAllowAllocations(true);
+  work = (OtaWork*)calloc(1, sizeof(OtaWork));
+  if (work != nullptr) {
+    mbedtls_sha256_init(&work->sha);
+  }
+  bool started = work != nullptr &&
+                 xTaskCreatePinnedToCore(otaTask, "ota", OTA_TASK_STACK, nullptr, OTA_TASK_PRIORITY,
+                                         &otaTaskHandle, OTA_TASK_CORE) == pdPASS;
+  memMonitorAllowAllocations(false);
+  if (!started) {
+    if (work != nullptr) {
+      mbedtls_sha256_free(&work->sha);
+    }
+    free(work);
+    work = nullptr;
+    otaTaskHandle = nullptr;
+    return fail("sem memória para a atualização");
+  }
+
+  Serial.print("[OTA] Baixando ");
+  Serial.println(jobUrl);
+  return true;
+}
+
+bool otaBusy() {
+  return otaTaskHandle != nullptr;
+}
+
+int otaReportJson(char* out, size_t capacity) {
+  portENTER_CRITICAL(&otaMux);
+  OtaStatus s = status;
+  portEXIT_CRITICAL(&otaMux);
+
+  int n;
+  if (s.state == OtaState::IDLE) {
+    n = snprintf(out, capacity, "null");
+  } else {
+    static const char* const STATE_NAMES[] = { "idle", "download", "ready", "up_to_date", "failed" };
+    n = snprintf(out, capacity,
+                 "{\"state\":\"%s\",\"kind\":\"%s\",\"rx\":%lu,\"total\":%lu,\"written\":%lu,\"resumes\":%u,\"error\":",
+                 STATE_NAMES[(int)s.state], s.kind == OTA_KIND_DELTA ? "delta" : "full",
+                 (unsigned long)s.received, (unsigned long)s.total, (unsigned long)s.written, (unsigned)s.resumes);
+    if (n >= 0 && (size_t)n < capacity) {
+      int m = s.error ? snprintf(out + n, capacity - n, "\"%s\"}", s.error)
+                      : snprintf(out + n, capacity - n, "null}");
+      n = m < 0 ? -1 : n + m;
+    }
+  }
+  if (n < 0 || (size_t)n >= capacity) {
+    return 0;
+  }
+  return n;
+}
+
+#else
+
+void otaInit() {}
+void otaLoop() {}
+bool otaHandleJob(const uint8_t*, size_t) { return false; }
+bool otaBusy() { return false; }
+
+int otaReportJson(char* out, size_t capacity) {
+  int n = snprintf(out, capacity, "null");
+  return (n < 0 || (size_t)n >= capacity) ? 0 : n;
+}
+
+#endif
@@ -0,0 +1,68 @@
+#pragma once
+#include <Arduino.h>
+
+// ==========================================================
+// ATUALIZAÇÃO OTA (imagem comprimida ou delta)
+// ==========================================================
+//
+// O pedido chega (retido) em casa/<id>/ota: {"url":"http://.../novo.vota"}.
+// O pacote (gerado por backend/tools/ota_pack.py) é baixado por HTTP(S) e
+// gravado direto na partição OTA inativa, sem guardar a imagem em RAM:
+//
+//   0   "VOTA", u8 versão, u8 tipo (0 = completa, 1 = delta), u8 log2 da
+//       janela zlib, u8 reservado
+//   8   u32 tamanho da imagem, u32 tamanho do fluxo comprimido
+//   16  SHA-256 da imagem nova, SHA-256 da imagem base (delta)
+//   80  u8 tamanho da assinatura, assinatura ECDSA P-256 (DER) dos bytes 0..79
+//   160 fluxo zlib
+//
+// Completa: o fluxo descomprimido é a imagem. Delta: operações contra a
+// partição em uso (COPY off len / DIFF off len bytes / DATA len bytes / END).
+//
+// Memória: janela de descompressão de OTA_WINDOW_SIZE + buffers de entrada
+// e de gravação, num bloco fixo alocado só durante a atualização.
+// Assinatura e imagem base são conferidas antes de apagar qualquer setor; o
+// SHA-256 da imagem gravada, antes de trocar a partição de boot.
+//
+// Roda numa task de prioridade baixa no core 0 (o loop, com motor e
+// controlador, segue no core 1). Gravar/apagar flash pausa o cache dos dois
+// cores, então a gravação espera o motor parar; o download pode seguir.
+// Conexão que cai é retomada do ponto onde parou (HTTP Range).
+//
+// Desliga com OTA_ENABLED = 0 (não inclui HTTPClient nem mbedtls).
+
+#ifndef OTA_ENABLED
+#define OTA_ENABLED 1
+#endif
+
+// Chave pública (ECDSA P-256, PEM) que assina os pacotes. Não fica no
+// repositório: "python -m tools.ota_pack keygen --header <sketch>/ota_key.h"
+// gera o par e escreve o ota_key.h (fora do git) com OTA_PUBLIC_KEY_PEM;
+// também dá para passar -DOTA_PUBLIC_KEY_PEM=... no build. Sem chave, todo
+// pacote é recusado ("chave pública do OTA não configurada").
+#if __has_include("ota_key.h")
+#include "ota_key.h"
+#endif
+#ifndef OTA_PUBLIC_KEY_PEM
+#define OTA_PUBLIC_KEY_PEM ""
+#endif
+
+static const size_t   OTA_WINDOW_SIZE = 8192;  // potência de 2; pacotes com janela maior são recusados
+static const size_t   OTA_URL_MAX     = 160;
+
+// Chamar no setup (confere se a imagem atual ainda está em teste)
+void otaInit();
+
+// Chamar no loop: reinicia depois de uma atualização (com o motor parado) e
+// confirma a imagem nova quando o MQTT conecta
+void otaLoop();
+
+// Pedido vindo de casa/<id>/ota. Retorna true se começou uma atualização.
+bool otaHandleJob(const uint8_t* payload, size_t length);
+
+bool otaBusy();
+
+// Escreve {"state":"..","kind":"..","rx":..,"total":..,"written":..,
+// "resumes":..,"error":".."} (ou null se nenhuma atualização desde o boot).
+// Retorna o nº de caracteres (0 se não coube).
+int otaReportJson(char* out, size_t capacity);
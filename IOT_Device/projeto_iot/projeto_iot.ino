@@ -4,7 +4,15 @@
 #include "stepper_motor.h"
 #include "varal_controller.h"
 #include "dht11_sensor.h"
+#include "rain_predictor.h"
 #include "mqtt_manager.h"
+#include "event_bus.h"
+#include "flight_recorder.h"
+#include "loop_profiler.h"
+#include "mem_monitor.h"
+#include "local_server.h"
+#include "rule_engine.h"
+#include "ota_update.h"
 
 void setup() {
   Serial.begin(115200);
@@ -13,13 +21,22 @@ void setup() {
   Serial.println();
   Serial.println("=== Inicializando ESP32 ===");
 
+  // --- Memória (antes de qualquer alocação do setup) ---
+  memMonitorInit();
+
+  // --- Caixa-preta (antes de tudo, pra registrar o boot) ---
+  flightRecorderInit();
+
   // --- Conectividade ---
   initWiFiManager();
   mqttInit();          // MQTT + AWS IoT Core
+  localServerInit();   // HTTP/WebSocket na rede local (mDNS)
+  otaInit();           // imagem nova ainda em teste?
 
   // --- Sensores ---
   rainSensorInit();
   dht11Init();
+  rainPredictorInit();
 
   // --- Atuadores ---
   stepperInit();
@@ -27,23 +44,49 @@ void setup() {
   stepperHome();
 
   // --- Regras de negócio ---
+  ruleEngineInit();    // programa de regras salvo na NVS + NTP
   varalControllerInit();
+
+  // Todos os buffers já existem: daqui pra frente o loop não aloca
+  memMonitorArmSteadyState();
 }
 
 void loop() {
+  // Cada etapa é cronometrada (ciclos) e vai no heartbeat como "loop_us"
+  uint32_t inicio = loopProfilerStart();
+  uint32_t t      = inicio;
+
   // Infraestrutura
   handleWiFi();
+  t = loopProfilerMark(LoopSection::WIFI, t);
   mqttLoop();       // mantém conexão MQTT + heartbeat
+  otaLoop();        // confirma imagem nova / reinicia depois de atualizar
+  t = loopProfilerMark(LoopSection::MQTT, t);
+  localServerLoop(); // comandos/eventos direto na rede local
+  t = loopProfilerMark(LoopSection::LOCAL, t);
 
   // Sensores
   rainSensorLoop();
   dht11Loop();
+  t = loopProfilerMark(LoopSection::SENSORS, t);
 
   // Atuadores
   stepperLoop();
+  t = loopProfilerMark(LoopSection::STEPPER, t);
+
+  // Entrega os eventos (chuva, modo, fim de movimento, link) na hora
+  eventBusDispatch();
+  t = loopProfilerMark(LoopSection::EVENTS, t);
 
   // Lógica de negócio
   varalControllerLoop();
+  t = loopProfilerMark(LoopSection::CONTROLLER, t);
+
+  // Caixa-preta (grava o buffer na flash de tempos em tempos)
+  flightRecorderLoop();
+  loopProfilerMark(LoopSection::RECORDER, t);
+
+  loopProfilerEndLoop(inicio);
 
   // nada de delayzão :)
 }
@@ -0,0 +1,202 @@
+#include <Arduino.h>
+#include <math.h>
+#include "rain_predictor.h"
+
+// ==========================
+// CONFIGURAÇÃO
+// ==========================
+
+// Suavização exponencial (EWMA) das leituras cruas do DHT11
+static const float EWMA_ALPHA = 0.2f;
+
+// A regressão usa um ponto da EWMA a cada 30 s, numa janela de 20 pontos
+// (~10 min). Leituras do DHT11 (2 s) entre um ponto e outro só alimentam a EWMA.
+static const unsigned long TREND_SAMPLE_INTERVAL_MS = 30'000;
+static const int           TREND_WINDOW             = 20;
+static const int           TREND_MIN_POINTS         = 6;  // ~3 min antes de opinar
+
+// Constantes da fórmula de Magnus (ponto de orvalho)
+static const float MAGNUS_B = 17.62f;
+static const float MAGNUS_C = 243.12f;
+
+// Limiares com histerese (ajustar olhando o Serial em dias de chuva)
+static const float HUMIDITY_ON       = 80.0f; // % mínima para considerar chuva
+static const float HUMIDITY_OFF      = 75.0f;
+static const float SLOPE_ON          = 0.4f;  // %/min subindo rápido
+static const float SPREAD_ON         = 2.0f;  // °C, ar quase saturado
+static const float SPREAD_OFF        = 3.5f;
+
+// ==========================
+// ESTADO INTERNO
+// ==========================
+
+static bool  hasEwma      = false;
+static float humidityEwma = NAN;
+static float tempEwma     = NAN;
+
+// Janela circular da regressão (y = umidade suavizada, x = índice 0..n-1)
+static float trendBuffer[TREND_WINDOW];
+static int   trendHead  = 0;   // posição do ponto mais antigo
+static int   trendCount = 0;
+static int   slidesSinceRecompute = 0;
+
+// Somatórios incrementais: Σy e Σ(x·y)
+static float sumY  = 0.0f;
+static float sumXY = 0.0f;
+
+static unsigned long lastTrendMillis = 0;
+
+static float humiditySlope  = 0.0f; // %/min
+static float dewPointSpread = NAN;  // °C
+static bool  rainLikely     = false;
+
+// ==========================
+// FUNÇÕES INTERNAS
+// ==========================
+
+static float computeDewPoint(float tempC, float humidity) {
+  if (humidity <= 0.0f) {
+    humidity = 0.1f;
+  }
+  float gamma = logf(humidity / 100.0f) + (MAGNUS_B * tempC) / (MAGNUS_C + tempC);
+  return (MAGNUS_C * gamma) / (MAGNUS_B - gamma);
+}
+
+// Refaz os somatórios a partir do buffer (evita acumular erro de float).
+// Só roda uma vez a cada TREND_WINDOW deslizes -> custo amortizado O(1).
+static void recomputeSums() {
+  sumY  = 0.0f;
+  sumXY = 0.0f;
+  for (int i = 0; i < trendCount; i++) {
+    float y = trendBuffer[(trendHead + i) % TREND_WINDOW];
+    sumY  += y;
+    sumXY += (float)i * y;
+  }
+  slidesSinceRecompute = 0;
+}
+
+static void addTrendPoint(float y) {
+  if (trendCount < TREND_WINDOW) {
+    int idx = (trendHead + trendCount) % TREND_WINDOW;
+    trendBuffer[idx] = y;
+    sumXY += (float)trendCount * y;
+    sumY  += y;
+    trendCount++;
+    return;
+  }
+
+  // Janela cheia: remove o mais antigo (x=0) e todos os x descem uma posição.
+  // Σ(x·y)' = Σ(x·y) - (Σy - y0) + (n-1)·yNovo
+  float oldest = trendBuffer[trendHead];
+  sumXY = sumXY - (sumY - oldest) + (float)(TREND_WINDOW - 1) * y;
+  sumY  = sumY - oldest + y;
+
+  trendBuffer[trendHead] = y;
+  trendHead = (trendHead + 1) % TREND_WINDOW;
+
+  if (++slidesSinceRecompute >= TREND_WINDOW) {
+    recomputeSums();
+  }
+}
+
+// Inclinação da reta de mínimos quadrados, em unidades por ponto
+static float computeSlopePerPoint() {
+  if (trendCount < 2) {
+    return 0.0f;
+  }
+  float n    = (float)trendCount;
+  float sumX  = n * (n - 1.0f) / 2.0f;
+  float sumXX = (n - 1.0f) * n * (2.0f * n - 1.0f) / 6.0f;
+  float denom = n * sumXX - sumX * sumX;
+  if (denom == 0.0f) {
+    return 0.0f;
+  }
+  return (n * sumXY - sumX * sumY) / denom;
+}
+
+static void updateRainLikely() {
+  if (trendCount < TREND_MIN_POINTS) {
+    rainLikely = false;
+    return;
+  }
+
+  if (!rainLikely) {
+    bool subindoRapido = humiditySlope >= SLOPE_ON;
+    bool quaseSaturado = dewPointSpread <= SPREAD_ON;
+    if (humidityEwma >= HUMIDITY_ON && (subindoRapido || quaseSaturado)) {
+      rainLikely = true;
+      Serial.print("[PREDICT] Chuva provável | Umid: ");
+      Serial.print(humidityEwma);
+      Serial.print(" % | Tendência: ");
+      Serial.print(humiditySlope);
+      Serial.print(" %/min | Spread: ");
+      Serial.print(dewPointSpread);
+      Serial.println(" °C");
+    }
+  } else {
+    bool secando = humiditySlope <= 0.0f && dewPointSpread >= SPREAD_OFF;
+    if (humidityEwma < HUMIDITY_OFF || secando) {
+      rainLikely = false;
+      Serial.println("[PREDICT] Tendência de chuva desfeita.");
+    }
+  }
+}
+
+// ==========================
+// FUNÇÕES PÚBLICAS
+// ==========================
+
+void rainPredictorInit() {
+  hasEwma       = false;
+  humidityEwma  = NAN;
+  tempEwma      = NAN;
+  trendHead     = 0;
+  trendCount    = 0;
+  slidesSinceRecompute = 0;
+  sumY          = 0.0f;
+  sumXY         = 0.0f;
+  lastTrendMillis = 0;
+  humiditySlope  = 0.0f;
+  dewPointSpread = NAN;
+  rainLikely     = false;
+}
+
+void rainPredictorAddSample(float tempC, float humidity, unsigned long nowMs) {
+  if (!hasEwma) {
+    humidityEwma = humidity;
+    tempEwma     = tempC;
+    hasEwma      = true;
+    lastTrendMillis = nowMs - TREND_SAMPLE_INTERVAL_MS; // primeiro ponto já entra
+  } else {
+    humidityEwma += EWMA_ALPHA * (humidity - humidityEwma);
+    tempEwma     += EWMA_ALPHA * (tempC - tempEwma);
+  }
+
+  dewPointSpread = tempEwma - computeDewPoint(tempEwma, humidityEwma);
+
+  if (nowMs - lastTrendMillis < TREND_SAMPLE_INTERVAL_MS) {
+    return;
+  }
+  lastTrendMillis = nowMs;
+
+  addTrendPoint(humidityEwma);
+  humiditySlope = computeSlopePerPoint() * (60'000.0f / (float)TREND_SAMPLE_INTERVAL_MS);
+
+  updateRainLikely();
+}
+
+bool rainPredictorIsRainLikely() {
+  return rainLikely;
+}
+
+float rainPredictorGetHumidityEwma() {
+  return humidityEwma;
+}
+
+float rainPredictorGetHumiditySlope() {
+  return humiditySlope;
+}
+
+float rainPredictorGetDewPointSpread() {
+  return dewPointSpread;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+// Previsão de chuva a partir da tendência de umidade/temperatura do DHT11.
+// Tudo é calculado de forma incremental (O(1) por amostra) e com
+// memória fixa, para o varal conseguir fechar ANTES da placa molhar.
+
+// Inicializa / zera as estatísticas
+void rainPredictorInit();
+
+// Alimenta com uma leitura válida do DHT11 (chamado pelo dht11Loop)
+void rainPredictorAddSample(float tempC, float humidity, unsigned long nowMs);
+
+// Sinal "chuva provável" (com histerese)
+bool rainPredictorIsRainLikely();
+
+// Estatísticas atuais (para debug / telemetria)
+float rainPredictorGetHumidityEwma();     // %
+float rainPredictorGetHumiditySlope();    // % por minuto
+float rainPredictorGetDewPointSpread();   // °C (temperatura - ponto de orvalho)
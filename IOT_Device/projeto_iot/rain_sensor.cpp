@@ -1,5 +1,8 @@
 #include <Arduino.h>
 #include "rain_sensor.h"
+#include "sensor_registry.h"
+#include "event_bus.h"
+#include "flight_recorder.h"
 
 // ==========================
 // CONFIGURAÇÃO DE PINOS
@@ -14,15 +17,20 @@ static const int RAIN_DIGITAL_PIN = 25;  // TODO: troque conforme sua ligação
 // Intervalo entre leituras (ms)
 static const unsigned long RAIN_READ_INTERVAL_MS = 1000; // 1 segundo
 
+// Amostras guardadas no histórico do sensor (1 por segundo -> 1 min)
+static const size_t RAIN_HISTORY = 60;
+
 // ==========================
 // ESTADO INTERNO
 // ==========================
 
-static unsigned long lastReadMillis = 0;
+struct RainReading {
+  int  analog;
+  bool digital;
+};
 
-static int        lastAnalogValue   = 0;
-static bool       lastDigitalValue  = false;
-static RainLevel  lastLevel         = RainLevel::NONE;
+// Nível calculado da última amostra (as leituras ficam no buffer do sensor)
+static RainLevel lastLevel = RainLevel::NONE;
 
 // ==========================
 // FUNÇÕES INTERNAS
@@ -48,11 +56,11 @@ static RainLevel computeRainLevel(int analogRaw) {
   }
 }
 
-static void debugPrint() {
+static void debugPrint(const RainReading& r) {
   Serial.print("[RAIN] Analog:");
-  Serial.print(lastAnalogValue);
+  Serial.print(r.analog);
   Serial.print(" | Digital:");
-  Serial.print(lastDigitalValue ? "CHUVA" : "SECO");
+  Serial.print(r.digital ? "CHUVA" : "SECO");
   Serial.print(" | Level: ");
 
   switch (lastLevel) {
@@ -63,6 +71,42 @@ static void debugPrint() {
   }
 }
 
+// ==========================
+// SENSOR (framework)
+// ==========================
+
+static const char* const RAIN_CHANNELS[] = { "analog" };
+
+class RainSensor : public Sensor<RainSensor, RainReading, RAIN_HISTORY> {
+public:
+  RainSensor() : Sensor("rain", RAIN_CHANNELS, RAIN_READ_INTERVAL_MS) {}
+
+  bool read(RainReading& out) {
+    out.analog  = analogRead(RAIN_ANALOG_PIN);
+    out.digital = (digitalRead(RAIN_DIGITAL_PIN) == LOW);
+    // Muitos módulos: D0 = LOW quando molhado (depende do ajuste do trimpot)
+    // Se no seu módulo for LOW = seco, é só inverter aqui.
+    return true;
+  }
+
+  static float channelValue(const RainReading& r, int) {
+    return (float)r.analog;
+  }
+
+  void onSample(const RainReading& r) {
+    RainLevel previous = lastLevel;
+    lastLevel = computeRainLevel(r.analog);
+    debugPrint(r);
+    flightRecorderLogRain(r.analog, r.digital, lastLevel);
+
+    if (lastLevel != previous) {
+      eventBusEmitRainLevel(lastLevel, previous);
+    }
+  }
+};
+
+static RainSensor rainSensor;
+
 // ==========================
 // FUNÇÕES "PÚBLICAS"
 // ==========================
@@ -72,43 +116,25 @@ void rainSensorInit() {
   // No ESP32, pinos analógicos já vêm prontos para analogRead()
   // mas se quiser tunar, pode usar analogSetAttenuation() etc.
 
-  // Leitura inicial
-  lastAnalogValue  = analogRead(RAIN_ANALOG_PIN);
-  lastDigitalValue = (digitalRead(RAIN_DIGITAL_PIN) == LOW); 
-  // Muitos módulos: D0 = LOW quando molhado (depende do ajuste do trimpot)
-
-  lastLevel = computeRainLevel(lastAnalogValue);
-
   Serial.println("[RAIN] Sensor de chuva inicializado.");
-  debugPrint();
+
+  // Leitura inicial
+  rainSensor.sampleNow(millis());
+  sensorRegistryAdd(&rainSensor);
 }
 
 void rainSensorLoop() {
-  unsigned long now = millis();
-  if (now - lastReadMillis < RAIN_READ_INTERVAL_MS) {
-    return;
-  }
-  lastReadMillis = now;
-
-  int  analogValue  = analogRead(RAIN_ANALOG_PIN);
-  bool digitalValue = (digitalRead(RAIN_DIGITAL_PIN) == LOW);
-  // Se no seu módulo for LOW = seco, é só inverter aqui.
-
-  lastAnalogValue  = analogValue;
-  lastDigitalValue = digitalValue;
-  lastLevel        = computeRainLevel(analogValue);
-
-  debugPrint();
+  rainSensor.loop(millis());
 }
 
 // Getters
 
 int rainGetAnalog() {
-  return lastAnalogValue;
+  return rainSensor.hasData() ? rainSensor.latest().value.analog : 0;
 }
 
 bool rainGetDigital() {
-  return lastDigitalValue;
+  return rainSensor.hasData() && rainSensor.latest().value.digital;
 }
 
 bool rainIsRaining() {
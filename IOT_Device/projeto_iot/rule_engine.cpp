@@ -0,0 +1,393 @@
+#include <Arduino.h>
+#include <Preferences.h>
+#include <time.h>
+
+#include "rule_engine.h"
+#include "rain_sensor.h"
+#include "rain_predictor.h"
+#include "dht11_sensor.h"
+#include "mem_monitor.h"
+
+// ==========================
+// CONFIGURAÇÃO
+// ==========================
+
+static const char*  NVS_NAMESPACE = "rules";
+static const char*  NVS_KEY       = "prog";
+static const size_t HEADER_SIZE   = 10;
+static const size_t CRC_SIZE      = 2;
+
+static const int    MOVE_HISTORY  = 32;      // teto do limite de movimentos por hora
+static const time_t TIME_VALID_AFTER = 1'600'000'000;  // antes disso o NTP não sincronizou
+
+// ==========================
+// ESTADO INTERNO
+// ==========================
+
+static uint8_t  program[RULE_PROGRAM_MAX];
+static size_t   programLen = 0;
+static bool     active     = false;
+
+// Cabeçalho decodificado
+static uint8_t  maxMovesPerHour = 0;
+static uint16_t minDwellS       = 0;
+static int16_t  tzOffsetMin     = 0;
+static const uint8_t* code      = nullptr;
+static uint16_t codeLen         = 0;
+static uint16_t programId       = 0;   // o próprio CRC
+
+// Movimentos automáticos recentes (anel de millis)
+static unsigned long moveTimes[MOVE_HISTORY];
+static int           moveHead     = 0;
+static int           moveCount    = 0;
+static unsigned long lastMoveMs   = 0;
+static bool          hasMoved     = false;
+
+// Telemetria
+static uint8_t    lastRule    = RULE_NO_RULE;
+static RuleAction lastAction  = RuleAction::DEFAULT;
+static uint32_t   blockedMoves = 0;
+static uint32_t   evalErrors   = 0;
+
+// ==========================
+// FUNÇÕES INTERNAS
+// ==========================
+
+static uint16_t readU16(const uint8_t* p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint16_t crc16(const uint8_t* data, size_t len) {
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (int b = 0; b < 8; b++) {
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+// Tamanho da instrução (opcode + operandos); 0 se o opcode não existe
+static size_t instructionSize(uint8_t op) {
+  switch (op) {
+    case RULE_OP_END:
+    case RULE_OP_EQ: case RULE_OP_NE: case RULE_OP_LT:
+    case RULE_OP_LE: case RULE_OP_GT: case RULE_OP_GE:
+    case RULE_OP_AND: case RULE_OP_OR: case RULE_OP_NOT:
+      return 1;
+    case RULE_OP_LOAD: case RULE_OP_JZ: case RULE_OP_JMP:
+    case RULE_OP_OPEN: case RULE_OP_CLOSE: case RULE_OP_AUTO:
+      return 2;
+    case RULE_OP_PUSH:
+      return 3;
+    case RULE_OP_WINDOW:
+      return 5;
+    default:
+      return 0;
+  }
+}
+
+// Confere cabeçalho, CRC e código (opcodes, operandos, saltos em fronteira
+// de instrução). Feito uma vez na instalação; a avaliação confia nisso.
+static bool validate(const uint8_t* data, size_t len) {
+  if (len < HEADER_SIZE + CRC_SIZE || len > RULE_PROGRAM_MAX) return false;
+  if (data[0] != 'V' || data[1] != 'R' || data[2] != RULE_FORMAT_VERSION) return false;
+
+  size_t n = readU16(data + 8);
+  if (HEADER_SIZE + n + CRC_SIZE != len || n == 0) return false;
+  if (crc16(data, HEADER_SIZE + n) != readU16(data + HEADER_SIZE + n)) return false;
+
+  const uint8_t* c = data + HEADER_SIZE;
+  uint8_t starts[RULE_PROGRAM_MAX / 8] = {};   // bitmap dos inícios de instrução
+  size_t pc = 0;
+  while (pc < n) {
+    size_t size = instructionSize(c[pc]);
+    if (size == 0 || pc + size > n) return false;
+    if (c[pc] == RULE_OP_LOAD && c[pc + 1] >= RULE_VAR_COUNT) return false;
+    if (c[pc] == RULE_OP_WINDOW && (readU16(c + pc + 1) >= 1440 || readU16(c + pc + 3) > 1440)) return false;
+    starts[pc / 8] |= (uint8_t)(1 << (pc % 8));
+    pc += size;
+  }
+
+  // Saltos: para frente, dentro do código (ou exatamente no fim) e em início de instrução
+  pc = 0;
+  while (pc < n) {
+    size_t size = instructionSize(c[pc]);
+    if (c[pc] == RULE_OP_JZ || c[pc] == RULE_OP_JMP) {
+      size_t target = pc + size + c[pc + 1];
+      if (target > n) return false;
+      if (target < n && !(starts[target / 8] & (1 << (target % 8)))) return false;
+    }
+    pc += size;
+  }
+  return true;
+}
+
+static void activate(const uint8_t* data, size_t len) {
+  memcpy(program, data, len);
+  programLen      = len;
+  maxMovesPerHour = program[3] > MOVE_HISTORY ? MOVE_HISTORY : program[3];
+  minDwellS       = readU16(program + 4);
+  tzOffsetMin     = (int16_t)readU16(program + 6);
+  codeLen         = readU16(program + 8);
+  code            = program + HEADER_SIZE;
+  programId       = readU16(program + HEADER_SIZE + codeLen);
+  active          = true;
+}
+
+static int movesLastHour(unsigned long now) {
+  int n = 0;
+  for (int i = 0; i < moveCount; i++) {
+    if (now - moveTimes[i] < 3'600'000UL) n++;
+  }
+  return n;
+}
+
+// Minuto do dia e dia da semana no fuso do programa (-1 sem NTP)
+static void localTime(int32_t& minute, int32_t& weekday) {
+  time_t now = time(nullptr);
+  if (now < TIME_VALID_AFTER) {
+    minute  = -1;
+    weekday = -1;
+    return;
+  }
+  int64_t localMin = (int64_t)now / 60 + tzOffsetMin;
+  int64_t days     = localMin / 1440;
+  minute  = (int32_t)(localMin % 1440);
+  weekday = (int32_t)((days + 4) % 7);   // 01/01/1970 foi quinta
+}
+
+// ==========================
+// API
+// ==========================
+
+void ruleEngineInit() {
+  // NTP em UTC; cada programa traz o próprio fuso
+  configTime(0, 0, "pool.ntp.org", "time.google.com");
+
+  Preferences prefs;
+  if (prefs.begin(NVS_NAMESPACE, true)) {
+    size_t len = prefs.getBytesLength(NVS_KEY);
+    if (len > 0 && len <= RULE_PROGRAM_MAX) {
+      static uint8_t buf[RULE_PROGRAM_MAX];
+      prefs.getBytes(NVS_KEY, buf, len);
+      if (validate(buf, len)) {
+        activate(buf, len);
+      } else {
+        Serial.println("[RULES] Programa na NVS inválido (ignorado).");
+      }
+    }
+    prefs.end();
+  }
+
+  if (active) {
+    Serial.print("[RULES] Programa carregado: ");
+    Serial.print(codeLen);
+    Serial.println(" bytes de código.");
+  } else {
+    Serial.println("[RULES] Sem programa: regra fixa (chuva fecha, seco abre).");
+  }
+}
+
+bool ruleEngineInstall(const uint8_t* data, size_t length) {
+  if (length == 0) {
+    if (!active) return true;
+    memMonitorAllowAllocations(true);  // NVS aloca por natureza
+    Preferences prefs;
+    if (prefs.begin(NVS_NAMESPACE, false)) {
+      prefs.remove(NVS_KEY);
+      prefs.end();
+    }
+    memMonitorAllowAllocations(false);
+    active     = false;
+    programLen = 0;
+    lastRule   = RULE_NO_RULE;
+    Serial.println("[RULES] Programa removido: regra fixa.");
+    return true;
+  }
+
+  if (!validate(data, length)) {
+    Serial.println("[RULES] Programa recusado (formato/CRC/código inválido).");
+    return false;
+  }
+
+  // Mesmo programa (mensagem retida reentregue a cada conexão): nada a gravar
+  if (active && length == programLen && memcmp(data, program, length) == 0) {
+    return true;
+  }
+
+  memMonitorAllowAllocations(true);
+  Preferences prefs;
+  bool saved = prefs.begin(NVS_NAMESPACE, false) && prefs.putBytes(NVS_KEY, data, length) == length;
+  prefs.end();
+  memMonitorAllowAllocations(false);
+  if (!saved) {
+    Serial.println("[RULES] Falha ao gravar na NVS (ativo só até reiniciar).");
+  }
+
+  activate(data, length);
+  Serial.print("[RULES] Programa instalado: ");
+  Serial.print(codeLen);
+  Serial.println(" bytes de código.");
+  return true;
+}
+
+bool ruleEngineActive() {
+  return active;
+}
+
+RuleAction ruleEngineEvaluate(bool isOpen) {
+  if (!active) {
+    return RuleAction::DEFAULT;
+  }
+
+  // Entradas lidas uma vez por avaliação
+  unsigned long now = millis();
+  bool dhtValid = dht11HasValidData();
+  int32_t vars[RULE_VAR_COUNT];
+  vars[RULE_VAR_RAIN_LEVEL]    = (int32_t)rainGetLevel();
+  vars[RULE_VAR_RAINING]       = rainIsRaining() ? 1 : 0;
+  vars[RULE_VAR_RAIN_LIKELY]   = rainPredictorIsRainLikely() ? 1 : 0;
+  vars[RULE_VAR_TEMP_X10]      = dhtValid ? lroundf(dht11GetTemperatureC() * 10.0f) : 0;
+  vars[RULE_VAR_HUMIDITY_X10]  = dhtValid ? lroundf(dht11GetHumidity() * 10.0f) : 0;
+  localTime(vars[RULE_VAR_MINUTE], vars[RULE_VAR_WEEKDAY]);
+  unsigned long sinceMove = hasMoved ? (now - lastMoveMs) / 60'000UL : 32767;
+  vars[RULE_VAR_MINUTES_SINCE_MOVE] = sinceMove > 32767 ? 32767 : (int32_t)sinceMove;
+  vars[RULE_VAR_MOVES_LAST_HOUR]    = movesLastHour(now);
+  vars[RULE_VAR_IS_OPEN]            = isOpen ? 1 : 0;
+  vars[RULE_VAR_DHT_VALID]          = dhtValid ? 1 : 0;
+
+  int32_t stack[RULE_STACK_SIZE];
+  int sp = 0;
+  size_t pc = 0;
+
+  lastRule   = RULE_NO_RULE;
+  lastAction = RuleAction::DEFAULT;
+
+  // Só saltos para frente: no máximo codeLen instruções
+  while (pc < codeLen) {
+    uint8_t op = code[pc];
+    switch (op) {
+      case RULE_OP_END:
+        return RuleAction::DEFAULT;
+
+      case RULE_OP_PUSH:
+      case RULE_OP_LOAD:
+        if (sp >= RULE_STACK_SIZE) goto error;
+        stack[sp++] = (op == RULE_OP_PUSH) ? (int16_t)readU16(code + pc + 1) : vars[code[pc + 1]];
+        break;
+
+      case RULE_OP_EQ: case RULE_OP_NE: case RULE_OP_LT:
+      case RULE_OP_LE: case RULE_OP_GT: case RULE_OP_GE:
+      case RULE_OP_AND: case RULE_OP_OR: {
+        if (sp < 2) goto error;
+        int32_t b = stack[--sp];
+        int32_t a = stack[sp - 1];
+        int32_t r;
+        switch (op) {
+          case RULE_OP_EQ:  r = a == b; break;
+          case RULE_OP_NE:  r = a != b; break;
+          case RULE_OP_LT:  r = a <  b; break;
+          case RULE_OP_LE:  r = a <= b; break;
+          case RULE_OP_GT:  r = a >  b; break;
+          case RULE_OP_GE:  r = a >= b; break;
+          case RULE_OP_AND: r = a && b; break;
+          default:          r = a || b; break;
+        }
+        stack[sp - 1] = r;
+        break;
+      }
+
+      case RULE_OP_NOT:
+        if (sp < 1) goto error;
+        stack[sp - 1] = !stack[sp - 1];
+        break;
+
+      case RULE_OP_WINDOW: {
+        if (sp >= RULE_STACK_SIZE) goto error;
+        int32_t m     = vars[RULE_VAR_MINUTE];
+        int32_t start = readU16(code + pc + 1);
+        int32_t end   = readU16(code + pc + 3);
+        bool in;
+        if (m < 0)            in = false;
+        else if (start <= end) in = m >= start && m < end;
+        else                   in = m >= start || m < end;   // cruza a meia-noite
+        stack[sp++] = in ? 1 : 0;
+        break;
+      }
+
+      case RULE_OP_JZ:
+        if (sp < 1) goto error;
+        if (stack[--sp] == 0) pc += code[pc + 1];
+        break;
+
+      case RULE_OP_JMP:
+        pc += code[pc + 1];
+        break;
+
+      case RULE_OP_OPEN:
+      case RULE_OP_CLOSE:
+      case RULE_OP_AUTO:
+        lastRule   = code[pc + 1];
+        lastAction = op == RULE_OP_OPEN  ? RuleAction::OPEN
+                   : op == RULE_OP_CLOSE ? RuleAction::CLOSE
+                   :                       RuleAction::DEFAULT;
+        return lastAction;
+    }
+    pc += instructionSize(op);
+  }
+  return RuleAction::DEFAULT;
+
+error:
+  // Pilha estourada/vazia: programa mal gerado; cai na regra fixa
+  evalErrors++;
+  return RuleAction::DEFAULT;
+}
+
+bool ruleEngineMoveAllowed() {
+  if (!active) {
+    return true;
+  }
+  unsigned long now = millis();
+  bool allowed = true;
+  if (hasMoved && minDwellS > 0 && now - lastMoveMs < (unsigned long)minDwellS * 1000UL) {
+    allowed = false;
+  }
+  if (maxMovesPerHour > 0 && movesLastHour(now) >= maxMovesPerHour) {
+    allowed = false;
+  }
+  return allowed;
+}
+
+void ruleEngineNoteBlocked() {
+  blockedMoves++;
+}
+
+void ruleEngineNoteMove() {
+  unsigned long now = millis();
+  lastMoveMs = now;
+  hasMoved   = true;
+
+  moveTimes[moveHead] = now;
+  moveHead = (moveHead + 1) % MOVE_HISTORY;
+  if (moveCount < MOVE_HISTORY) moveCount++;
+}
+
+int ruleEngineReportJson(char* out, size_t capacity) {
+  int n;
+  if (!active) {
+    n = snprintf(out, capacity, "null");
+  } else {
+    const char* action = lastAction == RuleAction::OPEN  ? "OPEN"
+                       : lastAction == RuleAction::CLOSE ? "CLOSE"
+                       :                                   "DEFAULT";
+    n = snprintf(out, capacity, "{\"id\":\"%04x\",\"rule\":%d,\"action\":\"%s\",\"blocked\":%lu,\"errors\":%lu}",
+                 programId, lastRule == RULE_NO_RULE ? -1 : (int)lastRule, action,
+                 (unsigned long)blockedMoves, (unsigned long)evalErrors);
+  }
+  if (n < 0 || (size_t)n >= capacity) {
+    return 0;
+  }
+  return n;
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include <Arduino.h>
+
+// ==========================================================
+// MOTOR DE REGRAS (automação sem regravar o firmware)
+// ==========================================================
+//
+// Um programa compacto em bytecode (gerado por backend/tools/rule_compiler.py)
+// chega por MQTT em casa/<id>/rules, é validado, gravado na NVS e passa a
+// decidir o modo AUTO no lugar da regra fixa (chuva -> fecha, seco -> abre).
+// Sem programa, ou se o programa terminar sem decidir, vale a regra fixa.
+//
+// Formato (little-endian):
+//   0  'V' 'R'
+//   2  u8  versão (RULE_FORMAT_VERSION)
+//   3  u8  máximo de movimentos automáticos por hora (0 = sem limite)
+//   4  u16 permanência mínima entre movimentos automáticos (s)
+//   6  i16 fuso em minutos (ex: -180 = UTC-3) para os horários
+//   8  u16 tamanho do código
+//   10 código
+//   .. u16 CRC-16/CCITT de tudo que vem antes
+//
+// Máquina de pilha (int32), só saltos para frente: cada instrução roda no
+// máximo uma vez por avaliação (tempo limitado pelo tamanho do código), sem
+// alocação. Instruções:
+//   END                      fim sem decisão (regra fixa)
+//   PUSH  i16                empilha constante
+//   LOAD  u8 var             empilha entrada (RuleVar)
+//   EQ NE LT LE GT GE        compara os dois do topo (a op b) -> 0/1
+//   AND OR NOT               lógica sobre 0/≠0
+//   WINDOW u16 ini, u16 fim  1 se o minuto do dia está em [ini, fim) (cruza
+//                            a meia-noite se ini > fim); 0 sem hora (NTP)
+//   JZ  u8 n                 desempilha; se 0, pula n bytes para frente
+//   JMP u8 n                 pula n bytes para frente
+//   OPEN/CLOSE/AUTO u8 regra decide (AUTO = regra fixa) e termina
+
+static const uint8_t RULE_FORMAT_VERSION = 1;
+static const size_t  RULE_PROGRAM_MAX    = 512;   // bytes, cabeçalho e CRC incluídos
+static const int     RULE_STACK_SIZE     = 16;
+static const uint8_t RULE_NO_RULE        = 255;   // decisão veio da regra fixa
+
+enum RuleOp : uint8_t {
+  RULE_OP_END    = 0x00,
+  RULE_OP_PUSH   = 0x01,
+  RULE_OP_LOAD   = 0x02,
+  RULE_OP_EQ     = 0x10,
+  RULE_OP_NE     = 0x11,
+  RULE_OP_LT     = 0x12,
+  RULE_OP_LE     = 0x13,
+  RULE_OP_GT     = 0x14,
+  RULE_OP_GE     = 0x15,
+  RULE_OP_AND    = 0x20,
+  RULE_OP_OR     = 0x21,
+  RULE_OP_NOT    = 0x22,
+  RULE_OP_WINDOW = 0x23,
+  RULE_OP_JZ     = 0x30,
+  RULE_OP_JMP    = 0x31,
+  RULE_OP_OPEN   = 0x40,
+  RULE_OP_CLOSE  = 0x41,
+  RULE_OP_AUTO   = 0x42
+};
+
+// Entradas do programa (LOAD)
+enum RuleVar : uint8_t {
+  RULE_VAR_RAIN_LEVEL = 0,   // 0..3 (RainLevel)
+  RULE_VAR_RAINING,          // 0/1
+  RULE_VAR_RAIN_LIKELY,      // 0/1 (previsão por tendência)
+  RULE_VAR_TEMP_X10,         // °C × 10
+  RULE_VAR_HUMIDITY_X10,     // % × 10
+  RULE_VAR_MINUTE,           // minuto do dia no fuso do programa (-1 sem NTP)
+  RULE_VAR_WEEKDAY,          // 0 = domingo .. 6 = sábado (-1 sem NTP)
+  RULE_VAR_MINUTES_SINCE_MOVE,
+  RULE_VAR_MOVES_LAST_HOUR,
+  RULE_VAR_IS_OPEN,          // 0/1
+  RULE_VAR_DHT_VALID,        // 0/1 (sem leitura válida, temp/umidade = 0)
+  RULE_VAR_COUNT
+};
+
+enum class RuleAction : uint8_t {
+  DEFAULT,   // regra fixa decide
+  OPEN,
+  CLOSE
+};
+
+// Carrega o programa salvo na NVS e liga o NTP (chamar no setup)
+void ruleEngineInit();
+
+// Valida, grava na NVS e ativa. Payload vazio remove o programa.
+bool ruleEngineInstall(const uint8_t* data, size_t length);
+
+bool ruleEngineActive();
+
+// Avalia o programa para o estado atual do varal
+RuleAction ruleEngineEvaluate(bool isOpen);
+
+// Limites do programa (permanência mínima, movimentos por hora) para
+// movimentos automáticos; sem programa, sempre true. Só consulta: fechar
+// com chuva não passa por aqui (o controlador nunca segura esse movimento)
+bool ruleEngineMoveAllowed();
+
+// Avisar a cada movimento automático iniciado (os de chuva contam também)
+void ruleEngineNoteMove();
+
+// Uma transição automática foi segurada pelos limites ("blocked" no
+// relatório). O controlador avisa uma vez por transição, não a cada decisão.
+void ruleEngineNoteBlocked();
+
+// Escreve {"id":"..","rule":..,"action":"..","blocked":..,"errors":..}
+// (ou null sem programa). Retorna o nº de caracteres (0 se não coube).
+int ruleEngineReportJson(char* out, size_t capacity);
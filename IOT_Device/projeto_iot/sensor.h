@@ -0,0 +1,183 @@
+#pragma once
+#include <Arduino.h>
+
+// ==========================================================
+// FRAMEWORK DE SENSORES
+// ==========================================================
+//
+// Cada sensor deriva de Sensor<Derived, T, N, CANAIS> (CRTP) e declara:
+//   bool  read(T& out);                      // leitura do hardware
+//   static float channelValue(const T&, int) // valor numérico de cada canal
+//   void  onSample(const T&)                 // opcional, pós-leitura
+// A chamada de read()/onSample() é resolvida em tempo de compilação
+// (sem virtual no caminho da amostragem).
+//
+// Guarda as últimas N amostras com timestamp e, por canal, mín/máx/média
+// da janela, atualizados a cada amostra em O(1) (amortizado).
+// O registro central (sensor_registry.h) enxerga os sensores pela
+// interface SensorView, usada só por telemetria/controlador.
+
+template <typename T>
+struct SensorSample {
+  unsigned long ms;
+  T value;
+};
+
+// ----------------------------------------------------------
+// Estatísticas de janela deslizante (últimas N amostras)
+// ----------------------------------------------------------
+template <size_t N>
+class WindowStats {
+public:
+  void push(float v) {
+    // Soma da janela (tira o que sai)
+    if (count == N) {
+      sum -= window[head];
+    } else {
+      count++;
+    }
+    window[head] = v;
+    head = (head + 1) % N;
+    sum += v;
+
+    uint32_t seq    = nextSeq++;
+    uint32_t oldest = seq + 1 - count;
+
+    // Descarta da frente o que saiu da janela (antes de inserir, pra caber em N)
+    while (minLen > 0 && minSeqs[minHead] < oldest) { minHead = (minHead + 1) % N; minLen--; }
+    while (maxLen > 0 && maxSeqs[maxHead] < oldest) { maxHead = (maxHead + 1) % N; maxLen--; }
+
+    // Filas monotônicas: frente = mín/máx da janela
+    while (minLen > 0 && minVals[back(minHead, minLen)] >= v) minLen--;
+    minVals[(minHead + minLen) % N] = v;
+    minSeqs[(minHead + minLen) % N] = seq;
+    minLen++;
+
+    while (maxLen > 0 && maxVals[back(maxHead, maxLen)] <= v) maxLen--;
+    maxVals[(maxHead + maxLen) % N] = v;
+    maxSeqs[(maxHead + maxLen) % N] = seq;
+    maxLen++;
+  }
+
+  size_t size() const { return count; }
+  float  min()  const { return count ? minVals[minHead] : NAN; }
+  float  max()  const { return count ? maxVals[maxHead] : NAN; }
+  float  mean() const { return count ? sum / (float)count : NAN; }
+
+private:
+  static size_t back(size_t head, size_t len) { return (head + len - 1) % N; }
+
+  float  window[N];
+  size_t head  = 0;
+  size_t count = 0;
+  float  sum   = 0.0f;
+  uint32_t nextSeq = 0;
+
+  float    minVals[N];
+  uint32_t minSeqs[N];
+  size_t   minHead = 0, minLen = 0;
+
+  float    maxVals[N];
+  uint32_t maxSeqs[N];
+  size_t   maxHead = 0, maxLen = 0;
+};
+
+// ----------------------------------------------------------
+// Interface vista pelo registro (telemetria / controlador)
+// ----------------------------------------------------------
+class SensorView {
+public:
+  virtual const char*   name() const = 0;
+  virtual int           channelCount() const = 0;
+  virtual const char*   channelName(int channel) const = 0;
+  virtual float         channelLast(int channel) const = 0;
+  virtual float         channelMin(int channel) const = 0;
+  virtual float         channelMax(int channel) const = 0;
+  virtual float         channelMean(int channel) const = 0;
+  virtual size_t        sampleCount() const = 0;
+  virtual unsigned long lastSampleMillis() const = 0;
+
+protected:
+  ~SensorView() = default;
+};
+
+// ----------------------------------------------------------
+// Base CRTP
+// ----------------------------------------------------------
+template <typename Derived, typename T, size_t N, int CHANNELS = 1>
+class Sensor : public SensorView {
+public:
+  Sensor(const char* sensorName, const char* const* channelNames, unsigned long periodMs)
+    : sensorName(sensorName), names(channelNames), periodMs(periodMs) {}
+
+  // Chamar no loop(): lê se já deu o período
+  void loop(unsigned long now) {
+    if (hasSample && now - lastMs < periodMs) {
+      return;
+    }
+    sampleNow(now);
+  }
+
+  // Leitura imediata (ex: no init)
+  bool sampleNow(unsigned long now) {
+    lastMs    = now;
+    hasSample = true;
+
+    T value;
+    if (!derived().read(value)) {
+      return false;
+    }
+
+    ring[ringHead] = { now, value };
+    ringHead = (ringHead + 1) % N;
+    if (ringCount < N) ringCount++;
+
+    for (int c = 0; c < CHANNELS; c++) {
+      stats[c].push(Derived::channelValue(value, c));
+    }
+    derived().onSample(value);
+    return true;
+  }
+
+  // Amostras: 0 = mais recente
+  bool hasData() const { return ringCount > 0; }
+  const SensorSample<T>& latest() const { return at(0); }
+  const SensorSample<T>& at(size_t age) const {
+    return ring[(ringHead + N - 1 - age) % N];
+  }
+
+  const WindowStats<N>& channelStats(int channel) const { return stats[channel]; }
+  unsigned long periodMillis() const { return periodMs; }
+
+  // ---- SensorView ----
+  const char*   name() const override { return sensorName; }
+  int           channelCount() const override { return CHANNELS; }
+  const char*   channelName(int channel) const override { return names[channel]; }
+  float         channelLast(int channel) const override {
+    return ringCount ? Derived::channelValue(latest().value, channel) : NAN;
+  }
+  float         channelMin(int channel) const override { return stats[channel].min(); }
+  float         channelMax(int channel) const override { return stats[channel].max(); }
+  float         channelMean(int channel) const override { return stats[channel].mean(); }
+  size_t        sampleCount() const override { return ringCount; }
+  unsigned long lastSampleMillis() const override { return ringCount ? latest().ms : 0; }
+
+protected:
+  // Gancho opcional (sombreado pelo sensor concreto)
+  void onSample(const T&) {}
+
+private:
+  Derived& derived() { return *static_cast<Derived*>(this); }
+
+  const char*        sensorName;
+  const char* const* names;
+  unsigned long      periodMs;
+  unsigned long      lastMs    = 0;
+  bool               hasSample = false;
+
+  SensorSample<T> ring[N];
+  size_t          ringHead  = 0;
+  size_t          ringCount = 0;
+
+  WindowStats<N>  stats[CHANNELS];
+};
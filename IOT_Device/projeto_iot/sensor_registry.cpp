@@ -0,0 +1,47 @@
+#include <Arduino.h>
+#include "sensor_registry.h"
+
+// ==========================
+// ESTADO INTERNO
+// ==========================
+
+static SensorView* sensors[SENSOR_REGISTRY_MAX];
+static int sensorCount = 0;
+
+// ==========================
+// FUNÇÕES PÚBLICAS
+// ==========================
+
+bool sensorRegistryAdd(SensorView* sensor) {
+  for (int i = 0; i < sensorCount; i++) {
+    if (sensors[i] == sensor) {
+      return true; // já registrado (init chamado de novo)
+    }
+  }
+  if (sensorCount >= SENSOR_REGISTRY_MAX) {
+    Serial.println("[SENSORS] Registro cheio, sensor ignorado.");
+    return false;
+  }
+  sensors[sensorCount++] = sensor;
+
+  Serial.print("[SENSORS] Registrado: ");
+  Serial.println(sensor->name());
+  return true;
+}
+
+int sensorRegistryCount() {
+  return sensorCount;
+}
+
+SensorView* sensorRegistryGet(int index) {
+  return (index >= 0 && index < sensorCount) ? sensors[index] : nullptr;
+}
+
+SensorView* sensorRegistryFind(const char* name) {
+  for (int i = 0; i < sensorCount; i++) {
+    if (strcmp(sensors[i]->name(), name) == 0) {
+      return sensors[i];
+    }
+  }
+  return nullptr;
+}
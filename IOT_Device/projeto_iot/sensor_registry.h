@@ -0,0 +1,17 @@
+#pragma once
+#include "sensor.h"
+
+// Registro central dos sensores (capacidade fixa, sem alocação).
+// Cada módulo de sensor se registra no seu init; telemetria e
+// controlador percorrem a lista sem conhecer os módulos.
+
+static const int SENSOR_REGISTRY_MAX = 8;
+
+// Registra um sensor (retorna false se o registro estiver cheio)
+bool sensorRegistryAdd(SensorView* sensor);
+
+int         sensorRegistryCount();
+SensorView* sensorRegistryGet(int index);
+
+// Procura pelo nome (ou nullptr)
+SensorView* sensorRegistryFind(const char* name);
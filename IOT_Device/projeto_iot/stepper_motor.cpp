@@ -1,50 +1,29 @@
 #include <Arduino.h>
+#include <driver/ledc.h>
 #include "stepper_motor.h"
+#include "event_bus.h"
 
 // ==========================
-// CONFIGURAÇÃO DE PINOS
+// CONFIGURAÇÃO DO MOTOR DO VARAL
 // ==========================
 
 // Ligue IN1..IN4 do ULN2003 nesses pinos:
-static const int STEPPER_IN1_PIN = 14; // IN1
-static const int STEPPER_IN2_PIN = 27; // IN2
-static const int STEPPER_IN3_PIN = 26; // IN3
-static const int STEPPER_IN4_PIN = 33; // IN4
-
-static const int ENDSTOP_PIN = 32; // ex: 32 se você colocar um fim de curso
-
 // 28BYJ-48 em half-step ~4096 passos por volta
-static const long STEPS_PER_REV = 4096;
-
-// Velocidade padrão (half-steps/s)
-static float stepperSpeedStepsPerSec = 400.0f;
+// ENDSTOP: ex: 32 se você colocar um fim de curso (-1 = sem fim de curso)
+static const StepperConfig VARAL_MOTOR_CONFIG = {
+  14, // IN1
+  27, // IN2
+  26, // IN3
+  33, // IN4
+  32, // ENDSTOP
+  4096,
+  StepperDrive::MICROSTEP
+};
 
 // ==========================
-// ESTADO INTERNO
+// TABELAS DE FASES
 // ==========================
 
-// Posição atual (sempre 0..STEPS_PER_REV-1)
-static long currentSteps = 0;
-// Alvo (0..STEPS_PER_REV-1)
-static long targetSteps  = 0;
-
-// Índice da fase (0..7) da sequência half-step
-static uint8_t phaseIndex = 0;
-
-static unsigned long lastStepMicros     = 0;
-static unsigned long stepIntervalMicros = 0;
-
-static bool homed = false;
-
-// Simples “estado” do motor
-enum class StepperMode {
-  IDLE,
-  MOVING,
-  HOMING
-};
-
-static StepperMode mode = StepperMode::IDLE;
-
 // Sequência de half-step (8 fases)
 static const uint8_t HALFSTEP_SEQ[8][4] = {
   {1, 0, 0, 0},
@@ -57,47 +36,146 @@ static const uint8_t HALFSTEP_SEQ[8][4] = {
   {1, 0, 0, 1}
 };
 
+// Full-step com 2 bobinas ligadas (4 fases)
+static const uint8_t FULLSTEP_SEQ[4][4] = {
+  {1, 1, 0, 0},
+  {0, 1, 1, 0},
+  {0, 0, 1, 1},
+  {1, 0, 0, 1}
+};
+
+// Wave drive: 1 bobina por vez (4 fases)
+static const uint8_t WAVE_SEQ[4][4] = {
+  {1, 0, 0, 0},
+  {0, 1, 0, 0},
+  {0, 0, 1, 0},
+  {0, 0, 0, 1}
+};
+
+// Corrente por bobina no microstepping: max(0, cos(2π·i/64)) × 1023.
+// Um ciclo elétrico = 8 half-steps = 64 micropassos; a bobina k (IN1..IN4)
+// tem o pico em i = 16·k, então nos múltiplos de 8 a tabela cai nas mesmas
+// bobinas do HALFSTEP_SEQ (com 0,707 em cada nas fases de duas bobinas).
+static const uint16_t MICROSTEP_DUTY[64] = {
+  1023, 1018, 1003,  979,  945,  902,  851,  791,
+   723,  649,  568,  482,  391,  297,  200,  100,
+     0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,
+     0,    0,    0,    0,    0,    0,    0,    0,
+     0,  100,  200,  297,  391,  482,  568,  649,
+   723,  791,  851,  902,  945,  979, 1003, 1018
+};
+
+static const uint16_t         DUTY_MAX        = 1023;
+static const ledc_timer_bit_t DUTY_RESOLUTION = LEDC_TIMER_10_BIT;
+static const ledc_mode_t      LEDC_MODE       = LEDC_LOW_SPEED_MODE;
+static const ledc_timer_t     LEDC_TIMER      = LEDC_TIMER_0;
+static const int              ELEC_MASK       = 63;
+
+// Canais LEDC já entregues (4 por motor em MICROSTEP)
+static int ledcChannelsUsed = 0;
+
 // ==========================
-// FUNÇÕES INTERNAS
+// StepperMotor
 // ==========================
 
-static void updateStepInterval() {
-  if (stepperSpeedStepsPerSec <= 0) {
-    stepIntervalMicros = 0;
-  } else {
-    stepIntervalMicros = (unsigned long)(1'000'000.0f / stepperSpeedStepsPerSec);
+StepperMotor::StepperMotor(const StepperConfig& config) : cfg(config) {
+  switch (cfg.drive) {
+    case StepperDrive::FULL_STEP: phaseTable = FULLSTEP_SEQ; phaseMask = 0x03; break;
+    case StepperDrive::WAVE:      phaseTable = WAVE_SEQ;     phaseMask = 0x03; break;
+    case StepperDrive::MICROSTEP:
+    case StepperDrive::HALF_STEP:
+    default:                      phaseTable = HALFSTEP_SEQ; phaseMask = 0x07; break;
   }
 }
 
-static void applyPhase(uint8_t idx) {
-  idx &= 0x07;
-  digitalWrite(STEPPER_IN1_PIN, HALFSTEP_SEQ[idx][0]);
-  digitalWrite(STEPPER_IN2_PIN, HALFSTEP_SEQ[idx][1]);
-  digitalWrite(STEPPER_IN3_PIN, HALFSTEP_SEQ[idx][2]);
-  digitalWrite(STEPPER_IN4_PIN, HALFSTEP_SEQ[idx][3]);
+void StepperMotor::begin() {
+  pinMode(cfg.in1Pin, OUTPUT);
+  pinMode(cfg.in2Pin, OUTPUT);
+  pinMode(cfg.in3Pin, OUTPUT);
+  pinMode(cfg.in4Pin, OUTPUT);
+
+  digitalWrite(cfg.in1Pin, LOW);
+  digitalWrite(cfg.in2Pin, LOW);
+  digitalWrite(cfg.in3Pin, LOW);
+  digitalWrite(cfg.in4Pin, LOW);
+
+  if (cfg.endstopPin >= 0) {
+    pinMode(cfg.endstopPin, INPUT_PULLUP); // ajuste se usar outro esquema
+  }
+
+  if (cfg.drive == StepperDrive::MICROSTEP && ledcChannel < 0 && !beginMicrostep()) {
+    Serial.println("[STEPPER] Microstepping indisponível (LEDC/timer): usando half-step.");
+  }
+
+  currentSteps = 0;
+  targetSteps  = 0;
+  phaseIndex   = 0;
+  stepsHoming  = 0;
+  coordinated  = false;
+  appliedPhase = -1;
+  timedMove    = false;
+  timedDone    = false;
+  applyPhase(phaseIndex);
+
+  homed = (cfg.endstopPin < 0);  // se não tem fim de curso, assume homed lógico
+
+  setSpeed(speedStepsPerSec);
+  lastStepMicros = micros();
+  mode = Mode::IDLE;
+}
+
+void StepperMotor::applyPhase(uint8_t idx) {
+  idx &= phaseMask;
+  const uint8_t* next = phaseTable[idx];
+
+  if (ledcChannel >= 0) {
+    // MICROSTEP fora do timer (homing, movimento coordenado): half-step cheio via PWM
+    elecIndex = idx * MICROSTEPS_PER_HALFSTEP;
+    for (int k = 0; k < 4; k++) {
+      writeCoilDuty(k, next[k] ? DUTY_MAX : 0);
+    }
+    appliedPhase = idx;
+    return;
+  }
+
+  if (appliedPhase < 0) {
+    digitalWrite(cfg.in1Pin, next[0]);
+    digitalWrite(cfg.in2Pin, next[1]);
+    digitalWrite(cfg.in3Pin, next[2]);
+    digitalWrite(cfg.in4Pin, next[3]);
+  } else {
+    // Entre fases vizinhas só 1 ou 2 bobinas mudam: escreve só essas
+    const uint8_t* prev = phaseTable[appliedPhase];
+    if (next[0] != prev[0]) digitalWrite(cfg.in1Pin, next[0]);
+    if (next[1] != prev[1]) digitalWrite(cfg.in2Pin, next[1]);
+    if (next[2] != prev[2]) digitalWrite(cfg.in3Pin, next[2]);
+    if (next[3] != prev[3]) digitalWrite(cfg.in4Pin, next[3]);
+  }
+  appliedPhase = idx;
 }
 
 // Anda 1 passo em uma direção
-static void stepOnce(bool clockwise) {
+void StepperMotor::stepOnce(bool clockwise) {
   if (clockwise) {
-    phaseIndex = (phaseIndex + 1) & 0x07;
+    phaseIndex = (phaseIndex + 1) & phaseMask;
     currentSteps++;
   } else {
-    phaseIndex = (phaseIndex + 7) & 0x07; // -1 mod 8
+    phaseIndex = (phaseIndex + phaseMask) & phaseMask; // -1 mod nº de fases
     currentSteps--;
   }
 
-  // Mantém dentro de 0..STEPS_PER_REV-1
-  if (currentSteps >= STEPS_PER_REV) currentSteps -= STEPS_PER_REV;
-  if (currentSteps < 0)              currentSteps += STEPS_PER_REV;
+  // Mantém dentro de 0..stepsPerRev-1
+  if (currentSteps >= cfg.stepsPerRev) currentSteps -= cfg.stepsPerRev;
+  if (currentSteps < 0)                currentSteps += cfg.stepsPerRev;
 
   applyPhase(phaseIndex);
 }
 
-// Decide o menor caminho (horário ou anti) pra ir de currentSteps a targetSteps
-static void moveOneStepTowardTarget() {
+void StepperMotor::moveOneStepTowardTarget() {
   if (currentSteps == targetSteps) {
-    mode = StepperMode::IDLE;
+    mode = Mode::IDLE;
     return;
   }
 
@@ -107,148 +185,507 @@ static void moveOneStepTowardTarget() {
   stepOnce(clockwise);
 }
 
+void StepperMotor::homingStep() {
+  if (cfg.endstopPin < 0) {
+    // não tem fim de curso, aborta homing
+    mode = Mode::IDLE;
+    return;
+  }
+
+  // Anda sempre na direção do fim de curso, por exemplo “fechar”
+  // aqui vou assumir anti-horário (clockwise=false), ajuste se precisar
+  stepOnce(false);
+
+  // Travinha de segurança: se der mais de 3 voltas, aborta
+  stepsHoming++;
+  if (stepsHoming > cfg.stepsPerRev * 3) {
+    Serial.println("[STEPPER] Homing falhou (não achou fim de curso).");
+    mode = Mode::IDLE;
+    stepsHoming = 0;
+    return;
+  }
+
+  // Supondo fim de curso para GND: LOW = acionado
+  if (digitalRead(cfg.endstopPin) == LOW) {
+    Serial.println("[STEPPER] Homing OK. Zero definido.");
+    currentSteps = 0;
+    targetSteps  = 0;
+    homed        = true;
+    mode         = Mode::IDLE;
+    stepsHoming  = 0;
+  }
+}
+
+bool StepperMotor::tick() {
+  if (mode == Mode::MOVING) {
+    moveOneStepTowardTarget();
+    return mode == Mode::IDLE;
+  }
+  if (mode == Mode::HOMING) {
+    homingStep();
+    return mode == Mode::IDLE;
+  }
+  return false;
+}
+
+void StepperMotor::setTarget(long newTargetSteps) {
+  // Normaliza alvo pra 0..stepsPerRev-1 (sem laço: custo fixo pra qualquer valor)
+  newTargetSteps %= cfg.stepsPerRev;
+  if (newTargetSteps < 0) newTargetSteps += cfg.stepsPerRev;
+
+  targetSteps = newTargetSteps;
+  mode = Mode::MOVING;
+}
+
+void StepperMotor::leaveCoordinated() {
+  if (!coordinated) {
+    return;
+  }
+  if (group != nullptr) {
+    group->detach(*this);
+  }
+  coordinated = false;
+}
+
+void StepperMotor::moveToSteps(long newTargetSteps) {
+  leaveCoordinated();
+  setTarget(newTargetSteps);
+
+  if (ledcChannel >= 0) {
+    startTimedMove();
+  }
+}
+
+void StepperMotor::moveRelativeSteps(long deltaSteps) {
+  moveToSteps(currentSteps + deltaSteps);
+}
+
+void StepperMotor::setSpeed(float stepsPerSecond) {
+  speedStepsPerSec = (stepsPerSecond <= 0) ? 0 : stepsPerSecond;
+  if (speedStepsPerSec <= 0) {
+    stepIntervalMicros = 0;
+  } else {
+    stepIntervalMicros = (unsigned long)(1'000'000.0f / speedStepsPerSec);
+  }
+
+  // Velocidade nova vale já, se o timer estiver andando
+  if (timedMove) {
+    startTimedMove();
+  }
+}
+
+bool StepperMotor::isMoving() const {
+  return mode != Mode::IDLE;
+}
+
+long StepperMotor::getCurrentSteps() const {
+  return currentSteps;
+}
+
+long StepperMotor::getTargetSteps() const {
+  return targetSteps;
+}
+
+long StepperMotor::angleToSteps(float degrees) const {
+  // normaliza ângulo (fmodf: custo fixo mesmo pra ângulos enormes,
+  // onde o laço de ±360 levava milhares de voltas)
+  degrees = fmodf(degrees, 360.0f);
+  if (degrees < 0.0f) degrees += 360.0f;
+
+  // lroundf fica em float (round() promove pra double, emulado em software no ESP32)
+  long steps = lroundf(degrees * ((float)cfg.stepsPerRev / 360.0f));
+  if (steps >= cfg.stepsPerRev) steps = 0;
+  return steps;
+}
+
+void StepperMotor::moveToAngle(float degrees) {
+  moveToSteps(angleToSteps(degrees));
+}
+
+void StepperMotor::home() {
+  if (cfg.endstopPin < 0) {
+    Serial.println("[STEPPER] Homing chamado mas endstopPin = -1.");
+    return;
+  }
+  Serial.println("[STEPPER] Iniciando homing...");
+  stopTimedMove();
+  leaveCoordinated();
+  mode        = Mode::HOMING;
+  homed       = false;
+  stepsHoming = 0;
+}
+
+bool StepperMotor::isHomed() const {
+  return homed;
+}
+
 // ==========================
-// FUNÇÕES PÚBLICAS
+// StepperMotor: microstepping (LEDC + esp_timer)
 // ==========================
 
-void stepperInit() {
-  pinMode(STEPPER_IN1_PIN, OUTPUT);
-  pinMode(STEPPER_IN2_PIN, OUTPUT);
-  pinMode(STEPPER_IN3_PIN, OUTPUT);
-  pinMode(STEPPER_IN4_PIN, OUTPUT);
+bool StepperMotor::beginMicrostep() {
+  if (ledcChannelsUsed + 4 > LEDC_CHANNEL_MAX) {
+    return false;
+  }
 
-  digitalWrite(STEPPER_IN1_PIN, LOW);
-  digitalWrite(STEPPER_IN2_PIN, LOW);
-  digitalWrite(STEPPER_IN3_PIN, LOW);
-  digitalWrite(STEPPER_IN4_PIN, LOW);
+  // Um timer LEDC para todos os motores (mesma frequência/resolução)
+  if (ledcChannelsUsed == 0) {
+    ledc_timer_config_t timerCfg = {};
+    timerCfg.speed_mode      = LEDC_MODE;
+    timerCfg.duty_resolution = DUTY_RESOLUTION;
+    timerCfg.timer_num       = LEDC_TIMER;
+    timerCfg.freq_hz         = MICROSTEP_PWM_FREQ_HZ;
+    timerCfg.clk_cfg         = LEDC_AUTO_CLK;
+    if (ledc_timer_config(&timerCfg) != ESP_OK) {
+      return false;
+    }
+  }
 
-  if (ENDSTOP_PIN >= 0) {
-    pinMode(ENDSTOP_PIN, INPUT_PULLUP); // ajuste se usar outro esquema
+  const int pins[4] = { cfg.in1Pin, cfg.in2Pin, cfg.in3Pin, cfg.in4Pin };
+  for (int k = 0; k < 4; k++) {
+    ledc_channel_config_t ch = {};
+    ch.gpio_num   = pins[k];
+    ch.speed_mode = LEDC_MODE;
+    ch.channel    = (ledc_channel_t)(ledcChannelsUsed + k);
+    ch.intr_type  = LEDC_INTR_DISABLE;
+    ch.timer_sel  = LEDC_TIMER;
+    ch.duty       = 0;
+    ch.hpoint     = 0;
+    if (ledc_channel_config(&ch) != ESP_OK) {
+      return false;
+    }
+    appliedDuty[k] = 0;
   }
 
-  currentSteps = 0;
-  targetSteps  = 0;
-  phaseIndex   = 0;
-  applyPhase(phaseIndex);
+  esp_timer_create_args_t timerArgs = {};
+  timerArgs.callback        = &StepperMotor::timerCallback;
+  timerArgs.arg             = this;
+  timerArgs.dispatch_method = ESP_TIMER_TASK;
+  timerArgs.name            = "stepper";
+  if (esp_timer_create(&timerArgs, &stepTimer) != ESP_OK) {
+    return false;
+  }
 
-  homed = (ENDSTOP_PIN < 0);  // se não tem fim de curso, assume homed lógico
+  ledcChannel       = (int8_t)ledcChannelsUsed;
+  ledcChannelsUsed += 4;
+  return true;
+}
 
-  stepperSetSpeed(stepperSpeedStepsPerSec);
-  lastStepMicros = micros();
-  mode = StepperMode::IDLE;
+void StepperMotor::writeCoilDuty(int coil, uint16_t duty) {
+  if (appliedDuty[coil] == duty) {
+    return;
+  }
+  ledc_channel_t ch = (ledc_channel_t)(ledcChannel + coil);
+  ledc_set_duty(LEDC_MODE, ch, duty);
+  ledc_update_duty(LEDC_MODE, ch);
+  appliedDuty[coil] = duty;
+}
 
-  Serial.println("[STEPPER] 28BYJ-48 inicializado.");
+// Correntes das 4 bobinas para uma posição do ciclo elétrico: 4 consultas
+// à tabela, no máximo 4 escritas de registrador (custo fixo)
+void StepperMotor::writeElectrical(uint8_t elec) {
+  if (elecIncrement == 1) {
+    for (int k = 0; k < 4; k++) {
+      writeCoilDuty(k, MICROSTEP_DUTY[(elec - k * 16) & ELEC_MASK]);
+    }
+  } else {
+    const uint8_t* phase = HALFSTEP_SEQ[elec / MICROSTEPS_PER_HALFSTEP];
+    for (int k = 0; k < 4; k++) {
+      writeCoilDuty(k, phase[k] ? DUTY_MAX : 0);
+    }
+  }
 }
 
-// Chamar no loop()
-void stepperLoop() {
-  if (stepIntervalMicros == 0) {
-    return; // velocidade 0
+void StepperMotor::startTimedMove() {
+  if (stepTimer == nullptr || speedStepsPerSec <= 0) {
+    return;
   }
 
-  unsigned long now = micros();
-  if (now - lastStepMicros < stepIntervalMicros) {
-    return; // ainda não é hora do próximo passo
+  // Abaixo do limite: 8 micropassos por half-step; acima: half-step cheio
+  bool micro = speedStepsPerSec <= MICROSTEP_MAX_SPEED;
+  uint64_t periodUs = micro ? stepIntervalMicros / MICROSTEPS_PER_HALFSTEP : stepIntervalMicros;
+  if (periodUs < 50) periodUs = 50;  // piso do esp_timer
+
+  esp_timer_stop(stepTimer);  // reinicia com o período novo (erro se parado: ok)
+  portENTER_CRITICAL(&timerMux);
+  nextIncrement = micro ? 1 : MICROSTEPS_PER_HALFSTEP;
+  timedDone     = false;
+  timedMove     = true;
+  portEXIT_CRITICAL(&timerMux);
+  esp_timer_start_periodic(stepTimer, periodUs);
+}
+
+void StepperMotor::stopTimedMove() {
+  if (stepTimer != nullptr) {
+    esp_timer_stop(stepTimer);
   }
-  lastStepMicros = now;
+  // Um tick em andamento termina antes daqui; os seguintes não mexem em nada
+  portENTER_CRITICAL(&timerMux);
+  timedMove = false;
+  timedDone = false;
+  portEXIT_CRITICAL(&timerMux);
+
+  // Parou no meio de um half-step: volta para a fronteira da fase atual
+  if (ledcChannel >= 0 && (elecIndex % MICROSTEPS_PER_HALFSTEP) != 0) {
+    appliedPhase = -1;
+    applyPhase(phaseIndex);
+  }
+}
 
-  if (mode == StepperMode::MOVING) {
-    moveOneStepTowardTarget();
-  } else if (mode == StepperMode::HOMING) {
-    if (ENDSTOP_PIN < 0) {
-      // não tem fim de curso, aborta homing
-      mode = StepperMode::IDLE;
+void StepperMotor::timerCallback(void* arg) {
+  static_cast<StepperMotor*>(arg)->timerTick();
+}
+
+// Roda na task do esp_timer. Direção, fim e troca micro/half-step só são
+// decididos na fronteira de um half-step (onde a posição é inteira).
+// Tudo sob timerMux: o loop pode parar o movimento (stopTimedMove,
+// moveCoordinated) enquanto um tick já disparado ainda roda.
+void StepperMotor::timerTick() {
+  portENTER_CRITICAL(&timerMux);
+  if (!timedMove || timedDone) {
+    portEXIT_CRITICAL(&timerMux);  // parado pelo loop depois do disparo
+    return;
+  }
+
+  if ((elecIndex % MICROSTEPS_PER_HALFSTEP) == 0) {
+    long target = targetSteps;
+    if (currentSteps == target) {
+      // Dentro do mux: um startTimedMove do loop não é desfeito por este stop
+      esp_timer_stop(stepTimer);
+      timedDone = true;
+      portEXIT_CRITICAL(&timerMux);
       return;
     }
+    timedDir      = (target > currentSteps) ? 1 : -1;
+    elecIncrement = nextIncrement;
+  }
 
-    // Anda sempre na direção do fim de curso, por exemplo “fechar”
-    // aqui vou assumir anti-horário (clockwise=false), ajuste se precisar
-    stepOnce(false);
-
-    // Travinha de segurança: se der mais de 3 voltas, aborta
-    static long stepsHoming = 0;
-    stepsHoming++;
-    if (stepsHoming > STEPS_PER_REV * 3) {
-      Serial.println("[STEPPER] Homing falhou (não achou fim de curso).");
-      mode = StepperMode::IDLE;
-      stepsHoming = 0;
-      return;
+  elecIndex = (uint8_t)((elecIndex + timedDir * elecIncrement) & ELEC_MASK);
+  writeElectrical(elecIndex);
+
+  if ((elecIndex % MICROSTEPS_PER_HALFSTEP) == 0) {
+    long steps = currentSteps + timedDir;
+    if (steps >= cfg.stepsPerRev) steps -= cfg.stepsPerRev;
+    if (steps < 0)                steps += cfg.stepsPerRev;
+    currentSteps = steps;
+    phaseIndex   = elecIndex / MICROSTEPS_PER_HALFSTEP;
+    appliedPhase = phaseIndex;
+  }
+  portEXIT_CRITICAL(&timerMux);
+}
+
+// ==========================
+// StepperGroup
+// ==========================
+
+int StepperGroup::add(StepperMotor& m) {
+  if (motorCount >= MAX_MOTORS) {
+    return -1;
+  }
+  motors[motorCount] = &m;
+  m.group = this;
+  return motorCount++;
+}
+
+StepperMotor* StepperGroup::motor(int index) const {
+  return (index >= 0 && index < motorCount) ? motors[index] : nullptr;
+}
+
+void StepperGroup::moveCoordinated(const long* targets, int count) {
+  if (count > motorCount) count = motorCount;
+
+  coordMaster    = -1;
+  coordStepsLeft = 0;
+
+  // Quem estava no movimento anterior e não entra neste segue sozinho
+  for (int i = count; i < motorCount; i++) {
+    motors[i]->coordinated = false;
+  }
+
+  for (int i = 0; i < count; i++) {
+    StepperMotor& m = *motors[i];
+    m.stopTimedMove();  // quem dita o ritmo é o mestre, no loop
+    m.setTarget(targets[i]);
+    m.coordinated = false;
+    m.coordDelta = labs(m.targetSteps - m.currentSteps);
+    if (m.coordDelta > coordStepsLeft) {
+      coordStepsLeft = m.coordDelta;
+      coordMaster    = i;
     }
+  }
+
+  if (coordMaster < 0) {
+    return; // todo mundo já está no alvo
+  }
+
+  for (int i = 0; i < count; i++) {
+    StepperMotor& m = *motors[i];
+    m.coordinated = true;
+    m.coordError  = coordStepsLeft / 2;
+  }
+}
 
-    int endstopState = digitalRead(ENDSTOP_PIN);
-    // Supondo fim de curso para GND: LOW = acionado
-    if (endstopState == LOW) {
-      Serial.println("[STEPPER] Homing OK. Zero definido.");
-      currentSteps = 0;
-      targetSteps  = 0;
-      homed        = true;
-      mode         = StepperMode::IDLE;
-      stepsHoming  = 0;
+// Um motor ganhou alvo próprio no meio do movimento coordenado: os que
+// continuam refazem o Bresenham com o que falta a cada um (o mais longo
+// vira o mestre), senão o mestre/deltas antigos valeriam para quem saiu
+void StepperGroup::detach(StepperMotor& leaving) {
+  leaving.coordinated = false;
+  if (coordMaster < 0) {
+    return;
+  }
+
+  coordMaster    = -1;
+  coordStepsLeft = 0;
+  for (int i = 0; i < motorCount; i++) {
+    StepperMotor& m = *motors[i];
+    if (!m.coordinated) continue;
+    m.coordDelta = labs(m.targetSteps - m.currentSteps);
+    if (m.coordDelta > coordStepsLeft) {
+      coordStepsLeft = m.coordDelta;
+      coordMaster    = i;
+    }
+  }
+
+  for (int i = 0; i < motorCount; i++) {
+    StepperMotor& m = *motors[i];
+    if (!m.coordinated) continue;
+    if (coordMaster < 0) {
+      // Os que sobraram já estão no alvo
+      m.coordinated = false;
+      m.mode = StepperMotor::Mode::IDLE;
+      eventBusEmitMotionDone((uint8_t)i, m.currentSteps);
+    } else {
+      m.coordError = coordStepsLeft / 2;
     }
   }
 }
 
-void stepperMoveToSteps(long newTargetSteps) {
-  // Normaliza alvo pra 0..STEPS_PER_REV-1
-  while (newTargetSteps < 0)            newTargetSteps += STEPS_PER_REV;
-  while (newTargetSteps >= STEPS_PER_REV) newTargetSteps -= STEPS_PER_REV;
+// Um passo do mestre; cada seguidor anda quando o erro acumulado estoura
+void StepperGroup::coordinatedTick(unsigned long now) {
+  StepperMotor& master = *motors[coordMaster];
+  if (master.stepIntervalMicros == 0 || now - master.lastStepMicros < master.stepIntervalMicros) {
+    return;
+  }
+  master.lastStepMicros = now;
+
+  for (int i = 0; i < motorCount; i++) {
+    StepperMotor& m = *motors[i];
+    if (!m.coordinated) continue;
 
-  targetSteps = newTargetSteps;
-  mode = StepperMode::MOVING;
+    m.coordError -= m.coordDelta;
+    if (m.coordError < 0) {
+      m.coordError += master.coordDelta;
+      m.moveOneStepTowardTarget();
+    }
+  }
+
+  if (--coordStepsLeft <= 0) {
+    for (int i = 0; i < motorCount; i++) {
+      StepperMotor& m = *motors[i];
+      if (!m.coordinated) continue;
+      m.coordinated = false;
+      m.mode = StepperMotor::Mode::IDLE;
+      eventBusEmitMotionDone((uint8_t)i, m.currentSteps);
+    }
+    coordMaster = -1;
+  }
+}
+
+void StepperGroup::loop() {
+  unsigned long now = micros();
+
+  if (coordMaster >= 0) {
+    coordinatedTick(now);
+  }
+
+  for (int i = 0; i < motorCount; i++) {
+    StepperMotor& m = *motors[i];
+
+    // Microstepping: os passos saem do timer; aqui só fecha o movimento
+    if (m.timedMove) {
+      portENTER_CRITICAL(&m.timerMux);
+      bool done = m.timedDone;
+      portEXIT_CRITICAL(&m.timerMux);
+      if (done) {
+        if (m.currentSteps != m.targetSteps) {
+          m.startTimedMove();  // alvo mudou enquanto o timer parava
+        } else {
+          m.timedMove = false;
+          m.mode      = StepperMotor::Mode::IDLE;
+          eventBusEmitMotionDone((uint8_t)i, m.currentSteps);
+        }
+      }
+      continue;
+    }
+
+    if (m.coordinated || m.mode == StepperMotor::Mode::IDLE || m.stepIntervalMicros == 0) {
+      continue;
+    }
+    if (now - m.lastStepMicros < m.stepIntervalMicros) {
+      continue; // ainda não é hora do próximo passo
+    }
+    m.lastStepMicros = now;
+    if (m.tick()) {
+      eventBusEmitMotionDone((uint8_t)i, m.currentSteps);
+    }
+  }
+}
+
+// ==========================
+// MOTOR DO VARAL (API de sempre)
+// ==========================
+
+static StepperMotor varalMotor(VARAL_MOTOR_CONFIG);
+static StepperGroup group;
+
+StepperGroup& stepperGroup() {
+  return group;
+}
+
+void stepperInit() {
+  varalMotor.begin();
+  if (group.count() == 0) {
+    group.add(varalMotor);
+  }
+  Serial.println("[STEPPER] 28BYJ-48 inicializado.");
+}
+
+void stepperLoop() {
+  group.loop();
+}
+
+void stepperMoveToSteps(long targetSteps) {
+  varalMotor.moveToSteps(targetSteps);
 }
 
 void stepperMoveRelativeSteps(long deltaSteps) {
-  long newTarget = currentSteps + deltaSteps;
-  stepperMoveToSteps(newTarget);
+  varalMotor.moveRelativeSteps(deltaSteps);
 }
 
 void stepperSetSpeed(float stepsPerSecond) {
-  if (stepsPerSecond <= 0) {
-    stepperSpeedStepsPerSec = 0;
-  } else {
-    stepperSpeedStepsPerSec = stepsPerSecond;
-  }
-  updateStepInterval();
+  varalMotor.setSpeed(stepsPerSecond);
 }
 
 bool stepperIsMoving() {
-  return mode != StepperMode::IDLE;
+  return varalMotor.isMoving();
 }
 
 long stepperGetCurrentSteps() {
-  return currentSteps;
+  return varalMotor.getCurrentSteps();
 }
 
-// ===== ÂNGULO =====
-
 long stepperAngleToSteps(float degrees) {
-  // normaliza ângulo
-  while (degrees < 0.0f)   degrees += 360.0f;
-  while (degrees >= 360.0f) degrees -= 360.0f;
-
-  float ratio = degrees / 360.0f;
-  long steps  = (long)round(ratio * (float)STEPS_PER_REV);
-  if (steps >= STEPS_PER_REV) steps = 0;
-  return steps;
+  return varalMotor.angleToSteps(degrees);
 }
 
 void stepperMoveToAngle(float degrees) {
-  long target = stepperAngleToSteps(degrees);
-  stepperMoveToSteps(target);
+  varalMotor.moveToAngle(degrees);
 }
 
-// ===== HOMING =====
-
 void stepperHome() {
-  if (ENDSTOP_PIN < 0) {
-    Serial.println("[STEPPER] Homing chamado mas ENDSTOP_PIN = -1.");
-    return;
-  }
-  Serial.println("[STEPPER] Iniciando homing...");
-  mode  = StepperMode::HOMING;
-  homed = false;
+  varalMotor.home();
 }
 
 bool stepperIsHomed() {
-  return homed;
+  return varalMotor.isHomed();
 }
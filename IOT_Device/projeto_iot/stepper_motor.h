@@ -1,11 +1,190 @@
 #pragma once
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+
+// ==========================
+// CONFIGURAÇÃO POR MOTOR
+// ==========================
+
+// Modo de acionamento das 4 bobinas (ULN2003)
+enum class StepperDrive : uint8_t {
+  HALF_STEP,  // 8 fases (padrão do 28BYJ-48, ~4096 passos/volta)
+  FULL_STEP,  // 4 fases, 2 bobinas ligadas (mais torque, metade da resolução)
+  WAVE,       // 4 fases, 1 bobina ligada (menos consumo)
+  MICROSTEP   // PWM (LEDC) senoidal, 8 micropassos por half-step; posição em half-steps
+};
+
+// Microstepping (StepperDrive::MICROSTEP)
+// As 4 entradas do ULN2003 viram canais LEDC; a corrente de cada bobina segue
+// max(0, cos) numa tabela de 64 micropassos por ciclo elétrico (8 half-steps).
+// Os passos saem de um esp_timer, não do loop(). Acima de MICROSTEP_MAX_SPEED
+// (half-steps/s) o mesmo timer anda em half-steps cheios (mais torque).
+static const int      MICROSTEPS_PER_HALFSTEP = 8;
+static const float    MICROSTEP_MAX_SPEED     = 500.0f;
+static const uint32_t MICROSTEP_PWM_FREQ_HZ   = 20'000;  // acima do audível
+
+struct StepperConfig {
+  int  in1Pin;
+  int  in2Pin;
+  int  in3Pin;
+  int  in4Pin;
+  int  endstopPin;     // -1 = sem fim de curso
+  long stepsPerRev;    // passos por volta NO modo escolhido (MICROSTEP: em half-steps)
+  StepperDrive drive;
+};
+
+class StepperGroup;
+
+// ==========================
+// UM MOTOR
+// ==========================
+
+class StepperMotor {
+public:
+  explicit StepperMotor(const StepperConfig& config);
+
+  // Inicializa pinos/estado (chamar no setup)
+  void begin();
+
+  // === Movimento em STEPS ===
+  void moveToSteps(long targetSteps);       // alvo absoluto (0..steps por volta)
+  void moveRelativeSteps(long deltaSteps);  // movimento relativo
+
+  void setSpeed(float stepsPerSecond);      // passos por segundo
+  bool isMoving() const;
+  long getCurrentSteps() const;
+  long getTargetSteps() const;
+
+  // === Movimento em ÂNGULO (0–360) ===
+  long angleToSteps(float degrees) const;
+  void moveToAngle(float degrees);
+
+  // === Homing (se endstopPin >= 0) ===
+  void home();
+  bool isHomed() const;
+
+  const StepperConfig& config() const { return cfg; }
+
+private:
+  friend class StepperGroup;
+
+  // Sai do movimento coordenado (novo alvo próprio, homing)
+  void leaveCoordinated();
+
+  enum class Mode : uint8_t {
+    IDLE,
+    MOVING,
+    HOMING
+  };
+
+  void applyPhase(uint8_t idx);
+  void stepOnce(bool clockwise);
+  void moveOneStepTowardTarget();
+  void homingStep();
+  void setTarget(long newTargetSteps);
+
+  // Microstepping: PWM por bobina + passos no esp_timer
+  bool beginMicrostep();
+  void writeCoilDuty(int coil, uint16_t duty);
+  void writeElectrical(uint8_t elec);
+  void startTimedMove();
+  void stopTimedMove();
+  void timerTick();
+  static void timerCallback(void* arg);
+
+  // Chamado pelo StepperGroup quando chega a hora do próximo passo.
+  // Retorna true se o motor acabou de ficar parado.
+  bool tick();
+
+  StepperConfig cfg;
+
+  const uint8_t (*phaseTable)[4];
+  uint8_t phaseMask;       // nº de fases - 1 (tabelas com 4 ou 8 fases)
+  uint8_t phaseIndex = 0;
+  int8_t  appliedPhase = -1;  // fase nas saídas agora (-1 = desconhecida)
+
+  long currentSteps = 0;   // sempre 0..stepsPerRev-1
+  long targetSteps  = 0;
+  long stepsHoming  = 0;
+
+  float         speedStepsPerSec   = 400.0f; // velocidade padrão
+  unsigned long stepIntervalMicros = 0;
+  unsigned long lastStepMicros     = 0;
+
+  bool homed = false;
+  Mode mode  = Mode::IDLE;
+
+  // Microstepping (só com StepperDrive::MICROSTEP e canais LEDC livres)
+  int8_t             ledcChannel = -1;        // 1º dos 4 canais (-1 = GPIO comum)
+  esp_timer_handle_t stepTimer   = nullptr;
+  uint16_t           appliedDuty[4] = {};
+  uint8_t            elecIndex      = 0;      // posição no ciclo elétrico (0..63)
+  uint8_t            elecIncrement  = 1;      // 1 = micropasso, 8 = half-step cheio
+  uint8_t            nextIncrement  = 1;      // troca só na fronteira de half-step
+  int8_t             timedDir       = 1;
+  bool               timedMove      = false;  // passos saindo do timer
+  bool               timedDone      = false;  // timer chegou no alvo (o loop fecha)
+  // esp_timer_stop não espera um tick que já começou: o estado do movimento
+  // no timer só muda com este mux (o tick sai na hora se timedMove caiu)
+  portMUX_TYPE       timerMux       = portMUX_INITIALIZER_UNLOCKED;
+
+  // Movimento coordenado (Bresenham): segue os passos do motor "mestre"
+  StepperGroup* group = nullptr;  // grupo em que foi registrado
+  bool coordinated = false;
+  long coordDelta  = 0;    // |passos| que este motor precisa dar
+  long coordError  = 0;
+};
+
+// ==========================
+// GRUPO DE MOTORES (uma base de tempo só)
+// ==========================
+
+class StepperGroup {
+public:
+  static const int MAX_MOTORS = 8;
+
+  // Registra um motor no grupo (retorna o índice ou -1 se lotado)
+  int add(StepperMotor& motor);
+
+  // Chamar no loop(): lê o relógio uma vez e dá os passos vencidos de todos
+  void loop();
+
+  // Move vários motores juntos para que todos cheguem ao mesmo tempo.
+  // O motor com o maior deslocamento dita o ritmo (na velocidade dele);
+  // os outros passam a seguir por Bresenham.
+  void moveCoordinated(const long* targets, int count);
+
+  int count() const { return motorCount; }
+  StepperMotor* motor(int index) const;
+
+private:
+  friend class StepperMotor;
+
+  void coordinatedTick(unsigned long now);
+  void detach(StepperMotor& motor);
+
+  StepperMotor* motors[MAX_MOTORS] = {};
+  int motorCount = 0;
+
+  // Movimento coordenado em andamento
+  int  coordMaster    = -1;
+  long coordStepsLeft = 0;
+};
+
+// ==========================
+// MOTOR DO VARAL (API de sempre)
+// ==========================
 
 // Inicializa motor (pinos, estado, etc.)
 void stepperInit();
 
-// Chamar no loop (não bloqueante)
+// Chamar no loop (não bloqueante) — avança todos os motores do grupo
 void stepperLoop();
 
+// Grupo global (para registrar motores de outros varais da sacada)
+StepperGroup& stepperGroup();
+
 // === Movimento em STEPS (half-steps) ===
 void stepperMoveToSteps(long targetSteps);     // alvo absoluto (0..steps por volta)
 void stepperMoveRelativeSteps(long deltaSteps); // movimento relativo
@@ -20,6 +199,6 @@ void stepperMoveToAngle(float degrees);        // move pro ângulo alvo (0–360
 
 // === Homing (opcional, com fim de curso) ===
 // Se você não tiver fim de curso, pode deixar implementado
-// mas não chamar, ou marcar ENDSTOP_PIN = -1 no .cpp
+// mas não chamar, ou marcar endstopPin = -1 na configuração do .cpp
 void stepperHome();
 bool stepperIsHomed();
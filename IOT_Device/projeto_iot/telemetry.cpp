@@ -0,0 +1,250 @@
+#include <Arduino.h>
+#include <stdarg.h>
+
+#include "telemetry.h"
+#include "dht11_sensor.h"
+#include "rain_sensor.h"
+#include "rain_predictor.h"
+#include "sensor_registry.h"
+#include "loop_profiler.h"
+#include "mem_monitor.h"
+#include "mqtt_transport.h"
+#include "rule_engine.h"
+#include "desired_state.h"
+#include "ota_update.h"
+
+// ==========================
+// ESCRITA NO BUFFER
+// ==========================
+
+struct JsonWriter {
+  char*  out;
+  size_t capacity;
+  size_t len;
+  bool   overflow;
+};
+
+// Anexa (printf); marca estouro em vez de cortar o JSON no meio
+static void append(JsonWriter& w, const char* fmt, ...) {
+  if (w.overflow) {
+    return;
+  }
+  va_list args;
+  va_start(args, fmt);
+  int n = vsnprintf(w.out + w.len, w.capacity - w.len, fmt, args);
+  va_end(args);
+
+  if (n < 0 || w.len + n >= w.capacity) {
+    w.overflow = true;
+    return;
+  }
+  w.len += n;
+}
+
+// Anexa um bloco gerado por outro módulo direto no buffer
+static void appendReport(JsonWriter& w, int (*report)(char*, size_t)) {
+  if (w.overflow) {
+    return;
+  }
+  int n = report(w.out + w.len, w.capacity - w.len);
+  if (n <= 0) {
+    w.overflow = true;
+    return;
+  }
+  w.len += n;
+}
+
+// Campos do estado reportado (também entram nos deltas)
+static void appendDht(JsonWriter& w) {
+  if (dht11HasValidData()) {
+    append(w, "\"temp_c\":%.1f,\"humidity\":%.1f", dht11GetTemperatureC(), dht11GetHumidity());
+  } else {
+    append(w, "\"temp_c\":null,\"humidity\":null");
+  }
+}
+
+// Corpo completo (sem as chaves de abertura/fechamento)
+static void appendFullBody(JsonWriter& w) {
+  // DHT
+  appendDht(w);
+
+  // Chuva
+  append(w, ",\"rain\":%s", rainIsRaining() ? "true" : "false");
+
+  // Previsão de chuva (tendência)
+  append(w, ",\"rain_likely\":%s", rainPredictorIsRainLikely() ? "true" : "false");
+
+  // Modo atual do varal
+  append(w, ",\"mode\":\"%s\"", telemetryModeName(varalControllerGetMode()));
+
+  // Estatísticas da janela de cada sensor registrado: [média, mín, máx]
+  append(w, ",\"sensors\":{");
+  bool first = true;
+  for (int i = 0; i < sensorRegistryCount(); i++) {
+    SensorView* sensor = sensorRegistryGet(i);
+    if (sensor->sampleCount() == 0) continue;
+    for (int c = 0; c < sensor->channelCount(); c++) {
+      append(w, "%s\"%s.%s\":[%.1f,%.1f,%.1f]",
+             first ? "" : ",", sensor->name(), sensor->channelName(c),
+             sensor->channelMean(c), sensor->channelMin(c), sensor->channelMax(c));
+      first = false;
+    }
+  }
+  append(w, "}");
+
+  // Programa de regras ativo e última decisão
+  append(w, ",\"rules\":");
+  appendReport(w, ruleEngineReportJson);
+
+  // Latência sensor/comando -> motor da última reação do controlador
+  append(w, ",\"reaction_ms\":%lu", varalControllerGetLastReactionMs());
+
+  // Custo de cada etapa do loop desde o último relatório completo: [média, máx] em µs
+  append(w, ",\"loop_us\":");
+  appendReport(w, loopProfilerReportJson);
+
+  // Memória: heap, alocações no loop e pilha das tasks
+  append(w, ",\"mem\":");
+  appendReport(w, memMonitorReportJson);
+
+  // Fila de saída MQTT: em voo, reenvios, descartes
+  append(w, ",\"mqtt\":");
+  appendReport(w, mqttTransportReportJson);
+
+  // Atualização OTA em andamento (ou o resultado da última)
+  append(w, ",\"ota\":");
+  appendReport(w, otaReportJson);
+}
+
+// ==========================
+// ESTADO REPORTADO (deltas)
+// ==========================
+
+// Mudança mínima para temperatura/umidade entrarem num delta
+static const float TEMP_DEADBAND_C       = 0.5f;
+static const float HUMIDITY_DEADBAND_PCT = 2.0f;
+
+// Relatório completo a cada N heartbeats (rede de segurança p/ deltas perdidos)
+static const uint8_t FULL_REPORT_EVERY = 10;
+
+struct ReportedState {
+  bool      dhtValid;
+  float     tempC;
+  float     humidity;
+  bool      rain;
+  bool      rainLikely;
+  VaralMode mode;
+  uint32_t  desiredVersion;
+  uint16_t  heartbeatS;
+};
+
+static ReportedState reported;               // o que o backend já recebeu
+static uint32_t      reportedVersion   = 0;  // "rv": sobe a cada relatório
+static uint8_t       reportsSinceFull  = 0;
+static bool          fullReportPending = true; // o primeiro depois do boot é completo
+
+static ReportedState captureState() {
+  ReportedState s;
+  s.dhtValid       = dht11HasValidData();
+  s.tempC          = s.dhtValid ? dht11GetTemperatureC() : 0.0f;
+  s.humidity       = s.dhtValid ? dht11GetHumidity() : 0.0f;
+  s.rain           = rainIsRaining();
+  s.rainLikely     = rainPredictorIsRainLikely();
+  s.mode           = varalControllerGetMode();
+  s.desiredVersion = desiredStateVersion();
+  s.heartbeatS     = desiredStateHeartbeatIntervalMs() / 1000UL;
+  return s;
+}
+
+static bool dhtChanged(const ReportedState& now) {
+  if (now.dhtValid != reported.dhtValid) {
+    return true;
+  }
+  return now.dhtValid && (fabsf(now.tempC - reported.tempC) >= TEMP_DEADBAND_C ||
+                          fabsf(now.humidity - reported.humidity) >= HUMIDITY_DEADBAND_PCT);
+}
+
+// Só os campos que mudaram desde o último relatório; cada um começa com ','
+static void appendDelta(JsonWriter& w, const ReportedState& now) {
+  if (dhtChanged(now)) {
+    append(w, ",");
+    appendDht(w);
+  }
+  if (now.rain != reported.rain) {
+    append(w, ",\"rain\":%s", now.rain ? "true" : "false");
+  }
+  if (now.rainLikely != reported.rainLikely) {
+    append(w, ",\"rain_likely\":%s", now.rainLikely ? "true" : "false");
+  }
+  if (now.mode != reported.mode) {
+    append(w, ",\"mode\":\"%s\"", telemetryModeName(now.mode));
+  }
+  if (now.heartbeatS != reported.heartbeatS) {
+    append(w, ",\"hb_s\":%u", (unsigned)now.heartbeatS);
+  }
+}
+
+// ==========================
+// API
+// ==========================
+
+const char* telemetryModeName(VaralMode mode) {
+  switch (mode) {
+    case VaralMode::AUTO:        return "AUTO";
+    case VaralMode::FORCE_OPEN:  return "FORCE_OPEN";
+    case VaralMode::FORCE_CLOSE: return "FORCE_CLOSE";
+    default:                     return "UNKNOWN";
+  }
+}
+
+int telemetryBuildHeartbeat(char* out, size_t capacity) {
+  JsonWriter w = { out, capacity, 0, capacity == 0 };
+  append(w, "{");
+  appendFullBody(w);
+
+  // Timestamp local (millis)
+  append(w, ",\"uptime_ms\":%lu}", millis());
+
+  return w.overflow ? 0 : (int)w.len;
+}
+
+int telemetryBuildReport(char* out, size_t capacity) {
+  ReportedState now = captureState();
+  bool full = fullReportPending || reportsSinceFull + 1 >= FULL_REPORT_EVERY;
+  uint32_t version = reportedVersion + 1;
+
+  JsonWriter w = { out, capacity, 0, capacity == 0 };
+  append(w, "{\"rv\":%lu,\"dv\":%lu", (unsigned long)version, (unsigned long)now.desiredVersion);
+  if (full) {
+    append(w, ",\"full\":true,\"hb_s\":%u,", (unsigned)now.heartbeatS);
+    appendFullBody(w);
+  } else {
+    appendDelta(w, now);
+  }
+  append(w, ",\"uptime_ms\":%lu}", millis());
+
+  if (w.overflow) {
+    return 0; // nada muda: o próximo relatório tenta de novo a partir do mesmo ponto
+  }
+
+  // Deltas são contra o que foi reportado (não contra a última leitura):
+  // uma variação lenta abaixo da faixa morta acaba aparecendo
+  if (!full && !dhtChanged(now)) {
+    now.tempC    = reported.tempC;
+    now.humidity = reported.humidity;
+  }
+  reported        = now;
+  reportedVersion = version;
+  if (full) {
+    fullReportPending = false;
+    reportsSinceFull  = 0;
+    loopProfilerResetWindow(); // "loop_us" cobre o intervalo entre relatórios completos
+  } else {
+    reportsSinceFull++;
+  }
+  return (int)w.len;
+}
+
+void telemetryRequestFullReport() {
+  fullReportPending = true;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <Arduino.h>
+#include "varal_controller.h"
+
+// ==========================================================
+// TELEMETRIA (JSON do heartbeat)
+// ==========================================================
+//
+// Monta o JSON do heartbeat: DHT, chuva, previsão, modo, janela dos
+// sensores, regras, reação do controlador, perfil do loop, memória e fila
+// MQTT. O servidor local recebe sempre o objeto completo; o backend recebe
+// relatórios versionados só com o que mudou (ver telemetryBuildReport).
+// Escreve num buffer do chamador; nada é alocado.
+
+// Heartbeat completo (servidor local e relatórios completos).
+// Escreve em 'out'. Retorna o nº de caracteres escritos
+// (0 se não coube: o JSON nunca sai cortado no meio).
+int telemetryBuildHeartbeat(char* out, size_t capacity);
+
+// Nome do modo como aparece no JSON ("AUTO", "FORCE_OPEN", "FORCE_CLOSE")
+const char* telemetryModeName(VaralMode mode);
+
+// Relatório para o backend (heartbeat MQTT), com versão "rv" e a versão do
+// estado desejado já aplicada "dv". Normalmente só leva os campos do estado
+// que mudaram desde o relatório anterior (temperatura/umidade com faixa
+// morta); a cada FULL_REPORT_EVERY, no boot ou quando pedido, vai completo
+// com "full":true. Retorna como telemetryBuildHeartbeat.
+int telemetryBuildReport(char* out, size_t capacity);
+
+// Próximo relatório completo (backend pediu "SYNC": perdeu algum delta)
+void telemetryRequestFullReport();
@@ -1,7 +1,11 @@
 #include <Arduino.h>
 #include "varal_controller.h"
 #include "rain_sensor.h"
+#include "rain_predictor.h"
 #include "stepper_motor.h"
+#include "event_bus.h"
+#include "flight_recorder.h"
+#include "rule_engine.h"
 
 // Ângulos do varal (ajuste de acordo com o teu mecanismo)
 static const float VARAL_ANGULO_FECHADO = 0.0f;
@@ -20,9 +24,47 @@ static VaralState varalState = VaralState::UNKNOWN;
 static VaralMode currentMode = VaralMode::AUTO;
 
 // Controle de frequência das decisões
+// (eventos de chuva/modo/motor decidem na hora; o intervalo é só rede de segurança,
+// ex: previsão de chuva, que não gera evento)
 static unsigned long lastDecisionMillis = 0;
 static const unsigned long DECISION_INTERVAL_MS = 2000; // 2s
 
+// Latência evento -> motor: instante do evento ainda não atendido
+static bool          triggerPending     = false;
+static unsigned long triggerMillis      = 0;
+static unsigned long lastReactionMillis = 0;
+
+// Transição automática segurada pelos limites do programa (contada uma vez)
+static bool moveHeld = false;
+
+// =======================
+// FUNÇÕES INTERNAS
+// =======================
+
+static void startMove(float angle) {
+  stepperMoveToAngle(angle);
+  flightRecorderLogMoveStart(0, stepperAngleToSteps(angle));
+
+  if (triggerPending) {
+    lastReactionMillis = millis() - triggerMillis;
+    triggerPending     = false;
+    Serial.print("[VARAL] Reação em ");
+    Serial.print(lastReactionMillis);
+    Serial.println(" ms");
+  }
+}
+
+static void decide();
+static void applyMode();
+
+static void onControllerEvent(const Event& event) {
+  if (!triggerPending) {
+    triggerPending = true;
+    triggerMillis  = event.millis;
+  }
+  decide();
+}
+
 // =======================
 // API
 // =======================
@@ -31,6 +73,17 @@ void varalControllerInit() {
   varalState = VaralState::UNKNOWN;
   currentMode = VaralMode::AUTO;     // sempre começa em AUTO, como antes
   lastDecisionMillis = 0;
+  triggerPending     = false;
+
+  // Reage na hora a chuva, comando e fim de movimento
+  static bool subscribed = false;
+  if (!subscribed) {
+    eventBusSubscribe(EventType::RAIN_LEVEL_CHANGED, onControllerEvent);
+    eventBusSubscribe(EventType::MODE_CHANGED,       onControllerEvent);
+    eventBusSubscribe(EventType::MOTION_DONE,        onControllerEvent);
+    subscribed = true;
+  }
+
   Serial.println("[VARAL] Controller inicializado (modo AUTO).");
 }
 
@@ -42,12 +95,30 @@ void varalControllerSetMode(VaralMode mode) {
     case VaralMode::FORCE_OPEN:  Serial.println("FORCE_OPEN");  break;
     case VaralMode::FORCE_CLOSE: Serial.println("FORCE_CLOSE"); break;
   }
+  eventBusEmitMode(mode);
+}
+
+bool varalControllerHandleCommand(const char* cmd) {
+  if (strcmp(cmd, "OPEN") == 0) {
+    varalControllerSetMode(VaralMode::FORCE_OPEN);
+  } else if (strcmp(cmd, "CLOSE") == 0) {
+    varalControllerSetMode(VaralMode::FORCE_CLOSE);
+  } else if (strcmp(cmd, "AUTO") == 0) {
+    varalControllerSetMode(VaralMode::AUTO);
+  } else {
+    return false;
+  }
+  return true;
 }
 
 VaralMode varalControllerGetMode() {
   return currentMode;
 }
 
+unsigned long varalControllerGetLastReactionMs() {
+  return lastReactionMillis;
+}
+
 // =======================
 // LOOP
 // =======================
@@ -59,7 +130,15 @@ void varalControllerLoop() {
   if (now - lastDecisionMillis < DECISION_INTERVAL_MS) {
     return;
   }
-  lastDecisionMillis = now;
+  decide();
+}
+
+// =======================
+// DECISÃO
+// =======================
+
+static void decide() {
+  lastDecisionMillis = millis();
 
   // Se o motor ainda está em movimento, espera ele terminar
   if (stepperIsMoving()) {
@@ -78,33 +157,63 @@ void varalControllerLoop() {
     Serial.println("[VARAL] Estado inicial assumido: FECHADO");
   }
 
-  // ======== MODO AUTO (COMPORTAMENTO ANTIGO) ========
+  applyMode();
+
+  // Decisão tomada: se não precisou mover, o evento já está atendido
+  triggerPending = false;
+}
+
+static void applyMode() {
+  // ======== MODO AUTO ========
+  // Programa de regras (se houver) decide; senão, ou se ele não decidir,
+  // vale a regra fixa: chovendo (ou prestes a chover) fecha, seco abre
   if (currentMode == VaralMode::AUTO) {
-    bool chovendo = rainIsRaining();
-
-    if (chovendo) {
-      // Chovendo -> fechamos o varal se ainda não estiver fechado
-      if (varalState != VaralState::FECHADO) {
-        Serial.println("[VARAL] AUTO: Chovendo -> FECHAR varal");
-        stepperMoveToAngle(VARAL_ANGULO_FECHADO);
-        varalState = VaralState::FECHADO;
+    bool chovendo      = rainIsRaining();
+    bool chuvaProvavel = rainPredictorIsRainLikely();
+
+    RuleAction action = ruleEngineEvaluate(varalState == VaralState::ABERTO);
+    bool fechar = (action == RuleAction::DEFAULT) ? (chovendo || chuvaProvavel)
+                                                  : (action == RuleAction::CLOSE);
+    VaralState desejado = fechar ? VaralState::FECHADO : VaralState::ABERTO;
+    if (varalState == desejado) {
+      moveHeld = false;
+      return;
+    }
+
+    // Permanência mínima / movimentos por hora do programa. Fechar com
+    // chuva nunca espera: os limites são contra abre-fecha à toa, não
+    // para deixar a roupa na chuva
+    bool fecharPorChuva = fechar && chovendo;
+    if (!fecharPorChuva && !ruleEngineMoveAllowed()) {
+      if (!moveHeld) {
+        moveHeld = true;
+        ruleEngineNoteBlocked();
       }
+      return;
+    }
+    moveHeld = false;
+
+    if (action != RuleAction::DEFAULT) {
+      Serial.println(fechar ? "[VARAL] AUTO: Regra -> FECHAR varal" : "[VARAL] AUTO: Regra -> ABRIR varal");
+    } else if (fechar && chovendo) {
+      Serial.println("[VARAL] AUTO: Chovendo -> FECHAR varal");
+    } else if (fechar) {
+      Serial.println("[VARAL] AUTO: Chuva provável -> FECHAR varal (antecipado)");
     } else {
-      // Não está chovendo -> abrimos o varal se ainda não estiver aberto
-      if (varalState != VaralState::ABERTO) {
-        Serial.println("[VARAL] AUTO: Seco -> ABRIR varal");
-        stepperMoveToAngle(VARAL_ANGULO_ABERTO);
-        varalState = VaralState::ABERTO;
-      }
+      Serial.println("[VARAL] AUTO: Seco -> ABRIR varal");
     }
+    startMove(fechar ? VARAL_ANGULO_FECHADO : VARAL_ANGULO_ABERTO);
+    ruleEngineNoteMove();
+    varalState = desejado;
     return; // já tratou AUTO, sai
   }
+  moveHeld = false;
 
   // ======== MODO FORCE_OPEN ========
   if (currentMode == VaralMode::FORCE_OPEN) {
     if (varalState != VaralState::ABERTO) {
       Serial.println("[VARAL] FORCE_OPEN: Abrindo varal (ignorando chuva)");
-      stepperMoveToAngle(VARAL_ANGULO_ABERTO);
+      startMove(VARAL_ANGULO_ABERTO);
       varalState = VaralState::ABERTO;
     }
     return;
@@ -114,7 +223,7 @@ void varalControllerLoop() {
   if (currentMode == VaralMode::FORCE_CLOSE) {
     if (varalState != VaralState::FECHADO) {
       Serial.println("[VARAL] FORCE_CLOSE: Fechando varal (ignorando chuva)");
-      stepperMoveToAngle(VARAL_ANGULO_FECHADO);
+      startMove(VARAL_ANGULO_FECHADO);
       varalState = VaralState::FECHADO;
     }
     return;
@@ -11,6 +11,14 @@ enum class VaralMode : uint8_t {
 void varalControllerInit();
 void varalControllerLoop();
 
-// usados pelo MQTT
+// usados pelo MQTT e pelo servidor local
 void varalControllerSetMode(VaralMode mode);
 VaralMode varalControllerGetMode();
+
+// Comando de modo já normalizado ("OPEN", "CLOSE" ou "AUTO").
+// Retorna false se não for um comando de modo.
+bool varalControllerHandleCommand(const char* cmd);
+
+// Tempo entre o evento que disparou a última decisão (mudança de chuva,
+// comando) e o início do movimento do motor, em ms
+unsigned long varalControllerGetLastReactionMs();
@@ -1,6 +1,7 @@
 #include <Arduino.h>
 #include <WiFi.h>
 #include "wifi_manager.h"
+#include "mem_monitor.h"
 
 // =======================
 // Configurações de Wi-Fi
@@ -21,10 +22,15 @@ static void printWiFiStatus() {
   wl_status_t status = WiFi.status();
 
   switch (status) {
-    case WL_CONNECTED:
+    case WL_CONNECTED: {
+      // IP formatado num buffer fixo (sem String)
+      IPAddress ip = WiFi.localIP();
+      char ipText[16];
+      snprintf(ipText, sizeof(ipText), "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
       Serial.print("Conectado | IP: ");
-      Serial.println(WiFi.localIP());
+      Serial.println(ipText);
       break;
+    }
     case WL_IDLE_STATUS:
       Serial.println("Idle");
       break;
@@ -98,7 +104,10 @@ void handleWiFi() {
 
   if (WiFi.status() != WL_CONNECTED) {
     Serial.println("[WiFi] Conexão perdida, tentando reconectar...");
+    // Reconexão aloca na pilha de rede: fora da contagem do monitor
+    memMonitorAllowAllocations(true);
     connectWiFi();
+    memMonitorAllowAllocations(false);
   }
 }
 
@@ -0,0 +1,149 @@
+import asyncio
+import time
+from typing import List, Literal, Optional
+
+from fastapi import APIRouter, HTTPException, Query, WebSocket, WebSocketDisconnect
+from pydantic import BaseModel
+
+from app.core.history_store import history_store
+from app.core.mqtt_client import mqtt_manager
+from app.core.tag_store import tag_store
+from app.models.group import TagList
+from app.models.heartbeat import Heartbeat
+from app.models.history import HistoryResponse
+from app.models.state import DesiredState, DesiredUpdate, DeviceState
+
+router = APIRouter(prefix="/devices", tags=["Devices"])
+
+# Sem eventos por esse tempo, manda um ping (detecta cliente que caiu)
+STREAM_PING_S = 25.0
+
+
+class CommandRequest(BaseModel):
+    command: str  # "OPEN", "CLOSE", "AUTO" etc.
+
+
+@router.get("/", response_model=List[Heartbeat])
+def list_devices():
+    """Lista os dispositivos conhecidos com o último heartbeat de cada um."""
+    return mqtt_manager.list_devices()
+
+
+@router.get("/{device_id}/heartbeat", response_model=Heartbeat)
+def get_heartbeat(device_id: str):
+    """Retorna o último heartbeat recebido do ESP32 indicado."""
+    hb = mqtt_manager.get_last_heartbeat(device_id)
+    if hb is None:
+        raise HTTPException(
+            status_code=404,
+            detail=f"Ainda não recebi heartbeat de '{device_id}'.",
+        )
+    return hb
+
+
+@router.get("/{device_id}/history", response_model=HistoryResponse)
+def get_history(
+    device_id: str,
+    start: Optional[float] = Query(None, description="epoch em segundos (padrão: 24h atrás)"),
+    end: Optional[float] = Query(None, description="epoch em segundos (padrão: agora)"),
+    resolution: Literal["auto", "raw", "1m", "1h"] = "auto",
+    max_points: int = Query(1000, ge=10, le=5000),
+):
+    """Histórico agregado (mín/máx/média por bucket) no intervalo pedido."""
+    end = time.time() if end is None else end
+    start = end - 86400 if start is None else start
+    if start >= end:
+        raise HTTPException(status_code=400, detail="start deve ser menor que end.")
+
+    used, step, points = history_store.query(device_id, start, end, resolution, max_points)
+    return HistoryResponse(
+        device_id=device_id, start=start, end=end,
+        resolution=used, step_s=step, points=points,
+    )
+
+
+@router.get("/{device_id}/state", response_model=DeviceState)
+def get_state(device_id: str):
+    """Estado desejado x reportado, com os campos ainda não aplicados ("delta")."""
+    state = mqtt_manager.get_state(device_id)
+    if state is None:
+        raise HTTPException(status_code=404, detail=f"Nada conhecido sobre '{device_id}'.")
+    return state
+
+
+@router.put("/{device_id}/desired", response_model=DesiredState)
+def set_desired(device_id: str, body: DesiredUpdate):
+    """
+    Muda o estado desejado (modo e/ou intervalo do heartbeat). Fica retido no
+    broker: se o varal estiver offline, aplica quando reconectar.
+    """
+    if body.mode is None and body.heartbeat_s is None:
+        raise HTTPException(status_code=400, detail="Informe mode e/ou heartbeat_s.")
+
+    desired = mqtt_manager.set_desired(device_id, mode=body.mode, heartbeat_s=body.heartbeat_s)
+    if desired is None:
+        raise HTTPException(status_code=500, detail="Falha ao publicar estado desejado no MQTT.")
+    return desired
+
+
+@router.get("/{device_id}/tags", response_model=TagList)
+def get_tags(device_id: str):
+    """Tags do varal (usadas para selecionar grupos em POST /groups/cmd)."""
+    return TagList(tags=tag_store.get_tags(device_id))
+
+
+@router.put("/{device_id}/tags", response_model=TagList)
+def set_tags(device_id: str, body: TagList):
+    """Substitui as tags do varal (lista vazia remove todas)."""
+    return TagList(tags=tag_store.set_tags(device_id, body.tags))
+
+
+@router.post("/{device_id}/cmd")
+def send_command(device_id: str, body: CommandRequest):
+    """
+    Envia um comando para o ESP32 indicado via MQTT (AWS IoT Core). Vira
+    estado desejado: não se perde se o varal estiver offline.
+    """
+    cmd = body.command.upper().strip()
+    if cmd not in ("OPEN", "CLOSE", "AUTO"):
+        raise HTTPException(
+            status_code=400,
+            detail="Comando inválido. Use OPEN, CLOSE ou AUTO.",
+        )
+
+    ok = mqtt_manager.publish_command(device_id, cmd)
+    if not ok:
+        raise HTTPException(
+            status_code=500,
+            detail="Falha ao publicar comando no MQTT.",
+        )
+
+    return {"status": "ok", "device_id": device_id, "sent": cmd}
+
+
+@router.websocket("/{device_id}/ws")
+async def heartbeat_stream(websocket: WebSocket, device_id: str):
+    """
+    Stream em tempo real do dispositivo: heartbeats, comandos enviados e
+    confirmações ("ack"). Ao conectar, o último heartbeat conhecido já vai
+    como primeiro evento. Use "*" como device_id para receber todos.
+    """
+    await websocket.accept()
+    sub = mqtt_manager.events.subscribe(None if device_id == "*" else device_id)
+    try:
+        hb = None if device_id == "*" else mqtt_manager.get_last_heartbeat(device_id)
+        if hb is not None:
+            await websocket.send_json({"type": "heartbeat", "device_id": device_id, "data": hb.model_dump(mode="json")})
+
+        while True:
+            try:
+                event = await asyncio.wait_for(sub.next(), timeout=STREAM_PING_S)
+            except asyncio.TimeoutError:
+                event = {"type": "ping"}
+            if sub.dropped:
+                event = {**event, "dropped": sub.dropped}
+            await websocket.send_json(event)
+    except (WebSocketDisconnect, RuntimeError):
+        pass
+    finally:
+        mqtt_manager.events.unsubscribe(sub)
@@ -0,0 +1,56 @@
+from typing import Dict, List
+
+from fastapi import APIRouter, HTTPException, Path, Query
+
+from app.core.mqtt_client import COMMAND_TO_MODE, mqtt_manager
+from app.core.tag_store import tag_store
+from app.models.group import TAG_PATTERN, GroupCommandRequest, GroupJob, TagUpdate
+
+router = APIRouter(prefix="/groups", tags=["Groups"])
+
+
+@router.post("/cmd", response_model=GroupJob, status_code=202)
+def send_group_command(body: GroupCommandRequest):
+    """
+    Envia OPEN/CLOSE/AUTO para todos os varais com as tags pedidas (todas ou
+    qualquer uma). Responde assim que as publicações saem para o broker;
+    acompanhe entrega e conclusão por varal em GET /groups/cmd/{id}.
+    """
+    cmd = body.command.upper().strip()
+    if cmd not in COMMAND_TO_MODE:
+        raise HTTPException(status_code=400, detail="Comando inválido. Use OPEN, CLOSE ou AUTO.")
+
+    device_ids = tag_store.select(body.tags, match_all=body.match == "all")
+    if not device_ids:
+        raise HTTPException(status_code=404, detail="Nenhum varal com essas tags.")
+
+    job_id = mqtt_manager.publish_group(cmd, device_ids, body.tags, body.match)
+    return mqtt_manager.groups.get(job_id)
+
+
+@router.get("/cmd", response_model=List[GroupJob])
+def list_group_commands():
+    """Comandos em grupo recentes (mais novo primeiro), só com os totais."""
+    return mqtt_manager.groups.list()
+
+
+@router.get("/cmd/{job_id}", response_model=GroupJob)
+def get_group_command(job_id: str, devices: bool = Query(False, description="incluir o estado de cada varal")):
+    """Andamento do comando: varais por estado e percentis de entrega/conclusão."""
+    job = mqtt_manager.groups.get(job_id, with_devices=devices)
+    if job is None:
+        raise HTTPException(status_code=404, detail=f"Comando em grupo '{job_id}' não encontrado.")
+    return job
+
+
+@router.get("/tags", response_model=Dict[str, int])
+def list_tags():
+    """Tags conhecidas e quantos varais cada uma tem."""
+    return tag_store.counts()
+
+
+@router.post("/tags/{tag}")
+def update_tag(body: TagUpdate, tag: str = Path(pattern=TAG_PATTERN)):
+    """Põe e/ou tira uma tag de vários varais de uma vez."""
+    size = tag_store.update_tag(tag, add=body.add, remove=body.remove)
+    return {"tag": tag, "devices": size}
@@ -0,0 +1,12 @@
+from fastapi import APIRouter
+from fastapi.responses import PlainTextResponse
+
+from app.core.metrics import metrics
+
+router = APIRouter(tags=["Metrics"])
+
+
+@router.get("/metrics", response_class=PlainTextResponse)
+def get_metrics():
+    """Métricas no formato texto do Prometheus (ingestão, latência de publish, varais online...)."""
+    return PlainTextResponse(metrics.render(), media_type="text/plain; version=0.0.4")
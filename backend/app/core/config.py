@@ -10,8 +10,46 @@ class Settings(BaseSettings):
 
     aws_iot_client_id_backend: str = "esp32_varal_backend"
 
-    aws_iot_topic_heartbeat: str = "casa/varal1/heartbeat"
-    aws_iot_topic_cmd: str = "casa/varal1/cmd"
+    # Tópicos por dispositivo: "+" / "{device_id}" ocupam o segmento do ID
+    aws_iot_topic_heartbeat: str = "casa/+/heartbeat"
+    aws_iot_topic_cmd: str = "casa/{device_id}/cmd"
+    # Confirmação das mensagens com "seq" (entrega confirmada do firmware)
+    aws_iot_topic_ack: str = "casa/{device_id}/ack"
+    ack_dedup_window: int = 64  # últimos seq lembrados por dispositivo
+    # Estado desejado (retido, versionado) e pedido de relatório completo
+    aws_iot_topic_desired: str = "casa/{device_id}/desired"
+    sync_request_interval_s: float = 10.0  # mínimo entre dois "SYNC" ao mesmo varal
+
+    # Estado por dispositivo
+    device_store_shards: int = 16
+    # Online: último heartbeat há no máximo N intervalos do varal (métricas)
+    online_missed_heartbeats: float = 3.0
+
+    # Comandos em grupo (fan-out por tags)
+    tags_path: str = "data/tags.json"
+    group_timeout_s: float = 120.0  # varal que não reporta a versão nesse prazo vira "timeout"
+    group_jobs_kept: int = 50
+    mqtt_max_inflight: int = 1000  # publicações QoS1 em voo no cliente do backend
+    mqtt_inflight_expire_s: float = 300.0  # sem PUBACK nesse prazo, a publicação sai da conta
+
+    # Stream (WebSocket): tamanho da fila por cliente (descarta os mais antigos)
+    stream_queue_size: int = 32
+
+    # Histórico (SQLite/WAL): lote de escrita, retenção por resolução
+    history_db_path: str = "data/history.db"
+    history_queue_size: int = 50_000
+    history_batch_size: int = 500
+    history_flush_interval_s: float = 1.0
+    history_expected_interval_s: float = 30.0  # intervalo do heartbeat no firmware
+    history_raw_days: int = 7
+    history_1m_days: int = 90
+    history_1h_days: int = 730
+
+    # Pacotes OTA (tools/ota_pack.py), servidos em /ota/<arquivo>
+    ota_dir: str = "data/ota"
+
+    # Desligar só para testes com broker local (mosquitto na 1883)
+    aws_iot_use_tls: bool = True
 
     aws_iot_ca_path: str = "certs/AmazonRootCA1.pem"
     aws_iot_cert_path: str = "certs/certificate.crt"
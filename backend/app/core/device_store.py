@@ -0,0 +1,112 @@
+import threading
+import time
+from typing import Dict, List, Optional
+
+from app.models.heartbeat import Heartbeat, VaralMode
+from app.models.state import DesiredState
+
+
+class _Shard:
+    """Um pedaço do mapa de dispositivos, com lock próprio."""
+
+    __slots__ = ("lock", "heartbeats", "desired")
+
+    def __init__(self) -> None:
+        self.lock = threading.Lock()
+        self.heartbeats: Dict[str, Heartbeat] = {}
+        self.desired: Dict[str, DesiredState] = {}
+
+
+class DeviceStore:
+    """
+    Estado por dispositivo: último heartbeat (estado reportado) e estado
+    desejado de cada varal.
+
+    O mapa é dividido em shards pelo hash do device_id, então a thread do
+    MQTT gravando um dispositivo não bloqueia as rotas HTTP lendo outro.
+    Leitura e escrita de um dispositivo são O(1).
+    """
+
+    def __init__(self, shard_count: int = 16) -> None:
+        self._shards: List[_Shard] = [_Shard() for _ in range(max(1, shard_count))]
+
+    def _shard(self, device_id: str) -> _Shard:
+        return self._shards[hash(device_id) % len(self._shards)]
+
+    def put_heartbeat(self, device_id: str, heartbeat: Heartbeat) -> None:
+        shard = self._shard(device_id)
+        with shard.lock:
+            shard.heartbeats[device_id] = heartbeat
+
+    def get_heartbeat(self, device_id: str) -> Optional[Heartbeat]:
+        shard = self._shard(device_id)
+        with shard.lock:
+            return shard.heartbeats.get(device_id)
+
+    def get_desired(self, device_id: str) -> DesiredState:
+        shard = self._shard(device_id)
+        with shard.lock:
+            return shard.desired.get(device_id) or DesiredState()
+
+    def update_desired(
+        self,
+        device_id: str,
+        mode: Optional[VaralMode],
+        heartbeat_s: Optional[int],
+        min_version: int = 0,
+    ) -> DesiredState:
+        """
+        Aplica as mudanças (None = mantém) e sobe a versão. A nova versão fica
+        acima de min_version (o "dv" que o varal já reportou), para continuar
+        crescente mesmo se o backend perdeu o estado.
+        """
+        shard = self._shard(device_id)
+        with shard.lock:
+            current = shard.desired.get(device_id) or DesiredState()
+            desired = DesiredState(
+                version=max(current.version, min_version) + 1,
+                mode=mode if mode is not None else current.mode,
+                heartbeat_s=heartbeat_s if heartbeat_s is not None else current.heartbeat_s,
+                updated_at=time.time(),
+            )
+            shard.desired[device_id] = desired
+            return desired
+
+    def put_desired_if_newer(self, device_id: str, desired: DesiredState) -> bool:
+        """Guarda o estado desejado (ex: o retido no broker) se a versão for maior."""
+        shard = self._shard(device_id)
+        with shard.lock:
+            current = shard.desired.get(device_id)
+            if current is not None and current.version >= desired.version:
+                return False
+            shard.desired[device_id] = desired
+            return True
+
+    def list_devices(self) -> List[Heartbeat]:
+        """Retorna o último heartbeat de todos os dispositivos conhecidos."""
+        result: List[Heartbeat] = []
+        for shard in self._shards:
+            with shard.lock:
+                result.extend(shard.heartbeats.values())
+        return result
+
+    def count(self) -> int:
+        """Quantos dispositivos já mandaram heartbeat."""
+        total = 0
+        for shard in self._shards:
+            with shard.lock:
+                total += len(shard.heartbeats)
+        return total
+
+    def count_online(self, default_interval_s: float, missed: float) -> int:
+        """
+        Quantos dispositivos mandaram heartbeat há no máximo `missed`
+        intervalos (o "hb_s" de cada um, ou default_interval_s).
+        """
+        now = time.time()
+        total = 0
+        for shard in self._shards:
+            with shard.lock:
+                total += sum(1 for hb in shard.heartbeats.values()
+                             if now - hb.received_at <= missed * (hb.hb_s or default_interval_s))
+        return total
@@ -0,0 +1,76 @@
+import asyncio
+import threading
+from collections import deque
+from typing import Any, Deque, Dict, Optional, Set
+
+
+class Subscription:
+    """
+    Fila de um cliente conectado ao stream.
+
+    A fila é limitada (deque com maxlen): se o cliente não consome a tempo,
+    os eventos mais antigos são descartados e o contador `dropped` sobe.
+    Assim um app lento nunca segura a thread do MQTT nem os outros clientes.
+    """
+
+    def __init__(self, device_id: Optional[str], max_queue: int, loop: asyncio.AbstractEventLoop) -> None:
+        self.device_id = device_id  # None = todos os dispositivos
+        self.dropped = 0
+        self._queue: Deque[Dict[str, Any]] = deque(maxlen=max_queue)
+        self._lock = threading.Lock()
+        self._loop = loop
+        self._ready = asyncio.Event()
+
+    def push(self, event: Dict[str, Any]) -> None:
+        """Chamado da thread do MQTT."""
+        with self._lock:
+            if len(self._queue) == self._queue.maxlen:
+                self.dropped += 1
+            self._queue.append(event)
+        try:
+            self._loop.call_soon_threadsafe(self._ready.set)
+        except RuntimeError:
+            pass  # event loop já encerrado (servidor descendo)
+
+    async def next(self) -> Dict[str, Any]:
+        """Aguarda e retorna o próximo evento (no event loop do servidor)."""
+        while True:
+            with self._lock:
+                if self._queue:
+                    return self._queue.popleft()
+                self._ready.clear()
+            await self._ready.wait()
+
+
+class EventHub:
+    """Distribui heartbeats e confirmações de comando para os clientes do stream."""
+
+    def __init__(self, max_queue: int = 32) -> None:
+        self._max_queue = max_queue
+        self._lock = threading.Lock()
+        # device_id -> assinantes (None = assinantes de todos os dispositivos)
+        self._subs: Dict[Optional[str], Set[Subscription]] = {}
+
+    def subscribe(self, device_id: Optional[str]) -> Subscription:
+        sub = Subscription(device_id, self._max_queue, asyncio.get_running_loop())
+        with self._lock:
+            self._subs.setdefault(device_id, set()).add(sub)
+        return sub
+
+    def unsubscribe(self, sub: Subscription) -> None:
+        with self._lock:
+            subs = self._subs.get(sub.device_id)
+            if subs is not None:
+                subs.discard(sub)
+                if not subs:
+                    del self._subs[sub.device_id]
+
+    def publish(self, device_id: str, event: Dict[str, Any]) -> None:
+        with self._lock:
+            targets = list(self._subs.get(device_id, ())) + list(self._subs.get(None, ()))
+        for sub in targets:
+            sub.push(event)
+
+    def subscriber_count(self) -> int:
+        with self._lock:
+            return sum(len(subs) for subs in self._subs.values())
@@ -0,0 +1,217 @@
+import itertools
+import threading
+import time
+from collections import OrderedDict
+from typing import Dict, List, Optional
+
+from app.core.metrics import metrics
+from app.models.group import GroupDeviceStatus, GroupJob
+
+# Conclusão: publish do job -> heartbeat do varal com a versão aplicada
+COMPLETION_BUCKETS = (0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0, 30.0, 60.0, 300.0)
+
+GROUP_COMMANDS = metrics.counter("varal_group_commands_total", "Comandos em grupo disparados", ("command",))
+GROUP_DEVICES = metrics.counter(
+    "varal_group_devices_total", "Varais por resultado final nos comandos em grupo", ("result",))
+GROUP_COMPLETION = metrics.histogram(
+    "varal_group_completion_seconds", "Comando em grupo: publish -> varal reporta a versão aplicada",
+    buckets=COMPLETION_BUCKETS)
+
+
+class _Target:
+    __slots__ = ("device_id", "state", "version", "mode", "delivered_at", "completed_at")
+
+    def __init__(self, device_id: str, mode: str) -> None:
+        self.device_id = device_id
+        self.state = "queued"
+        self.version: Optional[int] = None
+        self.mode = mode
+        self.delivered_at: Optional[float] = None
+        self.completed_at: Optional[float] = None
+
+
+class _Job:
+    def __init__(self, job_id: str, command: str, mode: str, tags: List[str], match: str,
+                 device_ids: List[str], timeout_s: float) -> None:
+        self.id = job_id
+        self.command = command
+        self.tags = tags
+        self.match = match
+        self.created_at = time.time()
+        self.deadline = self.created_at + timeout_s
+        self.publish_s = 0.0
+        self.targets: Dict[str, _Target] = {d: _Target(d, mode) for d in device_ids}
+        self.open = len(self.targets)  # ainda sem resultado final
+
+    def finish(self, target: _Target, state: str) -> None:
+        target.state = state
+        self.open -= 1
+        GROUP_DEVICES.inc(state)
+
+
+def _pick(values: List[float], p: float) -> Optional[float]:
+    if not values:
+        return None
+    values.sort()
+    return round(values[min(len(values) - 1, int(p * len(values)))] * 1000.0, 1)
+
+
+class GroupCommands:
+    """
+    Acompanhamento dos comandos em grupo (fan-out por tags).
+
+    Cada job guarda, por varal, a versão do estado desejado publicada e o
+    que já se sabe dela: entregue ao broker (PUBACK do QoS1) e concluída (o
+    varal reportou "dv" >= versão). Um índice varal -> jobs abertos deixa o
+    custo por heartbeat em O(jobs abertos do varal), não O(varais do job).
+    Varal que não conclui até o prazo vira "timeout" (o desejado continua
+    retido: ele ainda aplica quando voltar). Guarda os últimos max_jobs.
+    """
+
+    def __init__(self, timeout_s: float, max_jobs: int) -> None:
+        self._timeout_s = timeout_s
+        self._max_jobs = max_jobs
+        self._lock = threading.Lock()
+        self._jobs: "OrderedDict[str, _Job]" = OrderedDict()
+        self._waiting: Dict[str, List[_Job]] = {}
+        self._ids = itertools.count(1)
+
+    # ---------- ciclo de vida ----------
+
+    def create(self, command: str, mode: str, tags: List[str], match: str, device_ids: List[str]) -> str:
+        job_id = f"g{int(time.time())}-{next(self._ids)}"
+        job = _Job(job_id, command, mode, tags, match, device_ids, self._timeout_s)
+        with self._lock:
+            self._expire_locked(time.time())
+            self._jobs[job_id] = job
+            for device_id in device_ids:
+                self._waiting.setdefault(device_id, []).append(job)
+            while len(self._jobs) > self._max_jobs:
+                _, old = self._jobs.popitem(last=False)
+                self._close_locked(old, "timeout")
+        GROUP_COMMANDS.inc(command)
+        return job_id
+
+    def assign(self, job_id: str, device_id: str, version: int) -> None:
+        """Versão do desejado que o varal precisa reportar (antes do publish)."""
+        with self._lock:
+            job = self._jobs.get(job_id)
+            target = job.targets.get(device_id) if job is not None else None
+            if target is not None:
+                target.version = version
+
+    def failed(self, job_id: str, device_id: str) -> None:
+        """Publicação recusada pelo cliente MQTT."""
+        with self._lock:
+            job = self._jobs.get(job_id)
+            target = job.targets.get(device_id) if job is not None else None
+            if target is None or target.state not in ("queued", "delivered"):
+                return
+            job.finish(target, "failed")
+            self._unwait_locked(device_id, job)
+
+    def publish_done(self, job_id: str, elapsed_s: float) -> None:
+        with self._lock:
+            job = self._jobs.get(job_id)
+            if job is not None:
+                job.publish_s = elapsed_s
+
+    def delivered(self, job_id: str, device_id: str, at: float) -> None:
+        """PUBACK do broker (pode chegar depois da conclusão; nunca rebaixa o estado)."""
+        with self._lock:
+            job = self._jobs.get(job_id)
+            target = job.targets.get(device_id) if job is not None else None
+            if target is None or target.delivered_at is not None:
+                return
+            target.delivered_at = at
+            if target.state == "queued":
+                target.state = "delivered"
+
+    def on_report(self, device_id: str, dv: Optional[int], mode: Optional[str], at: float) -> None:
+        """Heartbeat do varal: conclui os jobs cuja versão ele já aplicou."""
+        with self._lock:
+            jobs = self._waiting.get(device_id)
+            if not jobs:
+                return
+            for job in list(jobs):
+                target = job.targets[device_id]
+                if target.version is None:
+                    continue
+                # Firmware sem "dv": vale o modo reportado
+                applied = dv >= target.version if dv is not None else mode == target.mode
+                if not applied:
+                    continue
+                target.completed_at = at
+                if target.delivered_at is None:
+                    target.delivered_at = at
+                job.finish(target, "completed")
+                GROUP_COMPLETION.observe(at - job.created_at)
+                self._unwait_locked(device_id, job)
+
+    def _unwait_locked(self, device_id: str, job: _Job) -> None:
+        jobs = self._waiting.get(device_id)
+        if jobs is None:
+            return
+        try:
+            jobs.remove(job)
+        except ValueError:
+            return
+        if not jobs:
+            del self._waiting[device_id]
+
+    def _close_locked(self, job: _Job, state: str) -> None:
+        for target in job.targets.values():
+            if target.state in ("queued", "delivered"):
+                job.finish(target, state)
+                self._unwait_locked(target.device_id, job)
+
+    def _expire_locked(self, now: float) -> None:
+        for job in self._jobs.values():
+            if job.open and now >= job.deadline:
+                self._close_locked(job, "timeout")
+
+    # ---------- consulta ----------
+
+    def _view_locked(self, job: _Job, with_devices: bool) -> GroupJob:
+        counts = {"queued": 0, "delivered": 0, "completed": 0, "failed": 0, "timeout": 0}
+        delivered: List[float] = []
+        completed: List[float] = []
+        devices: List[GroupDeviceStatus] = []
+        for t in job.targets.values():
+            counts[t.state] += 1
+            d = t.delivered_at - job.created_at if t.delivered_at is not None else None
+            c = t.completed_at - job.created_at if t.completed_at is not None else None
+            if d is not None:
+                delivered.append(d)
+            if c is not None:
+                completed.append(c)
+            if with_devices:
+                devices.append(GroupDeviceStatus(
+                    device_id=t.device_id, state=t.state, version=t.version,
+                    delivered_ms=round(d * 1000.0, 1) if d is not None else None,
+                    completed_ms=round(c * 1000.0, 1) if c is not None else None,
+                ))
+        return GroupJob(
+            id=job.id, command=job.command, tags=job.tags, match=job.match,
+            created_at=job.created_at, publish_ms=round(job.publish_s * 1000.0, 1),
+            total=len(job.targets), counts=counts, done=job.open == 0,
+            delivered_p50_ms=_pick(delivered, 0.50), delivered_p99_ms=_pick(delivered, 0.99),
+            completed_p50_ms=_pick(completed, 0.50), completed_p99_ms=_pick(completed, 0.99),
+            devices=devices if with_devices else None,
+        )
+
+    def get(self, job_id: str, with_devices: bool = False) -> Optional[GroupJob]:
+        with self._lock:
+            self._expire_locked(time.time())
+            job = self._jobs.get(job_id)
+            return self._view_locked(job, with_devices) if job is not None else None
+
+    def list(self) -> List[GroupJob]:
+        """Jobs guardados, do mais novo para o mais velho (sem a lista de varais)."""
+        with self._lock:
+            self._expire_locked(time.time())
+            return [self._view_locked(job, False) for job in reversed(self._jobs.values())]
+
+    def open_jobs(self) -> int:
+        with self._lock:
+            return sum(1 for job in self._jobs.values() if job.open)
@@ -0,0 +1,308 @@
+import math
+import os
+import queue
+import sqlite3
+import threading
+import time
+from collections import defaultdict
+from typing import Any, Dict, List, Optional, Tuple
+
+from app.core.config import settings
+from app.core.metrics import metrics
+from app.models.heartbeat import Heartbeat
+
+# Resoluções disponíveis (segundos por bucket)
+RESOLUTIONS: Dict[str, int] = {"1m": 60, "1h": 3600}
+
+_SCHEMA = """
+CREATE TABLE IF NOT EXISTS samples_raw (
+    device_id TEXT    NOT NULL,
+    ts        REAL    NOT NULL,
+    temp_c    REAL,
+    humidity  REAL,
+    rain      INTEGER,
+    mode      TEXT
+);
+CREATE INDEX IF NOT EXISTS idx_raw_device_ts ON samples_raw (device_id, ts);
+"""
+
+_ROLLUP_SCHEMA = """
+CREATE TABLE IF NOT EXISTS rollup_{name} (
+    device_id TEXT    NOT NULL,
+    bucket    INTEGER NOT NULL,
+    n         INTEGER NOT NULL,
+    temp_n    INTEGER NOT NULL,
+    temp_sum  REAL    NOT NULL,
+    temp_min  REAL,
+    temp_max  REAL,
+    hum_n     INTEGER NOT NULL,
+    hum_sum   REAL    NOT NULL,
+    hum_min   REAL,
+    hum_max   REAL,
+    rain_n    INTEGER NOT NULL,
+    PRIMARY KEY (device_id, bucket)
+) WITHOUT ROWID;
+"""
+
+# min/max ignorando NULL dos dois lados
+_ROLLUP_UPSERT = """
+INSERT INTO rollup_{name} VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
+ON CONFLICT (device_id, bucket) DO UPDATE SET
+    n        = n + excluded.n,
+    temp_n   = temp_n + excluded.temp_n,
+    temp_sum = temp_sum + excluded.temp_sum,
+    temp_min = min(coalesce(temp_min, excluded.temp_min), coalesce(excluded.temp_min, temp_min)),
+    temp_max = max(coalesce(temp_max, excluded.temp_max), coalesce(excluded.temp_max, temp_max)),
+    hum_n    = hum_n + excluded.hum_n,
+    hum_sum  = hum_sum + excluded.hum_sum,
+    hum_min  = min(coalesce(hum_min, excluded.hum_min), coalesce(excluded.hum_min, hum_min)),
+    hum_max  = max(coalesce(hum_max, excluded.hum_max), coalesce(excluded.hum_max, hum_max)),
+    rain_n   = rain_n + excluded.rain_n
+"""
+
+# Reagrupa buckets de uma rollup em passos maiores (limita o nº de pontos)
+_ROLLUP_QUERY = """
+SELECT (bucket / :step) * :step AS t,
+       sum(n), sum(temp_n), sum(temp_sum), min(temp_min), max(temp_max),
+       sum(hum_n), sum(hum_sum), min(hum_min), max(hum_max), sum(rain_n)
+FROM rollup_{name}
+WHERE device_id = :device_id AND bucket >= :start AND bucket < :end
+GROUP BY t
+ORDER BY t
+"""
+
+_RAW_QUERY = """
+SELECT ts, temp_c, humidity, rain
+FROM samples_raw
+WHERE device_id = ? AND ts >= ? AND ts < ?
+ORDER BY ts
+LIMIT ?
+"""
+
+# Sample: (device_id, ts, temp_c, humidity, rain, mode)
+Sample = Tuple[str, float, Optional[float], Optional[float], Optional[int], Optional[str]]
+
+
+class _Agg:
+    """Acumulador de um bucket dentro de um lote (antes do upsert)."""
+
+    __slots__ = ("n", "temp_n", "temp_sum", "temp_min", "temp_max",
+                 "hum_n", "hum_sum", "hum_min", "hum_max", "rain_n")
+
+    def __init__(self) -> None:
+        self.n = self.temp_n = self.hum_n = self.rain_n = 0
+        self.temp_sum = self.hum_sum = 0.0
+        self.temp_min = self.temp_max = self.hum_min = self.hum_max = None
+
+    def add(self, temp: Optional[float], hum: Optional[float], rain: Optional[int]) -> None:
+        self.n += 1
+        if temp is not None:
+            self.temp_n += 1
+            self.temp_sum += temp
+            self.temp_min = temp if self.temp_min is None else min(self.temp_min, temp)
+            self.temp_max = temp if self.temp_max is None else max(self.temp_max, temp)
+        if hum is not None:
+            self.hum_n += 1
+            self.hum_sum += hum
+            self.hum_min = hum if self.hum_min is None else min(self.hum_min, hum)
+            self.hum_max = hum if self.hum_max is None else max(self.hum_max, hum)
+        if rain:
+            self.rain_n += 1
+
+
+class HistoryStore:
+    """
+    Histórico dos heartbeats em SQLite (modo WAL).
+
+    - A thread do MQTT só enfileira; uma thread de escrita grava em lotes
+      (uma transação por lote) nas tabelas raw, 1 min e 1 h.
+    - As rollups guardam n/soma/mín/máx, então qualquer intervalo é
+      respondido a partir de buckets já agregados.
+    - Retenção: raw e 1 min expiram antes; 1 h fica por mais tempo.
+    """
+
+    def __init__(self, path: str) -> None:
+        self._path = path
+        self._queue: "queue.Queue[Sample]" = queue.Queue(maxsize=settings.history_queue_size)
+        self._thread: Optional[threading.Thread] = None
+        self._running = False
+        self._local = threading.local()
+        self._dropped_lock = threading.Lock()
+        self.dropped = 0
+
+    # ---------- Ciclo de vida ----------
+
+    def start(self) -> None:
+        if os.path.dirname(self._path):
+            os.makedirs(os.path.dirname(self._path), exist_ok=True)
+        conn = self._connect()
+        conn.executescript(_SCHEMA)
+        for name in RESOLUTIONS:
+            conn.executescript(_ROLLUP_SCHEMA.format(name=name))
+        conn.commit()
+
+        self._running = True
+        self._thread = threading.Thread(target=self._writer_loop, name="history-writer", daemon=True)
+        self._thread.start()
+
+    def stop(self) -> None:
+        self._running = False
+        if self._thread is not None:
+            self._thread.join(timeout=5)
+            self._thread = None
+
+    def _connect(self) -> sqlite3.Connection:
+        conn = getattr(self._local, "conn", None)
+        if conn is None:
+            conn = sqlite3.connect(self._path, timeout=10)
+            conn.execute("PRAGMA journal_mode=WAL")
+            conn.execute("PRAGMA synchronous=NORMAL")
+            self._local.conn = conn
+        return conn
+
+    # ---------- Escrita ----------
+
+    def add(self, heartbeat: Heartbeat) -> None:
+        """Enfileira um heartbeat (chamado da thread do MQTT, não bloqueia)."""
+        sample: Sample = (
+            heartbeat.device_id or "",
+            heartbeat.received_at,
+            heartbeat.temp_c,
+            heartbeat.humidity,
+            None if heartbeat.rain is None else int(heartbeat.rain),
+            heartbeat.mode.value if heartbeat.mode is not None else None,
+        )
+        try:
+            self._queue.put_nowait(sample)
+        except queue.Full:
+            with self._dropped_lock:
+                self.dropped += 1
+
+    def queue_depth(self) -> int:
+        """Amostras esperando a thread de gravação."""
+        return self._queue.qsize()
+
+    def write_batch(self, batch: List[Sample]) -> None:
+        """Grava um lote: raw + upsert das rollups, numa única transação."""
+        rollups: Dict[str, Dict[Tuple[str, int], _Agg]] = {
+            name: defaultdict(_Agg) for name in RESOLUTIONS
+        }
+        for device_id, ts, temp, hum, rain, _mode in batch:
+            for name, seconds in RESOLUTIONS.items():
+                rollups[name][(device_id, int(ts) // seconds * seconds)].add(temp, hum, rain)
+
+        conn = self._connect()
+        with conn:
+            conn.executemany("INSERT INTO samples_raw VALUES (?, ?, ?, ?, ?, ?)", batch)
+            for name, buckets in rollups.items():
+                conn.executemany(
+                    _ROLLUP_UPSERT.format(name=name),
+                    [
+                        (device_id, bucket, a.n, a.temp_n, a.temp_sum, a.temp_min, a.temp_max,
+                         a.hum_n, a.hum_sum, a.hum_min, a.hum_max, a.rain_n)
+                        for (device_id, bucket), a in buckets.items()
+                    ],
+                )
+
+    def apply_retention(self, now: Optional[float] = None) -> None:
+        now = time.time() if now is None else now
+        day = 86400
+        conn = self._connect()
+        with conn:
+            conn.execute("DELETE FROM samples_raw WHERE ts < ?", (now - settings.history_raw_days * day,))
+            conn.execute("DELETE FROM rollup_1m WHERE bucket < ?", (now - settings.history_1m_days * day,))
+            conn.execute("DELETE FROM rollup_1h WHERE bucket < ?", (now - settings.history_1h_days * day,))
+
+    def _writer_loop(self) -> None:
+        next_retention = time.monotonic()
+        while self._running or not self._queue.empty():
+            batch: List[Sample] = []
+            deadline = time.monotonic() + settings.history_flush_interval_s
+            while len(batch) < settings.history_batch_size:
+                timeout = deadline - time.monotonic()
+                if timeout <= 0:
+                    break
+                try:
+                    batch.append(self._queue.get(timeout=timeout))
+                except queue.Empty:
+                    break
+
+            try:
+                if batch:
+                    self.write_batch(batch)
+                if time.monotonic() >= next_retention:
+                    next_retention = time.monotonic() + 3600
+                    self.apply_retention()
+            except sqlite3.Error as e:
+                print("[HISTORY] Erro ao gravar lote:", e)
+
+    # ---------- Consulta ----------
+
+    def query(self, device_id: str, start: float, end: float,
+              resolution: str = "auto", max_points: int = 1000) -> Tuple[str, int, List[Dict[str, Any]]]:
+        """
+        Retorna (resolução usada, passo em segundos, buckets) no intervalo.
+
+        Em "auto" escolhe a resolução mais fina que cabe em max_points;
+        numa rollup, buckets vizinhos são somados até caber (nunca passa
+        de max_points, mesmo pedindo um ano inteiro). "raw" com mais
+        amostras que max_points não corta o intervalo: cai para a rollup,
+        como o "auto" faria (a resolução usada volta na resposta).
+        """
+        span = max(1.0, end - start)
+        if resolution == "auto":
+            if span / settings.history_expected_interval_s <= max_points and span <= settings.history_raw_days * 86400:
+                resolution = "raw"
+            else:
+                resolution = self._rollup_for(span, max_points)
+
+        conn = self._connect()
+        if resolution == "raw":
+            # Uma linha a mais só para saber se o intervalo cabe
+            rows = conn.execute(_RAW_QUERY, (device_id, start, end, max_points + 1)).fetchall()
+            if len(rows) > max_points:
+                resolution = self._rollup_for(span, max_points)
+
+        if resolution == "raw":
+            points = [
+                {
+                    "t": ts, "n": 1,
+                    "temp_avg": temp, "temp_min": temp, "temp_max": temp,
+                    "humidity_avg": hum, "humidity_min": hum, "humidity_max": hum,
+                    "rain_ratio": None if rain is None else float(rain),
+                }
+                for ts, temp, hum, rain in rows
+            ]
+            return resolution, 0, points
+
+        base = RESOLUTIONS[resolution]
+        step = max(base, math.ceil(span / max_points / base) * base)
+        rows = conn.execute(
+            _ROLLUP_QUERY.format(name=resolution),
+            {"device_id": device_id, "start": int(start) // base * base, "end": end, "step": step},
+        ).fetchall()
+        points = [
+            {
+                "t": t, "n": n,
+                "temp_avg": (temp_sum / temp_n) if temp_n else None,
+                "temp_min": temp_min, "temp_max": temp_max,
+                "humidity_avg": (hum_sum / hum_n) if hum_n else None,
+                "humidity_min": hum_min, "humidity_max": hum_max,
+                "rain_ratio": rain_n / n if n else None,
+            }
+            for t, n, temp_n, temp_sum, temp_min, temp_max, hum_n, hum_sum, hum_min, hum_max, rain_n in rows
+        ]
+        return resolution, step, points
+
+    @staticmethod
+    def _rollup_for(span: float, max_points: int) -> str:
+        """Rollup para um intervalo que não cabe em raw."""
+        return "1m" if span / RESOLUTIONS["1m"] <= max_points * 4 else "1h"
+
+
+# Instância única para a aplicação inteira
+history_store = HistoryStore(settings.history_db_path)
+
+metrics.gauge_from("varal_history_queue", "Heartbeats esperando gravação no histórico", history_store.queue_depth)
+metrics.counter_from("varal_history_dropped_total", "Heartbeats descartados com a fila do histórico cheia",
+                     lambda: history_store.dropped)
@@ -0,0 +1,159 @@
+import bisect
+import threading
+from typing import Callable, Dict, List, Sequence, Tuple
+
+# Latências de MQTT/HTTP: de 1 ms a 30 s
+DEFAULT_BUCKETS: Tuple[float, ...] = (
+    0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0, 30.0,
+)
+
+LabelValues = Tuple[str, ...]
+
+
+def _format_labels(names: Sequence[str], values: Sequence[str], extra: str = "") -> str:
+    parts = [f'{name}="{_escape(value)}"' for name, value in zip(names, values)]
+    if extra:
+        parts.append(extra)
+    return "{" + ",".join(parts) + "}" if parts else ""
+
+
+def _escape(value: str) -> str:
+    return str(value).replace("\\", "\\\\").replace("\n", "\\n").replace('"', '\\"')
+
+
+def _format_value(value: float) -> str:
+    if value == float("inf"):
+        return "+Inf"
+    return repr(float(value)) if isinstance(value, float) and not value.is_integer() else str(int(value))
+
+
+class Counter:
+    """Contador que só sobe (um por combinação de labels)."""
+
+    kind = "counter"
+
+    def __init__(self, name: str, help_text: str, labels: Sequence[str] = ()) -> None:
+        self.name = name
+        self.help = help_text
+        self.labels = tuple(labels)
+        self._lock = threading.Lock()
+        self._values: Dict[LabelValues, float] = {} if self.labels else {(): 0.0}
+
+    def inc(self, *label_values: str, amount: float = 1.0) -> None:
+        with self._lock:
+            self._values[label_values] = self._values.get(label_values, 0.0) + amount
+
+    def collect(self) -> List[str]:
+        with self._lock:
+            items = sorted(self._values.items())
+        return [f"{self.name}{_format_labels(self.labels, lv)} {_format_value(v)}" for lv, v in items]
+
+
+class Histogram:
+    """Histograma com buckets fixos (cumulativos na exposição, como o Prometheus espera)."""
+
+    kind = "histogram"
+
+    def __init__(self, name: str, help_text: str, labels: Sequence[str] = (),
+                 buckets: Sequence[float] = DEFAULT_BUCKETS) -> None:
+        self.name = name
+        self.help = help_text
+        self.labels = tuple(labels)
+        self.buckets = tuple(sorted(buckets))
+        self._lock = threading.Lock()
+        # labels -> (contagem por bucket, +Inf incluso; soma)
+        self._series: Dict[LabelValues, Tuple[List[int], List[float]]] = {}
+
+    def observe(self, value: float, *label_values: str) -> None:
+        index = bisect.bisect_left(self.buckets, value)
+        with self._lock:
+            series = self._series.get(label_values)
+            if series is None:
+                series = ([0] * (len(self.buckets) + 1), [0.0])
+                self._series[label_values] = series
+            series[0][index] += 1
+            series[1][0] += value
+
+    def collect(self) -> List[str]:
+        with self._lock:
+            items = sorted((lv, (list(counts), total[0])) for lv, (counts, total) in self._series.items())
+        lines: List[str] = []
+        for lv, (counts, total) in items:
+            cumulative = 0
+            for bound, count in zip(self.buckets + (float("inf"),), counts):
+                cumulative += count
+                le = 'le="' + _format_value(bound) + '"'
+                lines.append(f"{self.name}_bucket{_format_labels(self.labels, lv, le)} {cumulative}")
+            lines.append(f"{self.name}_sum{_format_labels(self.labels, lv)} {_format_value(total)}")
+            lines.append(f"{self.name}_count{_format_labels(self.labels, lv)} {cumulative}")
+        return lines
+
+
+class Collected:
+    """Valor lido na hora da coleta (contadores/tamanhos que já existem em outro objeto)."""
+
+    def __init__(self, name: str, help_text: str, kind: str,
+                 read: Callable[[], float], labels: Sequence[str] = ()) -> None:
+        self.name = name
+        self.help = help_text
+        self.kind = kind
+        self.labels = tuple(labels)
+        self._read = read
+
+    def collect(self) -> List[str]:
+        value = self._read()
+        if not self.labels:
+            return [f"{self.name} {_format_value(value)}"]
+        # Com labels, read() devolve {(valores dos labels): valor}
+        return [f"{self.name}{_format_labels(self.labels, lv)} {_format_value(v)}"
+                for lv, v in sorted(value.items())]
+
+
+class MetricsRegistry:
+    """
+    Métricas do backend no formato texto do Prometheus (GET /metrics).
+
+    Sem dependência externa: contadores e histogramas ficam em memória,
+    com lock próprio (a thread do MQTT e as rotas HTTP atualizam ao mesmo
+    tempo). Valores que já existem em outros objetos (dispositivos online,
+    fila do histórico) são lidos só na coleta.
+    """
+
+    def __init__(self) -> None:
+        self._lock = threading.Lock()
+        self._metrics: Dict[str, object] = {}
+
+    def _register(self, metric):
+        with self._lock:
+            if metric.name in self._metrics:
+                raise ValueError(f"métrica duplicada: {metric.name}")
+            self._metrics[metric.name] = metric
+        return metric
+
+    def counter(self, name: str, help_text: str, labels: Sequence[str] = ()) -> Counter:
+        return self._register(Counter(name, help_text, labels))
+
+    def histogram(self, name: str, help_text: str, labels: Sequence[str] = (),
+                  buckets: Sequence[float] = DEFAULT_BUCKETS) -> Histogram:
+        return self._register(Histogram(name, help_text, labels, buckets))
+
+    def gauge_from(self, name: str, help_text: str, read: Callable[[], float],
+                   labels: Sequence[str] = ()) -> Collected:
+        return self._register(Collected(name, help_text, "gauge", read, labels))
+
+    def counter_from(self, name: str, help_text: str, read: Callable[[], float]) -> Collected:
+        return self._register(Collected(name, help_text, "counter", read))
+
+    def render(self) -> str:
+        with self._lock:
+            metrics = list(self._metrics.values())
+        lines: List[str] = []
+        for metric in metrics:
+            lines.append(f"# HELP {metric.name} {metric.help}")
+            lines.append(f"# TYPE {metric.name} {metric.kind}")
+            lines.extend(metric.collect())
+        return "\n".join(lines) + "\n"
+
+
+# Instância única para a aplicação inteira
+metrics = MetricsRegistry()
@@ -1,21 +1,62 @@
+import functools
 import json
 import time
 import threading
-from typing import Optional, Dict, Any
+from collections import deque
+from typing import Callable, Optional, Dict, Any, List, Tuple
 
 import paho.mqtt.client as mqtt
 
 from app.core.config import settings
-from app.models.heartbeat import Heartbeat
+from app.core.device_store import DeviceStore
+from app.core.event_hub import EventHub
+from app.core.group_commands import GroupCommands
+from app.core.history_store import history_store
+from app.core.metrics import metrics
+from app.models.heartbeat import Heartbeat, VaralMode
+from app.models.state import DesiredState, DeviceState
+
+
+# Modo que o firmware reporta depois de cada comando
+COMMAND_TO_MODE: Dict[str, str] = {
+    "OPEN": "FORCE_OPEN",
+    "CLOSE": "FORCE_CLOSE",
+    "AUTO": "AUTO",
+}
+
+# Campos que o firmware reporta; num delta ("rv" sem "full") só vêm os que mudaram
+REPORTED_FIELDS = (
+    "temp_c", "humidity", "rain", "rain_likely", "mode", "uptime_ms", "sensors",
+    "reaction_ms", "loop_us", "mem", "mqtt", "rv", "dv", "hb_s",
+)
+
+HEARTBEATS = metrics.counter("varal_heartbeats_total", "Heartbeats aceitos (use rate() para a taxa de ingestão)")
+HEARTBEAT_SECONDS = metrics.histogram(
+    "varal_heartbeat_ingest_seconds", "Tratamento de um heartbeat no backend (parse, estado, histórico, stream)",
+    buckets=(0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.1))
+PUBLISH_SECONDS = metrics.histogram(
+    "varal_mqtt_publish_seconds", "Publish do backend até o PUBACK do broker (QoS1) ou a escrita no socket (QoS0)",
+    ("kind",))
+PUBLISH_ERRORS = metrics.counter("varal_mqtt_publish_errors_total", "Publicações recusadas pelo cliente MQTT",
+                                 ("kind",))
+PUBLISH_EXPIRED = metrics.counter("varal_mqtt_publish_expired_total",
+                                  "Publicações sem PUBACK no prazo (MQTT_INFLIGHT_EXPIRE_S), retiradas da conta",
+                                  ("kind",))
 
 
 class MqttManager:
     """
     Responsável por:
     - Conectar no AWS IoT Core via MQTT
-    - Assinar heartbeat do ESP32
-    - Disponibilizar último heartbeat recebido
-    - Publicar comandos para o ESP32
+    - Assinar heartbeat de todos os ESP32 (tópico com curinga)
+    - Disponibilizar último heartbeat recebido de cada dispositivo
+    - Manter o estado desejado de cada ESP32 (versionado, retido em casa/<id>/desired)
+    - Montar o estado reportado a partir de relatórios completos e deltas
+    - Publicar comandos para um ESP32 específico ou para um grupo (fan-out)
+    - Medir a latência de cada publicação até o PUBACK (métricas)
+    - Confirmar mensagens com "seq" (ack em casa/<id>/ack) e descartar duplicatas
+    - Enviar cada heartbeat para o histórico (HistoryStore)
+    - Empurrar heartbeats e confirmações de comando para o stream (EventHub)
     """
 
     def __init__(self) -> None:
@@ -27,16 +68,51 @@ class MqttManager:
         self._client.on_connect = self._on_connect
         self._client.on_message = self._on_message
         self._client.on_disconnect = self._on_disconnect
+        self._client.on_publish = self._on_publish
+
+        # Fan-out: muitas publicações QoS1 em voo ao mesmo tempo (o padrão do paho é 20)
+        self._client.max_inflight_messages_set(settings.mqtt_max_inflight)
 
         # TLS / certificados
-        self._client.tls_set(
-            ca_certs=settings.aws_iot_ca_path,
-            certfile=settings.aws_iot_cert_path,
-            keyfile=settings.aws_iot_key_path,
-        )
+        if settings.aws_iot_use_tls:
+            self._client.tls_set(
+                ca_certs=settings.aws_iot_ca_path,
+                certfile=settings.aws_iot_cert_path,
+                keyfile=settings.aws_iot_key_path,
+            )
+
+        self._devices = DeviceStore(settings.device_store_shards)
+
+        # Posição do device_id no tópico de heartbeat (segmento com "+")
+        self._hb_topic_parts: List[str] = settings.aws_iot_topic_heartbeat.split("/")
+        self._desired_topic_parts: List[str] = settings.aws_iot_topic_desired.format(device_id="+").split("/")
 
-        self._lock = threading.Lock()
-        self._last_heartbeat: Optional[Heartbeat] = None
+        # Stream para os apps + comandos aguardando confirmação (device_id -> versão do desejado)
+        self.events = EventHub(settings.stream_queue_size)
+        self._pending_lock = threading.Lock()
+        self._pending_cmd: Dict[str, Dict[str, Any]] = {}
+
+        # Últimos seq vistos por dispositivo (reenvios do firmware chegam repetidos)
+        self._seen_lock = threading.Lock()
+        self._seen_seq: Dict[str, Any] = {}
+        self.duplicates = 0
+
+        # Deltas fora de ordem / perdidos: pede relatório completo ("SYNC"), com intervalo mínimo
+        self._sync_lock = threading.Lock()
+        self._sync_requested_at: Dict[str, float] = {}
+        self.sync_requests = 0
+
+        # Publicações aguardando o PUBACK: mid -> (início, tipo, callback). O
+        # PUBACK pode chegar antes do registro (thread do paho): fica em _early_acks.
+        # Entradas mais velhas que mqtt_inflight_expire_s são descartadas (o mid
+        # do paho dá a volta em 65535 e não pode casar com uma publicação antiga).
+        self._publish_lock = threading.Lock()
+        self._inflight: Dict[int, Tuple[float, str, Optional[Callable[[float], None]]]] = {}
+        self._early_acks: Dict[int, float] = {}
+        self._next_expire = 0.0
+
+        # Comandos em grupo: entrega e conclusão por varal
+        self.groups = GroupCommands(settings.group_timeout_s, settings.group_jobs_kept)
 
     # ---------- Callbacks MQTT ----------
 
@@ -46,6 +122,8 @@ class MqttManager:
             topic = settings.aws_iot_topic_heartbeat
             client.subscribe(topic)
             print(f"[MQTT] Inscrito em {topic}")
+            # Estados desejados retidos: recupera as versões depois de reiniciar
+            client.subscribe("/".join(self._desired_topic_parts), qos=1)
         else:
             print("[MQTT] Erro na conexão MQTT")
 
@@ -53,34 +131,252 @@ class MqttManager:
         topic = msg.topic
         payload = msg.payload.decode("utf-8", errors="ignore")
 
-        if topic == settings.aws_iot_topic_heartbeat:
-            # Ignora mensagens que não parecem JSON
-            if not payload.strip().startswith("{"):
-                print("[MQTT] Mensagem ignorada em heartbeat (não-JSON):", payload)
+        device_id = self._device_id_from_topic(topic, self._hb_topic_parts)
+        if device_id is not None:
+            self._handle_heartbeat(device_id, payload)
+            return
+
+        device_id = self._device_id_from_topic(topic, self._desired_topic_parts)
+        if device_id is not None:
+            self._handle_retained_desired(device_id, payload)
+
+    def _handle_heartbeat(self, device_id: str, payload: str) -> None:
+        started = time.perf_counter()
+        # Ignora mensagens que não parecem JSON
+        if not payload.strip().startswith("{"):
+            print("[MQTT] Mensagem ignorada em heartbeat (não-JSON):", payload)
+            return
+
+        try:
+            data = json.loads(payload)
+        except Exception as e:
+            print("[MQTT] Erro ao parsear heartbeat:", e)
+            return
+
+        seq = data.get("seq")
+        if seq is not None:
+            # Confirma sempre, mesmo duplicata: o ack anterior pode ter se perdido
+            self._send_ack(device_id, seq)
+            if not self._first_time_seen(device_id, seq):
+                self.duplicates += 1
+                return
+
+        fields = self._reported_fields(device_id, data)
+        if fields is None:
+            return
+
+        heartbeat = Heartbeat(device_id=device_id, received_at=time.time(), **fields)
+        self._devices.put_heartbeat(device_id, heartbeat)
+        history_store.add(heartbeat)
+
+        hb_event = heartbeat.model_dump(mode="json")
+        self.events.publish(device_id, {"type": "heartbeat", "device_id": device_id, "data": hb_event})
+        self._check_command_ack(device_id, heartbeat)
+        self._adopt_local_change(device_id, heartbeat)
+        self.groups.on_report(device_id, heartbeat.dv, heartbeat.mode.value if heartbeat.mode else None,
+                              heartbeat.received_at)
+
+        HEARTBEATS.inc()
+        HEARTBEAT_SECONDS.observe(time.perf_counter() - started)
+
+    def _reported_fields(self, device_id: str, data: Dict[str, Any]) -> Optional[Dict[str, Any]]:
+        """
+        Estado reportado completo a partir da mensagem. Relatório completo (ou
+        firmware sem "rv") substitui tudo; delta é aplicado sobre o anterior.
+        Delta fora de sequência pede "SYNC"; se for mais velho que o estado
+        atual (reenvio atrasado, varal reiniciou), é descartado (None).
+        """
+        rv = data.get("rv")
+        if rv is None or data.get("full"):
+            return {key: data.get(key) for key in REPORTED_FIELDS}
+
+        prev = self._devices.get_heartbeat(device_id)
+        if prev is None or prev.rv is None or rv != prev.rv + 1:
+            self._request_sync(device_id)
+            if prev is not None and prev.rv is not None and rv <= prev.rv:
+                return None
+
+        fields = prev.model_dump(include=set(REPORTED_FIELDS)) if prev is not None else {}
+        fields.update({key: data[key] for key in REPORTED_FIELDS if key in data})
+        return fields
+
+    def _request_sync(self, device_id: str) -> None:
+        now = time.time()
+        with self._sync_lock:
+            last = self._sync_requested_at.get(device_id, 0.0)
+            if now - last < settings.sync_request_interval_s:
+                return
+            self._sync_requested_at[device_id] = now
+            self.sync_requests += 1
+        topic = settings.aws_iot_topic_cmd.format(device_id=device_id)
+        self._publish(topic, "SYNC", qos=1, kind="cmd")
+
+    def _adopt_local_change(self, device_id: str, heartbeat: Heartbeat) -> None:
+        """
+        O varal já aplicou o desejado atual ("dv" em dia), mas mostra outro
+        modo: mudou por comando local (WebSocket na rede da casa). O desejado
+        passa a ser esse modo, senão a próxima reconexão desfaria a escolha.
+        """
+        desired = self._devices.get_desired(device_id)
+        if desired.version == 0 or heartbeat.dv != desired.version:
+            return
+        if heartbeat.mode is None or desired.mode is None or heartbeat.mode == desired.mode:
+            return
+        print(f"[SHADOW] {device_id}: modo mudou no varal ({heartbeat.mode.value}), atualizando o desejado")
+        self.set_desired(device_id, mode=heartbeat.mode)
+
+    def _handle_retained_desired(self, device_id: str, payload: str) -> None:
+        """Estado desejado vindo do broker (retido, ou o que acabamos de publicar)."""
+        try:
+            doc = json.loads(payload) if payload else None
+            if not isinstance(doc, dict) or not isinstance(doc.get("v"), int):
                 return
+            retained = DesiredState(version=doc["v"], mode=doc.get("mode"), heartbeat_s=doc.get("hb_s"))
+        except ValueError:  # JSON inválido ou campo fora do modelo
+            return
+
+        if self._devices.put_desired_if_newer(device_id, retained):
+            return
+        # O broker tem uma versão mais velha que a nossa (publicação perdida): republica
+        ours = self._devices.get_desired(device_id)
+        if ours.version > retained.version:
+            self._publish_desired(device_id, ours)
+
+    def _publish_desired(
+        self,
+        device_id: str,
+        desired: DesiredState,
+        on_delivered: Optional[Callable[[float], None]] = None,
+    ) -> bool:
+        doc: Dict[str, Any] = {"v": desired.version}
+        if desired.mode is not None:
+            doc["mode"] = desired.mode.value
+        if desired.heartbeat_s is not None:
+            doc["hb_s"] = desired.heartbeat_s
+        topic = settings.aws_iot_topic_desired.format(device_id=device_id)
+        payload = json.dumps(doc, separators=(",", ":"))
+        return self._publish(topic, payload, qos=1, retain=True, kind="desired", on_delivered=on_delivered)
+
+    def _send_ack(self, device_id: str, seq: Any) -> None:
+        topic = settings.aws_iot_topic_ack.format(device_id=device_id)
+        self._publish(topic, str(seq), qos=1, kind="ack")
 
-            try:
-                data = json.loads(payload)
-            except Exception as e:
-                print("[MQTT] Erro ao parsear heartbeat:", e)
+    def _publish(
+        self,
+        topic: str,
+        payload: str,
+        qos: int = 0,
+        retain: bool = False,
+        kind: str = "cmd",
+        on_delivered: Optional[Callable[[float], None]] = None,
+    ) -> bool:
+        """
+        Publica sem esperar (o paho enfileira e a thread dele envia) e registra
+        o mid: o PUBACK alimenta o histograma de latência e chama on_delivered
+        com o instante da entrega. Várias chamadas seguidas ficam em voo juntas.
+        """
+        started = time.perf_counter()
+        result = self._client.publish(topic, payload, qos=qos, retain=retain)
+        ok = result.rc == mqtt.MQTT_ERR_SUCCESS
+        if not ok:
+            PUBLISH_ERRORS.inc(kind)
+            print(f"[MQTT] Falha ao publicar em {topic} (rc={result.rc})")
+
+        # Recusada sem conexão, a QoS1 fica na fila do paho e sai na reconexão;
+        # a QoS0 é descartada e nunca terá on_publish: não entra na conta
+        track = ok or qos > 0
+        with self._publish_lock:
+            self._expire_inflight_locked(started)
+            acked_at = self._early_acks.pop(result.mid, None)
+            if acked_at is None and track:
+                stale = self._inflight.get(result.mid)
+                if stale is not None:  # mid reaproveitado: a publicação antiga não terá PUBACK
+                    PUBLISH_EXPIRED.inc(stale[1])
+                self._inflight[result.mid] = (started, kind, on_delivered)
+        if acked_at is not None and track:
+            self._delivered(started, kind, on_delivered, acked_at)
+        return ok
+
+    def _expire_inflight_locked(self, now: float) -> None:
+        """Tira da conta as publicações sem PUBACK no prazo (no máximo uma varredura por segundo)."""
+        if now < self._next_expire:
+            return
+        self._next_expire = now + 1.0
+        limit = now - settings.mqtt_inflight_expire_s
+        for mid in [mid for mid, entry in self._inflight.items() if entry[0] < limit]:
+            PUBLISH_EXPIRED.inc(self._inflight.pop(mid)[1])
+        for mid in [mid for mid, at in self._early_acks.items() if at < limit]:
+            del self._early_acks[mid]
+
+    def _on_publish(self, client, userdata, mid):
+        now = time.perf_counter()
+        with self._publish_lock:
+            entry = self._inflight.pop(mid, None)
+            if entry is None:
+                self._early_acks[mid] = now
                 return
+        self._delivered(*entry, now)
 
-            hb_dict: Dict[str, Any] = {
-                "temp_c": data.get("temp_c"),
-                "humidity": data.get("humidity"),
-                "rain": data.get("rain"),
-                "mode": data.get("mode"),
-                "uptime_ms": data.get("uptime_ms"),
-                "received_at": time.time(),
-            }
+    @staticmethod
+    def _delivered(started: float, kind: str, on_delivered: Optional[Callable[[float], None]], at: float) -> None:
+        PUBLISH_SECONDS.observe(at - started, kind)
+        if on_delivered is not None:
+            on_delivered(time.time() - (time.perf_counter() - at))
 
+    def _first_time_seen(self, device_id: str, seq: Any) -> bool:
+        """Registra o seq; False se ele já estava entre os últimos vistos."""
+        with self._seen_lock:
+            seen = self._seen_seq.get(device_id)
+            if seen is None:
+                seen = (deque(maxlen=settings.ack_dedup_window), set())
+                self._seen_seq[device_id] = seen
+            order, members = seen
+            if seq in members:
+                return False
+            if len(order) == order.maxlen:
+                members.discard(order[0])
+            order.append(seq)
+            members.add(seq)
+            return True
 
-            heartbeat = Heartbeat(**hb_dict)
-            with self._lock:
-                self._last_heartbeat = heartbeat
+    def _check_command_ack(self, device_id: str, heartbeat: Heartbeat) -> None:
+        """
+        Confirma o comando pendente quando o varal reporta a versão do desejado
+        que o comando criou ("dv" >= versão, como em groups.on_report). O modo
+        sozinho não serve: pedir AUTO a um varal já em AUTO confirmaria com
+        qualquer heartbeat. Firmware sem "dv": vale o modo reportado.
+        """
+        with self._pending_lock:
+            pending = self._pending_cmd.get(device_id)
+            if pending is None:
+                return
+            if heartbeat.dv is not None:
+                applied = heartbeat.dv >= pending["version"]
+            else:
+                applied = heartbeat.mode is not None and heartbeat.mode.value == pending["mode"]
+            if not applied:
+                return
+            del self._pending_cmd[device_id]
 
-            print("[MQTT] Heartbeat atualizado:", heartbeat.model_dump())
+        self.events.publish(device_id, {
+            "type": "ack",
+            "device_id": device_id,
+            "command": pending["command"],
+            "version": pending["version"],
+            "latency_s": heartbeat.received_at - pending["sent_at"],
+        })
 
+    @staticmethod
+    def _device_id_from_topic(topic: str, pattern: List[str]) -> Optional[str]:
+        """Extrai o device_id se o tópico casa com o padrão (segmento "+" = ID)."""
+        parts = topic.split("/")
+        if len(parts) != len(pattern):
+            return None
+        id_index = pattern.index("+")
+        for i, expected in enumerate(pattern):
+            if i != id_index and parts[i] != expected:
+                return None
+        return parts[id_index] or None
 
     def _on_disconnect(self, client, userdata, rc):
         print(f"[MQTT] Desconectado do AWS IoT (rc={rc})")
@@ -106,20 +402,151 @@ class MqttManager:
         except Exception as e:
             print("[MQTT] Erro ao parar cliente MQTT:", e)
 
-    def get_last_heartbeat(self) -> Optional[Heartbeat]:
-        """Retorna o último heartbeat recebido (ou None)."""
-        with self._lock:
-            return self._last_heartbeat
+    def get_last_heartbeat(self, device_id: str) -> Optional[Heartbeat]:
+        """Retorna o último heartbeat recebido do dispositivo (ou None)."""
+        return self._devices.get_heartbeat(device_id)
 
-    def publish_command(self, command: str) -> bool:
-        """Publica um comando simples no tópico de controle do varal."""
-        topic = settings.aws_iot_topic_cmd
-        result = self._client.publish(topic, command)
-        ok = result.rc == mqtt.MQTT_ERR_SUCCESS
-        if not ok:
-            print(f"[MQTT] Falha ao publicar comando '{command}' (rc={result.rc})")
+    def list_devices(self) -> List[Heartbeat]:
+        """Retorna o último heartbeat de cada dispositivo conhecido."""
+        return self._devices.list_devices()
+
+    def count_devices(self) -> int:
+        return self._devices.count()
+
+    def count_online(self) -> int:
+        """Varais cujo último heartbeat tem até N intervalos (hb_s do varal, ou o padrão)."""
+        return self._devices.count_online(settings.history_expected_interval_s, settings.online_missed_heartbeats)
+
+    def inflight_count(self) -> int:
+        with self._publish_lock:
+            return len(self._inflight)
+
+    def get_state(self, device_id: str) -> Optional[DeviceState]:
+        """Desejado x reportado do dispositivo (None se não há nenhum dos dois)."""
+        desired = self._devices.get_desired(device_id)
+        reported = self._devices.get_heartbeat(device_id)
+        if desired.version == 0 and reported is None:
+            return None
+
+        delta: Dict[str, Any] = {}
+        wanted = {"mode": desired.mode, "hb_s": desired.heartbeat_s}
+        for key, value in wanted.items():
+            if value is not None and (reported is None or getattr(reported, key) != value):
+                delta[key] = value.value if isinstance(value, VaralMode) else value
+
+        applied = reported is not None and (reported.dv or 0) >= desired.version
+        return DeviceState(device_id=device_id, desired=desired, reported=reported,
+                           delta=delta, in_sync=applied and not delta)
+
+    def set_desired(
+        self,
+        device_id: str,
+        mode: Optional[VaralMode] = None,
+        heartbeat_s: Optional[int] = None,
+    ) -> Optional[DesiredState]:
+        """
+        Muda o estado desejado (nova versão) e publica retido: um varal offline
+        recebe a versão mais nova quando reconectar. Se a publicação falhar, o
+        estado fica guardado e é republicado quando o retido antigo chegar.
+        """
+        desired = self._next_desired(device_id, mode, heartbeat_s)
+        return desired if self._announce_desired(device_id, desired) else None
+
+    def _next_desired(
+        self,
+        device_id: str,
+        mode: Optional[VaralMode] = None,
+        heartbeat_s: Optional[int] = None,
+    ) -> DesiredState:
+        reported = self._devices.get_heartbeat(device_id)
+        min_version = (reported.dv or 0) if reported is not None else 0
+        return self._devices.update_desired(device_id, mode, heartbeat_s, min_version)
+
+    def _announce_desired(
+        self,
+        device_id: str,
+        desired: DesiredState,
+        on_delivered: Optional[Callable[[float], None]] = None,
+    ) -> bool:
+        """Publica o desejado (retido) e avisa o stream do dispositivo."""
+        ok = self._publish_desired(device_id, desired, on_delivered)
+        self.events.publish(device_id, {
+            "type": "desired",
+            "device_id": device_id,
+            "data": desired.model_dump(mode="json"),
+        })
         return ok
 
+    def publish_command(self, device_id: str, command: str) -> bool:
+        """
+        Comando para o varal indicado. OPEN/CLOSE/AUTO viram estado desejado
+        (não se perdem com o varal offline); os demais (ex: DUMP) vão direto
+        no tópico de controle.
+        """
+        expected_mode = COMMAND_TO_MODE.get(command)
+        desired: Optional[DesiredState] = None
+        if expected_mode is not None:
+            desired = self.set_desired(device_id, mode=VaralMode(expected_mode))
+            ok = desired is not None
+        else:
+            topic = settings.aws_iot_topic_cmd.format(device_id=device_id)
+            ok = self._publish(topic, command, kind="cmd")
+        if not ok:
+            return False
+
+        self._command_sent(device_id, command, desired)
+        return True
+
+    def publish_group(self, command: str, device_ids: List[str], tags: List[str], match: str) -> str:
+        """
+        Fan-out de OPEN/CLOSE/AUTO para um grupo: uma versão nova do estado
+        desejado por varal, publicadas em sequência sem esperar PUBACK (ficam
+        até mqtt_max_inflight em voo). Retorna o id do job; entrega e
+        conclusão de cada varal são acompanhadas em self.groups.
+        """
+        mode = VaralMode(COMMAND_TO_MODE[command])
+        job_id = self.groups.create(command, mode.value, tags, match, device_ids)
+        started = time.perf_counter()
+        for device_id in device_ids:
+            desired = self._next_desired(device_id, mode=mode)
+            # A versão vai para o job antes do publish: a resposta do varal pode chegar logo
+            self.groups.assign(job_id, device_id, desired.version)
+            delivered = functools.partial(self.groups.delivered, job_id, device_id)
+            if self._announce_desired(device_id, desired, delivered):
+                self._command_sent(device_id, command, desired)
+            else:
+                self.groups.failed(job_id, device_id)
+        self.groups.publish_done(job_id, time.perf_counter() - started)
+        return job_id
+
+    def _command_sent(self, device_id: str, command: str, desired: Optional[DesiredState]) -> None:
+        """Registra o comando para o "ack" do stream (heartbeat com a versão do desejado)."""
+        sent_at = time.time()
+        if desired is not None:
+            with self._pending_lock:
+                self._pending_cmd[device_id] = {
+                    "command": command, "version": desired.version,
+                    "mode": desired.mode.value if desired.mode is not None else None, "sent_at": sent_at,
+                }
+        self.events.publish(device_id, {
+            "type": "command",
+            "device_id": device_id,
+            "command": command,
+            "sent_at": sent_at,
+        })
+
 
 # Instância única para a aplicação inteira
 mqtt_manager = MqttManager()
+
+metrics.gauge_from("varal_devices_known", "Varais que já mandaram heartbeat", mqtt_manager.count_devices)
+metrics.gauge_from("varal_devices_online", "Varais com heartbeat recente (até N intervalos do próprio varal)",
+                   mqtt_manager.count_online)
+metrics.gauge_from("varal_mqtt_inflight", "Publicações aguardando PUBACK", mqtt_manager.inflight_count)
+metrics.counter_from("varal_mqtt_duplicates_total", "Heartbeats repetidos (reenvio do firmware) descartados",
+                     lambda: mqtt_manager.duplicates)
+metrics.counter_from("varal_sync_requests_total", "Pedidos de relatório completo (SYNC)",
+                     lambda: mqtt_manager.sync_requests)
+metrics.gauge_from("varal_group_jobs_open", "Comandos em grupo ainda sem resultado para todos os varais",
+                   mqtt_manager.groups.open_jobs)
+metrics.gauge_from("varal_stream_subscribers", "Clientes do stream WebSocket", mqtt_manager.events.subscriber_count)
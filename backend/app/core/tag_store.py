@@ -0,0 +1,103 @@
+import json
+import os
+import threading
+from typing import Dict, Iterable, List, Set
+
+from app.core.config import settings
+
+
+class TagStore:
+    """
+    Tags por dispositivo ("regiao:sul", "predio-b", ...) para comandos em grupo.
+
+    Índice nos dois sentidos (tag -> varais, varal -> tags): selecionar um
+    grupo custa o tamanho das tags pedidas, não o número de varais. Fica em
+    memória e é gravado inteiro num JSON a cada mudança (troca atômica do
+    arquivo); as tags mudam pouco, ao contrário dos heartbeats.
+    """
+
+    def __init__(self, path: str) -> None:
+        self._path = path
+        self._lock = threading.Lock()
+        self._by_device: Dict[str, Set[str]] = {}
+        self._by_tag: Dict[str, Set[str]] = {}
+
+    def start(self) -> None:
+        """Carrega o arquivo (se existir)."""
+        try:
+            with open(self._path, "r", encoding="utf-8") as f:
+                doc = json.load(f)
+        except FileNotFoundError:
+            return
+        except (OSError, ValueError) as e:
+            print(f"[TAGS] Erro ao ler {self._path}: {e}")
+            return
+        with self._lock:
+            for device_id, tags in doc.items():
+                self._set_locked(device_id, set(tags))
+        print(f"[TAGS] {len(self._by_device)} dispositivos com tags")
+
+    def _set_locked(self, device_id: str, tags: Set[str]) -> None:
+        for tag in self._by_device.pop(device_id, set()) - tags:
+            members = self._by_tag.get(tag)
+            if members is not None:
+                members.discard(device_id)
+                if not members:
+                    del self._by_tag[tag]
+        if tags:
+            self._by_device[device_id] = tags
+            for tag in tags:
+                self._by_tag.setdefault(tag, set()).add(device_id)
+
+    def _save_locked(self) -> None:
+        directory = os.path.dirname(self._path)
+        if directory:
+            os.makedirs(directory, exist_ok=True)
+        tmp = self._path + ".tmp"
+        with open(tmp, "w", encoding="utf-8") as f:
+            json.dump({device: sorted(tags) for device, tags in self._by_device.items()}, f)
+        os.replace(tmp, self._path)
+
+    def set_tags(self, device_id: str, tags: Iterable[str]) -> List[str]:
+        """Substitui as tags do dispositivo (lista vazia remove)."""
+        wanted = set(tags)
+        with self._lock:
+            self._set_locked(device_id, wanted)
+            self._save_locked()
+        return sorted(wanted)
+
+    def update_tag(self, tag: str, add: Iterable[str] = (), remove: Iterable[str] = ()) -> int:
+        """Põe/tira uma tag de muitos varais de uma vez (uma gravação). Retorna o tamanho do grupo."""
+        with self._lock:
+            for device_id in add:
+                self._set_locked(device_id, self._by_device.get(device_id, set()) | {tag})
+            for device_id in remove:
+                self._set_locked(device_id, self._by_device.get(device_id, set()) - {tag})
+            self._save_locked()
+            return len(self._by_tag.get(tag, ()))
+
+    def get_tags(self, device_id: str) -> List[str]:
+        with self._lock:
+            return sorted(self._by_device.get(device_id, ()))
+
+    def select(self, tags: Iterable[str], match_all: bool = True) -> List[str]:
+        """Varais com todas as tags (match_all) ou com qualquer uma delas."""
+        with self._lock:
+            groups = [self._by_tag.get(tag, set()) for tag in tags]
+            if not groups:
+                return []
+            if match_all:
+                groups.sort(key=len)  # interseção a partir do menor grupo
+                selected = set(groups[0]).intersection(*groups[1:])
+            else:
+                selected = set().union(*groups)
+        return sorted(selected)
+
+    def counts(self) -> Dict[str, int]:
+        """Número de varais por tag."""
+        with self._lock:
+            return {tag: len(members) for tag, members in sorted(self._by_tag.items())}
+
+
+# Instância única para a aplicação inteira
+tag_store = TagStore(settings.tags_path)
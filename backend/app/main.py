@@ -1,7 +1,13 @@
+import os
+
 from fastapi import FastAPI
+from fastapi.staticfiles import StaticFiles
 
-from app.api.routes import heartbeat, commands
+from app.api.routes import devices, groups, metrics
+from app.core.config import settings
+from app.core.history_store import history_store
 from app.core.mqtt_client import mqtt_manager
+from app.core.tag_store import tag_store
 
 
 def create_app() -> FastAPI:
@@ -11,18 +17,26 @@ def create_app() -> FastAPI:
     )
 
     # Rotas
-    app.include_router(heartbeat.router)
-    app.include_router(commands.router)
+    app.include_router(devices.router)
+    app.include_router(groups.router)
+    app.include_router(metrics.router)
+
+    # Pacotes OTA: arquivos estáticos, com Range (o varal retoma o download)
+    os.makedirs(settings.ota_dir, exist_ok=True)
+    app.mount("/ota", StaticFiles(directory=settings.ota_dir), name="ota")
 
     @app.on_event("startup")
     def on_startup() -> None:
-        """Inicia o cliente MQTT quando a API sobe."""
+        """Inicia o histórico, as tags e o cliente MQTT quando a API sobe."""
+        history_store.start()
+        tag_store.start()
         mqtt_manager.start()
 
     @app.on_event("shutdown")
     def on_shutdown() -> None:
-        """Encerra o cliente MQTT quando a API desce."""
+        """Encerra o cliente MQTT e grava o que falta do histórico."""
         mqtt_manager.stop()
+        history_store.stop()
 
     return app
 
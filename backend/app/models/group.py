@@ -0,0 +1,52 @@
+from typing import Annotated, Dict, List, Literal, Optional
+
+from pydantic import BaseModel, Field
+
+# Tag: minúsculas, dígitos e "-_.:" (ex: "regiao:sul", "predio-b")
+TAG_PATTERN = r"^[a-z0-9][a-z0-9_.:\-]{0,63}$"
+
+Tag = Annotated[str, Field(pattern=TAG_PATTERN)]
+
+
+class TagList(BaseModel):
+    tags: List[Tag] = Field(default_factory=list, max_length=32)
+
+
+class TagUpdate(BaseModel):
+    # device_ids que ganham / perdem a tag
+    add: List[str] = Field(default_factory=list)
+    remove: List[str] = Field(default_factory=list)
+
+
+class GroupCommandRequest(BaseModel):
+    command: str  # "OPEN", "CLOSE" ou "AUTO"
+    tags: List[Tag] = Field(min_length=1)
+    match: Literal["all", "any"] = "all"  # todas as tags ou qualquer uma
+
+
+class GroupDeviceStatus(BaseModel):
+    device_id: str
+    # queued -> delivered (PUBACK do broker) -> completed (heartbeat com o "dv" novo);
+    # failed (publish recusado) ou timeout (sem resposta no prazo)
+    state: Literal["queued", "delivered", "completed", "failed", "timeout"]
+    version: Optional[int] = None  # versão do estado desejado publicada
+    delivered_ms: Optional[float] = None  # desde o início do job
+    completed_ms: Optional[float] = None
+
+
+class GroupJob(BaseModel):
+    id: str
+    command: str
+    tags: List[str]
+    match: str
+    created_at: float
+    publish_ms: float  # tempo para entregar todas as publicações ao cliente MQTT
+    total: int
+    counts: Dict[str, int]  # varais por estado
+    done: bool
+    # Percentis (ms) de entrega ao broker e de conclusão no varal
+    delivered_p50_ms: Optional[float] = None
+    delivered_p99_ms: Optional[float] = None
+    completed_p50_ms: Optional[float] = None
+    completed_p99_ms: Optional[float] = None
+    devices: Optional[List[GroupDeviceStatus]] = None
@@ -1,5 +1,5 @@
 from enum import Enum
-from typing import Optional
+from typing import Any, Dict, List, Optional
 
 from pydantic import BaseModel
 
@@ -11,9 +11,24 @@ class VaralMode(str, Enum):
 
 
 class Heartbeat(BaseModel):
+    device_id: Optional[str] = None
     temp_c: Optional[float] = None
     humidity: Optional[float] = None
     rain: Optional[bool] = None
+    rain_likely: Optional[bool] = None  # previsão por tendência (DHT11)
     mode: Optional[VaralMode] = None  # <-- novo
     uptime_ms: Optional[int] = None
+    reaction_ms: Optional[int] = None  # último evento -> comando do motor
+    # Custo de cada etapa do loop() desde o heartbeat anterior: {"mqtt": [média, máx] µs, ...}
+    loop_us: Optional[Dict[str, List[float]]] = None
+    # Heap (livre, mínimo, maior bloco), alocações no loop e pilha das tasks (bytes)
+    mem: Optional[Dict[str, Any]] = None
+    # Fila de saída MQTT: queued, inflight, sent, acked, retx, dropped, expired
+    mqtt: Optional[Dict[str, int]] = None
+    # Janela de cada sensor: {"rain.analog": [média, mín, máx], ...}
+    sensors: Optional[Dict[str, List[float]]] = None
+    # Versão do relatório (sobe a cada heartbeat) e do estado desejado já aplicado
+    rv: Optional[int] = None
+    dv: Optional[int] = None
+    hb_s: Optional[int] = None  # intervalo do heartbeat em uso (s)
     received_at: float  # timestamp local (servidor)
@@ -0,0 +1,24 @@
+from typing import List, Optional
+
+from pydantic import BaseModel
+
+
+class HistoryBucket(BaseModel):
+    t: float  # início do bucket (epoch, segundos)
+    n: int    # heartbeats agregados no bucket
+    temp_avg: Optional[float] = None
+    temp_min: Optional[float] = None
+    temp_max: Optional[float] = None
+    humidity_avg: Optional[float] = None
+    humidity_min: Optional[float] = None
+    humidity_max: Optional[float] = None
+    rain_ratio: Optional[float] = None  # fração dos heartbeats com chuva
+
+
+class HistoryResponse(BaseModel):
+    device_id: str
+    start: float
+    end: float
+    resolution: str  # "raw", "1m" ou "1h"
+    step_s: int      # largura de cada bucket (0 em "raw")
+    points: List[HistoryBucket]
@@ -0,0 +1,26 @@
+from typing import Any, Dict, Optional
+
+from pydantic import BaseModel, Field
+
+from app.models.heartbeat import Heartbeat, VaralMode
+
+
+class DesiredState(BaseModel):
+    version: int = 0  # sobe a cada mudança; o firmware devolve a aplicada em "dv"
+    mode: Optional[VaralMode] = None
+    heartbeat_s: Optional[int] = None
+    updated_at: Optional[float] = None
+
+
+class DesiredUpdate(BaseModel):
+    mode: Optional[VaralMode] = None
+    heartbeat_s: Optional[int] = Field(None, ge=10, le=3600)
+
+
+class DeviceState(BaseModel):
+    device_id: str
+    desired: DesiredState
+    reported: Optional[Heartbeat] = None
+    # Campos desejados que o varal ainda não mostra (nome do campo -> valor desejado)
+    delta: Dict[str, Any]
+    in_sync: bool
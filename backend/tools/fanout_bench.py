@@ -0,0 +1,227 @@
+"""
+Fan-out de comando para milhares de varais: comando em grupo x um por um.
+
+Sobe N varais virtuais do swarm_sim no broker local (workers com
+selectors): inscritos em casa/<id>/desired, aplicam versão nova e
+respondem na hora com heartbeat completo ("rv"/"dv"). Marca todos com uma tag no backend e mede:
+
+- group: um POST /groups/cmd (publicações QoS1 em pipeline no backend)
+- serial: um POST /devices/{id}/cmd por varal (como antes do fan-out)
+
+Para cada um: tempo da requisição (ou da sequência), tempo até cada varal
+receber/aplicar o comando (relógio do próprio processo) e, no modo group,
+o que o backend acompanhou (entrega ao broker e conclusão por varal). No
+fim imprime as linhas principais do /metrics.
+
+Exemplo (backend rodando com o mesmo broker):
+    python -m tools.fanout_bench --devices 5000 --workers 4 --backend-url http://localhost:8000
+    python -m tools.fanout_bench --devices 2000 --mode both --port 1883
+"""
+
+import argparse
+import json
+import random
+import time
+import urllib.request
+from typing import Any, Dict, List, Optional
+
+from tools.swarm_sim import VirtualVaral, Worker, new_client, percentiles
+
+COMMAND_TO_MODE = {"OPEN": "FORCE_OPEN", "CLOSE": "FORCE_CLOSE", "AUTO": "AUTO"}
+
+# Métricas do backend mostradas no resumo (prefixos)
+METRICS_SHOWN = (
+    "varal_heartbeats_total", "varal_devices_known", "varal_devices_online", "varal_mqtt_inflight",
+    "varal_mqtt_publish_seconds_count", "varal_mqtt_publish_seconds_sum",
+    "varal_group_completion_seconds_count", "varal_group_completion_seconds_sum",
+    "varal_group_devices_total", "varal_mqtt_publish_errors_total",
+)
+
+
+# =========================================
+# VARAL VIRTUAL (estado desejado)
+# =========================================
+
+class DesiredVaral(VirtualVaral):
+    """Varal do swarm_sim (já segue casa/<id>/desired) que anota quando aplicou cada modo."""
+
+    def __init__(self, device_id: str, rng, started_at: float) -> None:
+        super().__init__(device_id, rng, started_at)
+        self.applied_at: Dict[str, float] = {}  # modo -> instante em que chegou
+
+    def _on_connect(self, client, userdata, flags, rc, properties=None):
+        super()._on_connect(client, userdata, flags, rc, properties)
+        if rc == 0:
+            self.publish_heartbeat(time.time())
+
+    def apply_desired(self, doc: Dict) -> None:
+        super().apply_desired(doc)
+        if doc.get("mode") in COMMAND_TO_MODE.values():
+            self.applied_at[self.mode] = time.time()
+
+
+# =========================================
+# BACKEND (HTTP)
+# =========================================
+
+def http_json(url: str, method: str = "GET", body: Optional[dict] = None, timeout: float = 30.0) -> Any:
+    data = json.dumps(body).encode() if body is not None else None
+    req = urllib.request.Request(url, data=data, method=method, headers={"Content-Type": "application/json"})
+    with urllib.request.urlopen(req, timeout=timeout) as resp:
+        return json.loads(resp.read())
+
+
+def scrape_metrics(backend_url: str) -> List[str]:
+    with urllib.request.urlopen(f"{backend_url}/metrics", timeout=10) as resp:
+        text = resp.read().decode()
+    return [line for line in text.splitlines() if line.startswith(METRICS_SHOWN)]
+
+
+def metric_value(backend_url: str, name: str) -> float:
+    for line in scrape_metrics(backend_url):
+        if line.startswith(name + " "):
+            return float(line.split()[-1])
+    return 0.0
+
+
+# =========================================
+# MEDIÇÕES
+# =========================================
+
+def wait_applied(devices: List[DesiredVaral], mode: str, timeout: float) -> int:
+    """Espera os varais aplicarem o modo; retorna quantos não aplicaram."""
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        missing = sum(1 for d in devices if mode not in d.applied_at)
+        if missing == 0:
+            return 0
+        time.sleep(0.02)
+    return sum(1 for d in devices if mode not in d.applied_at)
+
+
+def reach(devices: List[DesiredVaral], mode: str, started: float) -> List[float]:
+    return [d.applied_at[mode] - started for d in devices if mode in d.applied_at]
+
+
+def run_group(args, devices: List[DesiredVaral], tag: str, command: str) -> None:
+    mode = COMMAND_TO_MODE[command]
+    started = time.time()
+    job = http_json(f"{args.backend_url}/groups/cmd", "POST", {"command": command, "tags": [tag]})
+    request_s = time.time() - started
+    missing = wait_applied(devices, mode, args.timeout)
+    applied = reach(devices, mode, started)
+
+    # Espera o backend fechar o job (conclusão por varal vem dos heartbeats)
+    deadline = time.time() + args.timeout
+    while not job["done"] and time.time() < deadline:
+        time.sleep(0.1)
+        job = http_json(f"{args.backend_url}/groups/cmd/{job['id']}")
+
+    print(f"[FANOUT] group {command}: requisição {request_s * 1000:.0f} ms "
+          f"(publish no backend {job['publish_ms']:.0f} ms), {len(devices) - missing}/{len(devices)} aplicaram")
+    print(f"[FANOUT]   varal recebeu      : {percentiles(applied)} max={max(applied, default=0) * 1000:.0f}ms")
+    print(f"[FANOUT]   backend: entregue   p50={job['delivered_p50_ms']}ms p99={job['delivered_p99_ms']}ms | "
+          f"concluído p50={job['completed_p50_ms']}ms p99={job['completed_p99_ms']}ms | {job['counts']}")
+
+
+def run_serial(args, devices: List[DesiredVaral], command: str) -> None:
+    mode = COMMAND_TO_MODE[command]
+    started = time.time()
+    failures = 0
+    for dev in devices:
+        try:
+            http_json(f"{args.backend_url}/devices/{dev.device_id}/cmd", "POST", {"command": command})
+        except OSError:
+            failures += 1
+    request_s = time.time() - started
+    missing = wait_applied(devices, mode, args.timeout)
+    applied = reach(devices, mode, started)
+    print(f"[FANOUT] serial {command}: {len(devices)} requisições em {request_s * 1000:.0f} ms "
+          f"({failures} falharam), {len(devices) - missing}/{len(devices)} aplicaram")
+    print(f"[FANOUT]   varal recebeu      : {percentiles(applied)} max={max(applied, default=0) * 1000:.0f}ms")
+
+
+# =========================================
+# MAIN
+# =========================================
+
+def parse_args(argv: Optional[List[str]] = None):
+    p = argparse.ArgumentParser(description="Fan-out de comando: grupo (pipeline) x um por um.")
+    p.add_argument("--devices", type=int, default=2000)
+    p.add_argument("--workers", type=int, default=4)
+    p.add_argument("--mode", choices=("group", "serial", "both"), default="both")
+    p.add_argument("--rounds", type=int, default=2, help="comandos por modo (CLOSE/OPEN alternados)")
+    p.add_argument("--broker", default="localhost")
+    p.add_argument("--port", type=int, default=1883)
+    p.add_argument("--backend-url", default="http://localhost:8000")
+    p.add_argument("--timeout", type=float, default=60.0, help="espera máxima por rodada (s)")
+    p.add_argument("--prefix", default=None, help="prefixo dos IDs (padrão: um por execução)")
+    p.add_argument("--seed", type=int, default=1)
+    args = p.parse_args(argv)
+    args.backend_url = args.backend_url.rstrip("/")
+    args.workers = max(1, min(args.workers, args.devices))
+    # Sem heartbeat periódico: só as respostas aos comandos (mede o fan-out, não a carga)
+    args.heartbeat_interval = 1e9
+    return args
+
+
+def main(argv: Optional[List[str]] = None) -> None:
+    args = parse_args(argv)
+    rng = random.Random(args.seed)
+    prefix = args.prefix or f"fan{int(time.time()) % 100000:05d}-"
+    tag = f"bench:{prefix.rstrip('-')}"
+    started = time.time()
+
+    devices = [DesiredVaral(f"{prefix}{i:05d}", random.Random(rng.random()), started)
+               for i in range(args.devices)]
+    workers = [Worker(i, devices[i::args.workers], args) for i in range(args.workers)]
+    known_before = metric_value(args.backend_url, "varal_devices_known")
+    for w in workers:
+        w.start()
+
+    # Backend já viu todos (primeiro heartbeat de cada varal)
+    deadline = time.time() + args.timeout
+    while time.time() < deadline:
+        if metric_value(args.backend_url, "varal_devices_known") - known_before >= args.devices:
+            break
+        time.sleep(0.5)
+    print(f"[FANOUT] {args.devices} varais conectados em {time.time() - started:.1f} s "
+          f"({len(workers)} workers -> {args.broker}:{args.port})")
+
+    ids = [d.device_id for d in devices]
+    http_json(f"{args.backend_url}/groups/tags/{tag}", "POST", {"add": ids})
+
+    try:
+        commands = ["CLOSE" if i % 2 == 0 else "OPEN" for i in range(args.rounds * 2)]
+        for i, command in enumerate(commands):
+            for d in devices:
+                d.applied_at.pop(COMMAND_TO_MODE[command], None)
+            use_group = args.mode == "group" or (args.mode == "both" and i % 2 == 0)
+            if use_group:
+                run_group(args, devices, tag, command)
+            else:
+                run_serial(args, devices, command)
+            time.sleep(0.5)
+    finally:
+        http_json(f"{args.backend_url}/groups/tags/{tag}", "POST", {"remove": ids})
+        # Limpa os desejados retidos dos varais de teste
+        cleaner = new_client(f"{prefix}cleaner")
+        cleaner.connect(args.broker, args.port, keepalive=30)
+        cleaner.loop_start()
+        for d in devices:
+            cleaner.publish(d.topic_desired, b"", qos=0, retain=True)
+        time.sleep(1.0)
+        cleaner.loop_stop()
+        cleaner.disconnect()
+        for w in workers:
+            w.running = False
+        for w in workers:
+            w.join(timeout=5)
+
+    print("[FANOUT] ===== /metrics =====")
+    for line in scrape_metrics(args.backend_url):
+        print(f"[FANOUT] {line}")
+
+
+if __name__ == "__main__":
+    main()
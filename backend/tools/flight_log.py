@@ -0,0 +1,351 @@
+"""
+Decodificador da caixa-preta do varal (flight_recorder.cpp).
+
+Busca o log pelo MQTT (comando DUMP em casa/<id>/cmd, pedaços em
+casa/<id>/log) ou lê uma imagem crua da partição "flightrec" e imprime
+a linha do tempo: boots, amostras de chuva/DHT, modos, movimentos e
+quedas de conexão.
+
+Exemplos:
+    python -m tools.flight_log --device varal-a1b2c3 --broker localhost
+    python -m tools.flight_log --device varal-a1b2c3 --sectors 4 --save log.bin
+    python -m tools.flight_log --file log.bin
+    python -m tools.flight_log --file log.bin --csv > chuva.csv   # traço de tempo para o replay no host
+
+Imagem direto da flash (offset/tamanho em partitions.csv):
+    esptool.py read_flash 0x370000 0x80000 log.bin
+"""
+
+import argparse
+import json
+import struct
+import sys
+import threading
+import time
+from typing import Dict, Iterator, List, Optional, Set, Tuple
+
+SECTOR_SIZE = 4096
+HEADER = struct.Struct("<IIII")  # magic, seq, boot, uptime_ms do início
+MAGIC = 0x31524656  # "VFR1"
+TICK_MS = 10
+
+CHUNK_DATA = 1
+CHUNK_END = 2
+# Cabeçalho do pedaço: tipo, versão, offset no setor, seq do setor, índice no dump
+CHUNK_HEADER = struct.Struct("<BBHII")
+CHUNK_HEADER_V0 = struct.Struct("<BBHI")  # firmware antigo: sem índice
+
+REC_BOOT, REC_RAIN, REC_DHT, REC_MODE, REC_MOVE_START, REC_MOVE_END, REC_LINK = range(1, 8)
+
+RESET_REASONS = [
+    "UNKNOWN", "POWERON", "EXT", "SW", "PANIC", "INT_WDT", "TASK_WDT",
+    "WDT", "DEEPSLEEP", "BROWNOUT", "SDIO",
+]
+MODES = ["AUTO", "FORCE_OPEN", "FORCE_CLOSE"]
+RAIN_LEVELS = ["NONE", "LIGHT", "MODERATE", "HEAVY"]
+
+
+# =========================================
+# DECODIFICAÇÃO
+# =========================================
+
+class Reader:
+    def __init__(self, data: bytes, pos: int) -> None:
+        self.data = data
+        self.pos = pos
+
+    def u8(self) -> int:
+        v = self.data[self.pos]
+        self.pos += 1
+        return v
+
+    def varint(self) -> int:
+        shift = 0
+        value = 0
+        while True:
+            b = self.u8()
+            value |= (b & 0x7F) << shift
+            if b < 0x80:
+                return value
+            shift += 7
+            if shift > 35:
+                raise ValueError("varint inválido")
+
+    def zigzag(self) -> int:
+        v = self.varint()
+        return (v >> 1) ^ -(v & 1)
+
+
+def decode_sector(data: bytes) -> Tuple[int, List[dict]]:
+    """Decodifica um setor (cabeçalho + registros). Retorna (seq, registros)."""
+    magic, seq, boot, base_ms = HEADER.unpack_from(data)
+    if magic != MAGIC:
+        raise ValueError("setor sem cabeçalho válido")
+
+    r = Reader(data, HEADER.size)
+    t = base_ms
+    rain = temp10 = hum10 = target = pos = 0
+    out: List[dict] = []
+
+    while r.pos < len(data) and data[r.pos] != 0xFF:
+        start = r.pos
+        try:
+            kind = r.u8()
+            t += r.varint() * TICK_MS
+            rec: dict = {"seq": seq, "boot": boot}
+
+            if kind == REC_BOOT:
+                boot = r.varint()
+                t = r.varint()
+                reason = r.u8()
+                rain = temp10 = hum10 = target = pos = 0
+                rec.update(type="BOOT", boot=boot,
+                           reason=RESET_REASONS[reason] if reason < len(RESET_REASONS) else reason)
+            elif kind == REC_RAIN:
+                rain += r.zigzag()
+                flags = r.u8()
+                level = flags >> 1
+                rec.update(type="RAIN", analog=rain, digital=bool(flags & 1),
+                           level=RAIN_LEVELS[level] if level < len(RAIN_LEVELS) else level)
+            elif kind == REC_DHT:
+                temp10 += r.zigzag()
+                hum10 += r.zigzag()
+                rec.update(type="DHT", temp_c=temp10 / 10, humidity=hum10 / 10)
+            elif kind == REC_MODE:
+                mode = r.u8()
+                rec.update(type="MODE", mode=MODES[mode] if mode < len(MODES) else mode)
+            elif kind == REC_MOVE_START:
+                motor = r.u8()
+                target += r.zigzag()
+                rec.update(type="MOVE_START", motor=motor, target_steps=target)
+            elif kind == REC_MOVE_END:
+                motor = r.u8()
+                pos += r.zigzag()
+                rec.update(type="MOVE_END", motor=motor, steps=pos)
+            elif kind == REC_LINK:
+                rec.update(type="LINK", up=bool(r.u8()))
+            else:
+                raise ValueError(f"tipo desconhecido {kind}")
+        except (IndexError, ValueError) as e:
+            print(f"[FLOG] setor {seq}: registro corrompido em +{start} ({e}); resto do setor ignorado",
+                  file=sys.stderr)
+            break
+
+        rec["uptime_ms"] = t
+        rec["boot"] = boot
+        out.append(rec)
+
+    return seq, out
+
+
+def decode_sectors(sectors: Dict[int, bytes]) -> Iterator[dict]:
+    """Registros de todos os setores, do mais antigo ao mais novo."""
+    for seq in sorted(sectors):
+        _, records = decode_sector(sectors[seq])
+        yield from records
+
+
+def sectors_from_image(image: bytes) -> Dict[int, bytes]:
+    sectors: Dict[int, bytes] = {}
+    for off in range(0, len(image) - SECTOR_SIZE + 1, SECTOR_SIZE):
+        data = image[off:off + SECTOR_SIZE]
+        magic, seq, _, _ = HEADER.unpack_from(data)
+        if magic == MAGIC:
+            sectors[seq] = data
+    return sectors
+
+
+def sectors_to_image(sectors: Dict[int, bytes]) -> bytes:
+    out = bytearray()
+    for seq in sorted(sectors):
+        data = bytes(sectors[seq])
+        out += data + b"\xff" * (SECTOR_SIZE - len(data))
+    return bytes(out)
+
+
+# =========================================
+# DUMP VIA MQTT
+# =========================================
+
+def missing_chunks(received: Set[int], total: Optional[int]) -> List[int]:
+    """Índices que faltam: até o total do pedaço "fim", ou até o maior recebido."""
+    last = total if total is not None else (max(received) + 1 if received else 0)
+    return [i for i in range(last) if i not in received]
+
+
+def format_ranges(values: List[int]) -> str:
+    out: List[str] = []
+    for v in values:
+        if out and out[-1][1] == v - 1:
+            out[-1][1] = v
+        else:
+            out.append([v, v])
+    return ", ".join(str(a) if a == b else f"{a}-{b}" for a, b in out)
+
+
+def fetch_dump(broker: str, port: int, device_id: str, sectors: int,
+               timeout: float) -> Tuple[Dict[int, bytes], bool]:
+    """
+    Pede o DUMP e junta os pedaços por setor. Os pedaços vão em QoS0: o
+    índice de cada um e o total no pedaço "fim" mostram o que se perdeu.
+    Retorna (setores, completo).
+    """
+    from tools.swarm_sim import new_client
+
+    topic_log = f"casa/{device_id}/log"
+    topic_cmd = f"casa/{device_id}/cmd"
+
+    parts: Dict[int, bytearray] = {}
+    received: Set[int] = set()
+    done = threading.Event()
+    last_chunk = [time.monotonic()]
+    expected = [None]
+    total_chunks: List[Optional[int]] = [None]
+    indexed = [True]
+
+    def on_connect(client, userdata, flags, rc, properties=None):
+        client.subscribe(topic_log)
+        client.publish(topic_cmd, f"DUMP {sectors}" if sectors else "DUMP")
+
+    def on_message(client, userdata, msg):
+        if len(msg.payload) >= CHUNK_HEADER.size and msg.payload[1] >= 1:
+            kind, _, offset, seq, index = CHUNK_HEADER.unpack_from(msg.payload)
+            data = msg.payload[CHUNK_HEADER.size:]
+        else:
+            kind, _, offset, seq = CHUNK_HEADER_V0.unpack_from(msg.payload)
+            index, data = None, msg.payload[CHUNK_HEADER_V0.size:]
+            indexed[0] = False
+        last_chunk[0] = time.monotonic()
+        if kind == CHUNK_END:
+            expected[0] = seq
+            total_chunks[0] = index
+            done.set()
+            return
+        if index is not None:
+            received.add(index)
+        buf = parts.setdefault(seq, bytearray())
+        if offset != len(buf):
+            print(f"[FLOG] setor {seq}: pedaço fora de ordem/perdido (offset {offset}, tinha {len(buf)})",
+                  file=sys.stderr)
+            if offset > len(buf):
+                buf.extend(b"\xff" * (offset - len(buf)))
+            del buf[offset:]
+        buf.extend(data)
+
+    client = new_client(f"flight-log-{int(time.time())}")
+    client.on_connect = on_connect
+    client.on_message = on_message
+    client.connect(broker, port, keepalive=60)
+    client.loop_start()
+    try:
+        while not done.wait(0.2):
+            if time.monotonic() - last_chunk[0] > timeout:
+                print("[FLOG] tempo esgotado esperando o varal", file=sys.stderr)
+                break
+    finally:
+        client.loop_stop()
+        client.disconnect()
+
+    complete = done.is_set()
+    if not complete:
+        print("[FLOG] pedaço de fim não chegou: dump incompleto", file=sys.stderr)
+    if expected[0] is not None and expected[0] != len(parts):
+        print(f"[FLOG] esperava {expected[0]} setores, recebi {len(parts)}", file=sys.stderr)
+        complete = False
+    if indexed[0]:
+        missing = missing_chunks(received, total_chunks[0])
+        if missing:
+            print(f"[FLOG] {len(missing)} pedaços perdidos (índices {format_ranges(missing)}); "
+                  f"repita o DUMP ou use --sectors", file=sys.stderr)
+            complete = False
+    return {seq: bytes(buf) for seq, buf in parts.items()}, complete
+
+
+# =========================================
+# SAÍDA
+# =========================================
+
+def format_uptime(ms: int) -> str:
+    s, ms = divmod(ms, 1000)
+    m, s = divmod(s, 60)
+    h, m = divmod(m, 60)
+    d, h = divmod(h, 24)
+    return f"{d}d {h:02d}:{m:02d}:{s:02d}.{ms // 10:02d}"
+
+
+def format_record(rec: dict) -> str:
+    fields = {k: v for k, v in rec.items() if k not in ("seq", "boot", "uptime_ms", "type")}
+    details = " ".join(f"{k}={v}" for k, v in fields.items())
+    return f"#{rec['boot']:<4} {format_uptime(rec['uptime_ms'])}  {rec['type']:<10} {details}"
+
+
+def weather_csv(records: Iterator[dict]) -> List[str]:
+    """
+    Traço de tempo do último boot no formato do replay do host
+    (IOT_Device/host/data/weather): t_min,temp_c,humidity,rain_analog, uma
+    linha por amostra de DHT/chuva, com o último valor do outro sensor.
+    """
+    rows: List[str] = []
+    boot = None
+    start_ms = temp = hum = rain = None
+    for rec in records:
+        if rec["type"] not in ("DHT", "RAIN"):
+            continue
+        if rec["boot"] != boot:
+            boot, start_ms, rows = rec["boot"], rec["uptime_ms"], []
+            temp = hum = rain = None
+        if rec["type"] == "DHT":
+            temp, hum = rec["temp_c"], rec["humidity"]
+        else:
+            rain = rec["analog"]
+        if temp is not None and rain is not None:
+            rows.append(f"{(rec['uptime_ms'] - start_ms) / 60000:.3f},{temp:.1f},{hum:.1f},{rain}")
+    return ["t_min,temp_c,humidity,rain_analog"] + rows
+
+
+def main(argv: Optional[List[str]] = None) -> None:
+    p = argparse.ArgumentParser(description="Decodificador da caixa-preta do varal.")
+    src = p.add_mutually_exclusive_group(required=True)
+    src.add_argument("--device", help="ID do varal (ex: varal-a1b2c3) para buscar via MQTT")
+    src.add_argument("--file", help="imagem crua da partição (ou salva com --save)")
+    p.add_argument("--broker", default="localhost")
+    p.add_argument("--port", type=int, default=1883)
+    p.add_argument("--sectors", type=int, default=0, help="últimos N setores de 4 KB (0 = todos)")
+    p.add_argument("--timeout", type=float, default=10.0, help="segundos sem receber pedaços")
+    p.add_argument("--save", help="grava a imagem recebida para decodificar depois")
+    p.add_argument("--json", action="store_true", help="um registro JSON por linha")
+    p.add_argument("--type", action="append", help="filtra por tipo (RAIN, DHT, MODE, ...)")
+    p.add_argument("--csv", action="store_true", help="traço de tempo (DHT + chuva) do último boot, em CSV")
+    args = p.parse_args(argv)
+
+    complete = True
+    if args.file:
+        with open(args.file, "rb") as f:
+            sectors = sectors_from_image(f.read())
+    else:
+        sectors, complete = fetch_dump(args.broker, args.port, args.device, args.sectors, args.timeout)
+        if args.save:
+            with open(args.save, "wb") as f:
+                f.write(sectors_to_image(sectors))
+
+    total_bytes = sum(len(s) for s in sectors.values())
+    if args.csv:
+        rows = weather_csv(decode_sectors(sectors))
+        print("\n".join(rows))
+        print(f"[FLOG] {len(sectors)} setores, {len(rows) - 1} amostras no traço", file=sys.stderr)
+        sys.exit(0 if complete else 2)
+
+    count = 0
+    for rec in decode_sectors(sectors):
+        if args.type and rec["type"] not in args.type:
+            continue
+        print(json.dumps(rec) if args.json else format_record(rec))
+        count += 1
+
+    print(f"[FLOG] {len(sectors)} setores, {total_bytes} bytes, {count} registros", file=sys.stderr)
+    if not complete:
+        sys.exit(2)
+
+
+if __name__ == "__main__":
+    main()
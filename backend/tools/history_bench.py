@@ -0,0 +1,89 @@
+"""
+Benchmark do histórico (HistoryStore): ingestão em lote e consultas por intervalo.
+
+Gera heartbeats sintéticos (ciclo diário de temperatura/umidade e chuvas
+esporádicas) para D dispositivos ao longo de N dias, grava em lotes num
+banco temporário e mede a latência de /history para vários intervalos.
+
+Exemplo:
+    python -m tools.history_bench --devices 2 --days 365
+"""
+
+import argparse
+import math
+import os
+import random
+import tempfile
+import time
+from typing import List
+
+from app.core.history_store import HistoryStore, Sample
+
+
+def synthetic_samples(device_id: str, start: float, days: int, interval: float, rng: random.Random):
+    raining_until = 0.0
+    ts = start
+    end = start + days * 86400
+    while ts < end:
+        phase = (ts % 86400) / 86400 * 2 * math.pi
+        temp = 22 + 6 * math.sin(phase) + rng.gauss(0, 0.3)
+        hum = 60 - 15 * math.sin(phase) + rng.gauss(0, 1.0)
+        if ts > raining_until and rng.random() < 0.0005:
+            raining_until = ts + rng.uniform(600, 7200)
+        rain = 1 if ts < raining_until else 0
+        yield (device_id, ts, round(temp, 1), round(min(100.0, hum + 25 * rain), 1), rain, "AUTO")
+        ts += interval
+
+
+def main() -> None:
+    p = argparse.ArgumentParser(description="Benchmark do histórico (SQLite/WAL + rollups).")
+    p.add_argument("--devices", type=int, default=1)
+    p.add_argument("--days", type=int, default=365)
+    p.add_argument("--interval", type=float, default=30.0, help="segundos entre heartbeats")
+    p.add_argument("--batch", type=int, default=500)
+    p.add_argument("--queries", type=int, default=20, help="repetições por intervalo")
+    args = p.parse_args()
+
+    path = os.path.join(tempfile.mkdtemp(prefix="history-bench-"), "history.db")
+    store = HistoryStore(path)
+    store.start()
+    rng = random.Random(1)
+    now = time.time()
+    start = now - args.days * 86400
+
+    total = 0
+    t0 = time.perf_counter()
+    for d in range(args.devices):
+        batch: List[Sample] = []
+        for sample in synthetic_samples(f"bench-{d:04d}", start, args.days, args.interval, rng):
+            batch.append(sample)
+            if len(batch) >= args.batch:
+                store.write_batch(batch)
+                total += len(batch)
+                batch = []
+        if batch:
+            store.write_batch(batch)
+            total += len(batch)
+    ingest_s = time.perf_counter() - t0
+    print(f"[BENCH] ingestão: {total} heartbeats em {ingest_s:.1f}s ({total / ingest_s:.0f}/s, lote={args.batch})")
+    print(f"[BENCH] banco: {os.path.getsize(path) / 1e6:.1f} MB")
+
+    spans = [("1h", 3600), ("1d", 86400), ("7d", 7 * 86400), ("30d", 30 * 86400), ("365d", 365 * 86400)]
+    for label, span in spans:
+        if span > args.days * 86400:
+            continue
+        times = []
+        for _ in range(args.queries):
+            q_end = now - rng.uniform(0, max(0.0, args.days * 86400 - span))
+            t1 = time.perf_counter()
+            used, step, points = store.query("bench-0000", q_end - span, q_end)
+            times.append(time.perf_counter() - t1)
+        times.sort()
+        print(f"[BENCH] consulta {label:>4}: res={used:<3} passo={step:>5}s pontos={len(points):>4} "
+              f"p50={times[len(times) // 2] * 1000:.1f}ms máx={times[-1] * 1000:.1f}ms")
+
+    store.stop()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,166 @@
+"""
+Latência de comando: caminho local (WebSocket direto no varal) x nuvem.
+
+Local: ws://<varal>/ws, envia "OPEN"/"CLOSE" e espera o {"type":"ack"}
+que o firmware (local_server.cpp) manda depois de aplicar o comando.
+
+Nuvem:
+- com --backend-url: POST /devices/{id}/cmd e espera o "ack" no stream
+  /devices/{id}/ws do backend (app -> FastAPI -> broker -> varal -> volta);
+- sem: publica direto em casa/<id>/cmd e espera o heartbeat com o modo.
+
+Mede o varal de verdade: --device/--local-url apontam para o ESP32
+(firmware com LOCAL_SERVER_ENABLED = 1) e --token leva o
+LOCAL_SERVER_TOKEN dele (vai como ?token= no WebSocket). A parte do
+firmware, sem rede, sai do build do host: BM_LocalCommandAck x
+BM_MqttCommandHeartbeat no firmware_bench (IOT_Device/host/README.md).
+
+Exemplos:
+    python -m tools.local_bench --device varal-a1b2c3 --local-url ws://varal-a1b2c3.local/ws \\
+        --token <token> --backend-url http://localhost:8000
+    python -m tools.local_bench --device varal-a1b2c3 --local-url ws://varal-a1b2c3.local/ws \\
+        --token <token> --broker localhost --count 200
+"""
+
+import argparse
+import asyncio
+import json
+import threading
+import time
+import urllib.parse
+import urllib.request
+from typing import List, Optional
+
+import websockets
+
+from tools.swarm_sim import new_client, percentiles
+
+COMMAND_TO_MODE = {"OPEN": "FORCE_OPEN", "CLOSE": "FORCE_CLOSE", "AUTO": "AUTO"}
+
+
+# =========================================
+# MEDIÇÃO
+# =========================================
+
+def with_token(url: str, token: str) -> str:
+    """?token= na URL do WebSocket (o firmware aceita também o cabeçalho)."""
+    parts = urllib.parse.urlsplit(url)
+    query = urllib.parse.parse_qsl(parts.query)
+    query.append(("token", token))
+    return urllib.parse.urlunsplit(parts._replace(query=urllib.parse.urlencode(query)))
+
+
+async def bench_local(url: str, count: int) -> List[float]:
+    rtts: List[float] = []
+    async with websockets.connect(url) as ws:
+        for i in range(count):
+            cmd = "OPEN" if i % 2 == 0 else "CLOSE"
+            t0 = time.perf_counter()
+            await ws.send(cmd)
+            while True:
+                msg = json.loads(await asyncio.wait_for(ws.recv(), timeout=5.0))
+                if msg.get("type") == "ack" and msg.get("command") == cmd:
+                    break
+            rtts.append(time.perf_counter() - t0)
+    return rtts
+
+
+async def bench_backend(backend_url: str, device_id: str, count: int) -> List[float]:
+    ws_url = backend_url.replace("http", "ws", 1).rstrip("/") + f"/devices/{device_id}/ws"
+    rtts: List[float] = []
+    async with websockets.connect(ws_url) as ws:
+        for i in range(count):
+            cmd = "OPEN" if i % 2 == 0 else "CLOSE"
+            body = json.dumps({"command": cmd}).encode()
+            req = urllib.request.Request(f"{backend_url.rstrip('/')}/devices/{device_id}/cmd", data=body,
+                                         headers={"Content-Type": "application/json"}, method="POST")
+            t0 = time.perf_counter()
+            await asyncio.to_thread(lambda: urllib.request.urlopen(req, timeout=5).read())
+            while True:
+                msg = json.loads(await asyncio.wait_for(ws.recv(), timeout=10.0))
+                if msg.get("type") == "ack" and msg.get("command") == cmd:
+                    break
+            rtts.append(time.perf_counter() - t0)
+    return rtts
+
+
+def bench_mqtt(broker: str, port: int, device_id: str, count: int) -> List[float]:
+    topic_cmd = f"casa/{device_id}/cmd"
+    topic_hb = f"casa/{device_id}/heartbeat"
+    expected = [None]
+    got = threading.Event()
+    ready = threading.Event()
+
+    def on_connect(client, userdata, flags, rc, properties=None):
+        client.subscribe(topic_hb)
+        ready.set()
+
+    def on_message(client, userdata, msg):
+        try:
+            mode = json.loads(msg.payload).get("mode")
+        except ValueError:
+            return
+        if mode == expected[0]:
+            got.set()
+
+    client = new_client(f"local-bench-{int(time.time() * 1000) % 100000}")
+    client.on_connect = on_connect
+    client.on_message = on_message
+    client.connect(broker, port, keepalive=60)
+    client.loop_start()
+    ready.wait(5.0)
+    time.sleep(0.2)
+
+    rtts: List[float] = []
+    try:
+        for i in range(count):
+            cmd = "OPEN" if i % 2 == 0 else "CLOSE"
+            expected[0] = COMMAND_TO_MODE[cmd]
+            got.clear()
+            t0 = time.perf_counter()
+            client.publish(topic_cmd, cmd)
+            if not got.wait(10.0):
+                print(f"[BENCH] sem resposta ao comando {i} pelo MQTT")
+                continue
+            rtts.append(time.perf_counter() - t0)
+    finally:
+        client.loop_stop()
+        client.disconnect()
+    return rtts
+
+
+# =========================================
+# MAIN
+# =========================================
+
+async def run(args) -> None:
+    local = await bench_local(with_token(args.local_url, args.token), args.count)
+    if args.backend_url:
+        cloud_name = "backend"
+        cloud = await bench_backend(args.backend_url, args.device, args.count)
+    else:
+        cloud_name = "mqtt"
+        cloud = await asyncio.to_thread(bench_mqtt, args.broker, args.port, args.device, args.count)
+
+    print(f"[BENCH] local (WebSocket) : {percentiles(local)}")
+    print(f"[BENCH] nuvem ({cloud_name:<7}) : {percentiles(cloud)}")
+
+
+def parse_args(argv: Optional[List[str]] = None):
+    p = argparse.ArgumentParser(description="Latência de comando: WebSocket local x nuvem.")
+    p.add_argument("--device", required=True, help="ID do varal (ex: varal-a1b2c3)")
+    p.add_argument("--local-url", required=True, help="ws://<varal>.local/ws")
+    p.add_argument("--token", required=True, help="LOCAL_SERVER_TOKEN do firmware")
+    p.add_argument("--backend-url", help="mede pelo backend (POST /cmd + stream) em vez do MQTT direto")
+    p.add_argument("--broker", default="localhost")
+    p.add_argument("--port", type=int, default=1883)
+    p.add_argument("--count", type=int, default=100, help="comandos por caminho")
+    return p.parse_args(argv)
+
+
+def main(argv: Optional[List[str]] = None) -> None:
+    asyncio.run(run(parse_args(argv)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,125 @@
+"""
+Perfil do loop() do firmware com comparação contra uma linha de base.
+
+O firmware mede, a cada heartbeat, o custo médio e o pior caso de cada
+etapa do loop() em µs (campo "loop_us"). Esta ferramenta coleta alguns
+heartbeats de um varal, agrega os números e:
+
+- com --save-baseline, grava a linha de base (JSON) para commitar junto
+  com uma versão de firmware;
+- com --baseline, compara e sai com código 1 se alguma etapa ficou mais
+  lenta que a tolerância (média) — serve de checagem de regressão numa
+  bancada com um ESP32 ligado.
+
+Exemplos:
+    python -m tools.loop_profile --device varal-a1b2c3 --heartbeats 10 --save-baseline loop_base.json
+    python -m tools.loop_profile --device varal-a1b2c3 --baseline loop_base.json --tolerance 0.2
+"""
+
+import argparse
+import json
+import sys
+import threading
+from typing import Dict, List, Optional
+
+from tools.swarm_sim import new_client
+
+
+def collect(broker: str, port: int, device_id: str, heartbeats: int, timeout: float) -> List[Dict[str, List[float]]]:
+    topic = f"casa/{device_id}/heartbeat"
+    samples: List[Dict[str, List[float]]] = []
+    done = threading.Event()
+
+    def on_connect(client, userdata, flags, rc, properties=None):
+        client.subscribe(topic)
+        print(f"[LOOP] aguardando {heartbeats} heartbeats de {device_id}...", file=sys.stderr)
+
+    def on_message(client, userdata, msg):
+        try:
+            loop_us = json.loads(msg.payload).get("loop_us")
+        except ValueError:
+            return
+        if loop_us:
+            samples.append(loop_us)
+            if len(samples) >= heartbeats:
+                done.set()
+
+    client = new_client(f"loop-profile-{device_id}")
+    client.on_connect = on_connect
+    client.on_message = on_message
+    client.connect(broker, port, keepalive=60)
+    client.loop_start()
+    try:
+        if not done.wait(timeout):
+            print(f"[LOOP] tempo esgotado ({len(samples)} heartbeats)", file=sys.stderr)
+    finally:
+        client.loop_stop()
+        client.disconnect()
+    return samples
+
+
+def aggregate(samples: List[Dict[str, List[float]]]) -> Dict[str, Dict[str, float]]:
+    """Média das médias e pior dos máximos, por etapa."""
+    out: Dict[str, Dict[str, float]] = {}
+    for name in samples[0] if samples else []:
+        avgs = [s[name][0] for s in samples if name in s]
+        maxs = [s[name][1] for s in samples if name in s]
+        out[name] = {"avg_us": round(sum(avgs) / len(avgs), 2), "max_us": round(max(maxs), 2)}
+    return out
+
+
+def compare(current: Dict[str, Dict[str, float]], baseline: Dict[str, Dict[str, float]],
+            tolerance: float, floor_us: float) -> List[str]:
+    regressions = []
+    for name, base in baseline.items():
+        cur = current.get(name)
+        if cur is None:
+            continue
+        # Etapas de poucos µs oscilam muito em termos relativos: ignora abaixo do piso
+        limit = max(base["avg_us"] * (1 + tolerance), base["avg_us"] + floor_us)
+        if cur["avg_us"] > limit:
+            regressions.append(f"{name}: {base['avg_us']} -> {cur['avg_us']} µs (limite {limit:.1f})")
+    return regressions
+
+
+def main(argv: Optional[List[str]] = None) -> None:
+    p = argparse.ArgumentParser(description="Perfil do loop() do firmware (via heartbeat).")
+    p.add_argument("--device", required=True, help="ID do varal (ex: varal-a1b2c3)")
+    p.add_argument("--broker", default="localhost")
+    p.add_argument("--port", type=int, default=1883)
+    p.add_argument("--heartbeats", type=int, default=5)
+    p.add_argument("--timeout", type=float, default=300.0, help="segundos")
+    p.add_argument("--save-baseline", help="grava a linha de base neste arquivo")
+    p.add_argument("--baseline", help="compara com a linha de base deste arquivo")
+    p.add_argument("--tolerance", type=float, default=0.25, help="piora relativa aceita na média")
+    p.add_argument("--floor-us", type=float, default=2.0, help="piora absoluta sempre aceita (µs)")
+    args = p.parse_args(argv)
+
+    samples = collect(args.broker, args.port, args.device, args.heartbeats, args.timeout)
+    if not samples:
+        sys.exit("[LOOP] nenhum heartbeat com loop_us recebido")
+
+    current = aggregate(samples)
+    print(f"{'etapa':<12}{'média µs':>10}{'máx µs':>10}")
+    for name, s in current.items():
+        print(f"{name:<12}{s['avg_us']:>10.1f}{s['max_us']:>10.1f}")
+
+    if args.save_baseline:
+        with open(args.save_baseline, "w") as f:
+            json.dump(current, f, indent=2)
+        print(f"[LOOP] linha de base gravada em {args.save_baseline}", file=sys.stderr)
+
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+        regressions = compare(current, baseline, args.tolerance, args.floor_us)
+        if regressions:
+            print("[LOOP] REGRESSÃO:", file=sys.stderr)
+            for r in regressions:
+                print("  " + r, file=sys.stderr)
+            sys.exit(1)
+        print("[LOOP] dentro da linha de base", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
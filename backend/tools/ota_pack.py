@@ -0,0 +1,407 @@
+"""
+Pacotes de atualização OTA do varal (formato VOTA, ota_update.h) e medição
+de bytes: imagem completa comprimida x delta contra a imagem em uso.
+
+O pacote é um cabeçalho assinado (ECDSA P-256) seguido de um fluxo zlib
+com janela de 8 KB (o firmware descomprime com um buffer fixo desse
+tamanho). Na imagem completa o fluxo é a própria imagem; no delta é uma
+sequência de operações contra a partição em uso:
+
+    COPY off len        copia da imagem antiga
+    DIFF off len bytes  soma (mod 256) os bytes à imagem antiga; código
+                        recompilado muda endereços espalhados, e a
+                        diferença quase toda zero comprime muito bem
+    DATA len bytes      bytes novos
+
+O varal confere o SHA-256 da imagem antiga antes de começar (delta) e o da
+imagem escrita antes de trocar a partição de boot.
+
+Exemplos:
+    python -m tools.ota_pack keygen --key ota_key.pem --header ../IOT_Device/projeto_iot/ota_key.h
+    python -m tools.ota_pack full  build/novo.bin --key ota_key.pem -o novo.vota
+    python -m tools.ota_pack delta build/antigo.bin build/novo.bin --key ota_key.pem -o novo.vota
+    python -m tools.ota_pack verify novo.vota --base build/antigo.bin --pub ota_key.pub.pem
+    python -m tools.ota_pack measure build/antigo.bin build/novo.bin --kbps 32
+    python -m tools.ota_pack publish --device varal-a1b2c3 --url http://192.168.0.10:8000/ota/novo.vota
+
+Os pacotes são servidos pelo backend em /ota/<arquivo> (pasta OTA_DIR).
+"""
+
+import argparse
+import hashlib
+import struct
+import sys
+import time
+import zlib
+from typing import Iterator, List, Optional, Tuple
+
+MAGIC = b"VOTA"
+FORMAT_VERSION = 1
+KIND_FULL, KIND_DELTA = 0, 1
+WINDOW_LOG2 = 13  # 8 KB: igual a OTA_WINDOW_SIZE no firmware
+
+# Parte assinada: magic, versão, tipo, janela, reservado, tamanho da imagem,
+# tamanho do fluxo, SHA-256 da imagem nova, SHA-256 da imagem base (delta)
+SIGNED = struct.Struct("<4sBBBBII32s32s")
+SIG_MAX = 72
+HEADER_SIZE = 160
+
+OP_END, OP_COPY, OP_DIFF, OP_DATA = 0x00, 0x01, 0x02, 0x03
+
+# Delta: blocos indexados na imagem antiga
+BLOCK = 32
+INDEX_STRIDE = 8
+MIN_MATCH = 32
+
+
+class OtaError(Exception):
+    pass
+
+
+# =========================================
+# DELTA
+# =========================================
+
+def _index(base: bytes) -> dict:
+    idx = {}
+    for off in range(0, len(base) - BLOCK + 1, INDEX_STRIDE):
+        idx.setdefault(base[off:off + BLOCK], off)
+    return idx
+
+
+def _match_len(base: bytes, bo: int, new: bytes, no: int) -> int:
+    n = 0
+    limit = min(len(base) - bo, len(new) - no)
+    while n + 64 <= limit and base[bo + n:bo + n + 64] == new[no + n:no + n + 64]:
+        n += 64
+    while n < limit and base[bo + n] == new[no + n]:
+        n += 1
+    return n
+
+
+def _approx_extend(base: bytes, bo: int, new: bytes, no: int) -> int:
+    """Quanto dá para seguir com mais da metade dos bytes iguais (como o bsdiff)."""
+    limit = min(len(base) - bo, len(new) - no)
+    same = best_score = best = 0
+    for i in range(limit):
+        if base[bo + i] == new[no + i]:
+            same += 1
+        score = 2 * same - (i + 1)
+        if score > best_score:
+            best_score, best = score, i + 1
+        elif score < best_score - 64:
+            break
+    return best
+
+
+def make_delta(base: bytes, new: bytes) -> bytes:
+    """Fluxo de operações (antes do zlib) que reconstrói 'new' a partir de 'base'."""
+    idx = _index(base)
+    out = bytearray()
+    literal_start = 0
+    pos = 0
+
+    def emit_data(end: int) -> None:
+        if end > literal_start:
+            out.extend(struct.pack("<BI", OP_DATA, end - literal_start) + new[literal_start:end])
+
+    while pos + BLOCK <= len(new):
+        bo = idx.get(new[pos:pos + BLOCK])
+        if bo is None:
+            pos += 1
+            continue
+        # Volta o que der para trás (até o começo do literal pendente)
+        back = 0
+        while pos - back > literal_start and bo - back > 0 and base[bo - back - 1] == new[pos - back - 1]:
+            back += 1
+        bo, start = bo - back, pos - back
+        exact = _match_len(base, bo, new, start)
+        if exact < MIN_MATCH:
+            pos += 1
+            continue
+        emit_data(start)
+
+        # Trecho exato + continuação aproximada viram um DIFF (ou COPY se for tudo igual)
+        length = exact + _approx_extend(base, bo + exact, new, start + exact)
+        diff = bytes((new[start + i] - base[bo + i]) & 0xFF for i in range(exact, length))
+        if diff.count(0) == len(diff):
+            out += struct.pack("<BII", OP_COPY, bo, length)
+        else:
+            out += struct.pack("<BII", OP_DIFF, bo, length) + bytes(exact) + diff
+        pos = literal_start = start + length
+
+    emit_data(len(new))
+    out.append(OP_END)
+    return bytes(out)
+
+
+def apply_ops(base: bytes, ops: bytes) -> bytes:
+    """Referência do aplicador (o firmware faz o mesmo em streaming)."""
+    out = bytearray()
+    i = 0
+    while True:
+        op = ops[i]
+        if op == OP_END:
+            return bytes(out)
+        if op == OP_COPY:
+            off, n = struct.unpack_from("<II", ops, i + 1)
+            out += base[off:off + n]
+            i += 9
+        elif op == OP_DIFF:
+            off, n = struct.unpack_from("<II", ops, i + 1)
+            d = ops[i + 9:i + 9 + n]
+            out += bytes((base[off + k] + d[k]) & 0xFF for k in range(n))
+            i += 9 + n
+        elif op == OP_DATA:
+            (n,) = struct.unpack_from("<I", ops, i + 1)
+            out += ops[i + 5:i + 5 + n]
+            i += 5 + n
+        else:
+            raise OtaError(f"operação inválida 0x{op:02x} em {i}")
+
+
+# =========================================
+# PACOTE
+# =========================================
+
+def compress(data: bytes) -> bytes:
+    c = zlib.compressobj(level=9, wbits=WINDOW_LOG2)
+    return c.compress(data) + c.flush()
+
+
+def _load_private_key(path: str):
+    from cryptography.hazmat.primitives import serialization
+    with open(path, "rb") as f:
+        return serialization.load_pem_private_key(f.read(), password=None)
+
+
+def build_package(kind: int, image: bytes, payload: bytes, key_path: str, base: Optional[bytes] = None) -> bytes:
+    from cryptography.hazmat.primitives import hashes
+    from cryptography.hazmat.primitives.asymmetric import ec
+
+    signed = SIGNED.pack(MAGIC, FORMAT_VERSION, kind, WINDOW_LOG2, 0, len(image), len(payload),
+                         hashlib.sha256(image).digest(),
+                         hashlib.sha256(base).digest() if base is not None else bytes(32))
+    sig = _load_private_key(key_path).sign(signed, ec.ECDSA(hashes.SHA256()))
+    header = signed + bytes([len(sig)]) + sig.ljust(SIG_MAX, b"\0")
+    return header.ljust(HEADER_SIZE, b"\0") + payload
+
+
+def parse_header(package: bytes) -> dict:
+    if len(package) < HEADER_SIZE:
+        raise OtaError("pacote menor que o cabeçalho")
+    magic, version, kind, window, _, size, payload_size, image_sha, base_sha = SIGNED.unpack_from(package)
+    if magic != MAGIC or version != FORMAT_VERSION:
+        raise OtaError("não é um pacote VOTA v1")
+    sig_len = package[SIGNED.size]
+    return {
+        "kind": kind, "window_log2": window, "image_size": size, "payload_size": payload_size,
+        "image_sha": image_sha, "base_sha": base_sha,
+        "signed": package[:SIGNED.size],
+        "signature": package[SIGNED.size + 1:SIGNED.size + 1 + sig_len],
+    }
+
+
+def stream_apply(package: bytes, base: Optional[bytes], chunk: int = 1024) -> Iterator[bytes]:
+    """Descomprime em pedaços com a janela do cabeçalho (8 KB), como o firmware."""
+    info = parse_header(package)
+    d = zlib.decompressobj(wbits=info["window_log2"])
+    payload = package[HEADER_SIZE:HEADER_SIZE + info["payload_size"]]
+    pending = bytearray()
+    for i in range(0, len(payload), chunk):
+        data = d.decompress(payload[i:i + chunk])
+        if info["kind"] == KIND_FULL:
+            yield data
+        else:
+            pending += data
+    if info["kind"] == KIND_DELTA:
+        if base is None:
+            raise OtaError("delta precisa da imagem base (--base)")
+        yield apply_ops(base, bytes(pending))
+
+
+def verify_package(package: bytes, pub_path: Optional[str], base: Optional[bytes]) -> Tuple[dict, bytes]:
+    info = parse_header(package)
+    if pub_path:
+        from cryptography.exceptions import InvalidSignature
+        from cryptography.hazmat.primitives import hashes, serialization
+        from cryptography.hazmat.primitives.asymmetric import ec
+        with open(pub_path, "rb") as f:
+            pub = serialization.load_pem_public_key(f.read())
+        try:
+            pub.verify(info["signature"], info["signed"], ec.ECDSA(hashes.SHA256()))
+        except InvalidSignature:
+            raise OtaError("assinatura inválida")
+    if info["kind"] == KIND_DELTA and base is not None and hashlib.sha256(base).digest() != info["base_sha"]:
+        raise OtaError("imagem base diferente da usada no delta")
+    image = b"".join(stream_apply(package, base))
+    if len(image) != info["image_size"] or hashlib.sha256(image).digest() != info["image_sha"]:
+        raise OtaError("imagem reconstruída não confere (tamanho/SHA-256)")
+    return info, image
+
+
+# =========================================
+# MAIN
+# =========================================
+
+def _read(path: str) -> bytes:
+    with open(path, "rb") as f:
+        return f.read()
+
+
+def _write(path: str, data: bytes) -> None:
+    with open(path, "wb") as f:
+        f.write(data)
+
+
+def cmd_keygen(args) -> None:
+    from cryptography.hazmat.primitives import serialization
+    from cryptography.hazmat.primitives.asymmetric import ec
+
+    key = ec.generate_private_key(ec.SECP256R1())
+    _write(args.key, key.private_bytes(serialization.Encoding.PEM, serialization.PrivateFormat.PKCS8,
+                                       serialization.NoEncryption()))
+    pub = key.public_key().public_bytes(serialization.Encoding.PEM,
+                                        serialization.PublicFormat.SubjectPublicKeyInfo)
+    pub_path = args.key.rsplit(".", 1)[0] + ".pub.pem"
+    _write(pub_path, pub)
+    print(f"[OTA] chave privada em {args.key} (guarde fora do repositório), pública em {pub_path}")
+    if args.header:
+        _write(args.header, key_header(pub).encode())
+        print(f"[OTA] {args.header} com OTA_PUBLIC_KEY_PEM (ota_update.h) para o firmware")
+    else:
+        print("[OTA] defina OTA_PUBLIC_KEY_PEM no firmware (ou use --header <sketch>/ota_key.h):")
+        print(pub.decode().strip())
+
+
+def key_header(pub_pem: bytes) -> str:
+    """ota_key.h: a chave pública como literal C (uma linha do PEM por linha)."""
+    lines = "".join(f'    "{line}\\n" \\\n' for line in pub_pem.decode().strip().splitlines())
+    return ("// Gerado por tools/ota_pack.py keygen: chave pública dos pacotes OTA (não versionar)\n"
+            "#pragma once\n"
+            f"#define OTA_PUBLIC_KEY_PEM \\\n{lines}    \"\"\n")
+
+
+def cmd_full(args) -> None:
+    image = _read(args.image)
+    package = build_package(KIND_FULL, image, compress(image), args.key)
+    _write(args.out, package)
+    print(f"[OTA] completo: imagem {len(image)} B -> pacote {len(package)} B")
+
+
+def cmd_delta(args) -> None:
+    base, image = _read(args.base), _read(args.image)
+    t0 = time.perf_counter()
+    ops = make_delta(base, image)
+    package = build_package(KIND_DELTA, image, compress(ops), args.key, base)
+    _write(args.out, package)
+    print(f"[OTA] delta: imagem {len(image)} B, operações {len(ops)} B -> pacote {len(package)} B "
+          f"({time.perf_counter() - t0:.1f} s)")
+
+
+def cmd_verify(args) -> None:
+    package = _read(args.package)
+    base = _read(args.base) if args.base else None
+    try:
+        info, image = verify_package(package, args.pub, base)
+    except OtaError as e:
+        print(f"[OTA] {args.package}: {e}", file=sys.stderr)
+        sys.exit(1)
+    kind = "delta" if info["kind"] == KIND_DELTA else "completo"
+    print(f"[OTA] {args.package}: {kind}, imagem {len(image)} B, SHA-256 ok"
+          f"{', assinatura ok' if args.pub else ''}")
+
+
+def cmd_measure(args) -> None:
+    base, image = _read(args.base), _read(args.image)
+    ops = make_delta(base, image)
+    if apply_ops(base, ops) != image:
+        raise OtaError("delta não reconstrói a imagem (bug)")
+    rows = [
+        ("imagem crua (USB/OTA simples)", len(image)),
+        ("completa + zlib", HEADER_SIZE + len(compress(image))),
+        ("delta + zlib", HEADER_SIZE + len(compress(ops))),
+    ]
+    kinds = {OP_COPY: 0, OP_DIFF: 0, OP_DATA: 0}
+    i = 0
+    while ops[i] != OP_END:
+        kinds[ops[i]] += 1
+        n = struct.unpack_from("<I", ops, i + (5 if ops[i] != OP_DATA else 1))[0]
+        i += {OP_COPY: 9, OP_DIFF: 9 + n, OP_DATA: 5 + n}[ops[i]]
+    print(f"[OTA] operações: {kinds[OP_COPY]} COPY, {kinds[OP_DIFF]} DIFF, {kinds[OP_DATA]} DATA")
+    bytes_per_s = args.kbps * 1000 / 8
+    for name, size in rows:
+        print(f"[OTA] {name:<30}: {size:>9} B  {100.0 * size / len(image):5.1f}%  "
+              f"~{size / bytes_per_s:6.1f} s a {args.kbps:g} kbit/s")
+
+
+def cmd_publish(args) -> None:
+    from tools.swarm_sim import new_client
+
+    payload = f'{{"url":"{args.url}"}}'.encode() if not args.clear else b""
+    client = new_client(f"ota-pack-{args.device}")
+    client.connect(args.broker, args.port, keepalive=30)
+    client.loop_start()
+    try:
+        info = client.publish(f"casa/{args.device}/ota", payload, qos=1, retain=True)
+        info.wait_for_publish(timeout=10)
+    finally:
+        client.loop_stop()
+        client.disconnect()
+    print(f"[OTA] {'pedido removido' if args.clear else 'pedido publicado'} em casa/{args.device}/ota")
+
+
+def main(argv: Optional[List[str]] = None) -> None:
+    p = argparse.ArgumentParser(description="Pacotes OTA do varal (completo e delta).")
+    sub = p.add_subparsers(dest="cmd", required=True)
+
+    s = sub.add_parser("keygen", help="gera o par de chaves ECDSA P-256")
+    s.add_argument("--key", default="ota_key.pem")
+    s.add_argument("--header", default=None, help="escreve o ota_key.h do firmware (OTA_PUBLIC_KEY_PEM)")
+    s.set_defaults(func=cmd_keygen)
+
+    s = sub.add_parser("full", help="pacote com a imagem inteira comprimida")
+    s.add_argument("image")
+    s.add_argument("--key", required=True)
+    s.add_argument("-o", "--out", required=True)
+    s.set_defaults(func=cmd_full)
+
+    s = sub.add_parser("delta", help="pacote delta contra a imagem em uso no varal")
+    s.add_argument("base", help="imagem em uso no varal (.bin)")
+    s.add_argument("image", help="imagem nova (.bin)")
+    s.add_argument("--key", required=True)
+    s.add_argument("-o", "--out", required=True)
+    s.set_defaults(func=cmd_delta)
+
+    s = sub.add_parser("verify", help="reconstrói como o firmware e confere hash/assinatura")
+    s.add_argument("package")
+    s.add_argument("--base", help="imagem base (pacote delta)")
+    s.add_argument("--pub", help="chave pública (PEM)")
+    s.set_defaults(func=cmd_verify)
+
+    s = sub.add_parser("measure", help="bytes transferidos: imagem, completa comprimida, delta")
+    s.add_argument("base")
+    s.add_argument("image")
+    s.add_argument("--kbps", type=float, default=64.0, help="velocidade do link para o tempo estimado")
+    s.set_defaults(func=cmd_measure)
+
+    s = sub.add_parser("publish", help="pede a atualização ao varal (casa/<id>/ota, retido)")
+    s.add_argument("--device", required=True)
+    s.add_argument("--url", help="URL do pacote (ex: http://<backend>:8000/ota/novo.vota)")
+    s.add_argument("--clear", action="store_true", help="remove o pedido retido")
+    s.add_argument("--broker", default="localhost")
+    s.add_argument("--port", type=int, default=1883)
+    s.set_defaults(func=cmd_publish)
+
+    args = p.parse_args(argv)
+    if args.cmd == "publish" and not args.clear and not args.url:
+        p.error("publish precisa de --url (ou --clear)")
+    try:
+        args.func(args)
+    except OtaError as e:
+        print(f"[OTA] {e}", file=sys.stderr)
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
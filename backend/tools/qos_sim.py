@@ -0,0 +1,311 @@
+"""
+Simulador da fila de saída MQTT do firmware (mqtt_transport.cpp).
+
+Cria N varais virtuais com uma cópia em Python do transporte (slots,
+prioridade, janela de mensagens em voo, reenvio por tempo e ao reconectar)
+e compara, no mesmo broker e com as mesmas perdas simuladas:
+
+- qos0: publica e esquece (como o firmware antes da fila)
+- app:  entrega confirmada ("seq" no JSON, ack em casa/<id>/ack)
+
+Perdas são injetadas no próprio varal virtual (--loss descarta o publish
+antes de sair, --ack-loss descarta o ack recebido) e quedas de conexão com
+--outage-every/--outage-s. Um observador assina casa/+/heartbeat e mede
+entrega, duplicatas e latência (criação da mensagem -> chegada).
+
+Os acks vêm de um acker embutido; com --backend o próprio backend
+(MqttManager) confirma e o simulador só observa.
+
+Exemplo:
+    python -m tools.qos_sim --devices 20 --rate 2 --duration 60 --loss 0.1 --ack-loss 0.1
+    python -m tools.qos_sim --mode app --outage-every 20 --outage-s 5 --backend
+"""
+
+import argparse
+import json
+import random
+import threading
+import time
+from typing import Dict, List, Optional, Set
+
+from tools.swarm_sim import new_client, percentiles
+
+URGENT, NORMAL, BULK = range(3)
+
+
+# =========================================
+# TRANSPORTE (espelho de mqtt_transport.cpp)
+# =========================================
+
+class Slot:
+    __slots__ = ("reliable", "sent", "priority", "attempts", "seq", "order", "sent_at", "payload")
+
+
+class Transport:
+    SLOTS = 8
+    WINDOW = 4
+    MAX_ATTEMPTS = 6
+    SENDS_PER_LOOP = 4
+    BULK_RESERVED = 2
+
+    def __init__(self, ack_timeout: float, rng: random.Random) -> None:
+        self.ack_timeout = ack_timeout
+        self.slots: List[Slot] = []
+        self.next_seq = rng.getrandbits(32)
+        self.next_order = 0
+        self.lock = threading.Lock()
+        self.stats = dict(sent=0, acked=0, retx=0, dropped=0, expired=0)
+
+    def _inflight(self) -> int:
+        return sum(1 for s in self.slots if s.reliable and s.sent)
+
+    def publish(self, data: dict, priority: int, reliable: bool) -> bool:
+        with self.lock:
+            free = self.SLOTS - len(self.slots)
+            if priority == BULK and free <= self.BULK_RESERVED:
+                self.stats["dropped"] += 1
+                return False
+            if free == 0:
+                victims = [s for s in self.slots if s.priority >= priority]
+                if not victims:
+                    self.stats["dropped"] += 1
+                    return False
+                victim = max(victims, key=lambda s: (s.priority, -s.order))
+                self.slots.remove(victim)
+                self.stats["dropped"] += 1
+
+            s = Slot()
+            s.reliable, s.sent, s.priority, s.attempts, s.sent_at = reliable, False, priority, 0, 0.0
+            s.order = self.next_order
+            self.next_order += 1
+            s.seq = 0
+            if reliable:
+                s.seq = self.next_seq
+                self.next_seq = (self.next_seq + 1) & 0xFFFFFFFF
+                data = {"seq": s.seq, **data}
+            s.payload = json.dumps(data, separators=(",", ":"))
+            self.slots.append(s)
+            return True
+
+    def on_connected(self) -> None:
+        with self.lock:
+            for s in self.slots:
+                s.sent = False
+
+    def handle_ack(self, payload: bytes) -> None:
+        try:
+            seq = int(payload)
+        except ValueError:
+            return
+        with self.lock:
+            for s in self.slots:
+                if s.reliable and s.seq == seq:
+                    self.slots.remove(s)
+                    self.stats["acked"] += 1
+                    return
+
+    def loop(self, now: float, send) -> None:
+        with self.lock:
+            for _ in range(self.SENDS_PER_LOOP):
+                window_full = self._inflight() >= self.WINDOW
+                due = [s for s in self.slots
+                       if (not s.sent and not (s.reliable and window_full))
+                       or (s.sent and s.reliable and now - s.sent_at >= self.ack_timeout)]
+                if not due:
+                    return
+                s = min(due, key=lambda s: (s.priority, s.order))
+                if s.reliable and s.attempts >= self.MAX_ATTEMPTS:
+                    self.slots.remove(s)
+                    self.stats["expired"] += 1
+                    continue
+
+                send(s.payload)
+                self.stats["sent"] += 1
+                if s.attempts > 0:
+                    self.stats["retx"] += 1
+                s.attempts += 1
+                if s.reliable:
+                    s.sent, s.sent_at = True, now
+                else:
+                    self.slots.remove(s)
+
+
+# =========================================
+# VARAL VIRTUAL / OBSERVADOR
+# =========================================
+
+class VirtualDevice:
+    def __init__(self, device_id: str, args, rng: random.Random) -> None:
+        self.device_id = device_id
+        self.args = args
+        self.rng = rng
+        self.reliable = args.current_mode == "app"
+        self.transport = Transport(args.ack_timeout, rng)
+        self.topic_hb = f"casa/{device_id}/heartbeat"
+        self.topic_ack = f"casa/{device_id}/ack"
+        self.generated = 0
+        self.online = True
+        self.next_msg = 0.0
+
+        self.client = new_client(f"{device_id}-{int(time.time() * 1000) % 100000}")
+        self.client.on_connect = self._on_connect
+        self.client.on_message = self._on_message
+
+    def _on_connect(self, client, userdata, flags, rc, properties=None):
+        client.subscribe(self.topic_ack, qos=1)
+
+    def _on_message(self, client, userdata, msg):
+        if self.rng.random() < self.args.ack_loss:
+            return
+        self.transport.handle_ack(msg.payload)
+
+    def _send(self, payload: str) -> None:
+        if self.rng.random() < self.args.loss:
+            return  # perdido no caminho
+        self.client.publish(self.topic_hb, payload)
+
+    def tick(self, now: float, started: float) -> None:
+        if self.args.outage_every > 0:
+            phase = (now - started) % self.args.outage_every
+            online = phase < self.args.outage_every - self.args.outage_s
+            if online and not self.online:
+                self.transport.on_connected()
+            self.online = online
+
+        if now >= self.next_msg:
+            self.next_msg = now + 1.0 / self.args.rate
+            self.transport.publish({"id": self.generated, "t": time.time()}, NORMAL, self.reliable)
+            self.generated += 1
+
+        if self.online:
+            self.transport.loop(now, self._send)
+
+
+class Observer:
+    """Assina os heartbeats, confirma (acker embutido) e mede a entrega."""
+
+    def __init__(self, args) -> None:
+        self.ack = not args.backend
+        self.lock = threading.Lock()
+        self.received: Dict[str, Set[int]] = {}
+        self.duplicates = 0
+        self.latencies: List[float] = []
+        self.client = new_client(f"qos-observer-{int(time.time() * 1000) % 100000}")
+        self.client.on_connect = lambda c, u, f, rc, p=None: c.subscribe("casa/+/heartbeat")
+        self.client.on_message = self._on_message
+
+    def _on_message(self, client, userdata, msg):
+        now = time.time()
+        device_id = msg.topic.split("/")[1]
+        data = json.loads(msg.payload)
+        if self.ack and "seq" in data:
+            client.publish(f"casa/{device_id}/ack", str(data["seq"]), qos=1)
+        with self.lock:
+            seen = self.received.setdefault(device_id, set())
+            if data["id"] in seen:
+                self.duplicates += 1
+                return
+            seen.add(data["id"])
+            self.latencies.append(now - data["t"])
+
+
+# =========================================
+# EXECUÇÃO
+# =========================================
+
+def run(args, mode: str) -> dict:
+    args.current_mode = mode
+    rng = random.Random(args.seed)
+    prefix = f"qos-{mode}-{rng.getrandbits(16):04x}"
+
+    observer = Observer(args)
+    observer.client.connect(args.broker, args.port, keepalive=60)
+    observer.client.loop_start()
+
+    devices = [VirtualDevice(f"{prefix}-{i}", args, random.Random(rng.getrandbits(32)))
+               for i in range(args.devices)]
+    for d in devices:
+        d.client.connect(args.broker, args.port, keepalive=60)
+        d.client.loop_start()
+    time.sleep(1.0)  # inscrições
+
+    started = time.monotonic()
+    while time.monotonic() - started < args.duration:
+        now = time.monotonic()
+        for d in devices:
+            d.tick(now, started)
+        time.sleep(0.01)
+
+    # Escoa: para de gerar e deixa a fila esvaziar (reenvios incluídos)
+    drain_end = time.monotonic() + args.drain
+    while time.monotonic() < drain_end and any(d.transport.slots for d in devices):
+        now = time.monotonic()
+        for d in devices:
+            if d.online or args.outage_every <= 0:
+                d.transport.loop(now, d._send)
+            else:
+                d.online = True
+                d.transport.on_connected()
+        time.sleep(0.01)
+    time.sleep(1.0)
+
+    for d in devices:
+        d.client.loop_stop()
+        d.client.disconnect()
+    observer.client.loop_stop()
+    observer.client.disconnect()
+
+    generated = sum(d.generated for d in devices)
+    delivered = sum(len(s) for s in observer.received.values())
+    stats = {k: sum(d.transport.stats[k] for d in devices) for k in devices[0].transport.stats}
+    return {
+        "mode": mode,
+        "generated": generated,
+        "delivered": delivered,
+        "loss_pct": 100.0 * (generated - delivered) / generated if generated else 0.0,
+        "duplicates": observer.duplicates,
+        "throughput": delivered / args.duration,
+        "latency": percentiles(observer.latencies),
+        **stats,
+    }
+
+
+def parse_args(argv: Optional[List[str]] = None):
+    p = argparse.ArgumentParser(description="Compara QoS0 e entrega confirmada da fila MQTT do firmware.")
+    p.add_argument("--broker", default="localhost")
+    p.add_argument("--port", type=int, default=1883)
+    p.add_argument("--devices", type=int, default=20)
+    p.add_argument("--rate", type=float, default=2.0, help="mensagens/s por varal")
+    p.add_argument("--duration", type=float, default=30.0, help="segundos gerando mensagens")
+    p.add_argument("--drain", type=float, default=40.0, help="segundos máximos para esvaziar a fila no fim")
+    p.add_argument("--loss", type=float, default=0.05, help="probabilidade de perder um publish")
+    p.add_argument("--ack-loss", type=float, default=0.05, help="probabilidade de perder um ack")
+    p.add_argument("--ack-timeout", type=float, default=5.0, help="ACK_TIMEOUT_MS do firmware, em s")
+    p.add_argument("--outage-every", type=float, default=0.0, help="queda de conexão a cada N s (0 = sem)")
+    p.add_argument("--outage-s", type=float, default=3.0, help="duração de cada queda")
+    p.add_argument("--mode", choices=["qos0", "app", "both"], default="both")
+    p.add_argument("--backend", action="store_true", help="acks vêm do backend (MqttManager)")
+    p.add_argument("--seed", type=int, default=1)
+    return p.parse_args(argv)
+
+
+def main(argv: Optional[List[str]] = None) -> None:
+    args = parse_args(argv)
+    modes = ["qos0", "app"] if args.mode == "both" else [args.mode]
+
+    results = []
+    for mode in modes:
+        print(f"[QOS] rodando {mode}: {args.devices} varais x {args.rate}/s por {args.duration:.0f}s "
+              f"(perda {args.loss:.0%}, perda de ack {args.ack_loss:.0%})")
+        results.append(run(args, mode))
+
+    for r in results:
+        print(f"[QOS] {r['mode']:<5} entregues {r['delivered']}/{r['generated']} "
+              f"(perda {r['loss_pct']:.2f}%), duplicatas {r['duplicates']}, "
+              f"{r['throughput']:.1f} msg/s, latência {r['latency']}")
+        print(f"[QOS]       sent={r['sent']} retx={r['retx']} acked={r['acked']} "
+              f"dropped={r['dropped']} expired={r['expired']}")
+
+
+if __name__ == "__main__":
+    main()
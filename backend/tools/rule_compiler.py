@@ -0,0 +1,435 @@
+"""
+Compilador de regras do varal (motor de regras do firmware, rule_engine.h).
+
+Converte um arquivo de regras em texto no bytecode que o ESP32 executa e,
+opcionalmente, publica em casa/<id>/rules (retido: o varal recebe mesmo se
+estiver offline agora). Regras são avaliadas em ordem; a primeira que casar
+decide. Se nenhuma casar, vale o "default" (auto = regra fixa do firmware:
+chuva fecha, seco abre).
+
+Exemplo de arquivo:
+    timezone -03:00
+    dwell 15m                 # permanência mínima entre movimentos automáticos
+    max_moves 4               # movimentos automáticos por hora
+    close when raining or rain_level >= moderate
+    close when time 19:00-07:00
+    close when humidity > 90 and temp < 12
+    open  when time 09:00-16:00 and weekday in mon-fri and not rain_likely
+    default auto
+
+Entradas: rain_level (none/light/moderate/heavy), raining, rain_likely,
+temp (°C), humidity (%), weekday (sun..sat), minutes_since_move,
+moves_last_hour, is_open, dht_valid. Operadores: == != < <= > >=, and,
+or, not, parênteses, "time HH:MM-HH:MM", "weekday in sat,sun" / "mon-fri".
+
+    python -m tools.rule_compiler regras.txt --out regras.bin --disasm
+    python -m tools.rule_compiler regras.txt --device varal-a1b2c3 --broker localhost
+    python -m tools.rule_compiler --clear --device varal-a1b2c3
+"""
+
+import argparse
+import re
+import struct
+import sys
+from typing import List, Optional, Tuple
+
+FORMAT_VERSION = 1
+PROGRAM_MAX = 512
+HEADER = struct.Struct("<2sBBHhH")  # magic, versão, max_moves, dwell_s, tz_min, code_len
+STACK_SIZE = 16
+NO_RULE = 255
+
+OP_END, OP_PUSH, OP_LOAD = 0x00, 0x01, 0x02
+OP_EQ, OP_NE, OP_LT, OP_LE, OP_GT, OP_GE = 0x10, 0x11, 0x12, 0x13, 0x14, 0x15
+OP_AND, OP_OR, OP_NOT, OP_WINDOW = 0x20, 0x21, 0x22, 0x23
+OP_JZ, OP_JMP = 0x30, 0x31
+OP_OPEN, OP_CLOSE, OP_AUTO = 0x40, 0x41, 0x42
+
+OP_SIZES = {
+    OP_END: 1, OP_PUSH: 3, OP_LOAD: 2,
+    OP_EQ: 1, OP_NE: 1, OP_LT: 1, OP_LE: 1, OP_GT: 1, OP_GE: 1,
+    OP_AND: 1, OP_OR: 1, OP_NOT: 1, OP_WINDOW: 5,
+    OP_JZ: 2, OP_JMP: 2, OP_OPEN: 2, OP_CLOSE: 2, OP_AUTO: 2,
+}
+OP_NAMES = {
+    OP_END: "END", OP_PUSH: "PUSH", OP_LOAD: "LOAD", OP_EQ: "EQ", OP_NE: "NE", OP_LT: "LT",
+    OP_LE: "LE", OP_GT: "GT", OP_GE: "GE", OP_AND: "AND", OP_OR: "OR", OP_NOT: "NOT",
+    OP_WINDOW: "WINDOW", OP_JZ: "JZ", OP_JMP: "JMP", OP_OPEN: "OPEN", OP_CLOSE: "CLOSE", OP_AUTO: "AUTO",
+}
+COMPARE_OPS = {"==": OP_EQ, "!=": OP_NE, "<": OP_LT, "<=": OP_LE, ">": OP_GT, ">=": OP_GE}
+ACTION_OPS = {"open": OP_OPEN, "close": OP_CLOSE, "auto": OP_AUTO}
+
+# Mesma ordem do enum RuleVar do firmware; valor = escala da constante comparada
+VARS = [
+    ("rain_level", 1), ("raining", 1), ("rain_likely", 1), ("temp", 10), ("humidity", 10),
+    ("minute", 1), ("weekday", 1), ("minutes_since_move", 1), ("moves_last_hour", 1),
+    ("is_open", 1), ("dht_valid", 1),
+]
+VAR_INDEX = {name: i for i, (name, _) in enumerate(VARS)}
+SYMBOLS = {
+    "none": 0, "light": 1, "moderate": 2, "heavy": 3, "true": 1, "false": 0,
+    "sun": 0, "mon": 1, "tue": 2, "wed": 3, "thu": 4, "fri": 5, "sat": 6,
+}
+DAYS = ["sun", "mon", "tue", "wed", "thu", "fri", "sat"]
+
+
+class RuleError(Exception):
+    pass
+
+
+def crc16(data: bytes) -> int:
+    """CRC-16/CCITT (0xFFFF), igual ao do firmware."""
+    crc = 0xFFFF
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) & 0xFFFF if crc & 0x8000 else (crc << 1) & 0xFFFF
+    return crc
+
+
+# =========================================
+# EXPRESSÕES
+# =========================================
+
+TOKEN_RE = re.compile(r"\s*(\d{1,2}:\d{2}|\d+(?:\.\d+)?|==|!=|<=|>=|<|>|\(|\)|,|-|[a-z_]+)")
+
+
+def tokenize(text: str) -> List[str]:
+    tokens, pos = [], 0
+    text = text.strip()
+    while pos < len(text):
+        m = TOKEN_RE.match(text, pos)
+        if not m:
+            raise RuleError(f"não entendi '{text[pos:]}'")
+        tokens.append(m.group(1))
+        pos = m.end()
+    return tokens
+
+
+def parse_clock(tok: str) -> int:
+    m = re.fullmatch(r"(\d{1,2}):(\d{2})", tok)
+    if not m or int(m.group(1)) > 24 or int(m.group(2)) > 59:
+        raise RuleError(f"horário inválido '{tok}'")
+    minute = int(m.group(1)) * 60 + int(m.group(2))
+    if minute > 1440:
+        raise RuleError(f"horário inválido '{tok}'")
+    return minute
+
+
+class ExprCompiler:
+    """Descida recursiva; emite bytecode de pilha direto."""
+
+    def __init__(self, tokens: List[str]) -> None:
+        self.tokens = tokens
+        self.pos = 0
+        self.code = bytearray()
+        self.depth = 0
+        self.max_depth = 0
+
+    def peek(self) -> Optional[str]:
+        return self.tokens[self.pos] if self.pos < len(self.tokens) else None
+
+    def take(self, expected: Optional[str] = None) -> str:
+        tok = self.peek()
+        if tok is None or (expected is not None and tok != expected):
+            raise RuleError(f"esperava '{expected or 'algo'}', achei '{tok or 'fim'}'")
+        self.pos += 1
+        return tok
+
+    def push_depth(self, delta: int) -> None:
+        self.depth += delta
+        self.max_depth = max(self.max_depth, self.depth)
+
+    def emit_push(self, value: int) -> None:
+        if not -32768 <= value <= 32767:
+            raise RuleError(f"constante fora de 16 bits: {value}")
+        self.code += struct.pack("<Bh", OP_PUSH, value)
+        self.push_depth(1)
+
+    def emit_binary(self, op: int) -> None:
+        self.code.append(op)
+        self.push_depth(-1)
+
+    def compile(self) -> bytes:
+        self.expr()
+        if self.peek() is not None:
+            raise RuleError(f"sobrou '{' '.join(self.tokens[self.pos:])}'")
+        return bytes(self.code)
+
+    def expr(self) -> None:
+        self.and_expr()
+        while self.peek() == "or":
+            self.take()
+            self.and_expr()
+            self.emit_binary(OP_OR)
+
+    def and_expr(self) -> None:
+        self.unary()
+        while self.peek() == "and":
+            self.take()
+            self.unary()
+            self.emit_binary(OP_AND)
+
+    def unary(self) -> None:
+        if self.peek() == "not":
+            self.take()
+            self.unary()
+            self.code.append(OP_NOT)
+        else:
+            self.primary()
+
+    def primary(self) -> None:
+        tok = self.take()
+        if tok == "(":
+            self.expr()
+            self.take(")")
+        elif tok == "time":
+            start = parse_clock(self.take())
+            self.take("-")
+            end = parse_clock(self.take())
+            if start >= 1440:
+                raise RuleError("início da janela precisa ser antes de 24:00")
+            self.code += struct.pack("<BHH", OP_WINDOW, start, end)
+            self.push_depth(1)
+        elif tok == "weekday" and self.peek() == "in":
+            self.take()
+            self.weekday_set()
+        elif tok in VAR_INDEX:
+            self.code += bytes([OP_LOAD, VAR_INDEX[tok]])
+            self.push_depth(1)
+            if self.peek() in COMPARE_OPS:
+                op = COMPARE_OPS[self.take()]
+                self.emit_push(self.value(VARS[VAR_INDEX[tok]][1]))
+                self.emit_binary(op)
+        else:
+            raise RuleError(f"entrada desconhecida '{tok}'")
+
+    def value(self, scale: int) -> int:
+        tok = self.take()
+        if tok == "-":
+            return -self.value(scale)
+        if tok in SYMBOLS:
+            return SYMBOLS[tok]
+        try:
+            return round(float(tok) * scale)
+        except ValueError:
+            raise RuleError(f"valor inválido '{tok}'") from None
+
+    def weekday_set(self) -> None:
+        days = set()
+        while True:
+            first = self.take()
+            if first not in DAYS:
+                raise RuleError(f"dia inválido '{first}'")
+            if self.peek() == "-":
+                self.take()
+                last = self.take()
+                if last not in DAYS:
+                    raise RuleError(f"dia inválido '{last}'")
+                i = DAYS.index(first)
+                while True:
+                    days.add(i)
+                    if i == DAYS.index(last):
+                        break
+                    i = (i + 1) % 7
+            else:
+                days.add(DAYS.index(first))
+            if self.peek() != ",":
+                break
+            self.take()
+
+        for n, day in enumerate(sorted(days)):
+            self.code += bytes([OP_LOAD, VAR_INDEX["weekday"]])
+            self.push_depth(1)
+            self.emit_push(day)
+            self.emit_binary(OP_EQ)
+            if n > 0:
+                self.emit_binary(OP_OR)
+
+
+# =========================================
+# PROGRAMA
+# =========================================
+
+def parse_duration(tok: str) -> int:
+    m = re.fullmatch(r"(\d+)(s|m|h)?", tok)
+    if not m:
+        raise RuleError(f"duração inválida '{tok}'")
+    return int(m.group(1)) * {"s": 1, "m": 60, "h": 3600, None: 1}[m.group(2)]
+
+
+def parse_timezone(tok: str) -> int:
+    m = re.fullmatch(r"([+-])(\d{1,2}):?(\d{2})?", tok)
+    if not m:
+        raise RuleError(f"fuso inválido '{tok}' (ex: -03:00)")
+    minutes = int(m.group(2)) * 60 + int(m.group(3) or 0)
+    return -minutes if m.group(1) == "-" else minutes
+
+
+def compile_source(source: str) -> Tuple[bytes, List[str]]:
+    """Retorna (programa binário, descrição de cada regra pelo índice)."""
+    tz_min = 0
+    dwell_s = 0
+    max_moves = 0
+    default = "auto"
+    code = bytearray()
+    rules: List[str] = []
+    max_depth = 0
+
+    for lineno, raw in enumerate(source.splitlines(), 1):
+        line = raw.split("#", 1)[0].strip().lower()
+        if not line:
+            continue
+        try:
+            head, _, rest = line.partition(" ")
+            rest = rest.strip()
+            if head in ("timezone", "tz"):
+                tz_min = parse_timezone(rest)
+            elif head == "dwell":
+                dwell_s = parse_duration(rest)
+                if dwell_s > 0xFFFF:
+                    raise RuleError("permanência máxima: 18h")
+            elif head == "max_moves":
+                max_moves = int(rest.split("/")[0])
+                if not 0 <= max_moves <= 32:
+                    raise RuleError("max_moves vai de 0 (sem limite) a 32 por hora")
+            elif head == "default":
+                if rest not in ACTION_OPS:
+                    raise RuleError("default precisa ser open, close ou auto")
+                default = rest
+            elif head in ACTION_OPS:
+                cond = rest
+                if not cond.startswith("when "):
+                    raise RuleError(f"esperava '{head} when <condição>'")
+                ec = ExprCompiler(tokenize(cond[5:]))
+                cond_code = ec.compile()
+                max_depth = max(max_depth, ec.max_depth)
+                index = len(rules)
+                if index >= NO_RULE - 1:
+                    raise RuleError("regras demais")
+                code += cond_code + bytes([OP_JZ, 2, ACTION_OPS[head], index])
+                rules.append(raw.strip())
+            else:
+                raise RuleError(f"comando desconhecido '{head}'")
+        except RuleError as e:
+            raise RuleError(f"linha {lineno}: {e}") from None
+
+    if default == "auto":
+        code.append(OP_END)
+    else:
+        code += bytes([ACTION_OPS[default], len(rules)])
+        rules.append(f"default {default}")
+
+    if max_depth > STACK_SIZE:
+        raise RuleError(f"expressão funda demais (pilha {max_depth} > {STACK_SIZE})")
+
+    body = HEADER.pack(b"VR", FORMAT_VERSION, max_moves, dwell_s, tz_min, len(code)) + bytes(code)
+    program = body + struct.pack("<H", crc16(body))
+    if len(program) > PROGRAM_MAX:
+        raise RuleError(f"programa com {len(program)} bytes (máximo {PROGRAM_MAX})")
+    return program, rules
+
+
+def decode_header(program: bytes) -> dict:
+    magic, version, max_moves, dwell_s, tz_min, code_len = HEADER.unpack_from(program)
+    if magic != b"VR" or version != FORMAT_VERSION:
+        raise RuleError("não é um programa de regras (versão 1)")
+    if len(program) != HEADER.size + code_len + 2:
+        raise RuleError("tamanho não bate com o cabeçalho")
+    if crc16(program[:-2]) != struct.unpack_from("<H", program, len(program) - 2)[0]:
+        raise RuleError("CRC inválido")
+    return {
+        "max_moves": max_moves, "dwell_s": dwell_s, "tz_min": tz_min,
+        "code": program[HEADER.size:HEADER.size + code_len], "id": f"{crc16(program[:-2]):04x}",
+    }
+
+
+def disassemble(code: bytes) -> List[str]:
+    out, pc = [], 0
+    while pc < len(code):
+        op = code[pc]
+        size = OP_SIZES.get(op)
+        if size is None:
+            out.append(f"{pc:04d}  ?? {op:#04x}")
+            break
+        name = OP_NAMES[op]
+        if op == OP_PUSH:
+            arg = str(struct.unpack_from("<h", code, pc + 1)[0])
+        elif op == OP_LOAD:
+            arg = VARS[code[pc + 1]][0] if code[pc + 1] < len(VARS) else f"var{code[pc + 1]}"
+        elif op == OP_WINDOW:
+            a, b = struct.unpack_from("<HH", code, pc + 1)
+            arg = f"{a // 60:02d}:{a % 60:02d}-{b // 60:02d}:{b % 60:02d}"
+        elif op in (OP_JZ, OP_JMP):
+            arg = f"-> {pc + size + code[pc + 1]:04d}"
+        elif size == 2:
+            arg = f"regra {code[pc + 1]}"
+        else:
+            arg = ""
+        out.append(f"{pc:04d}  {name:<6} {arg}".rstrip())
+        pc += size
+    return out
+
+
+# =========================================
+# MAIN
+# =========================================
+
+def publish(broker: str, port: int, device_id: str, payload: bytes) -> None:
+    from tools.swarm_sim import new_client
+
+    client = new_client(f"rule-compiler-{device_id}")
+    client.connect(broker, port, keepalive=30)
+    client.loop_start()
+    try:
+        info = client.publish(f"casa/{device_id}/rules", payload, qos=1, retain=True)
+        info.wait_for_publish(timeout=10)
+    finally:
+        client.loop_stop()
+        client.disconnect()
+
+
+def main(argv: Optional[List[str]] = None) -> None:
+    p = argparse.ArgumentParser(description="Compila regras do varal para o bytecode do firmware.")
+    p.add_argument("source", nargs="?", help="arquivo de regras (texto)")
+    p.add_argument("--out", help="grava o programa binário")
+    p.add_argument("--disasm", action="store_true", help="mostra o bytecode gerado")
+    p.add_argument("--device", help="publica em casa/<id>/rules (retido)")
+    p.add_argument("--clear", action="store_true", help="remove o programa do varal (volta à regra fixa)")
+    p.add_argument("--broker", default="localhost")
+    p.add_argument("--port", type=int, default=1883)
+    args = p.parse_args(argv)
+
+    if args.clear:
+        if not args.device:
+            p.error("--clear precisa de --device")
+        publish(args.broker, args.port, args.device, b"")
+        print(f"[RULES] programa removido de {args.device}")
+        return
+    if not args.source:
+        p.error("informe o arquivo de regras")
+
+    with open(args.source, encoding="utf-8") as f:
+        try:
+            program, rules = compile_source(f.read())
+        except RuleError as e:
+            print(f"[RULES] {args.source}: {e}", file=sys.stderr)
+            sys.exit(1)
+
+    info = decode_header(program)
+    print(f"[RULES] id {info['id']}: {len(program)} bytes, {len(info['code'])} de código, "
+          f"{len(rules)} regras, dwell {info['dwell_s']}s, max {info['max_moves']}/h, fuso {info['tz_min']} min")
+    for i, text in enumerate(rules):
+        print(f"  [{i}] {text}")
+    if args.disasm:
+        print("\n".join(disassemble(info["code"])))
+    if args.out:
+        with open(args.out, "wb") as f:
+            f.write(program)
+    if args.device:
+        publish(args.broker, args.port, args.device, program)
+        print(f"[RULES] publicado em casa/{args.device}/rules")
+
+
+if __name__ == "__main__":
+    main()
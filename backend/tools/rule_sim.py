@@ -0,0 +1,299 @@
+"""
+Banco de provas de regras do varal: roda um programa (rule_compiler) contra
+séries simuladas, com a mesma máquina de pilha, os mesmos limites
+(permanência mínima, movimentos por hora) e o mesmo modo AUTO do firmware.
+
+Série: CSV com time (ISO, hora local), temp_c, humidity, rain_level (0..3)
+e, opcionais, raining (0/1) e rain_likely (0/1); ou --synthetic N dias
+(ciclo diário de temperatura/umidade e pancadas de chuva aleatórias).
+
+Verificações (saem com código 1 se falharem):
+    --max-open-in-rain M   minutos seguidos aberto com chuva
+    --max-moves-day N      movimentos por dia
+
+    python -m tools.rule_sim regras.txt --synthetic 14 --max-open-in-rain 5 --max-moves-day 12
+    python -m tools.rule_sim regras.txt --trace dias.csv --timeline
+    python -m tools.rule_sim regras.txt --synthetic 7 --baseline   # compara com a regra fixa
+"""
+
+import argparse
+import csv
+import datetime as dt
+import math
+import random
+import struct
+import sys
+from collections import Counter, deque
+from typing import Dict, Iterator, List, Optional, Tuple
+
+from tools.rule_compiler import (
+    OP_AND, OP_AUTO, OP_CLOSE, OP_END, OP_EQ, OP_GE, OP_GT, OP_JMP, OP_JZ, OP_LE, OP_LOAD,
+    OP_LT, OP_NE, OP_NOT, OP_OPEN, OP_OR, OP_PUSH, OP_SIZES, OP_WINDOW, NO_RULE, STACK_SIZE,
+    RuleError, VAR_INDEX, compile_source, decode_header,
+)
+
+DEFAULT, OPEN, CLOSE = "DEFAULT", "OPEN", "CLOSE"
+DECISION_STEP_S = 60  # a série é amostrada por minuto (o firmware decide a cada 2 s e em eventos)
+
+
+# =========================================
+# MÁQUINA (espelho de rule_engine.cpp)
+# =========================================
+
+class RuleVM:
+    def __init__(self, program: bytes) -> None:
+        info = decode_header(program)
+        self.code: bytes = info["code"]
+        self.max_moves = min(info["max_moves"], 32)
+        self.dwell_s = info["dwell_s"]
+        self.id = info["id"]
+        self.moves: deque = deque(maxlen=32)
+        self.last_move: Optional[float] = None
+        self.blocked = 0
+        self.errors = 0
+        self.max_steps = 0
+
+    def evaluate(self, inputs: Dict[str, int]) -> Tuple[str, int]:
+        """(ação, índice da regra) — o índice é NO_RULE se nenhuma decidiu."""
+        code, stack, pc, steps = self.code, [], 0, 0
+        while pc < len(code):
+            op = code[pc]
+            steps += 1
+            if op == OP_END:
+                break
+            if op == OP_PUSH:
+                stack.append(struct.unpack_from("<h", code, pc + 1)[0])
+            elif op == OP_LOAD:
+                stack.append(inputs[code[pc + 1]])
+            elif op in (OP_EQ, OP_NE, OP_LT, OP_LE, OP_GT, OP_GE, OP_AND, OP_OR):
+                if len(stack) < 2:
+                    self.errors += 1
+                    return DEFAULT, NO_RULE
+                b, a = stack.pop(), stack.pop()
+                stack.append(int({
+                    OP_EQ: a == b, OP_NE: a != b, OP_LT: a < b, OP_LE: a <= b,
+                    OP_GT: a > b, OP_GE: a >= b, OP_AND: bool(a and b), OP_OR: bool(a or b),
+                }[op]))
+            elif op == OP_NOT:
+                stack.append(int(not stack.pop()))
+            elif op == OP_WINDOW:
+                start, end = struct.unpack_from("<HH", code, pc + 1)
+                m = inputs[VAR_INDEX["minute"]]
+                if m < 0:
+                    stack.append(0)
+                elif start <= end:
+                    stack.append(int(start <= m < end))
+                else:
+                    stack.append(int(m >= start or m < end))
+            elif op == OP_JZ:
+                if stack.pop() == 0:
+                    pc += code[pc + 1]
+            elif op == OP_JMP:
+                pc += code[pc + 1]
+            elif op in (OP_OPEN, OP_CLOSE, OP_AUTO):
+                self.max_steps = max(self.max_steps, steps)
+                return {OP_OPEN: OPEN, OP_CLOSE: CLOSE, OP_AUTO: DEFAULT}[op], code[pc + 1]
+            if len(stack) > STACK_SIZE:
+                self.errors += 1
+                return DEFAULT, NO_RULE
+            pc += OP_SIZES[op]
+        self.max_steps = max(self.max_steps, steps)
+        return DEFAULT, NO_RULE
+
+    def moves_last_hour(self, now: float) -> int:
+        return sum(1 for t in self.moves if now - t < 3600)
+
+    def move_allowed(self, now: float) -> bool:
+        allowed = True
+        if self.last_move is not None and self.dwell_s and now - self.last_move < self.dwell_s:
+            allowed = False
+        if self.max_moves and self.moves_last_hour(now) >= self.max_moves:
+            allowed = False
+        return allowed
+
+    def note_move(self, now: float) -> None:
+        self.last_move = now
+        self.moves.append(now)
+
+
+# =========================================
+# SÉRIES
+# =========================================
+
+def synthetic_trace(days: int, seed: int) -> Iterator[dict]:
+    rng = random.Random(seed)
+    start = dt.datetime(2026, 1, 5)  # segunda-feira
+    shower_left = 0
+    shower_level = 0
+    warn_left = 0
+    for minute in range(days * 1440):
+        t = start + dt.timedelta(minutes=minute)
+        hour = t.hour + t.minute / 60
+        temp = 20 + 7 * math.sin((hour - 9) / 24 * 2 * math.pi) + rng.gauss(0, 0.3)
+        humidity = 70 - 20 * math.sin((hour - 9) / 24 * 2 * math.pi) + rng.gauss(0, 1.5)
+
+        if shower_left == 0 and warn_left == 0 and rng.random() < 1.5 / 1440:
+            warn_left = rng.randint(10, 40)          # previsão antes da chuva
+        if warn_left > 0:
+            warn_left -= 1
+            humidity += 10
+            if warn_left == 0:
+                shower_left = rng.randint(15, 120)
+                shower_level = rng.choice([1, 2, 2, 3])
+        if shower_left > 0:
+            shower_left -= 1
+            humidity = max(humidity, 92)
+
+        level = shower_level if shower_left > 0 else 0
+        yield {
+            "time": t, "temp_c": round(temp, 1), "humidity": round(min(humidity, 99), 1),
+            "rain_level": level, "raining": int(level > 0), "rain_likely": int(warn_left > 0),
+        }
+
+
+def csv_trace(path: str) -> Iterator[dict]:
+    with open(path, newline="", encoding="utf-8") as f:
+        for row in csv.DictReader(f):
+            level = int(row["rain_level"])
+            yield {
+                "time": dt.datetime.fromisoformat(row["time"]),
+                "temp_c": float(row["temp_c"]) if row.get("temp_c") not in (None, "") else None,
+                "humidity": float(row["humidity"]) if row.get("humidity") not in (None, "") else None,
+                "rain_level": level,
+                "raining": int(row.get("raining") or (level > 0)),
+                "rain_likely": int(row.get("rain_likely") or 0),
+            }
+
+
+# =========================================
+# SIMULAÇÃO (modo AUTO do varal_controller)
+# =========================================
+
+def simulate(trace: List[dict], vm: Optional[RuleVM], timeline: bool) -> dict:
+    is_open = False
+    t0 = trace[0]["time"]
+    moves_per_day: Counter = Counter()
+    rule_hits: Counter = Counter()
+    open_in_rain = 0
+    worst_open_in_rain = 0
+    held = False  # transição segurada pelos limites (conta uma vez, como o firmware)
+
+    for sample in trace:
+        now = (sample["time"] - t0).total_seconds()
+        dht_valid = sample["temp_c"] is not None and sample["humidity"] is not None
+
+        action, rule = DEFAULT, NO_RULE
+        if vm is not None:
+            since = 32767 if vm.last_move is None else min(32767, int((now - vm.last_move) // 60))
+            inputs = {
+                VAR_INDEX["rain_level"]: sample["rain_level"],
+                VAR_INDEX["raining"]: sample["raining"],
+                VAR_INDEX["rain_likely"]: sample["rain_likely"],
+                VAR_INDEX["temp"]: round(sample["temp_c"] * 10) if dht_valid else 0,
+                VAR_INDEX["humidity"]: round(sample["humidity"] * 10) if dht_valid else 0,
+                VAR_INDEX["minute"]: sample["time"].hour * 60 + sample["time"].minute,
+                VAR_INDEX["weekday"]: (sample["time"].weekday() + 1) % 7,
+                VAR_INDEX["minutes_since_move"]: since,
+                VAR_INDEX["moves_last_hour"]: vm.moves_last_hour(now),
+                VAR_INDEX["is_open"]: int(is_open),
+                VAR_INDEX["dht_valid"]: int(dht_valid),
+            }
+            action, rule = vm.evaluate(inputs)
+            rule_hits[rule] += 1
+
+        close = (sample["raining"] or sample["rain_likely"]) if action == DEFAULT else action == CLOSE
+        # Fechar com chuva não espera pelos limites (varal_controller.cpp)
+        allowed = vm is None or (close and sample["raining"]) or vm.move_allowed(now)
+        if close != is_open:
+            held = False
+        elif not allowed:
+            if not held:
+                held = True
+                vm.blocked += 1
+        else:
+            held = False
+            is_open = not close
+            moves_per_day[sample["time"].date()] += 1
+            if vm is not None:
+                vm.note_move(now)
+            if timeline:
+                why = f"regra {rule}" if rule != NO_RULE else "regra fixa"
+                print(f"{sample['time']:%Y-%m-%d %H:%M}  {'ABRE ' if is_open else 'FECHA'}  ({why}; "
+                      f"chuva {sample['rain_level']}, {sample['temp_c']}°C, {sample['humidity']}%)")
+
+        if is_open and sample["raining"]:
+            open_in_rain += 1
+            worst_open_in_rain = max(worst_open_in_rain, open_in_rain)
+        else:
+            open_in_rain = 0
+
+    days = max(1, len(moves_per_day))
+    return {
+        "moves": sum(moves_per_day.values()),
+        "moves_per_day_max": max(moves_per_day.values(), default=0),
+        "moves_per_day_avg": sum(moves_per_day.values()) / days,
+        "worst_open_in_rain_min": worst_open_in_rain * DECISION_STEP_S // 60,
+        "rule_hits": rule_hits,
+        "blocked": vm.blocked if vm else 0,
+        "errors": vm.errors if vm else 0,
+        "max_steps": vm.max_steps if vm else 0,
+    }
+
+
+def report(name: str, r: dict) -> None:
+    print(f"[RULESIM] {name}: {r['moves']} movimentos (máx {r['moves_per_day_max']}/dia, "
+          f"média {r['moves_per_day_avg']:.1f}), pior trecho aberto com chuva {r['worst_open_in_rain_min']} min, "
+          f"{r['blocked']} transições seguradas pelos limites, {r['errors']} erros, "
+          f"até {r['max_steps']} instruções por avaliação")
+    if r["rule_hits"]:
+        hits = ", ".join(f"{'fixa' if k == NO_RULE else k}: {v}" for k, v in sorted(r["rule_hits"].items()))
+        print(f"[RULESIM]   decisões por regra: {hits}")
+
+
+def main(argv: Optional[List[str]] = None) -> None:
+    p = argparse.ArgumentParser(description="Roda regras do varal contra séries simuladas.")
+    p.add_argument("source", help="arquivo de regras (texto) ou programa .bin")
+    src = p.add_mutually_exclusive_group(required=True)
+    src.add_argument("--trace", help="CSV: time, temp_c, humidity, rain_level[, raining, rain_likely]")
+    src.add_argument("--synthetic", type=int, metavar="DIAS", help="gera N dias de série")
+    p.add_argument("--seed", type=int, default=1)
+    p.add_argument("--timeline", action="store_true", help="imprime cada movimento")
+    p.add_argument("--baseline", action="store_true", help="compara com a regra fixa (sem programa)")
+    p.add_argument("--max-open-in-rain", type=int, help="falha se ficar aberto com chuva por mais de M min")
+    p.add_argument("--max-moves-day", type=int, help="falha se passar de N movimentos num dia")
+    args = p.parse_args(argv)
+
+    try:
+        if args.source.endswith(".bin"):
+            with open(args.source, "rb") as f:
+                program = f.read()
+        else:
+            with open(args.source, encoding="utf-8") as f:
+                program, _ = compile_source(f.read())
+        vm = RuleVM(program)
+    except RuleError as e:
+        print(f"[RULESIM] {args.source}: {e}", file=sys.stderr)
+        sys.exit(1)
+
+    trace = list(csv_trace(args.trace) if args.trace else synthetic_trace(args.synthetic, args.seed))
+    if not trace:
+        sys.exit("[RULESIM] série vazia")
+
+    result = simulate(trace, vm, args.timeline)
+    report(f"programa {vm.id}", result)
+    if args.baseline:
+        report("regra fixa", simulate(trace, None, False))
+
+    failed = False
+    if args.max_open_in_rain is not None and result["worst_open_in_rain_min"] > args.max_open_in_rain:
+        print(f"[RULESIM] FALHOU: {result['worst_open_in_rain_min']} min aberto com chuva "
+              f"(limite {args.max_open_in_rain})")
+        failed = True
+    if args.max_moves_day is not None and result["moves_per_day_max"] > args.max_moves_day:
+        print(f"[RULESIM] FALHOU: {result['moves_per_day_max']} movimentos num dia (limite {args.max_moves_day})")
+        failed = True
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,383 @@
+"""
+Estado desejado/reportado x comandos "dispara e esquece", com quedas.
+
+Cria N varais virtuais que imitam o firmware e, a cada ciclo, derruba a
+conexão de todos, manda um comando (OPEN/CLOSE alternados) com eles
+offline e reconecta. Compara os dois modelos no mesmo broker:
+
+- legacy: comando cru em casa/<id>/cmd (QoS0) e heartbeat completo a cada
+  intervalo (como o firmware antes do estado desejado)
+- shadow: PUT /devices/{id}/desired no backend (retido em casa/<id>/desired,
+  versão "v"); o varal aplica só o que difere e reporta deltas com "rv"/"dv",
+  relatório completo a cada --full-every (espelho de desired_state.cpp e
+  telemetryBuildReport)
+
+Mede comandos perdidos, bytes trocados (total e na janela de reconexão) e
+o tempo de convergência: reconexão -> varal no modo pedido (no modo shadow,
+GET /devices/{id}/state com "in_sync").
+
+Offline, os heartbeats esperam numa fila limitada (como mqtt_transport.cpp)
+e saem ao reconectar.
+
+Exemplo (backend rodando com o mesmo broker):
+    python -m tools.shadow_sim --devices 20 --cycles 5 --backend-url http://localhost:8000
+    python -m tools.shadow_sim --mode legacy --devices 20 --cycles 5
+"""
+
+import argparse
+import json
+import random
+import threading
+import time
+import urllib.request
+from collections import deque
+from typing import Any, Dict, List, Optional
+
+from tools.swarm_sim import new_client, percentiles
+
+COMMAND_TO_MODE = {"OPEN": "FORCE_OPEN", "CLOSE": "FORCE_CLOSE", "AUTO": "AUTO"}
+
+# Mesma faixa morta do firmware (telemetry.cpp)
+TEMP_DEADBAND_C = 0.5
+HUMIDITY_DEADBAND_PCT = 2.0
+
+# Fila de saída do firmware (slots)
+OFFLINE_QUEUE = 8
+
+# Blocos de diagnóstico que só vão no relatório completo (tamanho típico do firmware)
+DIAGNOSTICS = {
+    "sensors": {"rain.analog": [3210.4, 3180.0, 3240.0], "dht.temp": [24.1, 23.8, 24.3],
+                "dht.humidity": [55.2, 54.0, 56.0]},
+    "rules": None,
+    "reaction_ms": 42,
+    "loop_us": {"wifi": [3.1, 12.0], "mqtt": [55.2, 910.0], "local": [4.0, 30.0], "sensors": [20.4, 260.0],
+                "stepper": [2.2, 8.0], "events": [1.5, 14.0], "controller": [1.1, 9.0], "recorder": [0.8, 40.0]},
+    "mem": {"free": 182340, "min": 171200, "largest": 110580, "loop_allocs": 0,
+            "stack": {"loop": 5120, "async_tcp": 6200}},
+    "mqtt": {"queued": 0, "inflight": 0, "sent": 120, "acked": 120, "retx": 0, "dropped": 0, "expired": 0},
+}
+
+
+# =========================================
+# VARAL VIRTUAL
+# =========================================
+
+class VirtualVaral:
+    def __init__(self, device_id: str, mode: str, broker: str, port: int, full_every: int) -> None:
+        self.device_id = device_id
+        self.shadow = mode == "shadow"
+        self.broker = broker
+        self.port = port
+        self.full_every = full_every
+        self.lock = threading.Lock()
+        self.started = time.monotonic()
+
+        # Estado do varal
+        self.mode = "AUTO"
+        self.temp_c = 24.0 + random.uniform(-2, 2)
+        self.humidity = 55.0 + random.uniform(-5, 5)
+        self.rain = False
+        self.rain_likely = False
+        self.hb_s = 30
+
+        # Estado desejado aplicado / relatórios (firmware)
+        self.dv = 0
+        self.rv = 0
+        self.reported: Optional[Dict[str, Any]] = None
+        self.reports_since_full = 0
+        self.full_pending = True
+
+        # Fila de saída enquanto offline
+        self.outbox: deque = deque(maxlen=OFFLINE_QUEUE)
+        self.online = False
+        self.bytes_out = 0
+        self.reports = 0
+        self.bytes_in = 0
+        self.window_bytes = 0
+        self.in_window = False
+
+        self.topic_hb = f"casa/{device_id}/heartbeat"
+        self.topic_cmd = f"casa/{device_id}/cmd"
+        self.topic_desired = f"casa/{device_id}/desired"
+        self.client = None
+
+    # ---------- conexão ----------
+
+    def connect(self) -> None:
+        ready = threading.Event()
+
+        def on_connect(client, userdata, flags, rc, properties=None):
+            client.subscribe(self.topic_cmd)
+            if self.shadow:
+                client.subscribe(self.topic_desired, qos=1)
+            ready.set()
+
+        self.client = new_client(self.device_id)
+        self.client.on_connect = on_connect
+        self.client.on_message = self._on_message
+        self.client.connect(self.broker, self.port, keepalive=60)
+        self.client.loop_start()
+        ready.wait(5.0)
+        with self.lock:
+            self.online = True
+            pending = list(self.outbox)
+            self.outbox.clear()
+        for payload in pending:
+            self._send(payload)
+
+    def disconnect(self) -> None:
+        with self.lock:
+            self.online = False
+        self.client.disconnect()
+        self.client.loop_stop()
+
+    def _send(self, payload: str) -> None:
+        with self.lock:
+            if not self.online:
+                self.outbox.append(payload)
+                return
+            self._count(len(payload) + len(self.topic_hb))
+            self.reports += 1
+        self.client.publish(self.topic_hb, payload)
+
+    def _count(self, n: int) -> None:
+        self.bytes_out += n
+        if self.in_window:
+            self.window_bytes += n
+
+    # ---------- entrada ----------
+
+    def _on_message(self, client, userdata, msg):
+        payload = msg.payload.decode(errors="ignore")
+        with self.lock:
+            self.bytes_in += len(msg.payload) + len(msg.topic)
+            if self.in_window:
+                self.window_bytes += len(msg.payload) + len(msg.topic)
+        if msg.topic == self.topic_desired:
+            if self._apply_desired(payload):
+                self.heartbeat()
+            return
+        cmd = payload.strip().upper()
+        if cmd == "SYNC":
+            with self.lock:
+                self.full_pending = True
+            self.heartbeat()
+        elif cmd in COMMAND_TO_MODE:
+            with self.lock:
+                self.mode = COMMAND_TO_MODE[cmd]
+            self.heartbeat()
+
+    def _apply_desired(self, payload: str) -> bool:
+        try:
+            doc = json.loads(payload)
+        except ValueError:
+            return False
+        with self.lock:
+            if not isinstance(doc, dict) or doc.get("v", 0) <= self.dv:
+                return False
+            self.dv = doc["v"]
+            if doc.get("mode") in COMMAND_TO_MODE.values():
+                self.mode = doc["mode"]
+            if "hb_s" in doc:
+                self.hb_s = max(10, min(3600, int(doc["hb_s"])))
+            return True
+
+    # ---------- sensores ----------
+
+    def step_sensors(self) -> None:
+        with self.lock:
+            self.temp_c += random.gauss(0, 0.08)
+            self.humidity += random.gauss(0, 0.3)
+            if random.random() < 0.01:
+                self.rain = not self.rain
+            self.rain_likely = self.rain or self.humidity > 70
+
+    # ---------- relatórios ----------
+
+    def _state(self) -> Dict[str, Any]:
+        return {"temp_c": round(self.temp_c, 1), "humidity": round(self.humidity, 1), "rain": self.rain,
+                "rain_likely": self.rain_likely, "mode": self.mode, "hb_s": self.hb_s}
+
+    def _full(self) -> Dict[str, Any]:
+        return {**self._state(), **DIAGNOSTICS}
+
+    def _build(self) -> str:
+        uptime = int((time.monotonic() - self.started) * 1000)
+        if not self.shadow:
+            return json.dumps({**self._full(), "uptime_ms": uptime}, separators=(",", ":"))
+
+        now = self._state()
+        full = self.full_pending or self.reported is None or self.reports_since_full + 1 >= self.full_every
+        self.rv += 1
+        doc: Dict[str, Any] = {"rv": self.rv, "dv": self.dv}
+        if full:
+            doc.update({"full": True, **self._full()})
+            self.reported = now
+            self.full_pending = False
+            self.reports_since_full = 0
+        else:
+            prev = self.reported
+            if (abs(now["temp_c"] - prev["temp_c"]) >= TEMP_DEADBAND_C
+                    or abs(now["humidity"] - prev["humidity"]) >= HUMIDITY_DEADBAND_PCT):
+                doc["temp_c"], doc["humidity"] = now["temp_c"], now["humidity"]
+                prev["temp_c"], prev["humidity"] = now["temp_c"], now["humidity"]
+            for key in ("rain", "rain_likely", "mode", "hb_s"):
+                if now[key] != prev[key]:
+                    doc[key] = prev[key] = now[key]
+            self.reports_since_full += 1
+        doc["uptime_ms"] = uptime
+        return json.dumps(doc, separators=(",", ":"))
+
+    def heartbeat(self) -> None:
+        with self.lock:
+            payload = self._build()
+        self._send(payload)
+
+
+# =========================================
+# APP (comandos) E CONVERGÊNCIA
+# =========================================
+
+def http_json(url: str, method: str = "GET", body: Optional[dict] = None) -> Any:
+    data = json.dumps(body).encode() if body is not None else None
+    req = urllib.request.Request(url, data=data, method=method, headers={"Content-Type": "application/json"})
+    with urllib.request.urlopen(req, timeout=5) as resp:
+        return json.loads(resp.read())
+
+
+def send_command(args, publisher, dev: VirtualVaral, command: str) -> None:
+    if dev.shadow:
+        http_json(f"{args.backend_url.rstrip('/')}/devices/{dev.device_id}/desired", "PUT",
+                  {"mode": COMMAND_TO_MODE[command]})
+    else:
+        publisher.publish(dev.topic_cmd, command)
+
+
+def converged(args, dev: VirtualVaral, mode: str) -> bool:
+    if dev.mode != mode:
+        return False
+    if not dev.shadow:
+        return True
+    try:
+        state = http_json(f"{args.backend_url.rstrip('/')}/devices/{dev.device_id}/state")
+    except OSError:
+        return False
+    return bool(state.get("in_sync")) and (state.get("reported") or {}).get("mode") == mode
+
+
+# =========================================
+# MAIN
+# =========================================
+
+def run(args) -> int:
+    random.seed(args.seed)
+    prefix = f"varal-s{int(time.time()) % 100000:05d}"
+    devices = [VirtualVaral(f"{prefix}{i:03d}", args.mode, args.broker, args.port, args.full_every)
+               for i in range(args.devices)]
+    for dev in devices:
+        dev.connect()
+
+    publisher = new_client(f"{prefix}-app")
+    publisher.connect(args.broker, args.port, keepalive=60)
+    publisher.loop_start()
+
+    stop = threading.Event()
+
+    def ticker():
+        while not stop.is_set():
+            for dev in devices:
+                dev.step_sensors()
+                dev.heartbeat()
+            stop.wait(args.interval)
+
+    threading.Thread(target=ticker, daemon=True).start()
+    time.sleep(args.interval * 3)
+
+    convergence: List[float] = []
+    lost = 0
+    commands = 0
+    window_bytes: List[int] = []
+    try:
+        for cycle in range(args.cycles):
+            command = "OPEN" if cycle % 2 == 0 else "CLOSE"
+            target = COMMAND_TO_MODE[command]
+
+            for dev in devices:
+                dev.disconnect()
+            time.sleep(args.outage_s / 2)
+            for dev in devices:
+                send_command(args, publisher, dev, command)
+                commands += 1
+            time.sleep(args.outage_s / 2)
+
+            reconnected_at: Dict[str, float] = {}
+            for dev in devices:
+                with dev.lock:
+                    dev.window_bytes = 0
+                    dev.in_window = True
+                dev.connect()
+                reconnected_at[dev.device_id] = time.perf_counter()
+
+            waiting = set(reconnected_at)
+            deadline = time.perf_counter() + args.timeout
+            while waiting and time.perf_counter() < deadline:
+                for dev in devices:
+                    if dev.device_id in waiting and converged(args, dev, target):
+                        convergence.append(time.perf_counter() - reconnected_at[dev.device_id])
+                        waiting.discard(dev.device_id)
+                time.sleep(0.02)
+            lost += len(waiting)
+
+            time.sleep(args.interval)
+            for dev in devices:
+                with dev.lock:
+                    dev.in_window = False
+                    window_bytes.append(dev.window_bytes)
+            print(f"[SHADOW] ciclo {cycle + 1}/{args.cycles}: {command} -> "
+                  f"{len(devices) - len(waiting)}/{len(devices)} convergiram")
+    finally:
+        stop.set()
+        for dev in devices:
+            dev.disconnect()
+            if dev.shadow:
+                publisher.publish(dev.topic_desired, b"", qos=1, retain=True)  # limpa o retido
+        time.sleep(0.2)
+        publisher.loop_stop()
+        publisher.disconnect()
+
+    total_out = sum(dev.bytes_out for dev in devices)
+    total_in = sum(dev.bytes_in for dev in devices)
+    reports = sum(dev.reports for dev in devices)
+    avg_window = sum(window_bytes) / len(window_bytes) if window_bytes else 0.0
+    print(f"[SHADOW] modo={args.mode} varais={args.devices} ciclos={args.cycles}")
+    print(f"[SHADOW] comandos perdidos : {lost}/{commands}")
+    print(f"[SHADOW] convergência      : {percentiles(convergence)}")
+    print(f"[SHADOW] bytes varal->nuvem: {total_out} ({total_out / max(1, reports):.0f} por heartbeat)")
+    print(f"[SHADOW] bytes nuvem->varal: {total_in}")
+    print(f"[SHADOW] bytes na reconexão: {avg_window:.0f} por varal (média)")
+    return 1 if args.max_lost is not None and lost > args.max_lost else 0
+
+
+def parse_args(argv: Optional[List[str]] = None):
+    p = argparse.ArgumentParser(description="Estado desejado/reportado x comandos crus, com quedas.")
+    p.add_argument("--mode", choices=("shadow", "legacy"), default="shadow")
+    p.add_argument("--devices", type=int, default=10)
+    p.add_argument("--cycles", type=int, default=5, help="quedas (com um comando durante cada)")
+    p.add_argument("--outage-s", type=float, default=2.0, help="duração de cada queda")
+    p.add_argument("--interval", type=float, default=0.5, help="intervalo do heartbeat simulado (s)")
+    p.add_argument("--full-every", type=int, default=10, help="relatório completo a cada N (shadow)")
+    p.add_argument("--timeout", type=float, default=5.0, help="espera máxima pela convergência")
+    p.add_argument("--max-lost", type=int, help="falha (código 1) se perder mais que isso")
+    p.add_argument("--broker", default="localhost")
+    p.add_argument("--port", type=int, default=1883)
+    p.add_argument("--backend-url", default="http://localhost:8000")
+    p.add_argument("--seed", type=int, default=1)
+    return p.parse_args(argv)
+
+
+def main(argv: Optional[List[str]] = None) -> None:
+    raise SystemExit(run(parse_args(argv)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,118 @@
+"""
+Mede a latência de fan-out do stream WebSocket (/devices/{id}/ws).
+
+Abre N clientes WebSocket no backend, publica heartbeats falsos direto no
+broker (casa/<id>/heartbeat) e mede, em cada cliente, o tempo entre o
+publish e a chegada do evento. O backend precisa estar apontando para o
+mesmo broker local (AWS_IOT_ENDPOINT=localhost, AWS_IOT_PORT=1883,
+AWS_IOT_USE_TLS=false).
+
+Exemplo:
+    python -m tools.stream_fanout --clients 500 --messages 50 --backend-url http://localhost:8000
+"""
+
+import argparse
+import asyncio
+import json
+import time
+from typing import Dict, List
+
+import paho.mqtt.client as mqtt
+import websockets
+
+from tools.swarm_sim import new_client, percentiles
+
+
+def _settled(counter: Dict[str, int], total: int, ready: asyncio.Event) -> None:
+    if counter["connected"] + counter["failed"] == total:
+        ready.set()
+
+
+async def run_client(url: str, sent_at: Dict[int, float], latencies: List[float], ready: asyncio.Event,
+                     counter: Dict[str, int], errors: List[str], total: int, done: asyncio.Event) -> None:
+    try:
+        ws = await websockets.connect(url, max_queue=None)
+    except (OSError, asyncio.TimeoutError, websockets.WebSocketException) as e:
+        # Conexão recusada conta como falha (não trava a espera pelos outros)
+        counter["failed"] += 1
+        errors.append(f"{type(e).__name__}: {e}")
+        _settled(counter, total, ready)
+        return
+    async with ws:
+        counter["connected"] += 1
+        _settled(counter, total, ready)
+        while not done.is_set():
+            try:
+                raw = await asyncio.wait_for(ws.recv(), timeout=1.0)
+            except asyncio.TimeoutError:
+                continue
+            event = json.loads(raw)
+            if event.get("type") != "heartbeat":
+                continue
+            seq = event["data"].get("uptime_ms")
+            t0 = sent_at.get(seq)
+            if t0 is not None:
+                latencies.append(time.monotonic() - t0)
+
+
+async def main_async(args) -> None:
+    url = f"{args.backend_url.rstrip('/').replace('http', 'ws', 1)}/devices/{args.device_id}/ws"
+    sent_at: Dict[int, float] = {}
+    latencies: List[float] = []
+    ready, done = asyncio.Event(), asyncio.Event()
+    counter = {"connected": 0, "failed": 0}
+    errors: List[str] = []
+
+    tasks = [
+        asyncio.create_task(run_client(url, sent_at, latencies, ready, counter, errors, args.clients, done))
+        for _ in range(args.clients)
+    ]
+    try:
+        await asyncio.wait_for(ready.wait(), timeout=60)
+    except asyncio.TimeoutError:
+        pass
+    pending = args.clients - counter["connected"] - counter["failed"]
+    print(f"[FANOUT] {counter['connected']}/{args.clients} clientes conectados em {url} "
+          f"({counter['failed']} falharam, {pending} sem resposta em 60 s)")
+    for error in sorted(set(errors))[:5]:
+        print(f"[FANOUT]   {error}")
+    if counter["connected"] == 0:
+        done.set()
+        await asyncio.gather(*tasks, return_exceptions=True)
+        return
+
+    pub = new_client(f"fanout-{time.time_ns()}")
+    pub.connect(args.broker, args.port, keepalive=60)
+    pub.loop_start()
+    topic = f"casa/{args.device_id}/heartbeat"
+
+    for seq in range(1, args.messages + 1):
+        sent_at[seq] = time.monotonic()
+        pub.publish(topic, json.dumps({"mode": "AUTO", "rain": False, "uptime_ms": seq}))
+        await asyncio.sleep(args.interval)
+
+    await asyncio.sleep(2.0)
+    done.set()
+    await asyncio.gather(*tasks, return_exceptions=True)
+    pub.loop_stop()
+    pub.disconnect()
+
+    expected = counter["connected"] * args.messages
+    print(f"[FANOUT] entregues {len(latencies)}/{expected}")
+    print(f"[FANOUT] latência publish -> cliente: {percentiles(latencies)}")
+
+
+def main() -> None:
+    p = argparse.ArgumentParser(description="Latência de fan-out do stream WebSocket.")
+    p.add_argument("--clients", type=int, default=200)
+    p.add_argument("--messages", type=int, default=20)
+    p.add_argument("--interval", type=float, default=0.2, help="segundos entre heartbeats")
+    p.add_argument("--device-id", default="fanout-test")
+    p.add_argument("--backend-url", default="http://localhost:8000")
+    p.add_argument("--broker", default="localhost")
+    p.add_argument("--port", type=int, default=1883)
+    asyncio.run(main_async(p.parse_args()))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,462 @@
+"""
+Simulador de enxame de varais (gerador de carga para broker + backend).
+
+Cria N varais virtuais num único processo. Cada um reproduz a lógica do
+firmware (sensor de chuva com os mesmos thresholds de computeRainLevel(),
+controlador AUTO/FORCE_OPEN/FORCE_CLOSE, estado desejado versionado em
+casa/<id>/desired como desired_state.cpp e o heartbeat com "rv"/"dv") e
+fala MQTT com o broker local nos tópicos casa/<id>/...
+
+A reimplementação pode se afastar do firmware; o varal_swarm do
+IOT_Device/host (README de lá) roda o firmware de verdade com as mesmas
+métricas.
+
+Em vez de uma thread por dispositivo, um pool pequeno de workers atende
+todos os sockets via selectors (epoll), usando os ganchos de socket do
+paho-mqtt para integrar o cliente a um event loop externo.
+
+Métricas reportadas:
+- taxa de publicação (heartbeats/s)
+- round-trip de comando: nova versão do desejado (PUT /devices/{id}/desired
+  com --backend-url, senão publicada direto em casa/<id>/desired) ->
+  heartbeat com "dv" >= essa versão (vale também para AUTO -> AUTO)
+- atraso de ingestão no backend (received_at - instante do publish),
+  amostrando GET /devices/{id}/heartbeat quando --backend-url é informado
+
+Exemplo:
+    python -m tools.swarm_sim --devices 5000 --workers 4 \\
+        --heartbeat-interval 5 --cmd-rate 20 --backend-url http://localhost:8000
+
+Para dezenas de milhares de dispositivos aumente o limite de descritores
+(ulimit -n) e o max_connections do broker.
+"""
+
+import argparse
+import json
+import random
+import selectors
+import threading
+import time
+import urllib.request
+from typing import Dict, List, Optional, Tuple
+
+import paho.mqtt.client as mqtt
+
+
+# =========================================
+# LÓGICA DO FIRMWARE (espelho de rain_sensor.cpp / varal_controller.cpp)
+# =========================================
+
+RAIN_NONE, RAIN_LIGHT, RAIN_MODERATE, RAIN_HEAVY = range(4)
+
+DECISION_INTERVAL_S = 2.0
+RAIN_READ_INTERVAL_S = 1.0
+
+
+def compute_rain_level(analog_raw: int) -> int:
+    """Mesmos thresholds de computeRainLevel() no firmware."""
+    inverted = 4095 - analog_raw
+    if inverted < 300:
+        return RAIN_NONE
+    if inverted < 1200:
+        return RAIN_LIGHT
+    if inverted < 2400:
+        return RAIN_MODERATE
+    return RAIN_HEAVY
+
+
+def new_client(client_id: str) -> mqtt.Client:
+    if hasattr(mqtt, "CallbackAPIVersion"):
+        return mqtt.Client(mqtt.CallbackAPIVersion.VERSION2, client_id=client_id)
+    return mqtt.Client(client_id=client_id)
+
+
+class VirtualVaral:
+    """Um varal simulado: sensores, controlador e cliente MQTT."""
+
+    def __init__(self, device_id: str, rng: random.Random, started_at: float) -> None:
+        self.device_id = device_id
+        self.rng = rng
+        self.boot = started_at
+
+        self.topic_heartbeat = f"casa/{device_id}/heartbeat"
+        self.topic_status = f"casa/{device_id}/status"
+        self.topic_cmd = f"casa/{device_id}/cmd"
+        self.topic_desired = f"casa/{device_id}/desired"
+
+        # Sensores simulados (passeio aleatório)
+        self.analog = 4095
+        self.temp_c = rng.uniform(18.0, 30.0)
+        self.humidity = rng.uniform(40.0, 70.0)
+        self.rain_level = RAIN_NONE
+
+        # Controlador + estado desejado aplicado ("dv") e relatórios ("rv")
+        self.mode = "AUTO"
+        self.state = "FECHADO"
+        self.dv = 0
+        self.rv = 0
+        self.heartbeat_s: Optional[float] = None  # "hb_s" do desejado
+
+        self.next_rain_read = started_at
+        self.next_decision = started_at
+        self.next_heartbeat = started_at + rng.uniform(0.0, 1.0)
+
+        self.client = new_client(device_id)
+        self.client.on_message = self._on_message
+        self.client.on_connect = self._on_connect
+        self.published = 0
+        self.sent_at: Dict[int, float] = {}  # uptime_ms -> instante do publish
+
+    # ---------- MQTT ----------
+
+    def _on_connect(self, client, userdata, flags, rc, properties=None):
+        if rc == 0:
+            client.subscribe(self.topic_cmd)
+            client.subscribe(self.topic_desired, qos=1)
+            client.publish(self.topic_status, "online")
+
+    def _on_message(self, client, userdata, msg):
+        if msg.topic == self.topic_desired:
+            try:
+                doc = json.loads(msg.payload) if msg.payload else None
+            except ValueError:
+                return
+            # Como desired_state.cpp: só versão mais nova que a aplicada
+            if isinstance(doc, dict) and isinstance(doc.get("v"), int) and doc["v"] > self.dv:
+                self.apply_desired(doc)
+                self.publish_heartbeat(time.time())
+            return
+        # Tópico de controle: só o pedido de relatório completo
+        if msg.payload.decode("utf-8", errors="ignore").strip().upper() == "SYNC":
+            self.publish_heartbeat(time.time())
+
+    def apply_desired(self, doc: Dict) -> None:
+        self.dv = doc["v"]
+        if doc.get("mode") in ("AUTO", "FORCE_OPEN", "FORCE_CLOSE"):
+            self.mode = doc["mode"]
+        if isinstance(doc.get("hb_s"), int):
+            self.heartbeat_s = float(doc["hb_s"])
+
+    def publish_heartbeat(self, now: float) -> None:
+        uptime_ms = int((now - self.boot) * 1000)
+        self.rv += 1
+        payload = {
+            "rv": self.rv,
+            "dv": self.dv,
+            "full": True,
+            "temp_c": round(self.temp_c, 1),
+            "humidity": round(self.humidity, 1),
+            "rain": self.rain_level != RAIN_NONE,
+            "mode": self.mode,
+            "uptime_ms": uptime_ms,
+        }
+        self.client.publish(self.topic_heartbeat, json.dumps(payload, separators=(",", ":")))
+        self.published += 1
+        self.sent_at = {uptime_ms: now}
+
+    # ---------- Simulação ----------
+
+    def tick(self, now: float, heartbeat_interval: float) -> None:
+        if now >= self.next_rain_read:
+            self.next_rain_read = now + RAIN_READ_INTERVAL_S
+            self.analog = max(0, min(4095, self.analog + self.rng.randint(-60, 50)))
+            if self.rng.random() < 0.001:
+                self.analog = self.rng.choice((4095, 2500, 800))  # frente de chuva
+            self.rain_level = compute_rain_level(self.analog)
+            self.temp_c += self.rng.uniform(-0.05, 0.05)
+            self.humidity = max(0.0, min(100.0, self.humidity + self.rng.uniform(-0.2, 0.2)))
+
+        if now >= self.next_decision:
+            self.next_decision = now + DECISION_INTERVAL_S
+            self.decide()
+
+        if now >= self.next_heartbeat:
+            self.next_heartbeat = now + (self.heartbeat_s or heartbeat_interval)
+            self.publish_heartbeat(now)
+
+    def decide(self) -> None:
+        if self.mode == "AUTO":
+            self.state = "FECHADO" if self.rain_level != RAIN_NONE else "ABERTO"
+        elif self.mode == "FORCE_OPEN":
+            self.state = "ABERTO"
+        else:
+            self.state = "FECHADO"
+
+
+# =========================================
+# WORKER (event loop com selectors)
+# =========================================
+
+class Worker(threading.Thread):
+    """Atende um pedaço do enxame num único event loop."""
+
+    def __init__(self, index: int, devices: List[VirtualVaral], args) -> None:
+        super().__init__(name=f"swarm-worker-{index}", daemon=True)
+        self.devices = devices
+        self.args = args
+        self.selector = selectors.DefaultSelector()
+        self.running = True
+        self.connected = 0
+
+    def _watch(self, client: mqtt.Client, sock, events: int) -> None:
+        if not self.running:
+            return  # encerrando: o paho ainda mexe nos sockets ao ser coletado
+        try:
+            self.selector.modify(sock, events, client)
+        except KeyError:
+            self.selector.register(sock, events, client)
+
+    def _hook(self, dev: VirtualVaral) -> None:
+        c = dev.client
+        c.on_socket_open = lambda client, userdata, sock: self._watch(client, sock, selectors.EVENT_READ)
+        c.on_socket_close = lambda client, userdata, sock: self._unwatch(sock)
+        c.on_socket_register_write = lambda client, userdata, sock: self._watch(
+            client, sock, selectors.EVENT_READ | selectors.EVENT_WRITE)
+        c.on_socket_unregister_write = lambda client, userdata, sock: self._watch(
+            client, sock, selectors.EVENT_READ)
+
+    def _unwatch(self, sock) -> None:
+        try:
+            self.selector.unregister(sock)
+        except (KeyError, ValueError):
+            pass
+
+    def run(self) -> None:
+        for dev in self.devices:
+            self._hook(dev)
+            try:
+                dev.client.connect(self.args.broker, self.args.port, keepalive=60)
+                self.connected += 1
+            except OSError as e:
+                print(f"[SWARM] {dev.device_id}: falha ao conectar ({e})")
+
+        next_misc = time.monotonic()
+        while self.running:
+            for key, events in self.selector.select(timeout=0.05):
+                client = key.data
+                if events & selectors.EVENT_READ:
+                    client.loop_read()
+                if events & selectors.EVENT_WRITE:
+                    client.loop_write()
+
+            now = time.time()
+            for dev in self.devices:
+                dev.tick(now, self.args.heartbeat_interval)
+
+            if time.monotonic() >= next_misc:
+                next_misc = time.monotonic() + 1.0
+                for dev in self.devices:
+                    dev.client.loop_misc()
+
+        for dev in self.devices:
+            dev.client.disconnect()
+        self.selector.close()
+
+
+# =========================================
+# MEDIÇÕES
+# =========================================
+
+class CommandProbe:
+    """
+    Muda o modo desejado de varais sorteados e mede o tempo até o heartbeat
+    que reporta a versão nova ("dv" >= versão do comando). O modo não serve
+    de marca: AUTO pedido a um varal em AUTO casaria com qualquer heartbeat.
+    """
+
+    MODES = {"OPEN": "FORCE_OPEN", "CLOSE": "FORCE_CLOSE", "AUTO": "AUTO"}
+
+    def __init__(self, args, device_ids: List[str]) -> None:
+        self.args = args
+        self.device_ids = device_ids
+        self.pending: Dict[str, Tuple[int, float]] = {}  # device_id -> (versão, início)
+        self.last_dv: Dict[str, int] = {}
+        self.failures = 0
+        self.rtts: List[float] = []
+        self.lock = threading.Lock()
+        self.client = new_client(f"swarm-probe-{random.randint(0, 1 << 30)}")
+        self.client.on_connect = lambda c, u, f, rc, props=None: c.subscribe("casa/+/heartbeat")
+        self.client.on_message = self._on_message
+
+    def start(self) -> None:
+        self.client.connect(self.args.broker, self.args.port, keepalive=60)
+        self.client.loop_start()
+
+    def stop(self) -> None:
+        self.client.loop_stop()
+        self.client.disconnect()
+
+    def send_random(self) -> None:
+        device_id = random.choice(self.device_ids)
+        mode = self.MODES[random.choice(tuple(self.MODES))]
+        started = time.monotonic()
+        if self.args.backend_url:
+            # Caminho real: o backend cria a versão e publica o desejado retido
+            try:
+                version = desired_via_backend(self.args.backend_url, device_id, mode)
+            except (OSError, ValueError):
+                self.failures += 1
+                return
+        else:
+            with self.lock:
+                version = self.last_dv.get(device_id, 0) + 1
+            doc = json.dumps({"v": version, "mode": mode}, separators=(",", ":"))
+            self.client.publish(f"casa/{device_id}/desired", doc, qos=1)
+        with self.lock:
+            if self.last_dv.get(device_id, 0) >= version:  # heartbeat chegou antes da resposta HTTP
+                self.rtts.append(time.monotonic() - started)
+            else:
+                self.pending[device_id] = (version, started)
+
+    def _on_message(self, client, userdata, msg):
+        device_id = msg.topic.split("/")[1]
+        try:
+            dv = json.loads(msg.payload).get("dv")
+        except ValueError:
+            return
+        if not isinstance(dv, int):
+            return
+        with self.lock:
+            self.last_dv[device_id] = max(dv, self.last_dv.get(device_id, 0))
+            pending = self.pending.get(device_id)
+            if pending is not None and dv >= pending[0]:
+                self.rtts.append(time.monotonic() - pending[1])
+                del self.pending[device_id]
+
+    def drain(self) -> List[float]:
+        with self.lock:
+            out, self.rtts = self.rtts, []
+        return out
+
+
+def desired_via_backend(backend_url: str, device_id: str, mode: str) -> int:
+    """PUT /devices/{id}/desired; retorna a versão criada."""
+    req = urllib.request.Request(
+        f"{backend_url.rstrip('/')}/devices/{device_id}/desired",
+        data=json.dumps({"mode": mode}).encode(), method="PUT",
+        headers={"Content-Type": "application/json"},
+    )
+    with urllib.request.urlopen(req, timeout=5) as resp:
+        return int(json.loads(resp.read())["version"])
+
+
+def sample_ingest_lag(backend_url: str, devices: List[VirtualVaral], samples: int) -> List[float]:
+    """received_at do backend menos o instante em que o heartbeat saiu."""
+    lags: List[float] = []
+    for dev in random.sample(devices, min(samples, len(devices))):
+        url = f"{backend_url.rstrip('/')}/devices/{dev.device_id}/heartbeat"
+        try:
+            with urllib.request.urlopen(url, timeout=2) as resp:
+                hb = json.loads(resp.read())
+        except (OSError, ValueError):
+            continue
+        sent = dev.sent_at.get(hb.get("uptime_ms"))
+        if sent is not None and hb.get("received_at"):
+            lags.append(hb["received_at"] - sent)
+    return lags
+
+
+def percentiles(values: List[float]) -> str:
+    if not values:
+        return "—"
+    values = sorted(values)
+
+    def pick(p: float) -> float:
+        return values[min(len(values) - 1, int(p * len(values)))] * 1000.0
+
+    return f"p50={pick(0.50):.1f}ms p95={pick(0.95):.1f}ms p99={pick(0.99):.1f}ms (n={len(values)})"
+
+
+# =========================================
+# MAIN
+# =========================================
+
+def parse_args(argv: Optional[List[str]] = None):
+    p = argparse.ArgumentParser(description="Simulador de enxame de varais (MQTT).")
+    p.add_argument("--devices", type=int, default=500)
+    p.add_argument("--workers", type=int, default=4)
+    p.add_argument("--broker", default="localhost")
+    p.add_argument("--port", type=int, default=1883)
+    p.add_argument("--prefix", default="sim-")
+    p.add_argument("--heartbeat-interval", type=float, default=30.0, help="segundos (firmware: 30)")
+    p.add_argument("--duration", type=float, default=60.0, help="segundos")
+    p.add_argument("--cmd-rate", type=float, default=5.0, help="comandos/s para medir round-trip")
+    p.add_argument("--backend-url", default=None, help="ex: http://localhost:8000")
+    p.add_argument("--report-interval", type=float, default=5.0)
+    p.add_argument("--seed", type=int, default=1)
+    args = p.parse_args(argv)
+    # Pelo menos um worker e nunca mais workers que varais (fatia vazia)
+    args.workers = max(1, min(args.workers, args.devices))
+    return args
+
+
+def main(argv: Optional[List[str]] = None) -> None:
+    args = parse_args(argv)
+    rng = random.Random(args.seed)
+    started = time.time()
+
+    devices = [
+        VirtualVaral(f"{args.prefix}{i:06d}", random.Random(rng.random()), started)
+        for i in range(args.devices)
+    ]
+    workers = [Worker(i, devices[i::args.workers], args) for i in range(args.workers)]
+
+    probe = CommandProbe(args, [d.device_id for d in devices])
+    probe.start()
+    for w in workers:
+        w.start()
+
+    print(f"[SWARM] {args.devices} varais em {len(workers)} workers -> {args.broker}:{args.port}")
+
+    all_rtts: List[float] = []
+    all_lags: List[float] = []
+    t0 = time.monotonic()
+    last_report = t0
+    last_published = 0
+    next_cmd = t0
+
+    try:
+        while time.monotonic() - t0 < args.duration:
+            now = time.monotonic()
+            if args.cmd_rate > 0 and now >= next_cmd:
+                next_cmd = now + 1.0 / args.cmd_rate
+                probe.send_random()
+
+            if now - last_report >= args.report_interval:
+                published = sum(d.published for d in devices)
+                rate = (published - last_published) / (now - last_report)
+                last_published, last_report = published, now
+
+                rtts = probe.drain()
+                all_rtts.extend(rtts)
+                lags: List[float] = []
+                if args.backend_url:
+                    lags = sample_ingest_lag(args.backend_url, devices, 20)
+                    all_lags.extend(lags)
+
+                connected = sum(w.connected for w in workers)
+                print(f"[SWARM] conectados={connected} pub={rate:.0f} msg/s | "
+                      f"cmd RTT {percentiles(rtts)} | ingest lag {percentiles(lags)}")
+
+            time.sleep(0.005)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        for w in workers:
+            w.running = False
+        for w in workers:
+            w.join(timeout=5)
+        probe.stop()
+
+    elapsed = time.monotonic() - t0
+    total = sum(d.published for d in devices)
+    all_rtts.extend(probe.drain())
+    print("[SWARM] ===== Resumo =====")
+    print(f"[SWARM] heartbeats publicados: {total} ({total / elapsed:.0f} msg/s)")
+    print(f"[SWARM] round-trip de comando: {percentiles(all_rtts)} "
+          f"({len(probe.pending)} sem resposta, {probe.failures} recusados pelo backend)")
+    print(f"[SWARM] atraso de ingestão:    {percentiles(all_lags)}")
+
+
+if __name__ == "__main__":
+    main()
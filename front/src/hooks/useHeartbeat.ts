@@ -1,6 +1,6 @@
 import { useCallback, useEffect, useMemo, useRef, useState } from 'react';
 
-import { fetchHeartbeat, Heartbeat } from '../services/api';
+import { fetchHeartbeat, Heartbeat, openDeviceStream, resolveDeviceId } from '../services/api';
 
 type ConnectionState = 'connecting' | 'online' | 'stale' | 'offline';
 
@@ -11,15 +11,20 @@ interface UseHeartbeatResult {
   refresh: () => Promise<void>;
   lastUpdatedLabel: string;
   connectionState: ConnectionState;
+  streaming: boolean;
 }
 
+// Polling só entra como fallback quando o stream WebSocket está fora
 const REFRESH_MS = 10_000;
 const STALE_HEARTBEAT_MS = 60_000;
+const STREAM_RETRY_MIN_MS = 2_000;
+const STREAM_RETRY_MAX_MS = 30_000;
 
 export function useHeartbeat(autoRefresh = true): UseHeartbeatResult {
   const [data, setData] = useState<Heartbeat | null>(null);
   const [loading, setLoading] = useState<boolean>(true);
   const [error, setError] = useState<string | null>(null);
+  const [streaming, setStreaming] = useState<boolean>(false);
   const abortController = useRef<AbortController | null>(null);
 
   const refresh = useCallback(async () => {
@@ -50,9 +55,60 @@ export function useHeartbeat(autoRefresh = true): UseHeartbeatResult {
 
   useEffect(() => {
     if (!autoRefresh) return undefined;
+
+    let cancelled = false;
+    let closeStream: (() => void) | null = null;
+    let retryTimer: ReturnType<typeof setTimeout> | null = null;
+    let retryMs = STREAM_RETRY_MIN_MS;
+
+    const scheduleReconnect = () => {
+      if (cancelled) return;
+      retryTimer = setTimeout(connect, retryMs);
+      retryMs = Math.min(retryMs * 2, STREAM_RETRY_MAX_MS);
+    };
+
+    async function connect() {
+      retryTimer = null;
+      try {
+        const deviceId = await resolveDeviceId();
+        if (cancelled) return;
+        closeStream = openDeviceStream(deviceId, {
+          onOpen: () => {
+            retryMs = STREAM_RETRY_MIN_MS;
+            setStreaming(true);
+            setError(null);
+          },
+          onEvent: (event) => {
+            if (event.type === 'heartbeat') {
+              setData(event.data);
+              setLoading(false);
+            }
+          },
+          onClose: () => {
+            closeStream = null;
+            setStreaming(false);
+            scheduleReconnect();
+          },
+        });
+      } catch {
+        scheduleReconnect();
+      }
+    }
+
+    connect();
+    return () => {
+      cancelled = true;
+      if (retryTimer) clearTimeout(retryTimer);
+      closeStream?.();
+      setStreaming(false);
+    };
+  }, [autoRefresh]);
+
+  useEffect(() => {
+    if (!autoRefresh || streaming) return undefined;
     const interval = setInterval(refresh, REFRESH_MS);
     return () => clearInterval(interval);
-  }, [autoRefresh, refresh]);
+  }, [autoRefresh, refresh, streaming]);
 
   const lastUpdatedLabel = useMemo(() => {
     if (!data?.received_at) {
@@ -92,5 +148,6 @@ export function useHeartbeat(autoRefresh = true): UseHeartbeatResult {
     refresh,
     lastUpdatedLabel,
     connectionState,
+    streaming,
   };
 }
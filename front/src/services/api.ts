@@ -4,17 +4,39 @@ export type VaralMode = 'AUTO' | 'FORCE_OPEN' | 'FORCE_CLOSE';
 export type Command = 'AUTO' | 'OPEN' | 'CLOSE';
 
 export interface Heartbeat {
+  device_id?: string | null;
   temp_c?: number | null;
   humidity?: number | null;
   rain?: boolean | null;
+  rain_likely?: boolean | null;
   mode?: VaralMode | null;
   uptime_ms?: number | null;
   received_at?: number | null;
 }
 
-const extra = (Constants.expoConfig?.extra ?? {}) as { apiBaseUrl?: string };
+const extra = (Constants.expoConfig?.extra ?? {}) as { apiBaseUrl?: string; deviceId?: string };
 const envBaseUrl = typeof process !== 'undefined' ? process.env?.EXPO_PUBLIC_API_URL : undefined;
+const envDeviceId = typeof process !== 'undefined' ? process.env?.EXPO_PUBLIC_DEVICE_ID : undefined;
 const API_BASE_URL = extra.apiBaseUrl ?? envBaseUrl ?? 'http://35.171.203.111:8000';
+const CONFIGURED_DEVICE_ID = extra.deviceId ?? envDeviceId ?? null;
+
+let resolvedDeviceId: string | null = CONFIGURED_DEVICE_ID;
+
+function apiUrl(path: string): string {
+  return `${API_BASE_URL.replace(/\/$/, '')}${path}`;
+}
+
+export type StreamEvent =
+  | { type: 'heartbeat'; device_id: string; data: Heartbeat; dropped?: number }
+  | { type: 'command'; device_id: string; command: Command; sent_at: number; dropped?: number }
+  | { type: 'ack'; device_id: string; command: Command; latency_s: number; dropped?: number }
+  | { type: 'ping'; dropped?: number };
+
+interface StreamHandlers {
+  onOpen: () => void;
+  onEvent: (event: StreamEvent) => void;
+  onClose: () => void;
+}
 
 async function parseJson<T>(response: Response): Promise<T> {
   const text = await response.text();
@@ -26,8 +48,36 @@ async function parseJson<T>(response: Response): Promise<T> {
   }
 }
 
+export async function fetchDevices(signal?: AbortSignal): Promise<Heartbeat[]> {
+  const response = await fetch(apiUrl('/devices/'), { signal });
+
+  if (!response.ok) {
+    throw new Error('Não foi possível listar os varais.');
+  }
+
+  return parseJson<Heartbeat[]>(response);
+}
+
+// Usa o varal configurado (extra.deviceId / EXPO_PUBLIC_DEVICE_ID) ou,
+// na falta dele, o primeiro dispositivo que o backend conhece.
+export async function resolveDeviceId(signal?: AbortSignal): Promise<string> {
+  if (resolvedDeviceId) {
+    return resolvedDeviceId;
+  }
+
+  const devices = await fetchDevices(signal);
+  const first = devices.find((device) => Boolean(device.device_id));
+  if (!first?.device_id) {
+    throw new Error('Nenhum varal conectado ao backend.');
+  }
+
+  resolvedDeviceId = first.device_id;
+  return resolvedDeviceId;
+}
+
 export async function fetchHeartbeat(signal?: AbortSignal): Promise<Heartbeat> {
-  const endpoint = `${API_BASE_URL.replace(/\/$/, '')}/heartbeat/`;
+  const deviceId = await resolveDeviceId(signal);
+  const endpoint = apiUrl(`/devices/${encodeURIComponent(deviceId)}/heartbeat`);
   const response = await fetch(endpoint, { signal });
 
   if (!response.ok) {
@@ -38,7 +88,8 @@ export async function fetchHeartbeat(signal?: AbortSignal): Promise<Heartbeat> {
 }
 
 export async function sendCommand(command: Command): Promise<void> {
-  const endpoint = `${API_BASE_URL.replace(/\/$/, '')}/cmd/`;
+  const deviceId = await resolveDeviceId();
+  const endpoint = apiUrl(`/devices/${encodeURIComponent(deviceId)}/cmd`);
   const response = await fetch(endpoint, {
     method: 'POST',
     headers: { 'Content-Type': 'application/json' },
@@ -63,3 +114,31 @@ export async function sendCommand(command: Command): Promise<void> {
     throw new Error(errorBody || 'Não foi possível enviar o comando.');
   }
 }
+
+// Abre o stream WebSocket do varal. Retorna a função que fecha a conexão.
+export function openDeviceStream(deviceId: string, handlers: StreamHandlers): () => void {
+  const url = apiUrl(`/devices/${encodeURIComponent(deviceId)}/ws`).replace(/^http/, 'ws');
+  const socket = new WebSocket(url);
+  let closed = false;
+
+  socket.onopen = () => handlers.onOpen();
+  socket.onmessage = (message) => {
+    try {
+      handlers.onEvent(JSON.parse(String(message.data)) as StreamEvent);
+    } catch (error) {
+      console.warn('Evento inválido no stream', error);
+    }
+  };
+  socket.onerror = () => socket.close();
+  socket.onclose = () => {
+    if (!closed) {
+      closed = true;
+      handlers.onClose();
+    }
+  };
+
+  return () => {
+    closed = true;
+    socket.close();
+  };
+}
@@ -1,5 +1,6 @@
 declare const process: {
   env?: {
     EXPO_PUBLIC_API_URL?: string;
+    EXPO_PUBLIC_DEVICE_ID?: string;
   };
 };